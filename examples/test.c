@@ -1,5 +1,7 @@
 #include "test.h"
 
+#if !defined(TEST_HEADLESS)
+
 static int testW = 0;
 static int testH = 0;
 
@@ -10,9 +12,12 @@ static int fps = 0;
 static int fpsdraw = 0;
 static char *overtext = NULL;
 static float overcolor[4] = {0,0,0,1};
+static int coreprofile = 0;
 
 static CallbackFunc callbacks[TEST_CALLBACK_COUNT];
 
+#endif
+
 VGPath testCreatePath()
 {
   return vgCreatePath(VG_PATH_FORMAT_STANDARD, VG_PATH_DATATYPE_F,
@@ -115,6 +120,10 @@ void testClosePath(VGPath p)
   vgAppendPathData(p, 1, &seg, &data);
 }
 
+/* The window and main loop below are replaced by the ones
+   of test_golden.c in headless builds */
+#if !defined(TEST_HEADLESS)
+
 void testOverlayColor(float r, float g, float b, float a)
 {
   overcolor[0] = r;
@@ -142,6 +151,10 @@ void testOverlayString(const char *format, ...)
   va_start(ap, format);
   vsnprintf(overtext, len+1, format, ap);
   va_end(ap);
+  
+  /* No overlay to show it in with a core profile */
+  if (coreprofile)
+    printf("%s\n", overtext);
 }
 
 void testDrawString(float x, float y, const char *format, ...)
@@ -215,16 +228,21 @@ void testDisplay(void)
   if (callback)
     (*callback)(interval);
   
-  /* Draw overlay text */
-  if (overtext != NULL) {
+  /* Make sure deferred drawing reaches GL before the overlay */
+  vgFlush();
+  
+  /* Draw overlay text and fps, which need the fixed-function
+     pipeline a core profile doesn't have */
+  if (!coreprofile) {
+    if (overtext != NULL) {
+      glColor4fv(overcolor);
+      testDrawString(10, testHeight()-25, overtext);
+    }
+    
     glColor4fv(overcolor);
-    testDrawString(10, testHeight()-25, overtext);
+    testDrawString(10, 10, "FPS: %d", fpsdraw);
   }
   
-  /* Draw fps */
-  glColor4fv(overcolor);
-  testDrawString(10, 10, "FPS: %d", fpsdraw);
-  
   /* Swap */
   glutSwapBuffers();
   
@@ -236,6 +254,8 @@ void testDisplay(void)
       lastfps = now;
       fpsdraw = fps;
       fps = 0;
+      if (coreprofile)
+        printf("FPS: %d\n", fpsdraw);
     }
   }else{
     lastfps = now;
@@ -342,6 +362,18 @@ void testInit(int argc, char **argv,
   int i;
   glutInit(&argc, argv);
   
+  /* -core draws with the OpenGL 3.3 core profile renderer */
+  for (i=1; i<argc; ++i)
+    if (strcmp(argv[i], "-core") == 0)
+      coreprofile = 1;
+  
+  #if defined(GLUT_CORE_PROFILE)
+  if (coreprofile) {
+    glutInitContextVersion(3, 3);
+    glutInitContextProfile(GLUT_CORE_PROFILE);
+  }
+  #endif
+  
   #if defined(__APPLE__) || defined(WIN32)
   /*glutInitDisplayString("rgba alpha double stencil samples=4");*/
   glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_ALPHA |
@@ -365,7 +397,12 @@ void testInit(int argc, char **argv,
   glutPassiveMotionFunc(testMove);
   atexit(testCleanup);
   
-  vgCreateContextSH(w,h);
+  if (coreprofile) {
+    if (!vgCreateCoreContextSH(w,h)) {
+      printf("OpenGL 3.3 is required for -core\n");
+      exit(1);
+    }
+  }else vgCreateContextSH(w,h);
   
   testW = w;
   testH = h;
@@ -378,3 +415,5 @@ void testRun()
 {
   glutMainLoop();
 }
+
+#endif /* TEST_HEADLESS */
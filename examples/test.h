@@ -11,11 +11,26 @@
 #if defined(__APPLE__)
 #  include <OpenGL/gl.h>
 #  include <OpenGL/glu.h>
-#  include <GLUT/glut.h>
 #else
 #  include <GL/gl.h>
 #  include <GL/glu.h>
+#endif
+
+/* Headless builds of the examples draw without a window
+   (see test_golden.c), so the few GLUT names they use
+   are stood in for */
+#if defined(TEST_HEADLESS)
+#  define glutPostRedisplay()
+#  define GLUT_KEY_LEFT   100
+#  define GLUT_KEY_RIGHT  102
+#  define GLUT_UP         1
+#elif defined(__APPLE__)
+#  include <GLUT/glut.h>
+#else
 #  include <GL/glut.h>
+#  if defined(FREEGLUT)
+#    include <GL/freeglut_ext.h>
+#  endif
 #endif
 
 #include "GL/glext.h"
@@ -0,0 +1,665 @@
+#include <vg/openvg.h>
+#include <vg/vgu.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+/* Renders a fixed set of scenes offscreen, without a window
+   or GLUT, and prints the time per frame of each scene as
+   comma-separated values, for comparing builds in scripts
+   and continuous integration. Usage:
+
+     test_benchmark [frames] [size] [-software]
+
+   Every scene is timed on an OpenGL context on an EGL
+   pbuffer (preferably from the surfaceless Mesa platform,
+   which needs no display server), or on the software
+   renderer with -software. The stages are timed within the
+   same frames through the trace events of the library,
+   adding up the outermost scopes of each:
+
+     tessellation  flattening, bounds and image conversion
+                   ("flatten", "transform", "bounds" and
+                   "vgImageSubData")
+     stroking      stroke and dash geometry ("stroke")
+     submission    the work of the renderer ("submit"),
+                   including vgClear and waiting in vgFinish
+
+   The total is the wall-clock time of the frames, so it also
+   holds what no scope covers and the cost of the callback.
+   A library built with tracing disabled reports zero for the
+   stages.
+
+   Frames alternate between two zoom levels so the paths
+   are flattened and stroked again every frame, as in an
+   animation, instead of coming from the caches.            */
+
+extern const VGint     pathCount;
+extern const VGint     commandCounts[];
+extern const VGubyte*  commandArrays[];
+extern const VGfloat*  dataArrays[];
+extern const VGfloat*  styleArrays[];
+
+#define IMAGE_SIZE 256
+#define DASH_PATHS 40
+#define GRADIENT_PATHS 24
+
+int WIDTH = 600;
+int HEIGHT = 600;
+
+typedef struct
+{
+  const char *name;
+  void (*load)(void);
+  void (*draw)(int frame);
+  void (*unload)(void);
+} Scene;
+
+typedef enum
+{
+  RENDERER_GL,
+  RENDERER_SOFTWARE
+} Renderer;
+
+typedef enum
+{
+  STAGE_TESSELLATION,
+  STAGE_STROKING,
+  STAGE_SUBMISSION,
+  STAGE_COUNT
+} Stage;
+
+VGPath *tigerPaths = NULL;
+VGPath scenePaths[DASH_PATHS];
+VGPaint sceneFill;
+VGPaint sceneStroke;
+VGPaint sceneOutline;
+VGImage sceneImages[2];
+unsigned char *imageData = NULL;
+unsigned char *softwarePixels = NULL;
+
+double stageTimes[STAGE_COUNT];
+int stageOpen = -1;
+int stageDepth = 0;
+double stageStart = 0.0;
+
+EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+EGLSurface eglSurface = EGL_NO_SURFACE;
+EGLContext eglContext = EGL_NO_CONTEXT;
+
+double getMilliseconds()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+VGPath createPath()
+{
+  return vgCreatePath(VG_PATH_FORMAT_STANDARD, VG_PATH_DATATYPE_F,
+                      1,0,0,0, VG_PATH_CAPABILITY_ALL);
+}
+
+void clearSurface()
+{
+  VGfloat clearColor[] = {1,1,1,1};
+  vgSetfv(VG_CLEAR_COLOR, 4, clearColor);
+  vgClear(0, 0, WIDTH, HEIGHT);
+}
+
+/* Centers the 600x600 scene space on the surface at the
+   zoom level of the frame */
+
+void loadSceneMatrix(int frame)
+{
+  VGfloat zoom = (frame & 1) ? 0.95f : 0.9f;
+
+  vgLoadIdentity();
+  vgTranslate(WIDTH/2, HEIGHT/2);
+  vgScale(zoom * WIDTH/600.0f, zoom * HEIGHT/600.0f);
+  vgTranslate(-300, -300);
+}
+
+/* Fills the image data with an opaque color pattern that
+   shifts with the frame */
+
+void generateImageData(int frame)
+{
+  int x, y;
+  unsigned char *p = imageData;
+
+  for (y=0; y<IMAGE_SIZE; ++y) {
+    for (x=0; x<IMAGE_SIZE; ++x) {
+      *p++ = 0xFF;
+      *p++ = (unsigned char)(x + frame);
+      *p++ = (unsigned char)(y * 2);
+      *p++ = (unsigned char)((x ^ y) + frame);
+    }
+  }
+}
+
+/*-------------------------------------------------------
+ * Tiger: the SVG tiger, filled and stroked
+ *-------------------------------------------------------*/
+
+void loadTiger()
+{
+  int i;
+  VGPath temp;
+
+  temp = createPath();
+  tigerPaths = (VGPath*)malloc(pathCount * sizeof(VGPath));
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+  vgLoadIdentity();
+  vgTranslate(200,400);
+  vgScale(1,-1);
+
+  for (i=0; i<pathCount; ++i) {
+
+    vgClearPath(temp, VG_PATH_CAPABILITY_ALL);
+    vgAppendPathData(temp, commandCounts[i],
+                     commandArrays[i], dataArrays[i]);
+
+    tigerPaths[i] = createPath();
+    vgTransformPath(tigerPaths[i], temp);
+  }
+
+  sceneStroke = vgCreatePaint();
+  sceneFill = vgCreatePaint();
+  vgLoadIdentity();
+  vgDestroyPath(temp);
+}
+
+void drawTiger(int frame)
+{
+  int i;
+  const VGfloat *style;
+  VGint modes;
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+  loadSceneMatrix(frame);
+  vgSetPaint(sceneStroke, VG_STROKE_PATH);
+  vgSetPaint(sceneFill, VG_FILL_PATH);
+
+  for (i=0; i<pathCount; ++i) {
+
+    style = styleArrays[i];
+    modes = (VGint)style[9];
+    if (!modes) continue;
+
+    vgSetParameterfv(sceneStroke, VG_PAINT_COLOR, 4, &style[0]);
+    vgSetParameterfv(sceneFill, VG_PAINT_COLOR, 4, &style[4]);
+    vgSetf(VG_STROKE_LINE_WIDTH, style[8]);
+    vgDrawPath(tigerPaths[i], modes);
+  }
+}
+
+void unloadTiger()
+{
+  int i;
+
+  for (i=0; i<pathCount; ++i)
+    vgDestroyPath(tigerPaths[i]);
+  free(tigerPaths);
+
+  vgDestroyPaint(sceneStroke);
+  vgDestroyPaint(sceneFill);
+}
+
+/*-------------------------------------------------------
+ * Dashes: dashed ellipses and arcs with round joins
+ *-------------------------------------------------------*/
+
+void loadDashes()
+{
+  int i;
+  VGfloat color[] = {0.1f, 0.2f, 0.6f, 1.0f};
+
+  for (i=0; i<DASH_PATHS; ++i) {
+    scenePaths[i] = createPath();
+    if (i & 1)
+      vguEllipse(scenePaths[i], 300, 300, 40 + i * 12, 30 + i * 9);
+    else
+      vguArc(scenePaths[i], 300, 300, 60 + i * 12, 60 + i * 12,
+             i * 9.0f, 270, VGU_ARC_OPEN);
+  }
+
+  sceneStroke = vgCreatePaint();
+  vgSetParameterfv(sceneStroke, VG_PAINT_COLOR, 4, color);
+}
+
+void drawDashes(int frame)
+{
+  int i;
+  VGfloat dash[] = {12, 6, 2, 6};
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+  loadSceneMatrix(frame);
+  vgSetPaint(sceneStroke, VG_STROKE_PATH);
+  vgSetfv(VG_STROKE_DASH_PATTERN, 4, dash);
+  vgSetf(VG_STROKE_LINE_WIDTH, 3);
+  vgSeti(VG_STROKE_JOIN_STYLE, VG_JOIN_ROUND);
+  vgSeti(VG_STROKE_CAP_STYLE, VG_CAP_ROUND);
+
+  for (i=0; i<DASH_PATHS; ++i) {
+    vgSetf(VG_STROKE_DASH_PHASE, (VGfloat)(frame + i));
+    vgDrawPath(scenePaths[i], VG_STROKE_PATH);
+  }
+
+  vgSetfv(VG_STROKE_DASH_PATTERN, 0, NULL);
+  vgSeti(VG_STROKE_JOIN_STYLE, VG_JOIN_MITER);
+  vgSeti(VG_STROKE_CAP_STYLE, VG_CAP_BUTT);
+}
+
+void unloadDashes()
+{
+  int i;
+
+  for (i=0; i<DASH_PATHS; ++i)
+    vgDestroyPath(scenePaths[i]);
+  vgDestroyPaint(sceneStroke);
+}
+
+/*-------------------------------------------------------
+ * Gradients: linear and radial gradient fills with a
+ * solid outline
+ *-------------------------------------------------------*/
+
+void loadGradients()
+{
+  int i;
+  VGfloat stops[] = {
+    0.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+    0.5f,  1.0f, 1.0f, 0.0f, 1.0f,
+    1.0f,  0.0f, 0.0f, 1.0f, 1.0f};
+  VGfloat linear[] = {0, 0, 600, 600};
+  VGfloat radial[] = {300, 300, 250, 250, 350};
+  VGfloat black[] = {0, 0, 0, 1};
+
+  for (i=0; i<GRADIENT_PATHS; ++i) {
+    scenePaths[i] = createPath();
+    if (i & 1)
+      vguRoundRect(scenePaths[i], (i % 6) * 100 + 5, (i / 6) * 150 + 5,
+                   90, 140, 20, 20);
+    else
+      vguEllipse(scenePaths[i], (i % 6) * 100 + 50, (i / 6) * 150 + 75,
+                 90, 140);
+  }
+
+  sceneFill = vgCreatePaint();
+  vgSetParameteri(sceneFill, VG_PAINT_TYPE, VG_PAINT_TYPE_LINEAR_GRADIENT);
+  vgSetParameterfv(sceneFill, VG_PAINT_LINEAR_GRADIENT, 4, linear);
+  vgSetParameterfv(sceneFill, VG_PAINT_COLOR_RAMP_STOPS, 15, stops);
+
+  sceneStroke = vgCreatePaint();
+  vgSetParameteri(sceneStroke, VG_PAINT_TYPE, VG_PAINT_TYPE_RADIAL_GRADIENT);
+  vgSetParameterfv(sceneStroke, VG_PAINT_RADIAL_GRADIENT, 5, radial);
+  vgSetParameterfv(sceneStroke, VG_PAINT_COLOR_RAMP_STOPS, 15, stops);
+  vgSetParameteri(sceneStroke, VG_PAINT_COLOR_RAMP_SPREAD_MODE,
+                  VG_COLOR_RAMP_SPREAD_REFLECT);
+
+  sceneOutline = vgCreatePaint();
+  vgSetParameterfv(sceneOutline, VG_PAINT_COLOR, 4, black);
+}
+
+void drawGradients(int frame)
+{
+  int i;
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+  loadSceneMatrix(frame);
+  vgSetf(VG_STROKE_LINE_WIDTH, 2);
+  vgSetPaint(sceneOutline, VG_STROKE_PATH);
+
+  for (i=0; i<GRADIENT_PATHS; ++i) {
+    vgSetPaint((i & 2) ? sceneStroke : sceneFill, VG_FILL_PATH);
+    vgDrawPath(scenePaths[i], VG_FILL_PATH | VG_STROKE_PATH);
+  }
+}
+
+void unloadGradients()
+{
+  int i;
+
+  for (i=0; i<GRADIENT_PATHS; ++i)
+    vgDestroyPath(scenePaths[i]);
+  vgDestroyPaint(sceneFill);
+  vgDestroyPaint(sceneStroke);
+  vgDestroyPaint(sceneOutline);
+}
+
+/*-------------------------------------------------------
+ * Patterns: shapes filled with a repeated image
+ *-------------------------------------------------------*/
+
+void loadPatterns()
+{
+  int i;
+
+  for (i=0; i<GRADIENT_PATHS; ++i) {
+    scenePaths[i] = createPath();
+    vguEllipse(scenePaths[i], (i % 6) * 100 + 50, (i / 6) * 150 + 75,
+               90 - (i & 3) * 10, 140);
+  }
+
+  generateImageData(0);
+  sceneImages[0] = vgCreateImage(VG_sRGBA_8888, IMAGE_SIZE, IMAGE_SIZE,
+                                 VG_IMAGE_QUALITY_BETTER);
+  vgImageSubData(sceneImages[0], imageData, IMAGE_SIZE * 4,
+                 VG_sRGBA_8888, 0, 0, IMAGE_SIZE, IMAGE_SIZE);
+
+  sceneFill = vgCreatePaint();
+  vgSetParameteri(sceneFill, VG_PAINT_TYPE, VG_PAINT_TYPE_PATTERN);
+  vgSetParameteri(sceneFill, VG_PAINT_PATTERN_TILING_MODE, VG_TILE_REPEAT);
+  vgPaintPattern(sceneFill, sceneImages[0]);
+}
+
+void drawPatterns(int frame)
+{
+  int i;
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_FILL_PAINT_TO_USER);
+  vgLoadIdentity();
+  vgRotate((VGfloat)frame);
+  vgScale(0.25f, 0.25f);
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+  loadSceneMatrix(frame);
+  vgSetPaint(sceneFill, VG_FILL_PATH);
+
+  for (i=0; i<GRADIENT_PATHS; ++i)
+    vgDrawPath(scenePaths[i], VG_FILL_PATH);
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_FILL_PAINT_TO_USER);
+  vgLoadIdentity();
+}
+
+void unloadPatterns()
+{
+  int i;
+
+  for (i=0; i<GRADIENT_PATHS; ++i)
+    vgDestroyPath(scenePaths[i]);
+  vgDestroyPaint(sceneFill);
+  vgDestroyImage(sceneImages[0]);
+}
+
+/*-------------------------------------------------------
+ * Images: a static image drawn rotated at several places
+ * and one updated from memory every frame
+ *-------------------------------------------------------*/
+
+void loadImages()
+{
+  generateImageData(0);
+  sceneImages[0] = vgCreateImage(VG_sRGBA_8888, IMAGE_SIZE, IMAGE_SIZE,
+                                 VG_IMAGE_QUALITY_BETTER);
+  vgImageSubData(sceneImages[0], imageData, IMAGE_SIZE * 4,
+                 VG_sRGBA_8888, 0, 0, IMAGE_SIZE, IMAGE_SIZE);
+
+  sceneImages[1] = vgCreateImage(VG_sRGBA_8888, IMAGE_SIZE, IMAGE_SIZE,
+                                 VG_IMAGE_QUALITY_FASTER);
+}
+
+void drawImages(int frame)
+{
+  int i;
+
+  generateImageData(frame);
+  vgImageSubData(sceneImages[1], imageData, IMAGE_SIZE * 4,
+                 VG_sRGBA_8888, 0, 0, IMAGE_SIZE, IMAGE_SIZE);
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_IMAGE_USER_TO_SURFACE);
+  for (i=0; i<8; ++i) {
+    loadSceneMatrix(frame);
+    vgTranslate(300, 300);
+    vgRotate(i * 45.0f + frame);
+    vgTranslate(20, -IMAGE_SIZE/4);
+    vgScale(0.5f, 0.5f);
+    vgDrawImage(sceneImages[0]);
+  }
+
+  loadSceneMatrix(frame);
+  vgTranslate(300 - IMAGE_SIZE/2, 300 - IMAGE_SIZE/2);
+  vgDrawImage(sceneImages[1]);
+}
+
+void unloadImages()
+{
+  vgDestroyImage(sceneImages[0]);
+  vgDestroyImage(sceneImages[1]);
+}
+
+Scene scenes[] = {
+  {"tiger",     loadTiger,     drawTiger,     unloadTiger},
+  {"dashes",    loadDashes,    drawDashes,    unloadDashes},
+  {"gradients", loadGradients, drawGradients, unloadGradients},
+  {"patterns",  loadPatterns,  drawPatterns,  unloadPatterns},
+  {"images",    loadImages,    drawImages,    unloadImages}
+};
+
+#define SCENE_COUNT ((int)(sizeof(scenes) / sizeof(Scene)))
+
+/*-------------------------------------------------------
+ * Contexts
+ *-------------------------------------------------------*/
+
+int createEGLSurface()
+{
+  EGLint configAttribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+    EGL_NONE};
+  EGLint surfaceAttribs[5];
+  EGLConfig config;
+  EGLint configCount;
+
+#if defined(EGL_PLATFORM_SURFACELESS_MESA)
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay;
+  getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+    eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay)
+    eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                    EGL_DEFAULT_DISPLAY, NULL);
+#endif
+
+  if (eglDisplay == EGL_NO_DISPLAY)
+    eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (eglDisplay == EGL_NO_DISPLAY ||
+      !eglInitialize(eglDisplay, NULL, NULL))
+    return 0;
+
+  if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &configCount)
+      || configCount < 1)
+    return 0;
+
+  surfaceAttribs[0] = EGL_WIDTH;
+  surfaceAttribs[1] = WIDTH;
+  surfaceAttribs[2] = EGL_HEIGHT;
+  surfaceAttribs[3] = HEIGHT;
+  surfaceAttribs[4] = EGL_NONE;
+
+  eglBindAPI(EGL_OPENGL_API);
+  eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, NULL);
+  eglSurface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttribs);
+  if (eglContext == EGL_NO_CONTEXT || eglSurface == EGL_NO_SURFACE)
+    return 0;
+
+  return eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext);
+}
+
+void destroyEGLSurface()
+{
+  if (eglDisplay == EGL_NO_DISPLAY)
+    return;
+
+  eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (eglSurface != EGL_NO_SURFACE)
+    eglDestroySurface(eglDisplay, eglSurface);
+  if (eglContext != EGL_NO_CONTEXT)
+    eglDestroyContext(eglDisplay, eglContext);
+  eglTerminate(eglDisplay);
+}
+
+int createContext(Renderer renderer)
+{
+  switch (renderer) {
+  case RENDERER_SOFTWARE:
+    return vgCreateSoftwareContextSH(WIDTH, HEIGHT, softwarePixels,
+                                     WIDTH * 4);
+  default:
+    if (!createEGLSurface()) {
+      printf("Failed creating an EGL pbuffer surface\n");
+      return 0;
+    }
+    return vgCreateContextSH(WIDTH, HEIGHT);
+  }
+}
+
+/* Maps the name of a trace scope to the stage it is
+   counted in, -1 for scopes that aren't counted */
+
+int getStage(const char *name)
+{
+  if (strcmp(name, "flatten") == 0 ||
+      strcmp(name, "transform") == 0 ||
+      strcmp(name, "bounds") == 0 ||
+      strcmp(name, "vgImageSubData") == 0)
+    return STAGE_TESSELLATION;
+
+  if (strcmp(name, "stroke") == 0)
+    return STAGE_STROKING;
+
+  if (strcmp(name, "submit") == 0)
+    return STAGE_SUBMISSION;
+
+  return -1;
+}
+
+/* Trace callback adding the time of every counted scope
+   to its stage. Scopes nested in a counted one, e.g. the
+   "upload" of a batch flushed by "submit", are part of
+   the outer scope and not counted again */
+
+void traceStage(void *userData, const char *name,
+                VGboolean begin, double microseconds)
+{
+  int stage = getStage(name);
+  if (stage < 0) return;
+
+  if (begin) {
+    if (stageDepth++ == 0) {
+      stageOpen = stage;
+      stageStart = microseconds;
+    }
+  }else if (stageDepth > 0 && --stageDepth == 0) {
+    stageTimes[stageOpen] += (microseconds - stageStart) / 1000.0;
+  }
+}
+
+/* Runs every scene for the given number of frames, after
+   one frame to warm up, and stores the time per frame of
+   each in totals and of each of its stages in stages */
+
+int runScenes(Renderer renderer, int frames, double *totals,
+              double stages[][STAGE_COUNT])
+{
+  int s, i;
+  double start;
+
+  if (!createContext(renderer))
+    return 0;
+
+  vgSeti(VG_RENDERING_QUALITY, VG_RENDERING_QUALITY_BETTER);
+  vgTraceCallbackSH(traceStage, NULL);
+
+  for (s=0; s<SCENE_COUNT; ++s) {
+
+    scenes[s].load();
+    clearSurface();
+    scenes[s].draw(0);
+    vgFinish();
+
+    for (i=0; i<STAGE_COUNT; ++i)
+      stageTimes[i] = 0.0;
+
+    start = getMilliseconds();
+    for (i=1; i<=frames; ++i) {
+      clearSurface();
+      scenes[s].draw(i);
+      vgFinish();
+    }
+    totals[s] = (getMilliseconds() - start) / frames;
+
+    for (i=0; i<STAGE_COUNT; ++i)
+      stages[s][i] = stageTimes[i] / frames;
+
+    scenes[s].unload();
+  }
+
+  vgTraceCallbackSH(NULL, NULL);
+
+  if (vgGetError() != VG_NO_ERROR)
+    printf("OpenVG error while running the scenes\n");
+
+  vgDestroyContextSH();
+  if (renderer == RENDERER_GL)
+    destroyEGLSurface();
+
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  double stages[SCENE_COUNT][STAGE_COUNT];
+  double totals[SCENE_COUNT];
+  Renderer renderer = RENDERER_GL;
+  int frames = 100;
+  int numbers = 0;
+  int s, i;
+
+  for (i=1; i<argc; ++i) {
+    if (strcmp(argv[i], "-software") == 0)
+      renderer = RENDERER_SOFTWARE;
+    else if (numbers++ == 0)
+      frames = atoi(argv[i]);
+    else
+      WIDTH = HEIGHT = atoi(argv[i]);
+  }
+
+  if (frames < 1) frames = 1;
+  if (WIDTH < 1) WIDTH = HEIGHT = 600;
+
+  imageData = (unsigned char*)malloc(IMAGE_SIZE * IMAGE_SIZE * 4);
+  softwarePixels = (unsigned char*)malloc(WIDTH * HEIGHT * 4);
+  if (!imageData || !softwarePixels) return EXIT_FAILURE;
+
+  if (!runScenes(renderer, frames, totals, stages)) {
+    printf("Failed creating context\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("scene,renderer,size,frames,"
+         "tessellation_ms,stroking_ms,submission_ms,total_ms\n");
+
+  for (s=0; s<SCENE_COUNT; ++s) {
+    printf("%s,%s,%d,%d,%.4f,%.4f,%.4f,%.4f\n",
+           scenes[s].name,
+           renderer == RENDERER_GL ? "opengl" : "software",
+           WIDTH, frames, stages[s][STAGE_TESSELLATION],
+           stages[s][STAGE_STROKING], stages[s][STAGE_SUBMISSION],
+           totals[s]);
+  }
+
+  free(imageData);
+  free(softwarePixels);
+
+  return EXIT_SUCCESS;
+}
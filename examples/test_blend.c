@@ -1,5 +1,5 @@
 #include "test.h"
-/*#include "picu.h"*/
+#include <png.h>
 
 VGPath src;
 VGPath dst;
@@ -22,12 +22,52 @@ VGBlendMode blends[5] = {
   VG_BLEND_SRC_IN,
   VG_BLEND_DST_IN
 };
-/*
-void createOperands()
+/* Loads a PNG file into a new image, bottom row first */
+
+VGImage createImageFromPNG(const char *filename)
 {
-  PICUImage srcImage, dstImage;
-  VGfloat clear[] = {1,0,0,0};
+  png_image png;
+  VGubyte *data;
+  VGImage img;
+  unsigned int stride;
+  unsigned int lilEndianTest = 1;
+  VGImageFormat rgbaFormat;
+
+  /* Check for endianness */
+  if (((unsigned char*)&lilEndianTest)[0] == 1)
+    rgbaFormat = VG_sABGR_8888;
+  else rgbaFormat = VG_sRGBA_8888;
+
+  memset(&png, 0, sizeof(png));
+  png.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_file(&png, filename)) {
+    printf("Failed opening '%s' for reading!\n", filename);
+    return VG_INVALID_HANDLE; }
+
+  png.format = PNG_FORMAT_RGBA;
+  stride = png.width * 4;
+  data = (VGubyte*)malloc(stride * png.height);
+  if (!data) {
+    png_image_free(&png);
+    return VG_INVALID_HANDLE; }
+
+  /* Negative stride stores the rows bottom-up */
+  if (!png_image_finish_read(&png, NULL, data, -(png_int_32)stride, NULL)) {
+    printf("Failed reading '%s'!\n", filename);
+    free(data);
+    return VG_INVALID_HANDLE; }
+
+  img = vgCreateImage(rgbaFormat, png.width, png.height,
+                      VG_IMAGE_QUALITY_BETTER);
+  vgImageSubData(img, data, stride, rgbaFormat,
+                 0, 0, png.width, png.height);
+
+  free(data);
+  return img;
+}
 
+void createOperands()
+{
   src = testCreatePath();
   vguEllipse(src, 30,30,40,40);
 
@@ -39,20 +79,10 @@ void createOperands()
 
   dstFill = vgCreatePaint();
   vgSetParameterfv(dstFill, VG_PAINT_COLOR, 4, dstColor);
-  
-  picuReadFile(&srcImage, IMAGE_DIR"test_blend_src.png", "PNG");
-  picuReadFile(&dstImage, IMAGE_DIR"test_blend_dst.png", "PNG");
 
-  isrc = vgCreateImage(VG_sRGBA_8888, srcImage.width,
-                       srcImage.height, VG_IMAGE_QUALITY_BETTER);
-  vgImageSubData(isrc, srcImage.data, srcImage.stride, VG_sRGBA_8888,
-                  0,0, srcImage.width, srcImage.height);
-
-  idst = vgCreateImage(VG_sRGBA_8888, dstImage.width,
-                       dstImage.height, VG_IMAGE_QUALITY_BETTER);
-  vgImageSubData(idst, dstImage.data, dstImage.stride, VG_sRGBA_8888,
-                  0,0, dstImage.width, dstImage.height);
-}*/
+  isrc = createImageFromPNG(IMAGE_DIR"test_blend_src.png");
+  idst = createImageFromPNG(IMAGE_DIR"test_blend_dst.png");
+}
 
 void display(float interval)
 {
@@ -70,16 +100,24 @@ void display(float interval)
   vgDrawImage(isrc);
 }
 
-int main(int argc, char **argv)
+void cleanup()
 {
-  /*picuInit();*/
+  vgDestroyPath(src);
+  vgDestroyPath(dst);
+  vgDestroyPaint(srcFill);
+  vgDestroyPaint(dstFill);
+  vgDestroyImage(isrc);
+  vgDestroyImage(idst);
+}
 
+int main(int argc, char **argv)
+{
   testInit(argc, argv, 400,400, "ShivaVG: Blending Test");
   testCallback(TEST_CALLBACK_DISPLAY, (CallbackFunc)display);
+  testCallback(TEST_CALLBACK_CLEANUP, (CallbackFunc)cleanup);
   testOverlayColor(1,1,1,1);
-  testOverlayString("Not implemented yet");
 
-  /*createOperands();*/
+  createOperands();
   testRun();
   
   return EXIT_SUCCESS;
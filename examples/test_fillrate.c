@@ -0,0 +1,219 @@
+#include "test.h"
+#include <ctype.h>
+#include <math.h>
+
+/* Large, self-intersecting, mostly overdrawn fills whose cost
+   is dominated by the number of pixels touched rather than by
+   the number of vertices, drawn either through the stencil or
+   through the cached CPU triangulation. */
+
+#define NUM_SHAPES 3
+#define BENCH_FRAMES 50
+
+VGPath shapes[NUM_SHAPES];
+VGPaint fills[NUM_SHAPES];
+VGfloat colors[NUM_SHAPES][4] = {
+  {1.0f, 0.3f, 0.2f, 0.6f},
+  {0.2f, 0.6f, 1.0f, 0.6f},
+  {0.3f, 0.9f, 0.3f, 0.6f}
+};
+
+int layers = 10;
+int triangulation = 0;
+int nonzero = 0;
+int animate = 1;
+int bench = 0;
+VGfloat ang = 0.0f;
+
+const char commands[] =
+  "H - this help\n"
+  "T - toggle triangulation\n"
+  "F - toggle fill rule\n"
+  "+/- - more/less layers\n"
+  "B - benchmark both modes\n"
+  "SPACE - animation pause\\play\n";
+
+void updateOverlayString()
+{
+  testOverlayString("%s, %s, %d layers",
+                    triangulation ? "Triangulation" : "Stencil",
+                    nonzero ? "non-zero" : "even-odd", layers);
+}
+
+void drawScene()
+{
+  int i, s;
+  VGfloat white[] = {1,1,1,1};
+
+  vgSetfv(VG_CLEAR_COLOR, 4, white);
+  vgClear(0, 0, testWidth(), testHeight());
+
+  vgSeti(VG_FILL_TRIANGULATION_SH, triangulation ? VG_TRUE : VG_FALSE);
+  vgSeti(VG_FILL_RULE, nonzero ? VG_NON_ZERO : VG_EVEN_ODD);
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+
+  for (i=0; i<layers; ++i) {
+    for (s=0; s<NUM_SHAPES; ++s) {
+      vgLoadIdentity();
+      vgTranslate(testWidth()/2 + (s-1) * 40, testHeight()/2);
+      vgRotate(ang + i * 360.0f / layers);
+
+      vgSetPaint(fills[s], VG_FILL_PATH);
+      vgDrawPath(shapes[s], VG_FILL_PATH);
+    }
+  }
+}
+
+void runBenchmark()
+{
+  int i, m;
+  int start;
+  float ms[2];
+  int oldTriangulation = triangulation;
+
+  for (m=0; m<2; ++m) {
+
+    triangulation = m;
+
+    /* Warm up caches */
+    drawScene();
+    glFinish();
+
+    start = glutGet(GLUT_ELAPSED_TIME);
+    for (i=0; i<BENCH_FRAMES; ++i)
+      drawScene();
+    glFinish();
+
+    ms[m] = (float)(glutGet(GLUT_ELAPSED_TIME) - start) / BENCH_FRAMES;
+  }
+
+  triangulation = oldTriangulation;
+
+  printf("fillrate: %d layers, %s: stencil %.2f ms/frame, "
+         "triangulation %.2f ms/frame\n", layers,
+         nonzero ? "non-zero" : "even-odd", ms[0], ms[1]);
+
+  testOverlayString("Stencil: %.2f ms/frame\n"
+                    "Triangulation: %.2f ms/frame",
+                    ms[0], ms[1]);
+}
+
+void display(float interval)
+{
+  if (bench) {
+    runBenchmark();
+    bench = 0;
+  }
+
+  if (animate) {
+    ang += interval * 360 * 0.05f;
+    if (ang > 360) ang -= 360;
+  }
+
+  drawScene();
+}
+
+void key(unsigned char code, int x, int y)
+{
+  switch (tolower(code)) {
+  case 't':
+    triangulation = !triangulation;
+    break;
+
+  case 'f':
+    nonzero = !nonzero;
+    break;
+
+  case '+':
+    layers += 5;
+    break;
+
+  case '-':
+    if (layers > 5) layers -= 5;
+    break;
+
+  case 'b':
+    bench = 1;
+    return;
+
+  case ' ':
+    animate = !animate;
+    testOverlayString("%s\n", animate ? "Play" : "Pause");
+    return;
+
+  case 'h':
+    testOverlayString(commands);
+    return;
+
+  default:
+    return;
+  }
+
+  updateOverlayString();
+}
+
+void createStar(VGPath p, int points, int step, float r)
+{
+  int i;
+  float a;
+
+  /* Star polygon {points/step}: every vertex is
+     connected to the one 'step' places further */
+  for (i=0; i<points; ++i) {
+    a = (float)(i * step) * 2.0f * 3.14159265f / points;
+    if (i == 0) testMoveTo(p, r * cos(a), r * sin(a), VG_ABSOLUTE);
+    else testLineTo(p, r * cos(a), r * sin(a), VG_ABSOLUTE);
+  }
+
+  testClosePath(p);
+}
+
+void createSpiro(VGPath p, float r)
+{
+  int i;
+  float a1, a2;
+
+  /* Overlapping cubic petals around the center */
+  testMoveTo(p, 0, 0, VG_ABSOLUTE);
+  for (i=0; i<12; ++i) {
+    a1 = (float)i * 2.0f * 3.14159265f / 12;
+    a2 = a1 + 3.14159265f / 2;
+    testCubicTo(p, r * cos(a1), r * sin(a1),
+                r * cos(a2), r * sin(a2), 0, 0, VG_ABSOLUTE);
+  }
+
+  testClosePath(p);
+}
+
+void createShapes()
+{
+  int s;
+
+  shapes[0] = testCreatePath();
+  createStar(shapes[0], 17, 7, 220);
+
+  shapes[1] = testCreatePath();
+  createStar(shapes[1], 11, 4, 200);
+
+  shapes[2] = testCreatePath();
+  createSpiro(shapes[2], 260);
+
+  for (s=0; s<NUM_SHAPES; ++s) {
+    fills[s] = vgCreatePaint();
+    vgSetParameterfv(fills[s], VG_PAINT_COLOR, 4, colors[s]);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testInit(argc, argv, 600,600, "ShivaVG: Fill-rate Test");
+  testCallback(TEST_CALLBACK_DISPLAY, (CallbackFunc)display);
+  testCallback(TEST_CALLBACK_KEY, (CallbackFunc)key);
+
+  createShapes();
+
+  testOverlayString("Press H for a list of commands");
+  testRun();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,462 @@
+#include "test.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <png.h>
+#include <sys/time.h>
+
+/* Headless stand-in for the window and main loop of test.c:
+   every example scene is compiled once more against this file
+   (as <example>_check) and, instead of opening a window, draws
+   its first frame offscreen, saves it as <out>/<name>.png and
+   compares it against the golden image stored for the renderer
+   in GOLDEN_DIR. It then draws more frames and compares the
+   time of the fastest against the one an earlier run left in
+   the output directory. Usage:
+
+     test_xxx_check [-software | -core] [-update] [-frames N]
+                    [-golden DIR] [-out DIR] [-tolerance T]
+                    [-maxdiff P] [-threshold X]
+
+   The frame fails the comparison when more than P percent of
+   the pixels (default 0.1) differ by more than T (default 8)
+   in any channel; a <name>-diff.png then marks them in red.
+   The timing fails when it exceeds X times the recorded one
+   (default 1.25) by more than a millisecond. No timings are
+   kept next to the golden images, as they depend on the
+   machine: the timing only compares against an earlier local
+   run, and the first run into an output directory (e.g. on a
+   clean checkout) just records it and can't fail. -update
+   replaces the golden image and the recorded timing instead.
+   The exit status is non-zero on any failure or OpenVG error. */
+
+#ifndef TEST_NAME
+#  define TEST_NAME "test"
+#endif
+
+#ifndef GOLDEN_DIR
+#  define GOLDEN_DIR "./golden"
+#endif
+
+typedef enum
+{
+  RENDERER_GL,
+  RENDERER_CORE,
+  RENDERER_SOFTWARE
+} Renderer;
+
+static int testW = 0;
+static int testH = 0;
+
+static Renderer renderer = RENDERER_GL;
+static int update = 0;
+static int frames = 50;
+static const char *goldenDir = GOLDEN_DIR;
+static const char *outDir = ".";
+static int tolerance = 8;
+static double maxDiff = 0.1;
+static double threshold = 1.25;
+
+static unsigned char *softwarePixels = NULL;
+
+static EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+static EGLSurface eglSurface = EGL_NO_SURFACE;
+static EGLContext eglContext = EGL_NO_CONTEXT;
+
+static CallbackFunc callbacks[TEST_CALLBACK_COUNT];
+
+void testOverlayColor(float r, float g, float b, float a)
+{
+}
+
+void testOverlayString(const char *format, ...)
+{
+}
+
+void testCallback(TestCallbackType type, CallbackFunc func)
+{
+  if (type < 0 || type > TEST_CALLBACK_COUNT-1)
+    return;
+
+  callbacks[type] = func;
+}
+
+VGint testWidth()
+{
+  return testW;
+}
+
+VGint testHeight()
+{
+  return testH;
+}
+
+static double getMilliseconds()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/*-------------------------------------------------------
+ * Offscreen surface, from the surfaceless Mesa platform
+ * where available so no display server is needed
+ *-------------------------------------------------------*/
+
+static int createEGLSurface(int w, int h)
+{
+  EGLint configAttribs[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8,
+    EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+    EGL_NONE};
+  EGLint contextAttribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK,
+    EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE};
+  EGLint surfaceAttribs[5];
+  EGLConfig config;
+  EGLint configCount;
+
+#if defined(EGL_PLATFORM_SURFACELESS_MESA)
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay;
+  getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+    eglGetProcAddress("eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay)
+    eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                    EGL_DEFAULT_DISPLAY, NULL);
+#endif
+
+  if (eglDisplay == EGL_NO_DISPLAY)
+    eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (eglDisplay == EGL_NO_DISPLAY ||
+      !eglInitialize(eglDisplay, NULL, NULL))
+    return 0;
+
+  if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &configCount)
+      || configCount < 1)
+    return 0;
+
+  surfaceAttribs[0] = EGL_WIDTH;
+  surfaceAttribs[1] = w;
+  surfaceAttribs[2] = EGL_HEIGHT;
+  surfaceAttribs[3] = h;
+  surfaceAttribs[4] = EGL_NONE;
+
+  eglBindAPI(EGL_OPENGL_API);
+  eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT,
+                                renderer == RENDERER_CORE ?
+                                contextAttribs : NULL);
+  eglSurface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttribs);
+  if (eglContext == EGL_NO_CONTEXT || eglSurface == EGL_NO_SURFACE)
+    return 0;
+
+  return eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext);
+}
+
+static void destroyEGLSurface()
+{
+  if (eglDisplay == EGL_NO_DISPLAY)
+    return;
+
+  eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  if (eglSurface != EGL_NO_SURFACE)
+    eglDestroySurface(eglDisplay, eglSurface);
+  if (eglContext != EGL_NO_CONTEXT)
+    eglDestroyContext(eglDisplay, eglContext);
+  eglTerminate(eglDisplay);
+}
+
+/*-------------------------------------------------------
+ * PNG files of 8-bit RGBA pixels, top row first
+ *-------------------------------------------------------*/
+
+static int writePNG(const char *filename, unsigned char *pixels,
+                    int w, int h)
+{
+  png_image png;
+
+  memset(&png, 0, sizeof(png));
+  png.version = PNG_IMAGE_VERSION;
+  png.width = w;
+  png.height = h;
+  png.format = PNG_FORMAT_RGBA;
+
+  if (!png_image_write_to_file(&png, filename, 0, pixels, w * 4, NULL)) {
+    printf("Failed writing '%s'\n", filename);
+    return 0; }
+
+  return 1;
+}
+
+static unsigned char* readPNG(const char *filename, int *w, int *h)
+{
+  png_image png;
+  unsigned char *pixels;
+
+  memset(&png, 0, sizeof(png));
+  png.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_file(&png, filename))
+    return NULL;
+
+  png.format = PNG_FORMAT_RGBA;
+  pixels = (unsigned char*)malloc(PNG_IMAGE_SIZE(png));
+  if (!pixels) {
+    png_image_free(&png);
+    return NULL; }
+
+  if (!png_image_finish_read(&png, NULL, pixels, 0, NULL)) {
+    free(pixels);
+    return NULL; }
+
+  *w = png.width;
+  *h = png.height;
+  return pixels;
+}
+
+/*-------------------------------------------------------
+ * Checks
+ *-------------------------------------------------------*/
+
+static const char* rendererName()
+{
+  /* The core profile renderer is held to the same
+     images as the fixed-function one */
+  return renderer == RENDERER_SOFTWARE ? "software" : "opengl";
+}
+
+/* Reads the surface into 8-bit RGBA bytes, top row first */
+
+static unsigned char* readSurface()
+{
+  unsigned char *pixels;
+  unsigned int lilEndianTest = 1;
+  VGImageFormat rgbaFormat;
+  int stride = testW * 4;
+  int y;
+
+  if (((unsigned char*)&lilEndianTest)[0] == 1)
+    rgbaFormat = VG_sABGR_8888;
+  else rgbaFormat = VG_sRGBA_8888;
+
+  pixels = (unsigned char*)malloc(stride * testH);
+  if (!pixels)
+    return NULL;
+
+  /* Read the bottom-up surface one row at a time to turn it over */
+  for (y=0; y<testH; ++y)
+    vgReadPixels(pixels + (testH-1-y) * stride, stride,
+                 rgbaFormat, 0, y, testW, 1);
+  return pixels;
+}
+
+static int checkImage(unsigned char *pixels)
+{
+  char golden[1024];
+  char frame[1024];
+  char diff[1024];
+  unsigned char *expected;
+  int w, h, i, c, d;
+  int bad = 0;
+
+  sprintf(golden, "%s/%s/%s.png", goldenDir, rendererName(), TEST_NAME);
+
+  if (update) {
+    printf("%s: updated %s\n", TEST_NAME, golden);
+    return writePNG(golden, pixels, testW, testH); }
+
+  sprintf(frame, "%s/%s.png", outDir, TEST_NAME);
+  writePNG(frame, pixels, testW, testH);
+
+  expected = readPNG(golden, &w, &h);
+  if (!expected) {
+    printf("%s: FAIL missing golden image %s\n", TEST_NAME, golden);
+    return 0; }
+
+  if (w != testW || h != testH) {
+    printf("%s: FAIL golden image is %dx%d, frame is %dx%d\n",
+           TEST_NAME, w, h, testW, testH);
+    free(expected);
+    return 0; }
+
+  /* Count and mark the pixels off by more than the tolerance,
+     leaving the rest dimmed for orientation */
+  for (i=0; i < w*h*4; i+=4) {
+    for (c=0, d=0; c<4; ++c)
+      if (abs(pixels[i+c] - expected[i+c]) > tolerance) d = 1;
+    bad += d;
+    expected[i+0] = d ? 255 : expected[i+0] / 4;
+    expected[i+1] = d ? 0 : expected[i+1] / 4;
+    expected[i+2] = d ? 0 : expected[i+2] / 4;
+    expected[i+3] = 255;
+  }
+
+  if (bad * 100.0 > maxDiff * w * h) {
+    sprintf(diff, "%s/%s-diff.png", outDir, TEST_NAME);
+    writePNG(diff, expected, w, h);
+    printf("%s: FAIL %d pixels (%.2f%%) differ from %s, see %s\n",
+           TEST_NAME, bad, bad * 100.0 / (w * h), golden, diff);
+    free(expected);
+    return 0; }
+
+  printf("%s: image ok (%d pixels differ)\n", TEST_NAME, bad);
+  free(expected);
+  return 1;
+}
+
+static int checkTiming(double ms)
+{
+  char filename[1024];
+  FILE *f;
+  double recorded;
+  int read;
+
+  sprintf(filename, "%s/%s-%s.timing", outDir, TEST_NAME,
+          renderer == RENDERER_CORE ? "core" : rendererName());
+
+  f = fopen(filename, "r");
+  read = (f && fscanf(f, "%lf", &recorded) == 1);
+  if (f) fclose(f);
+
+  /* Nothing to compare against yet from an earlier run */
+  if (update || !read) {
+    f = fopen(filename, "w");
+    if (!f) {
+      printf("Failed writing '%s'\n", filename);
+      return 0; }
+    fprintf(f, "%f\n", ms);
+    fclose(f);
+    printf("%s: timing not checked, no earlier local run; "
+           "recorded %.3f ms per frame in %s\n", TEST_NAME, ms, filename);
+    return 1; }
+
+  if (ms > recorded * threshold + 1.0) {
+    printf("%s: FAIL %.3f ms per frame, %.3f ms recorded\n",
+           TEST_NAME, ms, recorded);
+    return 0; }
+
+  printf("%s: timing ok (%.3f ms per frame, %.3f ms recorded)\n",
+         TEST_NAME, ms, recorded);
+  return 1;
+}
+
+/*-------------------------------------------------------
+ * Driver
+ *-------------------------------------------------------*/
+
+void testInit(int argc, char **argv,
+              int w, int h, const char *title)
+{
+  int i;
+
+  for (i=1; i<argc; ++i) {
+    if (strcmp(argv[i], "-software") == 0)
+      renderer = RENDERER_SOFTWARE;
+    else if (strcmp(argv[i], "-core") == 0)
+      renderer = RENDERER_CORE;
+    else if (strcmp(argv[i], "-update") == 0)
+      update = 1;
+    else if (i+1 < argc && strcmp(argv[i], "-frames") == 0)
+      frames = atoi(argv[++i]);
+    else if (i+1 < argc && strcmp(argv[i], "-golden") == 0)
+      goldenDir = argv[++i];
+    else if (i+1 < argc && strcmp(argv[i], "-out") == 0)
+      outDir = argv[++i];
+    else if (i+1 < argc && strcmp(argv[i], "-tolerance") == 0)
+      tolerance = atoi(argv[++i]);
+    else if (i+1 < argc && strcmp(argv[i], "-maxdiff") == 0)
+      maxDiff = atof(argv[++i]);
+    else if (i+1 < argc && strcmp(argv[i], "-threshold") == 0)
+      threshold = atof(argv[++i]);
+  }
+
+  if (frames < 1) frames = 1;
+
+  if (renderer == RENDERER_SOFTWARE) {
+    softwarePixels = (unsigned char*)malloc(w * h * 4);
+    if (!softwarePixels ||
+        !vgCreateSoftwareContextSH(w, h, softwarePixels, w * 4)) {
+      printf("%s: FAIL creating a software context\n", TEST_NAME);
+      exit(EXIT_FAILURE); }
+
+  }else{
+    if (!createEGLSurface(w, h)) {
+      printf("%s: FAIL creating an EGL pbuffer surface\n", TEST_NAME);
+      exit(EXIT_FAILURE); }
+
+    if (renderer == RENDERER_CORE ?
+        !vgCreateCoreContextSH(w, h) : !vgCreateContextSH(w, h)) {
+      printf("%s: FAIL creating an OpenVG context\n", TEST_NAME);
+      exit(EXIT_FAILURE); }
+  }
+
+  testW = w;
+  testH = h;
+
+  for (i=0; i<TEST_CALLBACK_COUNT; ++i)
+    callbacks[i] = NULL;
+}
+
+void testRun()
+{
+  DisplayFunc display =
+    (DisplayFunc)callbacks[TEST_CALLBACK_DISPLAY];
+  ReshapeFunc reshape =
+    (ReshapeFunc)callbacks[TEST_CALLBACK_RESHAPE];
+  CleanupFunc cleanup =
+    (CleanupFunc)callbacks[TEST_CALLBACK_CLEANUP];
+
+  unsigned char *pixels;
+  double start, elapsed, fastest = 0.0;
+  VGErrorCode error;
+  int i, ok = 1;
+
+  if (reshape)
+    (*reshape)(testW, testH);
+
+  /* Errors while loading the scene count too */
+  error = vgGetError();
+
+  /* First frame, compared against the golden image */
+  if (display)
+    (*display)(0.0f);
+  vgFinish();
+
+  pixels = readSurface();
+  if (!pixels || !checkImage(pixels))
+    ok = 0;
+  free(pixels);
+
+  /* More frames of the still scene, timed. The fastest one
+     counts, which other load on the machine can't slow down */
+  for (i=0; i<frames; ++i) {
+    start = getMilliseconds();
+    if (display)
+      (*display)(0.0f);
+    vgFinish();
+    elapsed = getMilliseconds() - start;
+    if (i == 0 || elapsed < fastest)
+      fastest = elapsed;
+  }
+  if (!checkTiming(fastest))
+    ok = 0;
+
+  if (error == VG_NO_ERROR)
+    error = vgGetError();
+  if (error != VG_NO_ERROR) {
+    printf("%s: FAIL OpenVG error 0x%x\n", TEST_NAME, error);
+    ok = 0; }
+
+  if (cleanup)
+    (*cleanup)();
+
+  vgDestroyContextSH();
+  if (renderer == RENDERER_SOFTWARE)
+    free(softwarePixels);
+  else destroyEGLSurface();
+
+  exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,175 @@
+#include <vg/openvg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(WIN32)
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
+
+/* Renders the tiger into a plain memory buffer through a
+   software context, with no window or OpenGL context, and
+   reports the time per frame. Usage:
+
+     test_software [frames] [output.ppm] [threads] [size]
+
+   The tiger is scaled to fill a square surface of the given
+   size (600 by default), e.g. 7680 for an 8K-wide one. Pass
+   "-" as the output to skip writing the image.              */
+
+extern const VGint     pathCount;
+extern const VGint     commandCounts[];
+extern const VGubyte*  commandArrays[];
+extern const VGfloat*  dataArrays[];
+extern const VGfloat*  styleArrays[];
+
+int WIDTH = 600;
+int HEIGHT = 600;
+
+VGPath *tigerPaths = NULL;
+VGPaint tigerStroke;
+VGPaint tigerFill;
+
+double getMilliseconds()
+{
+#if defined(WIN32)
+  return (double)GetTickCount();
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+void loadTiger()
+{
+  int i;
+  VGPath temp;
+
+  temp = vgCreatePath(VG_PATH_FORMAT_STANDARD, VG_PATH_DATATYPE_F,
+                      1,0,0,0, VG_PATH_CAPABILITY_ALL);
+  tigerPaths = (VGPath*)malloc(pathCount * sizeof(VGPath));
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+  vgLoadIdentity();
+  vgTranslate(-100,100);
+  vgScale(1,-1);
+
+  for (i=0; i<pathCount; ++i) {
+
+    vgClearPath(temp, VG_PATH_CAPABILITY_ALL);
+    vgAppendPathData(temp, commandCounts[i],
+                     commandArrays[i], dataArrays[i]);
+
+    tigerPaths[i] = vgCreatePath(VG_PATH_FORMAT_STANDARD, VG_PATH_DATATYPE_F,
+                                 1,0,0,0, VG_PATH_CAPABILITY_ALL);
+    vgTransformPath(tigerPaths[i], temp);
+  }
+
+  tigerStroke = vgCreatePaint();
+  tigerFill = vgCreatePaint();
+  vgSetPaint(tigerStroke, VG_STROKE_PATH);
+  vgSetPaint(tigerFill, VG_FILL_PATH);
+  vgLoadIdentity();
+  vgDestroyPath(temp);
+}
+
+void drawTiger()
+{
+  int i;
+  const VGfloat *style;
+  VGfloat clearColor[] = {1,1,1,1};
+
+  vgSetfv(VG_CLEAR_COLOR, 4, clearColor);
+  vgClear(0, 0, WIDTH, HEIGHT);
+
+  vgSeti(VG_MATRIX_MODE, VG_MATRIX_PATH_USER_TO_SURFACE);
+  vgLoadIdentity();
+  vgTranslate(WIDTH/2, HEIGHT/2);
+  vgScale(WIDTH/600.0f, HEIGHT/600.0f);
+
+  for (i=0; i<pathCount; ++i) {
+
+    style = styleArrays[i];
+    vgSetParameterfv(tigerStroke, VG_PAINT_COLOR, 4, &style[0]);
+    vgSetParameterfv(tigerFill, VG_PAINT_COLOR, 4, &style[4]);
+    vgSetf(VG_STROKE_LINE_WIDTH, style[8]);
+    vgDrawPath(tigerPaths[i], (VGint)style[9]);
+  }
+
+  vgFinish();
+}
+
+int writePPM(const char *filename, const unsigned char *pixels)
+{
+  FILE *f;
+  int x, y;
+
+  f = fopen(filename, "wb");
+  if (!f) return 0;
+
+  fprintf(f, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+  for (y=0; y<HEIGHT; ++y)
+    for (x=0; x<WIDTH; ++x)
+      fwrite(pixels + (y * WIDTH + x) * 4, 1, 3, f);
+
+  fclose(f);
+  return 1;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned char *pixels;
+  int frames = 100;
+  int threads = 1;
+  int i;
+  double start, ms;
+
+  if (argc > 1) frames = atoi(argv[1]);
+  if (frames < 1) frames = 1;
+  if (argc > 3) threads = atoi(argv[3]);
+  if (argc > 4) WIDTH = HEIGHT = atoi(argv[4]);
+  if (WIDTH < 1) WIDTH = HEIGHT = 600;
+
+  /* Top-down image: start at the last row and walk backwards */
+  pixels = (unsigned char*)malloc(WIDTH * HEIGHT * 4);
+  if (!pixels) return EXIT_FAILURE;
+
+  if (!vgCreateSoftwareContextSH(WIDTH, HEIGHT,
+                                 pixels + (HEIGHT-1) * WIDTH * 4,
+                                 -WIDTH * 4)) {
+    printf("Failed creating software context\n");
+    return EXIT_FAILURE;
+  }
+
+  vgSeti(VG_RENDERING_QUALITY, VG_RENDERING_QUALITY_BETTER);
+  vgSeti(VG_SOFTWARE_THREADS_SH, threads);
+  if (vgGetError() != VG_NO_ERROR)
+    printf("Invalid thread count %d\n", threads);
+  loadTiger();
+
+  /* Warm up the path caches */
+  drawTiger();
+
+  start = getMilliseconds();
+  for (i=0; i<frames; ++i)
+    drawTiger();
+  ms = (getMilliseconds() - start) / frames;
+
+  printf("Tiger %dx%d, %d paths, %d thread(s): %.2f ms/frame, %.0f paths/s\n",
+         WIDTH, HEIGHT, (int)pathCount, vgGeti(VG_SOFTWARE_THREADS_SH), ms,
+         ms > 0.0 ? pathCount * 1000.0 / ms : 0.0);
+
+  if (argc > 2 && strcmp(argv[2], "-") != 0 && !writePPM(argv[2], pixels))
+    printf("Failed writing %s\n", argv[2]);
+
+  for (i=0; i<pathCount; ++i)
+    vgDestroyPath(tigerPaths[i]);
+  free(tigerPaths);
+
+  vgDestroyContextSH();
+  free(pixels);
+
+  return EXIT_SUCCESS;
+}
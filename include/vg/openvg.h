@@ -116,9 +116,58 @@ typedef enum {
   VG_MAX_IMAGE_PIXELS                         = 0x1167,
   VG_MAX_IMAGE_BYTES                          = 0x1168,
   VG_MAX_FLOAT                                = 0x1169,
-  VG_MAX_GAUSSIAN_STD_DEVIATION               = 0x116A
+  VG_MAX_GAUSSIAN_STD_DEVIATION               = 0x116A,
+
+  /* Fill paths with a CPU triangulation (extension) */
+  VG_FILL_TRIANGULATION_SH                    = 0x1180,
+  
+  /* Defer and merge consecutive fills (extension) */
+  VG_DRAW_BATCHING_SH                         = 0x1181,
+  
+  /* OpenGL state calls made and avoided during the
+     last frame, i.e. up to vgFlush or vgFinish (extension) */
+  VG_GL_CALLS_ISSUED_SH                       = 0x1182,
+  VG_GL_CALLS_SKIPPED_SH                      = 0x1183,
+  
+  /* Evaluate gradient paints in GLSL shaders (extension) */
+  VG_GRADIENT_SHADERS_SH                      = 0x1184,
+  
+  /* Surface areas touched during the last frame and
+     culling of draws to a redraw region (extension) */
+  VG_DAMAGE_TRACKING_SH                       = 0x1185,
+  VG_DAMAGE_RECTS_SH                          = 0x1186,
+  VG_REDRAW_CULLING_SH                        = 0x1187,
+  VG_REDRAW_RECTS_SH                          = 0x1188,
+  
+  /* Threads rasterizing software draws (extension) */
+  VG_SOFTWARE_THREADS_SH                      = 0x1189,
+  
+  /* Counters of the last frame, indexed by
+     VGStatisticSH (extension) */
+  VG_FRAME_STATISTICS_SH                      = 0x118A,
+  
+  /* Keep the shadow of the OpenGL state between calls,
+     up to vgFlush or vgFinish (extension) */
+  VG_RETAIN_GL_STATE_SH                       = 0x118B
 } VGParamType;
 
+typedef enum {
+  VG_STAT_PATHS_DRAWN_SH                      = 0,
+  VG_STAT_PATHS_CULLED_SH                     = 1,
+  VG_STAT_VERTICES_FLATTENED_SH               = 2,
+  VG_STAT_STROKE_TRIANGLES_SH                 = 3,
+  VG_STAT_TESS_CACHE_HITS_SH                  = 4,
+  VG_STAT_TESS_CACHE_MISSES_SH                = 5,
+  VG_STAT_STROKE_CACHE_HITS_SH                = 6,
+  VG_STAT_STROKE_CACHE_MISSES_SH              = 7,
+  VG_STAT_STENCIL_PASSES_SH                   = 8,
+  VG_STAT_TEXTURE_UPLOADS_SH                  = 9,
+  VG_STAT_TEXTURE_UPLOAD_BYTES_SH             = 10,
+  VG_STAT_DRAW_CALLS_SH                       = 11,
+  VG_STAT_IMAGE_CONVERSIONS_SH                = 12,
+  VG_STAT_COUNT_SH                            = 13
+} VGStatisticSH;
+
 typedef enum {
   VG_RENDERING_QUALITY_NONANTIALIASED         = 0x1200,
   VG_RENDERING_QUALITY_FASTER                 = 0x1201,
@@ -620,11 +669,74 @@ VG_API_CALL const VGubyte * vgGetString(VGStringID name);
 #define OVG_SH_blend_dst_out          1
 #define OVG_SH_blend_src_atop         1
 #define OVG_SH_blend_dst_atop         1
-
+#define OVG_SH_fill_triangulation     1
+#define OVG_SH_draw_batching          1
+#define OVG_SH_gl_state_counters      1
+#define OVG_SH_gradient_shaders       1
+#define OVG_SH_damage_tracking        1
+#define OVG_SH_command_lists          1
+#define OVG_SH_instanced_paths        1
+#define OVG_SH_software_rendering     1
+#define OVG_SH_null_rendering         1
+#define OVG_SH_core_profile           1
+#define OVG_SH_image_targets          1
+#define OVG_SH_frame_statistics       1
+#define OVG_SH_trace_events           1
+#define OVG_SH_multiple_contexts      1
+#define OVG_SH_share_groups           1
+
+typedef VGHandle VGCommandListSH;
+typedef VGHandle VGContextSH;
+
+typedef void (*VGTraceCallbackSH) (void *userData, const char *name,
+                                   VGboolean begin, double microseconds);
+
+/* Every call to vgCreateContextSH (and to the software, null and
+   core variants below) creates another context and makes it current
+   to the calling thread. Earlier versions did nothing when a context
+   existed already; now the context replaced as current is not
+   destroyed and leaks unless vgDestroyContextSH is called first or
+   its handle is kept from vgGetCurrentContextSH to use it again. */
 VG_API_CALL VGboolean vgCreateContextSH(VGint width, VGint height);
 VG_API_CALL void vgResizeSurfaceSH(VGint width, VGint height);
 VG_API_CALL void vgDestroyContextSH(void);
 
+/* Make the OpenGL context of a context current whenever it is
+   current for OpenVG calls, before or after vgMakeCurrentSH. An
+   OpenGL context's pending draws are drawn by its own next vgFlush
+   or vgFinish, never by switching or creating contexts. Fails with
+   VG_BAD_HANDLE_ERROR on the current context for handles of
+   contexts that were destroyed. */
+VG_API_CALL void vgMakeCurrentSH(VGContextSH context);
+VG_API_CALL VGContextSH vgGetCurrentContextSH(void);
+VG_API_CALL VGboolean vgJoinShareGroupSH(VGContextSH context);
+
+VG_API_CALL VGboolean vgCreateSoftwareContextSH(VGint width, VGint height,
+                                                void *pixels, VGint stride);
+VG_API_CALL void vgSetSoftwareSurfaceSH(void *pixels, VGint width,
+                                        VGint height, VGint stride);
+
+VG_API_CALL VGboolean vgCreateNullContextSH(VGint width, VGint height);
+
+VG_API_CALL VGboolean vgCreateCoreContextSH(VGint width, VGint height);
+
+VG_API_CALL void vgRenderToImageSH(VGImage image);
+
+VG_API_CALL void vgResetStatisticsSH(void);
+
+VG_API_CALL void vgTraceCallbackSH(VGTraceCallbackSH callback, void *userData);
+VG_API_CALL VGboolean vgTraceFileSH(const char *filename);
+
+VG_API_CALL VGCommandListSH vgCreateCommandListSH(void);
+VG_API_CALL void vgDestroyCommandListSH(VGCommandListSH list);
+VG_API_CALL void vgBeginCommandListSH(VGCommandListSH list);
+VG_API_CALL void vgEndCommandListSH(void);
+VG_API_CALL void vgDrawCommandListSH(VGCommandListSH list, const VGfloat *matrix);
+
+VG_API_CALL void vgDrawPathInstancedSH(VGPath path, VGbitfield paintModes,
+                                       VGint count, const VGfloat *matrices,
+                                       const VGfloat *colors);
+
 
 #if defined (__cplusplus)
 } /* extern "C" */
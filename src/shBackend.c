@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shContext.h"
+#include "shBackend.h"
+
+/*------------------------------------------------------------
+ * OpenGL backend: the stencil-and-cover pipeline of
+ * shPipeline.c drawing into the current GL context
+ *------------------------------------------------------------*/
+
+const SHBackend shGLBackend =
+{
+  "OpenGL",
+  1,
+  shGLDrawPath,
+  shGLDrawImage,
+  shGLClear,
+  shGLReadPixels,
+  shGLWritePixels,
+  shGLCopyPixels,
+  shGLFlushBatch,
+  shGLEndFrame,
+  shGLResize
+};
+
+/*------------------------------------------------------------
+ * OpenGL core backend: the same pipeline with shaders and
+ * vertex arrays only (see shGLCore.c), for 3.3+ core profile
+ * contexts. Reads and clears are shared with the above.
+ *------------------------------------------------------------*/
+
+const SHBackend shGLCoreBackend =
+{
+  "OpenGL core",
+  1,
+  shGLCoreDrawPath,
+  shGLCoreDrawImage,
+  shGLClear,
+  shGLReadPixels,
+  shGLCoreWritePixels,
+  shGLCoreCopyPixels,
+  shGLCoreFlushBatch,
+  shGLCoreEndFrame,
+  shGLCoreResize
+};
+
+/*------------------------------------------------------------
+ * Software backend: the CPU rasterizer of shRaster.c drawing
+ * into the buffer given to vgSetSoftwareSurfaceSH, which
+ * sets the size of the surface too.
+ *------------------------------------------------------------*/
+
+const SHBackend shRasterBackend =
+{
+  "Software",
+  0,
+  shRasterDrawPath,
+  shRasterDrawImage,
+  shRasterClear,
+  shRasterReadPixels,
+  shRasterWritePixels,
+  shRasterCopyPixels,
+  shRasterFlush,
+  shRasterEndFrame,
+  NULL
+};
+
+/*------------------------------------------------------------
+ * Null backend: accepts everything and draws nothing, so the
+ * argument checking, path flattening and stroking can be
+ * timed without a renderer. Reads leave the data as is.
+ *------------------------------------------------------------*/
+
+static void shNullDrawPath(VGContext *c, SHPath *p,
+                           VGbitfield paintModes, SHRectangle *bounds)
+{
+  SH_COUNT(c, VG_STAT_PATHS_DRAWN_SH, 1);
+}
+
+static void shNullDrawImage(VGContext *c, SHImage *i, SHRectangle *bounds)
+{
+}
+
+static void shNullClear(VGContext *c, SHint x, SHint y,
+                        SHint width, SHint height)
+{
+}
+
+static void shNullReadPixels(VGContext *c, void *data,
+                             VGImageFormat format, SHint stride,
+                             SHint dataWidth, SHint dataHeight,
+                             SHint dx, SHint dy, SHint sx, SHint sy,
+                             SHint width, SHint height)
+{
+}
+
+static void shNullWritePixels(VGContext *c, const void *data,
+                              VGImageFormat format, SHint stride,
+                              SHint dataWidth, SHint dataHeight,
+                              SHint dx, SHint dy, SHint sx, SHint sy,
+                              SHint width, SHint height)
+{
+}
+
+static void shNullCopyPixels(VGContext *c, SHint dx, SHint dy,
+                             SHint sx, SHint sy, SHint width, SHint height)
+{
+}
+
+static void shNullFlush(VGContext *c)
+{
+}
+
+static void shNullEndFrame(VGContext *c, SHint finish)
+{
+}
+
+static void shNullResize(VGContext *c)
+{
+}
+
+const SHBackend shNullBackend =
+{
+  "Null",
+  0,
+  shNullDrawPath,
+  shNullDrawImage,
+  shNullClear,
+  shNullReadPixels,
+  shNullWritePixels,
+  shNullCopyPixels,
+  shNullFlush,
+  shNullEndFrame,
+  shNullResize
+};
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __SHBACKEND_H
+#define __SHBACKEND_H
+
+#include "shDefs.h"
+#include "shVectors.h"
+#include "shPath.h"
+#include "shImage.h"
+
+struct VGContext;
+
+/*------------------------------------------------------------
+ * Render backend of a context. The API functions validate
+ * their arguments, update the path caches (flattening and
+ * stroking) and cull the draws against the scissor bounds
+ * and redraw region, then hand the rest to the backend. The
+ * surface is the area [0,surfaceWidth) x [0,surfaceHeight)
+ * with y=0 at the bottom.
+ *------------------------------------------------------------*/
+
+typedef struct SHBackend
+{
+  const char *name;
+
+  /* Non-zero if images, paints and the mask are
+     backed by OpenGL textures and programs */
+  SHint gl;
+
+  /* Fills and/or strokes the cached geometry of a path
+     with the current paints; bounds are the surface-space
+     bounds of the draw if known, NULL otherwise */
+  void (*drawPath) (struct VGContext *c, SHPath *p,
+                    VGbitfield paintModes, SHRectangle *bounds);
+
+  /* Draws an image with the image-user-to-surface matrix */
+  void (*drawImage) (struct VGContext *c, SHImage *i, SHRectangle *bounds);
+
+  /* Sets an area of the surface, clipped to it, to the
+     clear color within the scissor rectangles */
+  void (*clear) (struct VGContext *c, SHint x, SHint y,
+                 SHint width, SHint height);
+
+  /* Copy a (width,height) area between the surface at
+     (sx,sy) and a buffer of (dataWidth,dataHeight) pixels
+     at (dx,dy), or within the surface. Both are clipped
+     like shCopyPixels does. */
+  void (*readPixels) (struct VGContext *c, void *data,
+                      VGImageFormat format, SHint stride,
+                      SHint dataWidth, SHint dataHeight,
+                      SHint dx, SHint dy, SHint sx, SHint sy,
+                      SHint width, SHint height);
+
+  void (*writePixels) (struct VGContext *c, const void *data,
+                       VGImageFormat format, SHint stride,
+                       SHint dataWidth, SHint dataHeight,
+                       SHint dx, SHint dy, SHint sx, SHint sy,
+                       SHint width, SHint height);
+
+  void (*copyPixels) (struct VGContext *c, SHint dx, SHint dy,
+                      SHint sx, SHint sy, SHint width, SHint height);
+
+  /* Submits draws the backend is holding back */
+  void (*flush) (struct VGContext *c);
+
+  /* Ends a frame at vgFlush, or vgFinish if finish is set */
+  void (*endFrame) (struct VGContext *c, SHint finish);
+
+  /* The surface size changed, NULL if it can't */
+  void (*resize) (struct VGContext *c);
+
+} SHBackend;
+
+/* OpenGL, OpenGL core profile (see shGLCore.c), CPU rasterizer
+   (see shRaster.c) and a backend that draws nothing, for timing
+   the rest of the library */
+extern const SHBackend shGLBackend;
+extern const SHBackend shGLCoreBackend;
+extern const SHBackend shRasterBackend;
+extern const SHBackend shNullBackend;
+
+#endif /* __SHBACKEND_H */
@@ -0,0 +1,446 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shContext.h"
+#include <string.h>
+
+#define _ITEM_T SHDrawState
+#define _ARRAY_T SHDrawStateArray
+#define _FUNC_T shDrawStateArray
+#define _COMPARE_T(s1,s2) 0
+#define _ARRAY_DEFINE
+#include "shArrayBase.h"
+
+#define _ITEM_T SHCommand
+#define _ARRAY_T SHCommandArray
+#define _FUNC_T shCommandArray
+#define _COMPARE_T(c1,c2) 0
+#define _ARRAY_DEFINE
+#include "shArrayBase.h"
+
+#define _ITEM_T SHCommandList*
+#define _ARRAY_T SHCommandListArray
+#define _FUNC_T shCommandListArray
+#define _ARRAY_DEFINE
+#include "shArrayBase.h"
+
+/*------------------------------------------------------------
+ * A command list records vgDrawPath and vgDrawImage calls
+ * together with the drawing state they were made in. The
+ * state is resolved once when recorded: matrices are copied,
+ * paint handles validated and a new state entry stored only
+ * when it differs from the previous one, dash pattern and
+ * scissor rectangles included. Replaying the list
+ * sets the state directly and calls the drawing code without
+ * checking any handle again. Handles are checked once more
+ * only after an object has been destroyed.
+ *------------------------------------------------------------*/
+
+void SHCommandList_ctor(SHCommandList *l)
+{
+  SH_INITOBJ(SHCommandArray, l->commands);
+  SH_INITOBJ(SHDrawStateArray, l->states);
+  SH_INITOBJ(SHFloatArray, l->dashes);
+  SH_INITOBJ(SHRectArray, l->scissorRects);
+  l->generation = 0;
+}
+
+void SHCommandList_dtor(SHCommandList *l)
+{
+  SH_DEINITOBJ(SHCommandArray, l->commands);
+  SH_DEINITOBJ(SHDrawStateArray, l->states);
+  SH_DEINITOBJ(SHFloatArray, l->dashes);
+  SH_DEINITOBJ(SHRectArray, l->scissorRects);
+}
+
+/* Appends the dash pattern and scissor rectangles of the
+   context to the pools of the list */
+static void shGetDrawState(VGContext *c, SHCommandList *l, SHDrawState *s)
+{
+  SHint i;
+  
+  s->pathTransform = c->pathTransform;
+  s->imageTransform = c->imageTransform;
+  s->fillTransform = c->fillTransform;
+  s->strokeTransform = c->strokeTransform;
+  s->fillPaint = c->fillPaint;
+  s->strokePaint = c->strokePaint;
+  s->fillRule = c->fillRule;
+  s->imageQuality = c->imageQuality;
+  s->renderingQuality = c->renderingQuality;
+  s->blendMode = c->blendMode;
+  s->imageMode = c->imageMode;
+  s->scissoring = c->scissoring;
+  s->masking = c->masking;
+  s->strokeLineWidth = c->strokeLineWidth;
+  s->strokeCapStyle = c->strokeCapStyle;
+  s->strokeJoinStyle = c->strokeJoinStyle;
+  s->strokeMiterLimit = c->strokeMiterLimit;
+  s->strokeDashPhase = c->strokeDashPhase;
+  s->strokeDashPhaseReset = c->strokeDashPhaseReset;
+  
+  s->dashStart = l->dashes.size;
+  s->dashCount = c->strokeDashPattern.size;
+  for (i=0; i<s->dashCount; ++i)
+    shFloatArrayPushBack(&l->dashes, c->strokeDashPattern.items[i]);
+  
+  s->scissorStart = l->scissorRects.size;
+  s->scissorCount = c->scissor.size;
+  for (i=0; i<s->scissorCount; ++i)
+    shRectArrayPushBack(&l->scissorRects, c->scissor.items[i]);
+}
+
+/* Drops what shGetDrawState added to the pools for s */
+static void shDropDrawState(SHCommandList *l, SHDrawState *s)
+{
+  l->dashes.size = s->dashStart;
+  l->scissorRects.size = s->scissorStart;
+}
+
+static int shSameDashes(SHCommandList *l, SHDrawState *s,
+                        const SHfloat *dashes, SHint count)
+{
+  return (s->dashCount == count && (count == 0 ||
+          memcmp(&l->dashes.items[s->dashStart], dashes,
+                 count * sizeof(SHfloat)) == 0));
+}
+
+static int shSameScissorRects(SHCommandList *l, SHDrawState *s,
+                              const SHRectangle *rects, SHint count)
+{
+  return (s->scissorCount == count && (count == 0 ||
+          memcmp(&l->scissorRects.items[s->scissorStart], rects,
+                 count * sizeof(SHRectangle)) == 0));
+}
+
+static int shDrawStatesEqual(SHCommandList *l, SHDrawState *a, SHDrawState *b)
+{
+  return (memcmp(&a->pathTransform, &b->pathTransform, sizeof(SHMatrix3x3)) == 0 &&
+          memcmp(&a->imageTransform, &b->imageTransform, sizeof(SHMatrix3x3)) == 0 &&
+          memcmp(&a->fillTransform, &b->fillTransform, sizeof(SHMatrix3x3)) == 0 &&
+          memcmp(&a->strokeTransform, &b->strokeTransform, sizeof(SHMatrix3x3)) == 0 &&
+          a->fillPaint == b->fillPaint &&
+          a->strokePaint == b->strokePaint &&
+          a->fillRule == b->fillRule &&
+          a->imageQuality == b->imageQuality &&
+          a->renderingQuality == b->renderingQuality &&
+          a->blendMode == b->blendMode &&
+          a->imageMode == b->imageMode &&
+          a->scissoring == b->scissoring &&
+          a->masking == b->masking &&
+          a->strokeLineWidth == b->strokeLineWidth &&
+          a->strokeCapStyle == b->strokeCapStyle &&
+          a->strokeJoinStyle == b->strokeJoinStyle &&
+          a->strokeMiterLimit == b->strokeMiterLimit &&
+          a->strokeDashPhase == b->strokeDashPhase &&
+          a->strokeDashPhaseReset == b->strokeDashPhaseReset &&
+          shSameDashes(l, a, &l->dashes.items[b->dashStart], b->dashCount) &&
+          shSameScissorRects(l, a, &l->scissorRects.items[b->scissorStart],
+                             b->scissorCount));
+}
+
+/* Makes the given state current, with the user-to-surface
+   matrices premultiplied by base if given */
+static void shSetDrawState(VGContext *c, SHCommandList *l,
+                           SHDrawState *s, SHMatrix3x3 *base)
+{
+  SHint i;
+  SHint scissorChanged = !shSameScissorRects(l, s, c->scissor.items,
+                                             c->scissor.size);
+  
+  /* Same as changing these through vgSet */
+  if (c->fillRule != s->fillRule || c->blendMode != s->blendMode ||
+      c->scissoring != s->scissoring || c->masking != s->masking ||
+      scissorChanged)
+    shFlushBatch(c);
+  
+  /* Only rebuilt when changed, as that invalidates the mask */
+  if (scissorChanged)
+    shSetScissorRects(c, &l->scissorRects.items[s->scissorStart],
+                      s->scissorCount);
+  
+  if (!shSameDashes(l, s, c->strokeDashPattern.items,
+                    c->strokeDashPattern.size)) {
+    shFloatArrayClear(&c->strokeDashPattern);
+    for (i=0; i<s->dashCount; ++i)
+      shFloatArrayPushBack(&c->strokeDashPattern,
+                           l->dashes.items[s->dashStart + i]);
+  }
+  
+  if (base) {
+    MULMATMAT((*base), s->pathTransform, c->pathTransform);
+    MULMATMAT((*base), s->imageTransform, c->imageTransform);
+  }else{
+    c->pathTransform = s->pathTransform;
+    c->imageTransform = s->imageTransform;
+  }
+  
+  c->fillTransform = s->fillTransform;
+  c->strokeTransform = s->strokeTransform;
+  shRetainPaint(s->fillPaint);
+  shRetainPaint(s->strokePaint);
+  shReleasePaint(c->fillPaint);
+  shReleasePaint(c->strokePaint);
+  c->fillPaint = s->fillPaint;
+  c->strokePaint = s->strokePaint;
+  c->fillRule = s->fillRule;
+  c->imageQuality = s->imageQuality;
+  c->renderingQuality = s->renderingQuality;
+  c->blendMode = s->blendMode;
+  c->imageMode = s->imageMode;
+  c->scissoring = s->scissoring;
+  c->masking = s->masking;
+  c->strokeLineWidth = s->strokeLineWidth;
+  c->strokeCapStyle = s->strokeCapStyle;
+  c->strokeJoinStyle = s->strokeJoinStyle;
+  c->strokeMiterLimit = s->strokeMiterLimit;
+  c->strokeDashPhase = s->strokeDashPhase;
+  c->strokeDashPhaseReset = s->strokeDashPhaseReset;
+}
+
+/*------------------------------------------------------------
+ * Called by the drawing functions while a list is recorded,
+ * after their arguments have been checked
+ *------------------------------------------------------------*/
+
+static void shRecordCommand(VGContext *c, SHCommandType type,
+                            void *object, VGbitfield paintModes)
+{
+  SHCommandList *l = c->recordList;
+  SHDrawState s;
+  SHCommand cmd;
+  
+  shGetDrawState(c, l, &s);
+  if (l->states.size > 0 &&
+      shDrawStatesEqual(l, &s, &l->states.items[l->states.size-1])) {
+    shDropDrawState(l, &s);
+  }else{
+    cmd.type = SH_COMMAND_STATE;
+    cmd.object = NULL;
+    cmd.paintModes = 0;
+    shDrawStateArrayPushBackP(&l->states, &s);
+    shCommandArrayPushBackP(&l->commands, &cmd);
+  }
+  
+  cmd.type = type;
+  cmd.object = object;
+  cmd.paintModes = paintModes;
+  shCommandArrayPushBackP(&l->commands, &cmd);
+}
+
+void shRecordPathCommand(VGContext *c, SHPath *p, VGbitfield paintModes)
+{
+  shRecordCommand(c, SH_COMMAND_DRAW_PATH, p, paintModes);
+}
+
+void shRecordImageCommand(VGContext *c, SHImage *i)
+{
+  shRecordCommand(c, SH_COMMAND_DRAW_IMAGE, i, 0);
+}
+
+/*------------------------------------------------------------
+ * Drops the draws of destroyed objects and falls back to the
+ * default paint for destroyed paints. Only needed when any
+ * object has been destroyed since the list was last checked.
+ *------------------------------------------------------------*/
+
+static void shValidateCommandList(VGContext *c, SHCommandList *l)
+{
+  SHCommand *cmd;
+  SHDrawState *s;
+  SHint i, n;
+  
+  if (l->generation == c->share->objectGeneration)
+    return;
+  
+  for (i=0; i<l->states.size; ++i) {
+    s = &l->states.items[i];
+    if (s->fillPaint && !shIsValidPaint(c, (VGHandle)s->fillPaint))
+      s->fillPaint = NULL;
+    if (s->strokePaint && !shIsValidPaint(c, (VGHandle)s->strokePaint))
+      s->strokePaint = NULL;
+  }
+  
+  for (i=0, n=0; i<l->commands.size; ++i) {
+    cmd = &l->commands.items[i];
+    if (cmd->type == SH_COMMAND_DRAW_PATH &&
+        !shIsValidPath(c, (VGHandle)cmd->object))
+      continue;
+    if (cmd->type == SH_COMMAND_DRAW_IMAGE &&
+        !shIsValidImage(c, (VGHandle)cmd->object))
+      continue;
+    l->commands.items[n++] = *cmd;
+  }
+  
+  l->commands.size = n;
+  l->generation = c->share->objectGeneration;
+}
+
+SHint shIsValidCommandList(VGContext *c, VGHandle h)
+{
+  int index = shCommandListArrayFind(&c->share->commandLists,
+                                     (SHCommandList*)h);
+  return (index == -1) ? 0 : 1;
+}
+
+VG_API_CALL VGCommandListSH vgCreateCommandListSH(void)
+{
+  SHCommandList *l = NULL;
+  VG_GETCONTEXT(VG_INVALID_HANDLE);
+  
+  /* Create new command list object */
+  SH_NEWOBJ(SHCommandList, l);
+  VG_RETURN_ERR_IF(!l, VG_OUT_OF_MEMORY_ERROR,
+                   VG_INVALID_HANDLE);
+  
+  /* Add to resource list */
+  shCommandListArrayPushBack(&context->share->commandLists, l);
+  
+  VG_RETURN((VGCommandListSH)l);
+}
+
+VG_API_CALL void vgDestroyCommandListSH(VGCommandListSH list)
+{
+  VGContext *c;
+  SHint index;
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  /* Check if handle valid */
+  index = shCommandListArrayFind(&context->share->commandLists,
+                                 (SHCommandList*)list);
+  VG_RETURN_ERR_IF(index == -1, VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+  
+  /* Any context of the group may be recording it */
+  for (c = context->share->contexts; c; c = c->shareNext)
+    if (c->recordList == (SHCommandList*)list)
+      c->recordList = NULL;
+  
+  /* Delete object and remove resource */
+  SH_DELETEOBJ(SHCommandList, (SHCommandList*)list);
+  shCommandListArrayRemoveAt(&context->share->commandLists, index);
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
+
+/*------------------------------------------------------------
+ * Starts recording into the given list, replacing what it
+ * held. The recorded calls are still executed as usual.
+ *------------------------------------------------------------*/
+
+VG_API_CALL void vgBeginCommandListSH(VGCommandListSH list)
+{
+  SHCommandList *l;
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(!shIsValidCommandList(context, list),
+                   VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(context->recordList != NULL,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  l = (SHCommandList*)list;
+  shCommandArrayClear(&l->commands);
+  shDrawStateArrayClear(&l->states);
+  shFloatArrayClear(&l->dashes);
+  shRectArrayClear(&l->scissorRects);
+  l->generation = context->share->objectGeneration;
+  context->recordList = l;
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
+
+VG_API_CALL void vgEndCommandListSH(void)
+{
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(context->recordList == NULL,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  context->recordList = NULL;
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
+
+/*------------------------------------------------------------
+ * Replays the list. The given affine matrix, in the layout
+ * of vgLoadMatrix, is applied on top of the recorded path-
+ * and image-user-to-surface matrices. The drawing state of
+ * the context is left as it was before the call.
+ *------------------------------------------------------------*/
+
+VG_API_CALL void vgDrawCommandListSH(VGCommandListSH list, const VGfloat *matrix)
+{
+  SHCommandList *l;
+  SHCommand *cmd;
+  SHDrawState saved;
+  SHMatrix3x3 base, *pbase = NULL;
+  SHint i, s = 0;
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(!shIsValidCommandList(context, list),
+                   VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+  
+  /* Lists can't be recorded into lists */
+  VG_RETURN_ERR_IF(context->recordList != NULL,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  l = (SHCommandList*)list;
+  shValidateCommandList(context, l);
+  
+  if (matrix) {
+    SETMAT(base,
+           matrix[0], matrix[3], matrix[6],
+           matrix[1], matrix[4], matrix[7],
+           0.0f,      0.0f,      1.0f);
+    pbase = &base;
+  }
+  
+  /* The saved paints stay alive through the replay, and the
+     saved dashes and scissor rectangles are only kept in the
+     pools of the list until then */
+  shGetDrawState(context, l, &saved);
+  shRetainPaint(saved.fillPaint);
+  shRetainPaint(saved.strokePaint);
+  
+  for (i=0; i<l->commands.size; ++i) {
+    cmd = &l->commands.items[i];
+    switch (cmd->type) {
+    case SH_COMMAND_STATE:
+      shSetDrawState(context, l, &l->states.items[s++], pbase);
+      break;
+    case SH_COMMAND_DRAW_PATH:
+      shDrawPath(context, (SHPath*)cmd->object, cmd->paintModes);
+      break;
+    case SH_COMMAND_DRAW_IMAGE:
+      shDrawImage(context, (SHImage*)cmd->object);
+      break;
+    }
+  }
+  
+  shSetDrawState(context, l, &saved, NULL);
+  shDropDrawState(l, &saved);
+  shReleasePaint(saved.fillPaint);
+  shReleasePaint(saved.strokePaint);
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
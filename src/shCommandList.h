@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+#ifndef __SHCOMMANDLIST_H
+#define __SHCOMMANDLIST_H
+
+#include "shDefs.h"
+#include "shVectors.h"
+#include "shPath.h"
+#include "shPaint.h"
+#include "shImage.h"
+#include "shArrays.h"
+
+/* Context state read by vgDrawPath and vgDrawImage,
+   resolved at record time. The dash pattern and scissor
+   rectangles are kept in the pools of the list and
+   referenced by their first index and count. */
+typedef struct
+{
+  SHMatrix3x3 pathTransform;
+  SHMatrix3x3 imageTransform;
+  SHMatrix3x3 fillTransform;
+  SHMatrix3x3 strokeTransform;
+  SHPaint *fillPaint;
+  SHPaint *strokePaint;
+  VGFillRule fillRule;
+  VGImageQuality imageQuality;
+  VGRenderingQuality renderingQuality;
+  VGBlendMode blendMode;
+  VGImageMode imageMode;
+  VGboolean scissoring;
+  VGboolean masking;
+  SHfloat strokeLineWidth;
+  VGCapStyle strokeCapStyle;
+  VGJoinStyle strokeJoinStyle;
+  SHfloat strokeMiterLimit;
+  SHfloat strokeDashPhase;
+  VGboolean strokeDashPhaseReset;
+  SHint dashStart;
+  SHint dashCount;
+  SHint scissorStart;
+  SHint scissorCount;
+  
+} SHDrawState;
+
+#define _ITEM_T SHDrawState
+#define _ARRAY_T SHDrawStateArray
+#define _FUNC_T shDrawStateArray
+#define _ARRAY_DECLARE
+#include "shArrayBase.h"
+
+typedef enum
+{
+  SH_COMMAND_STATE      = 0,
+  SH_COMMAND_DRAW_PATH  = 1,
+  SH_COMMAND_DRAW_IMAGE = 2
+  
+} SHCommandType;
+
+typedef struct
+{
+  SHCommandType type;
+  void *object;
+  VGbitfield paintModes;
+  
+} SHCommand;
+
+#define _ITEM_T SHCommand
+#define _ARRAY_T SHCommandArray
+#define _FUNC_T shCommandArray
+#define _ARRAY_DECLARE
+#include "shArrayBase.h"
+
+typedef struct
+{
+  SHCommandArray commands;
+  SHDrawStateArray states;
+  SHFloatArray dashes;
+  SHRectArray scissorRects;
+  SHint generation;
+  
+} SHCommandList;
+
+void SHCommandList_ctor(SHCommandList *l);
+void SHCommandList_dtor(SHCommandList *l);
+
+#define _ITEM_T SHCommandList*
+#define _ARRAY_T SHCommandListArray
+#define _FUNC_T shCommandListArray
+#define _ARRAY_DECLARE
+#include "shArrayBase.h"
+
+struct VGContext;
+
+void shRecordPathCommand(struct VGContext *c, SHPath *p, VGbitfield paintModes);
+void shRecordImageCommand(struct VGContext *c, SHImage *i);
+
+#endif /* __SHCOMMANDLIST_H */
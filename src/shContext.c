@@ -24,39 +24,158 @@
 #include "shParams.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 /*-----------------------------------------------------
- * Simple functions to create a VG context instance
- * on top of an existing OpenGL context.
+ * Simple functions to create VG context instances on
+ * top of existing OpenGL contexts. Every thread has a
+ * current context which the API calls of the thread go
+ * to, so separate threads can draw with contexts of
+ * their own at the same time.
  * TODO: There is no mechanics yet to asure the OpenGL
  * context exists and to choose which context / window
  * to bind to. 
  *-----------------------------------------------------*/
 
-static VGContext *g_context = NULL;
+static SH_THREAD_LOCAL VGContext *g_context = NULL;
 
-VG_API_CALL VGboolean vgCreateContextSH(VGint width, VGint height)
+/* Contexts not destroyed yet, linked by liveNext, so
+   handles passed in by the application can be checked */
+static VGContext *g_contexts = NULL;
+
+#if defined(SH_SHARE_LOCKING)
+static pthread_mutex_t g_contextsLock = PTHREAD_MUTEX_INITIALIZER;
+#  define SH_LOCK_CONTEXTS() pthread_mutex_lock(&g_contextsLock)
+#  define SH_UNLOCK_CONTEXTS() pthread_mutex_unlock(&g_contextsLock)
+#else
+#  define SH_LOCK_CONTEXTS() ((void)0)
+#  define SH_UNLOCK_CONTEXTS() ((void)0)
+#endif
+
+void shLoadExtensions(VGContext *c);
+
+/*-----------------------------------------------------
+ * Returns true if the context hasn't been destroyed.
+ * Must be called with the list of contexts locked.
+ *-----------------------------------------------------*/
+
+static SHint shIsLiveContext(VGContext *c)
+{
+  VGContext *l;
+  
+  for (l = g_contexts; l; l = l->liveNext)
+    if (l == c) return 1;
+  
+  return 0;
+}
+
+/*-----------------------------------------------------
+ * Makes the given context current to the calling
+ * thread. A software context replaced draws what it
+ * has binned. An OpenGL one keeps its pending batch
+ * until its own next vgFlush, vgFinish or call that
+ * needs the framebuffer: the application may have made
+ * another OpenGL context current already, e.g. to
+ * create a context on it, and the batch would be drawn
+ * into that one.
+ *-----------------------------------------------------*/
+
+static void shSetCurrentContext(VGContext *c)
+{
+  SHint live;
+  
+  if (g_context && g_context != c && !g_context->backend->gl) {
+    SH_LOCK_CONTEXTS();
+    live = shIsLiveContext(g_context);
+    SH_UNLOCK_CONTEXTS();
+    
+    if (live) {
+      SH_LOCK_SHARE(g_context);
+      shFlushBatch(g_context);
+      SH_UNLOCK_SHARE(g_context);
+    }
+  }
+  
+  g_context = c;
+}
+
+/*-----------------------------------------------------
+ * Allocates a context in a share group of its own and
+ * adds it to the live ones
+ *-----------------------------------------------------*/
+
+static VGContext* shNewContext(void)
+{
+  VGContext *c;
+  
+  SH_NEWOBJ(VGContext, c);
+  if (c && !c->share) {
+    SH_DELETEOBJ(VGContext, c);
+    return NULL;
+  }
+  
+  if (c) {
+    SH_LOCK_CONTEXTS();
+    c->liveNext = g_contexts;
+    g_contexts = c;
+    SH_UNLOCK_CONTEXTS();
+  }
+  
+  return c;
+}
+
+/*-----------------------------------------------------
+ * Removes a context from the live ones and deletes it
+ *-----------------------------------------------------*/
+
+static void shDeleteContext(VGContext *c)
 {
-  /* return if already created */
-  if (g_context) return VG_TRUE;
+  VGContext **l;
+  
+  SH_LOCK_CONTEXTS();
+  for (l = &g_contexts; *l; l = &(*l)->liveNext) {
+    if (*l == c) {
+      *l = c->liveNext;
+      break;
+    }
+  }
+  SH_UNLOCK_CONTEXTS();
+  
+  SH_DELETEOBJ(VGContext, c);
+}
+
+/*-----------------------------------------------------
+ * Creates a context drawing into the current OpenGL
+ * context, with the core-profile renderer if asked for
+ * or if that's the only kind of context it can be.
+ *-----------------------------------------------------*/
+
+static VGboolean shCreateGLContext(VGint width, VGint height, SHint core)
+{
+  VGContext *c;
   
   /* create new context */
-  SH_NEWOBJ(VGContext, g_context);
-  if (!g_context) return VG_FALSE;
+  c = shNewContext();
+  if (!c) return VG_FALSE;
   
   /* init surface info */
-  g_context->surfaceWidth = width;
-  g_context->surfaceHeight = height;
+  c->surfaceWidth = width;
+  c->surfaceHeight = height;
+  c->windowWidth = width;
+  c->windowHeight = height;
   
-  /* setup GL projection */
-  glViewport(0,0,width,height);
+  shLoadExtensions(c);
   
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-  gluOrtho2D(0,width,0,height);
+  if (core || c->isGLCoreProfile) {
+    c->backend = &shGLCoreBackend;
+    if (!shGLCoreInit(c)) {
+      shDeleteContext(c);
+      return VG_FALSE;
+    }
+  }
   
-  glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
+  shSetCurrentContext(c);
+  c->backend->resize(c);
 
   /* depth buffer clear value for scissor test */
   glClearDepth(0.0);
@@ -66,40 +185,310 @@ VG_API_CALL VGboolean vgCreateContextSH(VGint width, VGint height)
   return VG_TRUE;
 }
 
-VG_API_CALL void vgResizeSurfaceSH(VGint width, VGint height)
+VG_API_CALL VGboolean vgCreateContextSH(VGint width, VGint height)
+{
+  return shCreateGLContext(width, height, 0);
+}
+
+/*-----------------------------------------------------
+ * Creates a context drawing with the OpenGL 3.3 core
+ * profile renderer (see shGLCore.c), which works in
+ * compatibility contexts too. Fails if the current
+ * OpenGL context can't run it.
+ *-----------------------------------------------------*/
+
+VG_API_CALL VGboolean vgCreateCoreContextSH(VGint width, VGint height)
+{
+  return shCreateGLContext(width, height, 1);
+}
+
+/*-----------------------------------------------------
+ * Creates a context that draws into the given buffer on
+ * the CPU, for hosts with no OpenGL context to render to
+ * (see shRaster.c). The buffer holds 4 bytes per pixel in
+ * R,G,B,A order with the bottom row y=0 at pixels and row
+ * y at pixels + y * stride. A negative stride with pixels
+ * pointing at the last row of a top-down image works too.
+ *-----------------------------------------------------*/
+
+VG_API_CALL VGboolean vgCreateSoftwareContextSH(VGint width, VGint height,
+                                                void *pixels, VGint stride)
+{
+  VGContext *c;
+  
+  if (width <= 0 || height <= 0 || pixels == NULL ||
+      SH_ABS(stride) < width * 4)
+    return VG_FALSE;
+  
+  /* create new context */
+  c = shNewContext();
+  if (!c) return VG_FALSE;
+  
+  /* init surface info */
+  c->surfaceWidth = width;
+  c->surfaceHeight = height;
+  c->windowWidth = width;
+  c->windowHeight = height;
+  c->backend = &shRasterBackend;
+  c->raster.pixels = (SHuint8*)pixels;
+  c->raster.stride = stride;
+  
+  shSetCurrentContext(c);
+  return VG_TRUE;
+}
+
+/*-----------------------------------------------------
+ * Creates a context that goes through all the work of
+ * the library up to drawing, which it skips. Paths are
+ * still flattened, stroked and culled, so the CPU side
+ * can be timed without OpenGL or pixels. Reading the
+ * surface leaves the output untouched.
+ *-----------------------------------------------------*/
+
+VG_API_CALL VGboolean vgCreateNullContextSH(VGint width, VGint height)
+{
+  VGContext *c;
+  
+  if (width <= 0 || height <= 0)
+    return VG_FALSE;
+  
+  /* create new context */
+  c = shNewContext();
+  if (!c) return VG_FALSE;
+  
+  /* init surface info */
+  c->surfaceWidth = width;
+  c->surfaceHeight = height;
+  c->windowWidth = width;
+  c->windowHeight = height;
+  c->backend = &shNullBackend;
+  
+  shSetCurrentContext(c);
+  return VG_TRUE;
+}
+
+VG_API_CALL void vgSetSoftwareSurfaceSH(void *pixels, VGint width,
+                                        VGint height, VGint stride)
 {
   VG_GETCONTEXT(VG_NO_RETVAL);
   
+  VG_RETURN_ERR_IF(context->backend != &shRasterBackend,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(width <= 0 || height <= 0 || pixels == NULL ||
+                   SH_ABS(stride) < width * 4,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  /* finish pending draws in the old buffer */
+  shFlushBatch(context);
+  
   /* update surface info */
   context->surfaceWidth = width;
   context->surfaceHeight = height;
+  context->windowWidth = width;
+  context->windowHeight = height;
+  context->raster.pixels = (SHuint8*)pixels;
+  context->raster.stride = stride;
+  
+  /* keep the mask the size of the surface */
+  shResizeMask(context);
+  shDamageSurface(context);
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
+
+VG_API_CALL void vgResizeSurfaceSH(VGint width, VGint height)
+{
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  /* software surfaces come with their buffer */
+  VG_RETURN_ERR_IF(context->backend->resize == NULL,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  /* draw pending batch with the old projection */
+  shFlushBatch(context);
+  
+  /* update surface info, only the window's while
+     an image is the render target */
+  context->windowWidth = width;
+  context->windowHeight = height;
+  if (context->renderTarget == NULL) {
+    context->surfaceWidth = width;
+    context->surfaceHeight = height;
+  }
+  
+  /* keep the mask the size of the surface */
+  shResizeMask(context);
+  shDamageSurface(context);
+  
+  if (context->renderTarget == NULL)
+    context->backend->resize(context);
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
+
+/*-----------------------------------------------------
+ * Puts the current context into the share group of the
+ * given one, so both see the same paths, paints, images
+ * and command lists. The current context must not own
+ * any objects yet. OpenGL contexts can only join other
+ * OpenGL contexts, whose OpenGL context must share
+ * textures and buffers with theirs. Handles of contexts
+ * that were destroyed fail with VG_BAD_HANDLE_ERROR.
+ *-----------------------------------------------------*/
+
+VG_API_CALL VGboolean vgJoinShareGroupSH(VGContextSH context)
+{
+  VGContext *c = shGetContext();
+  VGContext *other = (VGContext*)context;
+  SHShareGroup *g;
+  SHint empty;
+  
+  if (!c) return VG_FALSE;
+  
+  /* The other context stays alive while it's looked at */
+  SH_LOCK_CONTEXTS();
+  if (!shIsLiveContext(other)) {
+    SH_UNLOCK_CONTEXTS();
+    shSetError(c, VG_BAD_HANDLE_ERROR);
+    return VG_FALSE;
+  }
+  
+  if (other->backend->gl != c->backend->gl) {
+    SH_UNLOCK_CONTEXTS();
+    shSetError(c, VG_ILLEGAL_ARGUMENT_ERROR);
+    return VG_FALSE;
+  }
+  
+  if (other->share == c->share) {
+    SH_UNLOCK_CONTEXTS();
+    return VG_TRUE;
+  }
+  
+  /* A group of its own, with no objects alive */
+  g = c->share;
+  empty = (g->contexts == c && c->shareNext == NULL &&
+           g->paths.size == 0 && g->paints.size == 0 &&
+           g->images.size == 0 && g->commandLists.size == 0 &&
+           g->ramps.size == 0 && c->fillPaint == NULL &&
+           c->strokePaint == NULL && c->renderTarget == NULL);
+  
+  if (!empty) {
+    SH_UNLOCK_CONTEXTS();
+    shSetError(c, VG_ILLEGAL_ARGUMENT_ERROR);
+    return VG_FALSE;
+  }
+  
+  shDeleteRampAtlas(c);
+  SH_DELETEOBJ(SHShareGroup, g);
+  
+  SH_LOCK_SHARE(other);
+  c->share = other->share;
+  c->shareNext = c->share->contexts;
+  c->share->contexts = c;
+  SH_UNLOCK_SHARE(other);
+  SH_UNLOCK_CONTEXTS();
+  
+  return VG_TRUE;
+}
+
+/*-----------------------------------------------------
+ * Sets the OpenGL viewport and projection to the size
+ * of the surface
+ *-----------------------------------------------------*/
+
+void shGLResize(VGContext *c)
+{
+  /* depth buffer contents are undefined after a resize */
+  shEndScissoring(c);
   
   /* setup GL projection */
-  glViewport(0,0,width,height);
+  glViewport(0,0,c->surfaceWidth,c->surfaceHeight);
   
   glMatrixMode(GL_PROJECTION);
   glLoadIdentity();
-  gluOrtho2D(0,width,0,height);
+  gluOrtho2D(0,c->surfaceWidth,0,c->surfaceHeight);
   
   glMatrixMode(GL_MODELVIEW);
   glLoadIdentity();
-  
-  VG_RETURN(VG_NO_RETVAL);
 }
 
+/*-----------------------------------------------------
+ * Destroys the current context of the calling thread,
+ * which is left without one. Other contexts have to be
+ * made current first to be destroyed.
+ *-----------------------------------------------------*/
+
 VG_API_CALL void vgDestroyContextSH()
 {
+  SHint live;
+  
   /* return if already released */
   if (!g_context) return;
   
+  /* Only forget a context another thread destroyed
+     while current here too; there is no context left
+     to report the error on */
+  SH_LOCK_CONTEXTS();
+  live = shIsLiveContext(g_context);
+  SH_UNLOCK_CONTEXTS();
+  if (!live) {
+    g_context = NULL;
+    return;
+  }
+  
+  /* draw pending batch */
+  SH_LOCK_SHARE(g_context);
+  shFlushBatch(g_context);
+  SH_UNLOCK_SHARE(g_context);
+  
   /* delete context object */
-  SH_DELETEOBJ(VGContext, g_context);
+  shDeleteContext(g_context);
   g_context = NULL;
 }
 
+/*-----------------------------------------------------
+ * Makes a context returned by vgGetCurrentContextSH
+ * current to the calling thread, or leaves the thread
+ * without one for VG_INVALID_HANDLE. A context must not
+ * be current to more than one thread at a time, and
+ * the OpenGL context it was created on must be made
+ * current along with it, in either order: nothing is
+ * drawn by the switch itself (see shSetCurrentContext). Handles of contexts that
+ * were destroyed or never created leave the current
+ * one in place with VG_BAD_HANDLE_ERROR.
+ *-----------------------------------------------------*/
+
+VG_API_CALL void vgMakeCurrentSH(VGContextSH context)
+{
+  VGContext *c = (VGContext*)context;
+  SHint live = 1;
+  
+  if (c) {
+    SH_LOCK_CONTEXTS();
+    live = shIsLiveContext(c);
+    SH_UNLOCK_CONTEXTS();
+  }
+  
+  if (!live) {
+    if (g_context) {
+      SH_LOCK_SHARE(g_context);
+      shSetError(g_context, VG_BAD_HANDLE_ERROR);
+      SH_UNLOCK_SHARE(g_context);
+    }
+    return;
+  }
+  
+  shSetCurrentContext(c);
+}
+
+VG_API_CALL VGContextSH vgGetCurrentContextSH(void)
+{
+  return (VGContextSH)g_context;
+}
+
 VGContext* shGetContext()
 {
-  SH_ASSERT(g_context);
   return g_context;
 }
 
@@ -107,13 +496,17 @@ VGContext* shGetContext()
  * VGContext constructor
  *-----------------------------------------------------*/
 
-void shLoadExtensions(VGContext *c);
-
 void VGContext_ctor(VGContext *c)
 {
+  int i;
+  
   /* Surface info */
   c->surfaceWidth = 0;
   c->surfaceHeight = 0;
+  c->windowWidth = 0;
+  c->windowHeight = 0;
+  c->backend = &shGLBackend;
+  SH_INITOBJ(SHRaster, c->raster);
   
   /* GetString info */
   strncpy(c->vendor, "Ivan Leben", sizeof(c->vendor));
@@ -130,10 +523,73 @@ void VGContext_ctor(VGContext *c)
   c->imageMode = VG_DRAW_IMAGE_NORMAL;
   
   /* Scissor rectangles */
-  SH_INITOBJ(SHVector3Array, c->scissor);
-  SH_INITOBJ(SHUint16Array, c->scissorIndices);
+  SH_INITOBJ(SHRectArray, c->scissor);
+  SH_INITOBJ(SHRectArray, c->scissorBands);
+  shRectangleSet(&c->scissorBounds, 0,0,0,0);
+  c->scissorMaskValid = VG_FALSE;
   c->scissoring = VG_FALSE;
   c->masking = VG_FALSE;
+  c->maskData = NULL;
+  c->maskWidth = 0;
+  c->maskHeight = 0;
+  c->maskTexture = 0;
+  c->maskTexWidth = 0;
+  c->maskTexHeight = 0;
+  c->maskTexParams[0] = -1;
+  c->maskTexParams[1] = -1;
+  c->maskActive = 0;
+  
+  /* Damage tracking */
+  c->damageTracking = VG_FALSE;
+  SH_INITOBJ(SHRectArray, c->damage);
+  SH_INITOBJ(SHRectArray, c->lastDamage);
+  c->redrawCulling = VG_FALSE;
+  SH_INITOBJ(SHRectArray, c->redrawRects);
+  
+  c->fillTriangulation = VG_FALSE;
+  
+  /* Draw batching */
+  c->drawBatching = VG_FALSE;
+  c->retainGLState = VG_FALSE;
+  SH_INITOBJ(SHVector2Array, c->batchTriangles);
+  SH_INITOBJ(SHVector2Array, c->batchQuads);
+  CSET(c->batchColor, 0,0,0,0);
+  c->batchDraws = 0;
+  c->batchBuffer = 0;
+  
+  /* Instanced draws, the programs are built on first use */
+  SH_INITOBJ(SHFloatArray, c->instanceData);
+  c->instanceBuffer = 0;
+  SH_INITOBJ(SHPaint, c->instancePaint);
+  c->instanceProgramsState = 0;
+  SH_INITOBJ(SHInstanceProgram, c->instanceProgram);
+  SH_INITOBJ(SHInstanceProgram, c->instanceMaskProgram);
+  
+  /* Gradient programs are built on first use */
+  c->gradientShaders = VG_TRUE;
+  c->gradientProgramsState = 0;
+  SH_INITOBJ(SHGradientProgram, c->linearProgram);
+  SH_INITOBJ(SHGradientProgram, c->radialProgram);
+  SH_INITOBJ(SHGradientProgram, c->linearMaskProgram);
+  SH_INITOBJ(SHGradientProgram, c->radialMaskProgram);
+  
+  /* Drawing goes to the window */
+  c->renderTarget = NULL;
+  c->targetFramebuffer = 0;
+  c->targetDepthStencil = 0;
+  c->targetWidth = 0;
+  c->targetHeight = 0;
+  
+  /* Core-profile renderer, set up by shGLCoreInit */
+  c->coreVertexArray = 0;
+  c->coreVertexArrayBound = 0;
+  c->coreBuffer = 0;
+  c->coreTexture = 0;
+  c->coreTextureParams[0] = -1;
+  c->coreTextureParams[1] = -1;
+  SH_INITOBJ(SHVector2Array, c->coreVertices);
+  for (i=0; i<SH_CORE_PROGRAMS; ++i)
+    SH_INITOBJ(SHCoreProgram, c->corePrograms[i]);
   
   /* Stroke parameters */
   c->strokeLineWidth = 1.0f;
@@ -172,35 +628,192 @@ void VGContext_ctor(VGContext *c)
   /* Error */
   c->error = VG_NO_ERROR;
   
-  /* Resources */
-  SH_INITOBJ(SHPathArray, c->paths);
-  SH_INITOBJ(SHPaintArray, c->paints);
-  SH_INITOBJ(SHImageArray, c->images);
+  /* Resources, in a group of their own until joining
+     another context's */
+  SH_NEWOBJ(SHShareGroup, c->share);
+  if (c->share) c->share->contexts = c;
+  c->shareNext = NULL;
+  c->liveNext = NULL;
+  c->recordList = NULL;
+  
+  /* OpenGL state is unknown until first set */
+  SH_INITOBJ(SHGLState, c->glState);
+  
+  for (i=0; i<VG_STAT_COUNT_SH; ++i) {
+    c->stats[i] = 0;
+    c->frameStats[i] = 0;
+  }
+  
+  c->traceCallback = NULL;
+  c->traceUserData = NULL;
+}
 
-  shLoadExtensions(c);
+/*-----------------------------------------------------
+ * Takes the context out of its share group, the lock
+ * of which is held. The last context to leave frees
+ * the resources of the group.
+ *-----------------------------------------------------*/
+
+static void shLeaveShareGroup(VGContext *c)
+{
+  SHShareGroup *g = c->share;
+  VGContext **link;
+  SHint i, last;
+  
+  for (link = &g->contexts; *link != c; link = &(*link)->shareNext);
+  *link = c->shareNext;
+  c->shareNext = NULL;
+  last = (g->contexts == NULL);
+  SH_UNLOCK_SHARE(c);
+  
+  if (!last)
+    return;
+  
+  /* Destroy resources */
+  for (i=0; i<g->paths.size; ++i)
+    SH_DELETEOBJ(SHPath, g->paths.items[i]);
+  
+  for (i=0; i<g->paints.size; ++i)
+    shReleasePaint(g->paints.items[i]);
+  
+  for (i=0; i<g->images.size; ++i)
+    shReleaseImage(g->images.items[i]);
+  
+  for (i=0; i<g->commandLists.size; ++i)
+    SH_DELETEOBJ(SHCommandList, g->commandLists.items[i]);
+  
+  /* Paints release their ramps, so this is just a safety net */
+  for (i=0; i<g->ramps.size; ++i)
+    SH_DELETEOBJ(SHColorRamp, g->ramps.items[i]);
+  shDeleteRampAtlas(c);
+  
+  SH_DELETEOBJ(SHShareGroup, g);
+  c->share = NULL;
 }
 
 /*-----------------------------------------------------
- * VGContext constructor
+ * VGContext destructor
  *-----------------------------------------------------*/
 
 void VGContext_dtor(VGContext *c)
 {
   int i;
   
-  SH_DEINITOBJ(SHVector3Array, c->scissor);
-  SH_DEINITOBJ(SHUint16Array, c->scissorIndices);
+  /* Releasing paints and images touches the group */
+  if (c->share)
+    SH_LOCK_SHARE(c);
+  
+  SH_DEINITOBJ(SHRectArray, c->scissor);
+  SH_DEINITOBJ(SHRectArray, c->scissorBands);
+  SH_DEINITOBJ(SHRectArray, c->damage);
+  SH_DEINITOBJ(SHRectArray, c->lastDamage);
+  SH_DEINITOBJ(SHRectArray, c->redrawRects);
   SH_DEINITOBJ(SHFloatArray, c->strokeDashPattern);
+  SH_DEINITOBJ(SHVector2Array, c->batchTriangles);
+  SH_DEINITOBJ(SHVector2Array, c->batchQuads);
+  SH_DEINITOBJ(SHGLState, c->glState);
+  SH_DEINITOBJ(SHRaster, c->raster);
   
-  /* Destroy resources */
-  for (i=0; i<c->paths.size; ++i)
-    SH_DELETEOBJ(SHPath, c->paths.items[i]);
+  SH_DEINITOBJ(SHFloatArray, c->instanceData);
+  SH_DEINITOBJ(SHPaint, c->instancePaint);
+  
+  if (c->batchBuffer)
+    c->pglDeleteBuffers(1, &c->batchBuffer);
+  if (c->instanceBuffer)
+    c->pglDeleteBuffers(1, &c->instanceBuffer);
+  
+  if (c->gradientProgramsState > 0)
+    shDeleteGradientPrograms(c);
+  SH_DEINITOBJ(SHGradientProgram, c->linearProgram);
+  SH_DEINITOBJ(SHGradientProgram, c->radialProgram);
+  SH_DEINITOBJ(SHGradientProgram, c->linearMaskProgram);
+  SH_DEINITOBJ(SHGradientProgram, c->radialMaskProgram);
+  if (c->instanceProgramsState > 0)
+    shDeleteInstancePrograms(c);
+  SH_DEINITOBJ(SHInstanceProgram, c->instanceProgram);
+  SH_DEINITOBJ(SHInstanceProgram, c->instanceMaskProgram);
+  shReleaseRenderTarget(c);
+  shCloseTrace(c);
+  if (c->targetFramebuffer)
+    c->pglDeleteFramebuffers(1, &c->targetFramebuffer);
+  if (c->targetDepthStencil)
+    c->pglDeleteRenderbuffers(1, &c->targetDepthStencil);
+  
+  if (c->backend == &shGLCoreBackend)
+    shGLCoreRelease(c);
+  SH_DEINITOBJ(SHVector2Array, c->coreVertices);
+  for (i=0; i<SH_CORE_PROGRAMS; ++i)
+    SH_DEINITOBJ(SHCoreProgram, c->corePrograms[i]);
+  shDeleteMask(c);
+  
+  shReleasePaint(c->fillPaint);
+  shReleasePaint(c->strokePaint);
+  
+  if (c->share)
+    shLeaveShareGroup(c);
+}
+
+/*-----------------------------------------------------
+ * Share group constructor and destructor
+ *-----------------------------------------------------*/
+
+void SHShareGroup_ctor(SHShareGroup *g)
+{
+  g->contexts = NULL;
+  SH_INITOBJ(SHPathArray, g->paths);
+  SH_INITOBJ(SHPaintArray, g->paints);
+  SH_INITOBJ(SHImageArray, g->images);
+  SH_INITOBJ(SHCommandListArray, g->commandLists);
+  g->objectGeneration = 0;
+  SH_INITOBJ(SHColorRampArray, g->ramps);
+  SH_INITOBJ(SHUint8Array, g->rampAtlasRows);
+  g->rampAtlas = 0;
+  g->rampAtlasParams[0] = g->rampAtlasParams[1] = -1;
+  
+#if defined(SH_SHARE_LOCKING)
+  pthread_mutex_init(&g->lock, NULL);
+#endif
+}
+
+void SHShareGroup_dtor(SHShareGroup *g)
+{
+  SH_DEINITOBJ(SHPathArray, g->paths);
+  SH_DEINITOBJ(SHPaintArray, g->paints);
+  SH_DEINITOBJ(SHImageArray, g->images);
+  SH_DEINITOBJ(SHCommandListArray, g->commandLists);
+  SH_DEINITOBJ(SHColorRampArray, g->ramps);
+  SH_DEINITOBJ(SHUint8Array, g->rampAtlasRows);
+  
+#if defined(SH_SHARE_LOCKING)
+  pthread_mutex_destroy(&g->lock);
+#endif
+}
+
+/*-----------------------------------------------------
+ * Draws what the software contexts of the group have
+ * binned, before an image they may read changes
+ *-----------------------------------------------------*/
+
+void shFlushShareGroup(VGContext *c)
+{
+  VGContext *o;
   
-  for (i=0; i<c->paints.size; ++i)
-    SH_DELETEOBJ(SHPaint, c->paints.items[i]);
+  for (o = c->share->contexts; o; o = o->shareNext)
+    shRasterFlush(o);
+}
+
+/*-----------------------------------------------------
+ * Drops a shared texture about to be deleted from the
+ * OpenGL state shadows of the contexts of the group
+ *-----------------------------------------------------*/
+
+void shForgetSharedTexture(VGContext *c, GLuint texture)
+{
+  VGContext *o;
   
-  for (i=0; i<c->images.size; ++i)
-    SH_DELETEOBJ(SHImage, c->images.items[i]);
+  shGLStateForgetTexture(&c->glState, texture);
+  for (o = c->share->contexts; o; o = o->shareNext)
+    if (o != c) shGLStateForgetTexture(&o->glState, texture);
 }
 
 /*--------------------------------------------------
@@ -209,19 +822,19 @@ void VGContext_dtor(VGContext *c)
 
 SHint shIsValidPath(VGContext *c, VGHandle h)
 {
-  int index = shPathArrayFind(&c->paths, (SHPath*)h);
+  int index = shPathArrayFind(&c->share->paths, (SHPath*)h);
   return (index == -1) ? 0 : 1;
 }
 
 SHint shIsValidPaint(VGContext *c, VGHandle h)
 {
-  int index = shPaintArrayFind(&c->paints, (SHPaint*)h);
+  int index = shPaintArrayFind(&c->share->paints, (SHPaint*)h);
   return (index == -1) ? 0 : 1;
 }
 
 SHint shIsValidImage(VGContext *c, VGHandle h)
 {
-  int index = shImageArrayFind(&c->images, (SHImage*)h);
+  int index = shImageArrayFind(&c->share->images, (SHImage*)h);
   return (index == -1) ? 0 : 1;
 }
 
@@ -273,57 +886,86 @@ VG_API_CALL VGErrorCode vgGetError(void)
 VG_API_CALL void vgFlush(void)
 {
   VG_GETCONTEXT(VG_NO_RETVAL);
-  glFlush();
+  shFlushBatch(context);
+  SH_TRACE_BEGIN(context, "submit");
+  context->backend->endFrame(context, 0);
+  SH_TRACE_END(context, "submit");
+  shEndDamageFrame(context);
+  shEndStatisticsFrame(context);
   VG_RETURN(VG_NO_RETVAL);
 }
 
 VG_API_CALL void vgFinish(void)
 {
   VG_GETCONTEXT(VG_NO_RETVAL);
-  glFinish();
+  shFlushBatch(context);
+  SH_TRACE_BEGIN(context, "submit");
+  context->backend->endFrame(context, 1);
+  SH_TRACE_END(context, "submit");
+  shEndDamageFrame(context);
+  shEndStatisticsFrame(context);
   VG_RETURN(VG_NO_RETVAL);
 }
 
-VG_API_CALL void vgMask(VGImage mask, VGMaskOperation operation,
-                        VGint x, VGint y, VGint width, VGint height)
+/*-----------------------------------------------------
+ * Moves the counters of the current frame to the ones
+ * reported by VG_FRAME_STATISTICS_SH
+ *-----------------------------------------------------*/
+
+void shEndStatisticsFrame(VGContext *c)
 {
+  SHint i;
+  
+  for (i=0; i<VG_STAT_COUNT_SH; ++i) {
+    c->frameStats[i] = c->stats[i];
+    c->stats[i] = 0;
+  }
 }
 
-static void makeRectangle(VGfloat x, VGfloat y, VGfloat w, VGfloat h, VGfloat z,
-                          SHVector3* coords, SHuint16* indices,
-                          SHuint16 indexBase)
+VG_API_CALL void vgResetStatisticsSH(void)
 {
-  if (coords) {
-    coords->x = x;  coords->y = y;  coords->z = z;
-    coords++;
-    coords->x = x + w;  coords->y = y;  coords->z = z;
-    coords++;
-    coords->x = x + w;  coords->y = y + h;  coords->z = z;
-    coords++;
-    coords->x = x;  coords->y = y + h;  coords->z = z;
-  }
-  if (indices) {
-    indices[0] = indexBase;
-    indices[1] = indexBase + 1;
-    indices[2] = indexBase + 2;
-    indices[3] = indexBase;
-    indices[4] = indexBase + 2;
-    indices[5] = indexBase + 3;
+  SHint i;
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  for (i=0; i<VG_STAT_COUNT_SH; ++i) {
+    context->frameStats[i] = 0;
+    context->stats[i] = 0;
   }
+  
+  VG_RETURN(VG_NO_RETVAL);
 }
 
-VG_API_CALL void vgClear(VGint x, VGint y, VGint width, VGint height)
+/*-----------------------------------------------------
+ * Ends an OpenGL frame. The application may touch
+ * OpenGL state from here on.
+ *-----------------------------------------------------*/
+
+void shGLEndFrame(VGContext *context, SHint finish)
 {
-  SHVector3 clearVerts[4];
-  static SHuint16 clearIdx[6] = {0, 1, 2, 0, 2, 3};
+  if (finish) glFinish();
+  else glFlush();
   
-  VG_GETCONTEXT(VG_NO_RETVAL);
+  shEndScissoring(context);
+  shGLStateEndFrame(&context->glState);
+  shGLStateInvalidate(&context->glState);
+}
+
+/*-----------------------------------------------------
+ * Clears the surface area, given clipped to it, with
+ * the scissor box, or through the depth mask for more
+ * than a single scissor rectangle
+ *-----------------------------------------------------*/
+
+void shGLClear(VGContext *context, SHint x, SHint y,
+               SHint width, SHint height)
+{
+  SHRectangle area;
+  GLint x0, y0, x1, y1;
+  
+  shFlushBatch(context);
+  shRectangleSet(&area, (SHfloat)x, (SHfloat)y,
+                 (SHfloat)width, (SHfloat)height);
   
-  /* Clip to window */
-  if (x < 0) x = 0;
-  if (y < 0) y = 0;
-  if (width > context->surfaceWidth) width = context->surfaceWidth;
-  if (height > context->surfaceHeight) height = context->surfaceHeight;
   /* Check if scissoring needed */
   if (context->scissoring == VG_FALSE) {
     if (x > 0 || y > 0 ||
@@ -331,36 +973,91 @@ VG_API_CALL void vgClear(VGint x, VGint y, VGint width, VGint height)
         height < context->surfaceHeight) {
     
       glScissor(x, y, width, height);
-      glEnable(GL_SCISSOR_TEST);
+      shGLEnable(context, GL_SCISSOR_TEST);
     }
     glClearColor(context->clearColor.r,
                  context->clearColor.g,
                  context->clearColor.b,
                  context->clearColor.a);
     glClear(GL_COLOR_BUFFER_BIT);
-    glDisable(GL_SCISSOR_TEST);
-    VG_RETURN(VG_NO_RETVAL);
+    shGLDisable(context, GL_SCISSOR_TEST);
+    SH_RETURN(SH_NO_RETVAL);
   }
   
-  makeRectangle((VGfloat)x, (VGfloat)y, (VGfloat)width, (VGfloat)height,
-                0.0f, clearVerts, 0, 0);
+  if (!shBeginScissoring(context, &area))
+    SH_RETURN(SH_NO_RETVAL);
+  
+  /* Narrow the scissor box down to the cleared area */
+  x0 = SH_MAX(x, (GLint)SH_FLOOR(context->scissorBounds.x));
+  y0 = SH_MAX(y, (GLint)SH_FLOOR(context->scissorBounds.y));
+  x1 = SH_MIN(x + width, (GLint)SH_CEIL(context->scissorBounds.x +
+                                        context->scissorBounds.w));
+  y1 = SH_MIN(y + height, (GLint)SH_CEIL(context->scissorBounds.y +
+                                         context->scissorBounds.h));
+  glScissor(x0, y0, x1 - x0, y1 - y0);
+  
+  if (context->scissorBands.size == 1) {
+    /* A single rectangle is handled by the scissor box alone */
+    glClearColor(context->clearColor.r,
+                 context->clearColor.g,
+                 context->clearColor.b,
+                 context->clearColor.a);
+    glClear(GL_COLOR_BUFFER_BIT);
+    SH_RETURN(SH_NO_RETVAL);
+  }
+  
+  /* Otherwise fill the area through the depth mask */
+  if (context->backend == &shGLCoreBackend) {
+    shRectangleSet(&area, (SHfloat)x0, (SHfloat)y0,
+                   (SHfloat)(x1 - x0), (SHfloat)(y1 - y0));
+    shGLCoreFillRects(context, &area, 1, 0.0f, &context->clearColor);
+    SH_RETURN(SH_NO_RETVAL);
+  }
+  
+  shGLDisable(context, GL_BLEND);
   glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
   glLoadIdentity();
-  /* Clear GL color buffer */
-  glEnableClientState(GL_VERTEX_ARRAY);
-  glVertexPointer(3, GL_FLOAT, 0, clearVerts);
   glColor4fv(&context->clearColor.r);
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, clearIdx);
-  glDisableClientState(GL_VERTEX_ARRAY);
+  glBegin(GL_QUADS);
+  glVertex2i(x0, y0);
+  glVertex2i(x1, y0);
+  glVertex2i(x1, y1);
+  glVertex2i(x0, y1);
+  glEnd();
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  glPopMatrix();
 
   /* TODO: what about stencil and depth? when do we clear that?
      we would need some kind of special "begin" function at
      beginning of each drawing or clear the planes prior to each
      drawing where it takes places */
   
-  VG_RETURN(VG_NO_RETVAL);
+  SH_RETURN(SH_NO_RETVAL);
 }
 
+VG_API_CALL void vgClear(VGint x, VGint y, VGint width, VGint height)
+{
+  SHRectangle area;
+  
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  /* Clip to window */
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+  if (width > context->surfaceWidth) width = context->surfaceWidth;
+  if (height > context->surfaceHeight) height = context->surfaceHeight;
+  shRectangleSet(&area, (SHfloat)x, (SHfloat)y,
+                 (SHfloat)width, (SHfloat)height);
+  if (!shRecordDraw(context, &area))
+    VG_RETURN(VG_NO_RETVAL);
+  
+  SH_TRACE_BEGIN(context, "submit");
+  context->backend->clear(context, x, y, width, height);
+  SH_TRACE_END(context, "submit");
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
 
 /*-----------------------------------------------------------
  * Returns the matrix currently selected via VG_MATRIX_MODE
@@ -536,90 +1233,336 @@ VG_API_CALL VGHardwareQueryResult vgHardwareQuery(VGHardwareQueryType key,
   return VG_HARDWARE_UNACCELERATED;
 }
 
-void shBuildScissorContext(VGContext* c, SHint count, const void* values,
-                           SHint floats)
+/*-----------------------------------------------------------
+ * Scissor rectangles are decomposed into disjoint bands:
+ * horizontal slabs between consecutive rectangle edges, each
+ * holding the merged x-intervals of the rectangles crossing
+ * it, with equal neighbouring slabs joined together. A union
+ * that is a single rectangle then uses plain glScissor, and
+ * the culling tests need not deal with overlaps.
+ *-----------------------------------------------------------*/
+
+static int shCompareFloats(const void *a, const void *b)
 {
-  SHint numRects;
-  SHVector3* vert;
-  SHuint16* idx;
-  SHuint16 rectIdx;
-  SHint i;
+  SHfloat fa = *(const SHfloat*)a;
+  SHfloat fb = *(const SHfloat*)b;
+  return (fa < fb ? -1 : (fa > fb ? 1 : 0));
+}
+
+static int shCompareIntervals(const void *a, const void *b)
+{
+  return shCompareFloats(&((const SHVector2*)a)->x,
+                         &((const SHVector2*)b)->x);
+}
 
-  count = SH_MIN(count, SH_MAX_SCISSOR_RECTS * 4);
-  numRects  = count / 4;
-  shVector3ArrayReserve(&c->scissor, count);
-  c->scissor.size = count;
-  shUint16ArrayReserve(&c->scissorIndices, numRects * 6);
-  c->scissorIndices.size = numRects * 6;
-  for (vert = c->scissor.items, idx = c->scissorIndices.items, rectIdx = 0;
-       rectIdx < count;
-       vert += 4, idx += 6, rectIdx += 4) {
-    SHRectangle r;
-    r.x = shParamToFloat(values, floats, rectIdx + 0);
-    r.y = shParamToFloat(values, floats, rectIdx + 1);
-    r.w = shParamToFloat(values, floats, rectIdx + 2);
-    r.h = shParamToFloat(values, floats, rectIdx + 3);
-    if (r.w < 0 || r.h < 0) {
-      r.w = 0;
-      r.h = 0;
+static void shDecomposeScissorRects(VGContext *c)
+{
+  SHFloatArray ys;
+  SHVector2Array spans;
+  SHVector2 span;
+  SHRectangle *r, band;
+  SHint i, j, y, prevStart = 0, prevCount = 0, start;
+  SHfloat y0, y1;
+  
+  shRectArrayClear(&c->scissorBands);
+  SH_INITOBJ(SHFloatArray, ys);
+  SH_INITOBJ(SHVector2Array, spans);
+  
+  /* Sorted unique horizontal edges */
+  for (i=0; i<c->scissor.size; ++i) {
+    r = &c->scissor.items[i];
+    if (r->w <= 0.0f || r->h <= 0.0f) continue;
+    shFloatArrayPushBack(&ys, r->y);
+    shFloatArrayPushBack(&ys, r->y + r->h);
+  }
+  
+  qsort(ys.items, ys.size, sizeof(SHfloat), shCompareFloats);
+  for (i=1, j=0; i<ys.size; ++i)
+    if (ys.items[i] != ys.items[j]) ys.items[++j] = ys.items[i];
+  if (ys.size > 0) ys.size = j+1;
+  
+  for (y=0; y+1<ys.size; ++y) {
+    y0 = ys.items[y];
+    y1 = ys.items[y+1];
+    
+    /* Intervals of the rectangles spanning this slab */
+    shVector2ArrayClear(&spans);
+    for (i=0; i<c->scissor.size; ++i) {
+      r = &c->scissor.items[i];
+      if (r->w <= 0.0f || r->h <= 0.0f) continue;
+      if (r->y > y0 || r->y + r->h < y1) continue;
+      SET2(span, r->x, r->x + r->w);
+      shVector2ArrayPushBackP(&spans, &span);
+    }
+    
+    /* Merge overlapping and touching ones */
+    qsort(spans.items, spans.size, sizeof(SHVector2), shCompareIntervals);
+    for (i=1, j=0; i<spans.size; ++i) {
+      if (spans.items[i].x <= spans.items[j].y) {
+        if (spans.items[i].y > spans.items[j].y)
+          spans.items[j].y = spans.items[i].y;
+      }else spans.items[++j] = spans.items[i];
+    }
+    if (spans.size > 0) spans.size = j+1;
+    
+    /* Extend the previous slab if it has the same intervals */
+    if (prevCount == spans.size && prevCount > 0 &&
+        c->scissorBands.items[prevStart].y +
+        c->scissorBands.items[prevStart].h == y0) {
+      for (i=0; i<spans.size; ++i) {
+        r = &c->scissorBands.items[prevStart + i];
+        if (r->x != spans.items[i].x ||
+            r->x + r->w != spans.items[i].y) break;
+      }
+      if (i == spans.size) {
+        for (i=0; i<spans.size; ++i)
+          c->scissorBands.items[prevStart + i].h = y1 - 
+            c->scissorBands.items[prevStart + i].y;
+        continue;
+      }
+    }
+    
+    start = c->scissorBands.size;
+    for (i=0; i<spans.size; ++i) {
+      shRectangleSet(&band, spans.items[i].x, y0,
+                     spans.items[i].y - spans.items[i].x, y1 - y0);
+      shRectArrayPushBackP(&c->scissorBands, &band);
     }
-    makeRectangle(r.x, r.y, r.w, r.h, -.5f, vert, idx, rectIdx);
+    
+    prevStart = start;
+    prevCount = spans.size;
+  }
+  
+  SH_DEINITOBJ(SHFloatArray, ys);
+  SH_DEINITOBJ(SHVector2Array, spans);
+  
+  /* Bounds of the union */
+  for (i=0; i<c->scissorBands.size; ++i) {
+    r = &c->scissorBands.items[i];
+    if (i == 0) { c->scissorBounds = *r; continue; }
+    y0 = SH_MIN(c->scissorBounds.x, r->x);
+    y1 = SH_MAX(c->scissorBounds.x + c->scissorBounds.w, r->x + r->w);
+    c->scissorBounds.x = y0; c->scissorBounds.w = y1 - y0;
+    y0 = SH_MIN(c->scissorBounds.y, r->y);
+    y1 = SH_MAX(c->scissorBounds.y + c->scissorBounds.h, r->y + r->h);
+    c->scissorBounds.y = y0; c->scissorBounds.h = y1 - y0;
   }
-  if (c->scissoring == VG_TRUE)
-    shEnableScissoring(c);
 }
 
-int shCopyOutScissorParams(VGContext *c, SHint count, void *values,
-                           SHint floats)
+/*-----------------------------------------------------------
+ * Conversion of rectangle lists from and to parameter
+ * vectors of (x, y, width, height) quadruples
+ *-----------------------------------------------------------*/
+
+void shRectsFromParams(SHRectArray *rects, SHint max, SHint count,
+                       const void *values, SHint floats)
+{
+  SHRectangle r;
+  SHint i;
+
+  count = SH_MIN(count, max * 4);
+  shRectArrayClear(rects);
+  shRectArrayReserve(rects, count / 4);
+  
+  for (i = 0; i + 3 < count; i += 4) {
+    r.x = shParamToFloat(values, floats, i + 0);
+    r.y = shParamToFloat(values, floats, i + 1);
+    r.w = shParamToFloat(values, floats, i + 2);
+    r.h = shParamToFloat(values, floats, i + 3);
+    shRectArrayPushBackP(rects, &r);
+  }
+}
+
+int shRectsToParams(SHRectArray *rects, SHint count, void *values,
+                    SHint floats)
 {
   int i;
   
-  if (count > (c->scissor.size))
+  if (count > rects->size * 4)
     return 1;
-  for (i = 0; i < c->scissor.size; i += 4) {
-    SHRectangle r;
-    
-    r.x = c->scissor.items[i].x;
-    r.y = c->scissor.items[i].y;
-    r.w = c->scissor.items[i + 2].x - r.x;
-    r.h = c->scissor.items[i + 2].y - r.y;
+  for (i = 0; i < count / 4; ++i) {
+    SHRectangle *r = &rects->items[i];
     /* XXX should round to nearest integer */
-    shIntToParam((SHint)r.x, count, values, floats, i + 0);
-    shIntToParam((SHint)r.y, count, values, floats, i + 1);
-    shIntToParam((SHint)r.w, count, values, floats, i + 2);
-    shIntToParam((SHint)r.h, count, values, floats, i + 3);
+    shIntToParam((SHint)r->x, count, values, floats, i*4 + 0);
+    shIntToParam((SHint)r->y, count, values, floats, i*4 + 1);
+    shIntToParam((SHint)r->w, count, values, floats, i*4 + 2);
+    shIntToParam((SHint)r->h, count, values, floats, i*4 + 3);
   }
   return 0;
 }
 
-/* The scissor test makes use of the depth buffer. The default ortho2D
-   z range is from 1 to -1. The depth buffer is cleared to the near
-   plane, so that nothing can pass the depth test. The scissor
-   rectangles are drawn at -.5, which punches out a mask in the depth buffer.
-   Stroke polygons and everything else are rendered at z = 0, so they
-   will be rendered where the scissor rectangles were drawn. */
+void shBuildScissorContext(VGContext* c, SHint count, const void* values,
+                           SHint floats)
+{
+  shRectsFromParams(&c->scissor, SH_MAX_SCISSOR_RECTS,
+                    count, values, floats);
+  shDecomposeScissorRects(c);
+  c->scissorMaskValid = VG_FALSE;
+}
+
+/* Same as above from rectangles already converted */
+void shSetScissorRects(VGContext *c, const SHRectangle *rects, SHint count)
+{
+  SHint i;
+  
+  shRectArrayClear(&c->scissor);
+  shRectArrayReserve(&c->scissor, count);
+  for (i=0; i<count; ++i)
+    shRectArrayPushBack(&c->scissor, rects[i]);
+  
+  shDecomposeScissorRects(c);
+  c->scissorMaskValid = VG_FALSE;
+}
+
+int shCopyOutScissorParams(VGContext *c, SHint count, void *values,
+                           SHint floats)
+{
+  return shRectsToParams(&c->scissor, count, values, floats);
+}
+
+/* With more than one band the scissor test makes use of the depth
+   buffer. The default ortho2D z range is from 1 to -1. The depth
+   buffer is cleared to the near plane, so that nothing can pass the
+   depth test. The bands are drawn at -.5, which punches out a mask
+   in the depth buffer. Stroke polygons and everything else are
+   rendered at z = 0, so they will be rendered where the bands were
+   drawn. The mask stays valid until the rectangles or the surface
+   change or vgFlush / vgFinish hand the buffers back to the
+   application, and is rebuilt by the next draw that needs it. */
 
-void shEnableScissoring(VGContext *c)
+static void shBuildScissorMask(VGContext *c)
 {
-  glDepthMask(GL_TRUE);
+  SHRectangle *r;
+  SHint i;
+  
+  shGLDisable(c, GL_SCISSOR_TEST);
+  shGLDepthMask(c, GL_TRUE);
   glClear(GL_DEPTH_BUFFER_BIT);
-  glEnable(GL_DEPTH_TEST);
-  if (c->scissor.size > 0) {
-    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-    /* Render scissor polys with depth test "disabled." */
-    glDepthFunc(GL_ALWAYS);
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, c->scissor.items);
-    glDrawElements(GL_TRIANGLES, c->scissorIndices.size, GL_UNSIGNED_SHORT,
-                   c->scissorIndices.items);
-    glDisableClientState(GL_VERTEX_ARRAY);
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  shGLEnable(c, GL_DEPTH_TEST);
+  
+  shGLColorMask(c, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  /* Render bands with depth test "disabled." */
+  shGLDepthFunc(c, GL_ALWAYS);
+  if (c->backend == &shGLCoreBackend) {
+    /* Same depth after the ortho2D projection */
+    shGLCoreFillRects(c, c->scissorBands.items, c->scissorBands.size,
+                      0.5f, NULL);
+  }else{
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glBegin(GL_QUADS);
+    for (i=0; i<c->scissorBands.size; ++i) {
+      r = &c->scissorBands.items[i];
+      glVertex3f(r->x, r->y, -.5f);
+      glVertex3f(r->x + r->w, r->y, -.5f);
+      glVertex3f(r->x + r->w, r->y + r->h, -.5f);
+      glVertex3f(r->x, r->y + r->h, -.5f);
+    }
+    glEnd();
+    SH_COUNT(c, VG_STAT_DRAW_CALLS_SH, 1);
+    glPopMatrix();
   }
-  glDepthMask(GL_FALSE);
-  glDepthFunc(GL_LESS);
+  shGLColorMask(c, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  
+  shGLDepthMask(c, GL_FALSE);
+  c->scissorMaskValid = VG_TRUE;
 }
 
-void shDisableScissoring(VGContext *c)
+static SHint shRectsOverlap(SHRectangle *a, SHRectangle *b)
 {
-  glDisable(GL_DEPTH_TEST);
+  return (a->x < b->x + b->w && b->x < a->x + a->w &&
+          a->y < b->y + b->h && b->y < a->y + a->h);
+}
+
+/*-----------------------------------------------------------
+ * Sets up scissoring for the next draw, which covers the
+ * given surface-space bounds (or anything if NULL). Returns
+ * 0 if the draw is scissored away completely.
+ *-----------------------------------------------------------*/
+
+SHint shBeginScissoring(VGContext *c, SHRectangle *bounds)
+{
+  SHRectangle *r;
+  SHint i;
+  
+  if (c->scissoring == VG_FALSE) {
+    shGLDisable(c, GL_SCISSOR_TEST);
+    shGLDisable(c, GL_DEPTH_TEST);
+    return 1;
+  }
+  
+  if (c->scissorBands.size == 0)
+    return 0;
+  
+  /* Cull against the union of the rectangles */
+  if (bounds) {
+    if (!shRectsOverlap(bounds, &c->scissorBounds))
+      return 0;
+    for (i=0; i<c->scissorBands.size; ++i)
+      if (shRectsOverlap(bounds, &c->scissorBands.items[i])) break;
+    if (i == c->scissorBands.size)
+      return 0;
+  }
+  
+  if (c->scissorBands.size > 1) {
+    if (c->scissorMaskValid == VG_FALSE)
+      shBuildScissorMask(c);
+    shGLEnable(c, GL_DEPTH_TEST);
+    shGLDepthFunc(c, GL_LESS);
+    shGLDepthMask(c, GL_FALSE);
+  }else{
+    shGLDisable(c, GL_DEPTH_TEST);
+  }
+  
+  /* The bounds of the union clip the rest of the
+     surface cheaply in either case */
+  r = &c->scissorBounds;
+  glScissor((GLint)SH_FLOOR(r->x), (GLint)SH_FLOOR(r->y),
+            (GLint)SH_CEIL(r->x + r->w) - (GLint)SH_FLOOR(r->x),
+            (GLint)SH_CEIL(r->y + r->h) - (GLint)SH_FLOOR(r->y));
+  shGLEnable(c, GL_SCISSOR_TEST);
+  return 1;
+}
+
+/*-----------------------------------------------------------
+ * Leaves the scissor and depth tests off for the application
+ * and forgets the depth mask, whose contents are not ours
+ * to rely on anymore.
+ *-----------------------------------------------------------*/
+
+void shEndScissoring(VGContext *c)
+{
+  shGLDisable(c, GL_SCISSOR_TEST);
+  shGLDisable(c, GL_DEPTH_TEST);
+  c->scissorMaskValid = VG_FALSE;
+}
+
+/*-----------------------------------------------------------
+ * Surface-space bounds of a user-space box under the given
+ * transformation
+ *-----------------------------------------------------------*/
+
+void shTransformBounds(SHMatrix3x3 *m, SHVector2 *min, SHVector2 *max,
+                       SHfloat pad, SHRectangle *out)
+{
+  SHVector2 corners[4];
+  SHfloat x0=0, y0=0, x1=0, y1=0;
+  SHint i;
+  
+  SET2(corners[0], min->x - pad, min->y - pad);
+  SET2(corners[1], max->x + pad, min->y - pad);
+  SET2(corners[2], max->x + pad, max->y + pad);
+  SET2(corners[3], min->x - pad, max->y + pad);
+  
+  for (i=0; i<4; ++i) {
+    TRANSFORM2(corners[i], (*m));
+    if (i == 0 || corners[i].x < x0) x0 = corners[i].x;
+    if (i == 0 || corners[i].x > x1) x1 = corners[i].x;
+    if (i == 0 || corners[i].y < y0) y0 = corners[i].y;
+    if (i == 0 || corners[i].y > y1) y1 = corners[i].y;
+  }
+  
+  /* One pixel more for antialiasing */
+  shRectangleSet(out, x0 - 1.0f, y0 - 1.0f, x1 - x0 + 2.0f, y1 - y0 + 2.0f);
 }
@@ -27,6 +27,65 @@
 #include "shPath.h"
 #include "shPaint.h"
 #include "shImage.h"
+#include "shGLState.h"
+#include "shShader.h"
+#include "shCommandList.h"
+#include "shRaster.h"
+#include "shBackend.h"
+
+/* Texture unit sampling the alpha mask; the pipeline
+   uses the units below it for paints and images */
+#define SH_MASK_TEXTURE_UNIT GL_TEXTURE2
+
+/* Contexts sharing resources take turns on a mutex,
+   which needs POSIX threads */
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_LIBPTHREAD)
+#  define SH_SHARE_LOCKING
+#  include <pthread.h>
+#endif
+
+/*------------------------------------------------
+ * Resources of a group of contexts. Freed with the
+ * last context leaving the group.
+ *------------------------------------------------*/
+
+struct VGContext;
+
+typedef struct SHShareGroup
+{
+  /* Contexts of the group, linked by shareNext */
+  struct VGContext  *contexts;
+  
+  SHPathArray       paths;
+  SHPaintArray      paints;
+  SHImageArray      images;
+  SHCommandListArray commandLists;
+  
+  /* Bumped when a path, paint or image is destroyed */
+  SHint             objectGeneration;
+  
+  /* Color ramps shared by paints and the atlas texture
+     holding them, with a used flag per atlas row */
+  SHColorRampArray  ramps;
+  SHUint8Array      rampAtlasRows;
+  GLuint            rampAtlas;
+  GLint             rampAtlasParams[2];
+  
+#if defined(SH_SHARE_LOCKING)
+  pthread_mutex_t   lock;
+#endif
+} SHShareGroup;
+
+void SHShareGroup_ctor(SHShareGroup *g);
+void SHShareGroup_dtor(SHShareGroup *g);
+
+#if defined(SH_SHARE_LOCKING)
+#  define SH_LOCK_SHARE(C) pthread_mutex_lock(&(C)->share->lock)
+#  define SH_UNLOCK_SHARE(C) pthread_mutex_unlock(&(C)->share->lock)
+#else
+#  define SH_LOCK_SHARE(C) ((void)0)
+#  define SH_UNLOCK_SHARE(C) ((void)0)
+#endif
 
 /*------------------------------------------------
  * VGContext object
@@ -40,12 +99,22 @@ typedef enum
   SH_RESOURCE_IMAGE     = 3
 } SHResourceType;
 
-typedef struct
+typedef struct VGContext
 {
   /* Surface info (since no EGL yet) */
   SHint surfaceWidth;
   SHint surfaceHeight;
   
+  /* Size of the window surface, which the above is too
+     unless an image is the render target (see shImage.c) */
+  SHint windowWidth;
+  SHint windowHeight;
+  
+  /* Renderer of the context (see shBackend.h), and the
+     caller's buffer of software contexts (see shRaster.c) */
+  const SHBackend *backend;
+  SHRaster raster;
+  
   /* GetString info */
   char vendor[256];
   char renderer[256];
@@ -61,11 +130,82 @@ typedef struct
 	VGImageMode         imageMode;
   
 	/* Scissor rectangles */
-  SHVector3Array     scissor;
-  SHUint16Array      scissorIndices;
+  SHRectArray        scissor;
+  SHRectArray        scissorBands;
+  SHRectangle        scissorBounds;
+  VGboolean          scissorMaskValid;
   VGboolean          scissoring;
   VGboolean          masking;
   
+  /* Alpha mask (see shMask.c), all ones while maskData
+     is NULL. maskActive is set while draws sample it. */
+  SHuint8           *maskData;
+  SHint              maskWidth;
+  SHint              maskHeight;
+  GLuint             maskTexture;
+  SHint              maskTexWidth;
+  SHint              maskTexHeight;
+  GLint              maskTexParams[2];
+  SHint              maskActive;
+  
+  /* Damaged areas of the current and the last frame and
+     the region outside of which draws are dropped */
+  VGboolean          damageTracking;
+  SHRectArray        damage;
+  SHRectArray        lastDamage;
+  VGboolean          redrawCulling;
+  SHRectArray        redrawRects;
+  
+  /* Command list being recorded, if any */
+  SHCommandList     *recordList;
+  
+  /* Fill with a CPU triangulation instead of stencil */
+  VGboolean          fillTriangulation;
+  
+  /* Keep the OpenGL state shadow between API calls */
+  VGboolean          retainGLState;
+  
+  /* Pending batch of fills (see shPipeline.c) */
+  VGboolean          drawBatching;
+  SHVector2Array     batchTriangles;
+  SHVector2Array     batchQuads;
+  SHColor            batchColor;
+  SHint              batchDraws;
+  GLuint             batchBuffer;
+  
+  /* Instanced draws (see shPipeline.c) */
+  SHFloatArray       instanceData;
+  GLuint             instanceBuffer;
+  SHPaint            instancePaint;
+  SHint              instanceProgramsState;
+  SHInstanceProgram  instanceProgram;
+  SHInstanceProgram  instanceMaskProgram;
+  
+  /* Image drawn into instead of the window, through a
+     framebuffer object with a depth and stencil buffer */
+  SHImage           *renderTarget;
+  GLuint             targetFramebuffer;
+  GLuint             targetDepthStencil;
+  SHint              targetWidth;
+  SHint              targetHeight;
+  
+  /* Core-profile renderer (see shGLCore.c) */
+  GLuint             coreVertexArray;
+  SHint              coreVertexArrayBound;
+  GLuint             coreBuffer;
+  GLuint             coreTexture;
+  GLint              coreTextureParams[2];
+  SHVector2Array     coreVertices;
+  SHCoreProgram      corePrograms[SH_CORE_PROGRAMS];
+  
+  /* Per-pixel gradients (see shShader.c) */
+  VGboolean          gradientShaders;
+  SHint              gradientProgramsState;
+  SHGradientProgram  linearProgram;
+  SHGradientProgram  radialProgram;
+  SHGradientProgram  linearMaskProgram;
+  SHGradientProgram  radialMaskProgram;
+  
 	/* Stroke parameters */
   SHfloat           strokeLineWidth;
   VGCapStyle        strokeCapStyle;
@@ -102,21 +242,89 @@ typedef struct
   
   VGErrorCode       error;
   
-  /* Resources */
-  SHPathArray       paths;
-  SHPaintArray      paints;
-  SHImageArray      images;
+  /* Resources, shared with the other contexts of the
+     group (see vgJoinShareGroupSH) */
+  struct SHShareGroup *share;
+  struct VGContext  *shareNext;
+  
+  /* Next of the contexts not destroyed yet */
+  struct VGContext  *liveNext;
 
+  /* Shadow copy of the OpenGL state */
+  SHGLState         glState;
+  
+  /* Counters of the current and the last frame,
+     indexed by VGStatisticSH */
+  SHint             stats[VG_STAT_COUNT_SH];
+  SHint             frameStats[VG_STAT_COUNT_SH];
+  
+  /* Sink of the trace events around the pipeline stages */
+  VGTraceCallbackSH traceCallback;
+  void             *traceUserData;
+  
   SHint glMajor;
   SHint glMinor;
+  SHint isGLCoreProfile;
+  GLint maxTextureUnits;
   /* Pointers to extensions */
   SHint isGLAvailable_ClampToEdge;
   SHint isGLAvailable_MirroredRepeat;
   SHint isGLAvailable_Multitexture;
   SHint isGLAvailable_TextureNonPowerOfTwo;
+  SHint isGLAvailable_StencilWrap;
+  SHint isGLAvailable_StencilOpSeparate;
+  SHint isGLAvailable_StencilTwoSide;
+  SHint isGLAvailable_VertexBufferObject;
+  SHint isGLAvailable_Shaders;
+  SHint isGLAvailable_Instancing;
+  SHint isGLAvailable_VertexArrayObject;
+  SHint isGLAvailable_FramebufferObject;
   SH_PGLACTIVETEXTURE pglActiveTexture;
   SH_PGLMULTITEXCOORD1F pglMultiTexCoord1f;
   SH_PGLMULTITEXCOORD2F pglMultiTexCoord2f;
+  SH_PGLSTENCILOPSEPARATE pglStencilOpSeparate;
+  SH_PGLACTIVESTENCILFACE pglActiveStencilFace;
+  SH_PGLGENBUFFERS pglGenBuffers;
+  SH_PGLDELETEBUFFERS pglDeleteBuffers;
+  SH_PGLBINDBUFFER pglBindBuffer;
+  SH_PGLBUFFERDATA pglBufferData;
+  SH_PGLBUFFERSUBDATA pglBufferSubData;
+  SH_PGLCREATESHADER pglCreateShader;
+  SH_PGLSHADERSOURCE pglShaderSource;
+  SH_PGLCOMPILESHADER pglCompileShader;
+  SH_PGLGETSHADERIV pglGetShaderiv;
+  SH_PGLDELETESHADER pglDeleteShader;
+  SH_PGLCREATEPROGRAM pglCreateProgram;
+  SH_PGLATTACHSHADER pglAttachShader;
+  SH_PGLLINKPROGRAM pglLinkProgram;
+  SH_PGLGETPROGRAMIV pglGetProgramiv;
+  SH_PGLDELETEPROGRAM pglDeleteProgram;
+  SH_PGLUSEPROGRAM pglUseProgram;
+  SH_PGLGETUNIFORMLOCATION pglGetUniformLocation;
+  SH_PGLUNIFORM1I pglUniform1i;
+  SH_PGLUNIFORM1F pglUniform1f;
+  SH_PGLUNIFORM2F pglUniform2f;
+  SH_PGLUNIFORM3F pglUniform3f;
+  SH_PGLUNIFORM4F pglUniform4f;
+  SH_PGLGETATTRIBLOCATION pglGetAttribLocation;
+  SH_PGLVERTEXATTRIBPOINTER pglVertexAttribPointer;
+  SH_PGLENABLEVERTEXATTRIBARRAY pglEnableVertexAttribArray;
+  SH_PGLDISABLEVERTEXATTRIBARRAY pglDisableVertexAttribArray;
+  SH_PGLVERTEXATTRIBDIVISOR pglVertexAttribDivisor;
+  SH_PGLDRAWARRAYSINSTANCED pglDrawArraysInstanced;
+  SH_PGLGENVERTEXARRAYS pglGenVertexArrays;
+  SH_PGLBINDVERTEXARRAY pglBindVertexArray;
+  SH_PGLDELETEVERTEXARRAYS pglDeleteVertexArrays;
+  SH_PGLGENFRAMEBUFFERS pglGenFramebuffers;
+  SH_PGLDELETEFRAMEBUFFERS pglDeleteFramebuffers;
+  SH_PGLBINDFRAMEBUFFER pglBindFramebuffer;
+  SH_PGLFRAMEBUFFERTEXTURE2D pglFramebufferTexture2D;
+  SH_PGLCHECKFRAMEBUFFERSTATUS pglCheckFramebufferStatus;
+  SH_PGLGENRENDERBUFFERS pglGenRenderbuffers;
+  SH_PGLDELETERENDERBUFFERS pglDeleteRenderbuffers;
+  SH_PGLBINDRENDERBUFFER pglBindRenderbuffer;
+  SH_PGLRENDERBUFFERSTORAGE pglRenderbufferStorage;
+  SH_PGLFRAMEBUFFERRENDERBUFFER pglFramebufferRenderbuffer;
   
 } VGContext;
 
@@ -126,28 +334,35 @@ void shSetError(VGContext *c, VGErrorCode e);
 SHint shIsValidPath(VGContext *c, VGHandle h);
 SHint shIsValidPaint(VGContext *c, VGHandle h);
 SHint shIsValidImage(VGContext *c, VGHandle h);
+SHint shIsValidCommandList(VGContext *c, VGHandle h);
 SHResourceType shGetResourceType(VGContext *c, VGHandle h);
 VGContext* shGetContext();
 
 /*----------------------------------------------------
- * TODO: Add mutex locking/unlocking to these macros
- * to assure sequentiallity in multithreading.
+ * API calls hold the lock of the context's share
+ * group, so contexts sharing resources can be used
+ * from several threads. Unless the application keeps
+ * its hands off OpenGL (VG_RETAIN_GL_STATE_SH), each
+ * call starts from an unknown OpenGL state.
  *----------------------------------------------------*/
 
 #define VG_NO_RETVAL
 
 #define VG_GETCONTEXT(RETVAL) \
   VGContext *context = shGetContext(); \
-  if (!context) return RETVAL;
+  if (!context) return RETVAL; \
+  SH_LOCK_SHARE(context); \
+  if (context->retainGLState == VG_FALSE) context->glState.stale = 1;
   
 #define VG_RETURN(RETVAL) \
-  { return RETVAL; }
+  { SH_UNLOCK_SHARE(context); return RETVAL; }
 
 #define VG_RETURN_ERR(ERRORCODE, RETVAL) \
-  { shSetError(context,ERRORCODE); return RETVAL; }
+  { shSetError(context,ERRORCODE); SH_UNLOCK_SHARE(context); return RETVAL; }
 
 #define VG_RETURN_ERR_IF(COND, ERRORCODE, RETVAL) \
-  { if (COND) {shSetError(context,ERRORCODE); return RETVAL;} }
+  { if (COND) {shSetError(context,ERRORCODE); \
+      SH_UNLOCK_SHARE(context); return RETVAL;} }
 
 /*-----------------------------------------------------------
  * Same macros but no mutex handling - used by sub-functions
@@ -168,11 +383,143 @@ VGContext* shGetContext();
 #define SH_RETURN_ERR_IF(COND, ERRORCODE, RETVAL) \
   { if (COND) {shSetError(context,ERRORCODE); return RETVAL;} }
 
+/* Adds to a counter reported by VG_FRAME_STATISTICS_SH */
+#define SH_COUNT(C, STAT, N) \
+  { (C)->stats[STAT] += (SHint)(N); }
+
+/* Open and close a named scope of the trace events. Building
+   with SH_DISABLE_TRACING removes them from the pipeline */
+#if defined(SH_DISABLE_TRACING)
+#  define SH_TRACE_BEGIN(C, NAME)
+#  define SH_TRACE_END(C, NAME)
+#else
+#  define SH_TRACE_BEGIN(C, NAME) \
+  { if ((C)->traceCallback) shTraceEvent((C), (NAME), VG_TRUE); }
+#  define SH_TRACE_END(C, NAME) \
+  { if ((C)->traceCallback) shTraceEvent((C), (NAME), VG_FALSE); }
+#endif
+
 
 extern void shBuildScissorContext(VGContext* c, SHint count, const void* values,
                                   SHint floats);
+extern void shSetScissorRects(VGContext *c, const SHRectangle *rects,
+                              SHint count);
 extern int shCopyOutScissorParams(VGContext *c, SHint count, void *values,
                                   SHint floats);
-extern void shEnableScissoring(VGContext *c);
-extern void shDisableScissoring(VGContext *c);
+extern void shRectsFromParams(SHRectArray *rects, SHint max, SHint count,
+                              const void *values, SHint floats);
+extern int shRectsToParams(SHRectArray *rects, SHint count, void *values,
+                           SHint floats);
+extern SHint shBeginScissoring(VGContext *c, SHRectangle *bounds);
+extern void shEndScissoring(VGContext *c);
+extern void shTransformBounds(SHMatrix3x3 *m, SHVector2 *min, SHVector2 *max,
+                              SHfloat pad, SHRectangle *out);
+extern void shFlushBatch(VGContext *c);
+extern void shDrawPath(VGContext *c, SHPath *p, VGbitfield paintModes);
+extern void shDrawImage(VGContext *c, SHImage *i);
+extern SHint shRecordDraw(VGContext *c, SHRectangle *bounds);
+extern void shEndDamageFrame(VGContext *c);
+extern void shEndStatisticsFrame(VGContext *c);
+extern void shDamageSurface(VGContext *c);
+extern void shBeginMasking(VGContext *c);
+extern void shEndMasking(VGContext *c);
+extern void shResizeMask(VGContext *c);
+extern void shDeleteMask(VGContext *c);
+extern SHint shLoadGradientPrograms(VGContext *c);
+extern void shDeleteGradientPrograms(VGContext *c);
+extern SHint shLoadInstancePrograms(VGContext *c);
+extern void shDeleteInstancePrograms(VGContext *c);
+extern SHCoreProgram* shLoadCoreProgram(VGContext *c, SHint variant);
+extern void shDeleteCorePrograms(VGContext *c);
+extern void shUpdateVertexBuffer(VGContext *c, SHPath *p);
+extern void shUpdateStrokeBuffer(VGContext *c, SHPath *p);
+extern void shUpdateTrianglesBuffer(VGContext *c, SHPath *p);
+extern int shIsBatchable(VGContext *c, SHPaint *fill, VGbitfield paintModes);
+extern void shAddToBatch(VGContext *c, SHPath *p, SHPaint *fill);
+extern void updateBlendingStateGL(VGContext *c, int alphaIsOne);
+extern VGboolean shIsTrianglesCacheValid(VGContext *c, SHPath *p);
+extern void shGLFlushBatch(VGContext *c);
+extern void shGLDrawPath(VGContext *c, SHPath *p, VGbitfield paintModes,
+                         SHRectangle *bounds);
+extern void shGLDrawImage(VGContext *c, SHImage *i, SHRectangle *bounds);
+extern void shGLClear(VGContext *c, SHint x, SHint y,
+                      SHint width, SHint height);
+extern void shGLReadPixels(VGContext *c, void *data,
+                           VGImageFormat format, SHint stride,
+                           SHint dataWidth, SHint dataHeight,
+                           SHint dx, SHint dy, SHint sx, SHint sy,
+                           SHint width, SHint height);
+extern void shGLWritePixels(VGContext *c, const void *data,
+                            VGImageFormat format, SHint stride,
+                            SHint dataWidth, SHint dataHeight,
+                            SHint dx, SHint dy, SHint sx, SHint sy,
+                            SHint width, SHint height);
+extern void shGLCopyPixels(VGContext *c, SHint dx, SHint dy,
+                           SHint sx, SHint sy, SHint width, SHint height);
+extern void shGLEndFrame(VGContext *c, SHint finish);
+extern void shGLResize(VGContext *c);
+extern void shSyncImageData(VGContext *c, SHImage *i);
+extern void shReleaseRenderTarget(VGContext *c);
+extern void shFlushShareGroup(VGContext *c);
+extern void shForgetSharedTexture(VGContext *c, GLuint texture);
+extern void shTraceEvent(VGContext *c, const char *name, VGboolean begin);
+extern void shCloseTrace(VGContext *c);
+extern SHint shGLCoreInit(VGContext *c);
+extern void shGLCoreRelease(VGContext *c);
+extern void shGLCoreFillRects(VGContext *c, SHRectangle *rects, SHint count,
+                              SHfloat depth, SHColor *color);
+extern void shGLCoreDrawPath(VGContext *c, SHPath *p, VGbitfield paintModes,
+                             SHRectangle *bounds);
+extern void shGLCoreDrawImage(VGContext *c, SHImage *i, SHRectangle *bounds);
+extern void shGLCoreWritePixels(VGContext *c, const void *data,
+                                VGImageFormat format, SHint stride,
+                                SHint dataWidth, SHint dataHeight,
+                                SHint dx, SHint dy, SHint sx, SHint sy,
+                                SHint width, SHint height);
+extern void shGLCoreCopyPixels(VGContext *c, SHint dx, SHint dy,
+                               SHint sx, SHint sy, SHint width, SHint height);
+extern void shGLCoreFlushBatch(VGContext *c);
+extern void shGLCoreEndFrame(VGContext *c, SHint finish);
+extern void shGLCoreResize(VGContext *c);
+extern VGImageFormat shRasterFormat(void);
+extern SHint shRasterFillPath(VGContext *c, SHPath *p, SHPaint *paint);
+extern SHint shRasterStrokePath(VGContext *c, SHPath *p, SHPaint *paint);
+extern void shRasterDrawPath(VGContext *c, SHPath *p, VGbitfield paintModes,
+                             SHRectangle *bounds);
+extern void shRasterDrawImage(VGContext *c, SHImage *i, SHRectangle *bounds);
+extern void shRasterClear(VGContext *c, SHint x, SHint y,
+                          SHint width, SHint height);
+extern void shRasterReadPixels(VGContext *c, void *data,
+                               VGImageFormat format, SHint stride,
+                               SHint dataWidth, SHint dataHeight,
+                               SHint dx, SHint dy, SHint sx, SHint sy,
+                               SHint width, SHint height);
+extern void shRasterWritePixels(VGContext *c, const void *data,
+                                VGImageFormat format, SHint stride,
+                                SHint dataWidth, SHint dataHeight,
+                                SHint dx, SHint dy, SHint sx, SHint sy,
+                                SHint width, SHint height);
+extern void shRasterCopyPixels(VGContext *c, SHint dx, SHint dy,
+                               SHint sx, SHint sy, SHint width, SHint height);
+extern void shRasterFlush(VGContext *c);
+extern void shRasterEndFrame(VGContext *c, SHint finish);
+extern SHint shRasterMaxThreads(void);
+extern void shRasterSetThreads(VGContext *c, SHint threads);
+
+/* OpenGL state changes skipping redundant calls (see shGLState.c) */
+void shGLEnable(VGContext *c, GLenum cap);
+void shGLDisable(VGContext *c, GLenum cap);
+void shGLBlendFunc(VGContext *c, GLenum src, GLenum dst);
+void shGLStencilFunc(VGContext *c, GLenum func, GLint ref, GLuint mask);
+void shGLStencilOp(VGContext *c, GLenum fail, GLenum zfail, GLenum zpass);
+void shGLColorMask(VGContext *c, GLboolean r, GLboolean g,
+                   GLboolean b, GLboolean a);
+void shGLDepthFunc(VGContext *c, GLenum func);
+void shGLDepthMask(VGContext *c, GLboolean flag);
+void shGLActiveTexture(VGContext *c, GLenum unit);
+void shGLUseProgram(VGContext *c, GLuint program);
+void shGLTexEnvMode(VGContext *c, GLint mode);
+void shGLBindTexture(VGContext *c, GLenum target, GLuint texture);
+void shGLTexParameters(VGContext *c, GLenum target, GLint *cache,
+                       GLint wrap, GLint filter);
 #endif /* __SHCONTEXT_H */
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shContext.h"
+
+/*------------------------------------------------------------
+ * Damage tracking: every call that writes to the surface
+ * reports the surface-space bounds it may touch. With
+ * VG_DAMAGE_TRACKING_SH on they are collected into a short
+ * list of pixel-aligned rectangles, which becomes readable
+ * through VG_DAMAGE_RECTS_SH once the frame is ended by
+ * vgFlush or vgFinish. With VG_REDRAW_CULLING_SH on, calls
+ * outside every rectangle of VG_REDRAW_RECTS_SH are dropped.
+ *------------------------------------------------------------*/
+
+static SHfloat shRectArea(SHRectangle *r)
+{
+  return r->w * r->h;
+}
+
+static void shUniteRects(SHRectangle *a, SHRectangle *b, SHRectangle *out)
+{
+  SHfloat x0 = SH_MIN(a->x, b->x);
+  SHfloat y0 = SH_MIN(a->y, b->y);
+  SHfloat x1 = SH_MAX(a->x + a->w, b->x + b->w);
+  SHfloat y1 = SH_MAX(a->y + a->h, b->y + b->h);
+  shRectangleSet(out, x0, y0, x1 - x0, y1 - y0);
+}
+
+/* Touching rectangles count as overlapping,
+   so that adjacent damage is merged as well */
+static SHint shRectsTouch(SHRectangle *a, SHRectangle *b)
+{
+  return (a->x <= b->x + b->w && b->x <= a->x + a->w &&
+          a->y <= b->y + b->h && b->y <= a->y + a->h);
+}
+
+/*------------------------------------------------------------
+ * Adds a rectangle to the damage list. Rectangles that touch
+ * it are merged into it first; when the list is full, it is
+ * merged with the rectangle whose bounds grow the least.
+ *------------------------------------------------------------*/
+
+static void shAddDamage(SHRectArray *damage, SHRectangle *rect)
+{
+  SHRectangle r = *rect;
+  SHRectangle u;
+  SHfloat growth, best;
+  SHint i, bi;
+
+  for (i=0; i<damage->size; ++i) {
+    if (shRectsTouch(&damage->items[i], &r)) {
+      shUniteRects(&damage->items[i], &r, &r);
+      shRectArrayRemoveAt(damage, i);
+      i = -1;
+    }
+  }
+
+  while (damage->size >= SH_MAX_DAMAGE_RECTS) {
+    bi = 0; best = 0.0f;
+    for (i=0; i<damage->size; ++i) {
+      shUniteRects(&damage->items[i], &r, &u);
+      growth = shRectArea(&u) - shRectArea(&damage->items[i]);
+      if (i == 0 || growth < best) { bi = i; best = growth; }
+    }
+    shUniteRects(&damage->items[bi], &r, &r);
+    shRectArrayRemoveAt(damage, bi);
+  }
+
+  shRectArrayPushBackP(damage, &r);
+}
+
+/*------------------------------------------------------------
+ * Called with the surface-space bounds of every draw before
+ * it is made. Returns 0 if the draw can be skipped because
+ * it falls outside the redraw region or the surface.
+ *------------------------------------------------------------*/
+
+SHint shRecordDraw(VGContext *c, SHRectangle *bounds)
+{
+  SHRectangle r;
+  SHfloat x0, y0, x1, y1;
+  SHint i;
+
+  /* Draws into an image leave the window alone */
+  if (c->renderTarget != NULL)
+    return 1;
+
+  if (c->redrawCulling == VG_TRUE) {
+    for (i=0; i<c->redrawRects.size; ++i) {
+      r = c->redrawRects.items[i];
+      if (r.w > 0.0f && r.h > 0.0f &&
+          bounds->x < r.x + r.w && r.x < bounds->x + bounds->w &&
+          bounds->y < r.y + r.h && r.y < bounds->y + bounds->h)
+        break;
+    }
+    if (i == c->redrawRects.size)
+      return 0;
+  }
+
+  if (c->damageTracking == VG_FALSE)
+    return 1;
+
+  /* Whole pixels touched within the surface and scissor */
+  x0 = SH_MAX(SH_FLOOR(bounds->x), 0.0f);
+  y0 = SH_MAX(SH_FLOOR(bounds->y), 0.0f);
+  x1 = SH_MIN(SH_CEIL(bounds->x + bounds->w), (SHfloat)c->surfaceWidth);
+  y1 = SH_MIN(SH_CEIL(bounds->y + bounds->h), (SHfloat)c->surfaceHeight);
+
+  if (c->scissoring == VG_TRUE) {
+    r = c->scissorBounds;
+    x0 = SH_MAX(x0, SH_FLOOR(r.x));
+    y0 = SH_MAX(y0, SH_FLOOR(r.y));
+    x1 = SH_MIN(x1, SH_CEIL(r.x + r.w));
+    y1 = SH_MIN(y1, SH_CEIL(r.y + r.h));
+  }
+
+  if (x0 >= x1 || y0 >= y1)
+    return 0;
+
+  shRectangleSet(&r, x0, y0, x1 - x0, y1 - y0);
+  shAddDamage(&c->damage, &r);
+  return 1;
+}
+
+/*------------------------------------------------------------
+ * Publishes the damage of the frame ended by vgFlush or
+ * vgFinish and starts collecting the next one
+ *------------------------------------------------------------*/
+
+void shEndDamageFrame(VGContext *c)
+{
+  SHRectArray last = c->lastDamage;
+
+  c->lastDamage = c->damage;
+  c->damage = last;
+  shRectArrayClear(&c->damage);
+}
+
+/* The whole surface changes size, so all of it is damaged */
+void shDamageSurface(VGContext *c)
+{
+  SHRectangle r;
+
+  if (c->damageTracking == VG_FALSE)
+    return;
+
+  shRectArrayClear(&c->damage);
+  shRectangleSet(&r, 0, 0, (SHfloat)c->windowWidth,
+                 (SHfloat)c->windowHeight);
+  shRectArrayPushBackP(&c->damage, &r);
+}
@@ -121,6 +121,17 @@ SHfloat getMaxFloat();
 #  define SH_ISNAN isnan
 #endif
 
+/* Storage class of variables kept per thread, where the
+   compiler has one (otherwise shared by all threads) */
+
+#if defined(_MSC_VER)
+#  define SH_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#  define SH_THREAD_LOCAL __thread
+#else
+#  define SH_THREAD_LOCAL
+#endif
+
 
 /* Helper macros */
 
@@ -142,6 +153,8 @@ SHfloat getMaxFloat();
 /* Implementation limits */
 
 #define SH_MAX_SCISSOR_RECTS             16384
+#define SH_MAX_REDRAW_RECTS              SH_MAX_SCISSOR_RECTS
+#define SH_MAX_DAMAGE_RECTS              16
 #define SH_MAX_DASH_COUNT                VG_MAXINT
 #define SH_MAX_IMAGE_WIDTH               VG_MAXINT
 #define SH_MAX_IMAGE_HEIGHT              VG_MAXINT
@@ -82,16 +82,34 @@ PFVOID shGetProcAddress(const char *name)
 
 void shLoadExtensions(VGContext *c)
 {
-  const char *ext = (const char*)glGetString(GL_EXTENSIONS);
+  const char *ext;
   const char *versionStr = glGetString(GL_VERSION);
   char *decimal = strchr(versionStr, '.');
+  GLint profile = 0;
 
   c->glMajor = (SHint)strtol(versionStr, 0, 10);
   c->glMinor = 0;
   if (decimal && *(decimal + 1))
     c->glMinor = strtol(decimal + 1, 0, 10);
+  
+  /* Core profiles have no extension string, the
+     version tells what is available there */
+  c->isGLCoreProfile = 0;
+  if (c->glMajor > 3 || (c->glMajor == 3 && c->glMinor >= 2)) {
+    glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profile);
+    c->isGLCoreProfile = ((profile & GL_CONTEXT_CORE_PROFILE_BIT) != 0);
+  }
+  
+  ext = NULL;
+  if (!c->isGLCoreProfile)
+    ext = (const char*)glGetString(GL_EXTENSIONS);
+  if (ext == NULL)
+    ext = "";
+  
   /* GL_TEXTURE_CLAMP_TO_EDGE */
-  if (checkExtension(ext, "GL_EXT_texture_edge_clamp"))
+  if (c->glMajor > 1 || c->glMinor >= 2)
+    c->isGLAvailable_ClampToEdge = 1;
+  else if (checkExtension(ext, "GL_EXT_texture_edge_clamp"))
     c->isGLAvailable_ClampToEdge = 1;
   else if (checkExtension(ext, "GL_SGIS_texture_edge_clamp"))
     c->isGLAvailable_ClampToEdge = 1;
@@ -100,7 +118,9 @@ void shLoadExtensions(VGContext *c)
   
   
   /* GL_TEXTURE_MIRRORED_REPEAT */
-  if (checkExtension(ext, "GL_ARB_texture_mirrored_repeat"))
+  if (c->glMajor > 1 || c->glMinor >= 4)
+    c->isGLAvailable_MirroredRepeat = 1;
+  else if (checkExtension(ext, "GL_ARB_texture_mirrored_repeat"))
     c->isGLAvailable_MirroredRepeat = 1;
   else if(checkExtension(ext, "GL_IBM_texture_mirrored_repeat"))
     c->isGLAvailable_MirroredRepeat = 1;
@@ -138,9 +158,272 @@ void shLoadExtensions(VGContext *c)
     c->pglMultiTexCoord2f = (SH_PGLMULTITEXCOORD2F)fallbackMultiTexCoord2f;
   }
   
+  /* Units for fixed-function texturing */
+  c->maxTextureUnits = 1;
+  if (c->isGLAvailable_Multitexture && !c->isGLCoreProfile)
+    glGetIntegerv(GL_MAX_TEXTURE_UNITS, &c->maxTextureUnits);
+  
   /* Non-power-of-two textures */
-  if (checkExtension(ext, "GL_ARB_texture_non_power_of_two"))
+  if (c->glMajor >= 2)
+    c->isGLAvailable_TextureNonPowerOfTwo = 1;
+  else if (checkExtension(ext, "GL_ARB_texture_non_power_of_two"))
     c->isGLAvailable_TextureNonPowerOfTwo = 1;
   else /* Unavailable */
     c->isGLAvailable_TextureNonPowerOfTwo = 0;
+  
+  
+  /* GL_INCR_WRAP, GL_DECR_WRAP */
+  if ((c->glMajor > 1 || c->glMinor >= 4)
+      || checkExtension(ext, "GL_EXT_stencil_wrap"))
+    c->isGLAvailable_StencilWrap = 1;
+  else /* Unavailable */
+    c->isGLAvailable_StencilWrap = 0;
+  
+  
+  /* glStencilOpSeparate or glActiveStencilFaceEXT */
+  c->pglStencilOpSeparate = NULL;
+  c->pglActiveStencilFace = NULL;
+  if (c->glMajor >= 2)
+    c->pglStencilOpSeparate = (SH_PGLSTENCILOPSEPARATE)
+      shGetProcAddress("glStencilOpSeparate");
+  else if (checkExtension(ext, "GL_ATI_separate_stencil"))
+    c->pglStencilOpSeparate = (SH_PGLSTENCILOPSEPARATE)
+      shGetProcAddress("glStencilOpSeparateATI");
+  
+  if (c->pglStencilOpSeparate == NULL &&
+      checkExtension(ext, "GL_EXT_stencil_two_side"))
+    c->pglActiveStencilFace = (SH_PGLACTIVESTENCILFACE)
+      shGetProcAddress("glActiveStencilFaceEXT");
+  
+  c->isGLAvailable_StencilOpSeparate = (c->pglStencilOpSeparate != NULL);
+  c->isGLAvailable_StencilTwoSide = (c->pglActiveStencilFace != NULL);
+  
+  
+  /* Vertex buffer objects */
+  if (c->glMajor > 1 || c->glMinor >= 5) {
+    c->pglGenBuffers = (SH_PGLGENBUFFERS)
+      shGetProcAddress("glGenBuffers");
+    c->pglDeleteBuffers = (SH_PGLDELETEBUFFERS)
+      shGetProcAddress("glDeleteBuffers");
+    c->pglBindBuffer = (SH_PGLBINDBUFFER)
+      shGetProcAddress("glBindBuffer");
+    c->pglBufferData = (SH_PGLBUFFERDATA)
+      shGetProcAddress("glBufferData");
+    c->pglBufferSubData = (SH_PGLBUFFERSUBDATA)
+      shGetProcAddress("glBufferSubData");
+  }else if (checkExtension(ext, "GL_ARB_vertex_buffer_object")) {
+    c->pglGenBuffers = (SH_PGLGENBUFFERS)
+      shGetProcAddress("glGenBuffersARB");
+    c->pglDeleteBuffers = (SH_PGLDELETEBUFFERS)
+      shGetProcAddress("glDeleteBuffersARB");
+    c->pglBindBuffer = (SH_PGLBINDBUFFER)
+      shGetProcAddress("glBindBufferARB");
+    c->pglBufferData = (SH_PGLBUFFERDATA)
+      shGetProcAddress("glBufferDataARB");
+    c->pglBufferSubData = (SH_PGLBUFFERSUBDATA)
+      shGetProcAddress("glBufferSubDataARB");
+  }else{ /* Unavailable */
+    c->pglGenBuffers = NULL;
+    c->pglDeleteBuffers = NULL;
+    c->pglBindBuffer = NULL;
+    c->pglBufferData = NULL;
+    c->pglBufferSubData = NULL;
+  }
+  
+  c->isGLAvailable_VertexBufferObject =
+    (c->pglGenBuffers != NULL && c->pglDeleteBuffers != NULL &&
+     c->pglBindBuffer != NULL && c->pglBufferData != NULL &&
+     c->pglBufferSubData != NULL);
+  
+  
+  /* GLSL programs (the ARB_shader_objects entry points use
+     different handle types, so only OpenGL 2.0 is supported) */
+  if (c->glMajor >= 2) {
+    c->pglCreateShader = (SH_PGLCREATESHADER)
+      shGetProcAddress("glCreateShader");
+    c->pglShaderSource = (SH_PGLSHADERSOURCE)
+      shGetProcAddress("glShaderSource");
+    c->pglCompileShader = (SH_PGLCOMPILESHADER)
+      shGetProcAddress("glCompileShader");
+    c->pglGetShaderiv = (SH_PGLGETSHADERIV)
+      shGetProcAddress("glGetShaderiv");
+    c->pglDeleteShader = (SH_PGLDELETESHADER)
+      shGetProcAddress("glDeleteShader");
+    c->pglCreateProgram = (SH_PGLCREATEPROGRAM)
+      shGetProcAddress("glCreateProgram");
+    c->pglAttachShader = (SH_PGLATTACHSHADER)
+      shGetProcAddress("glAttachShader");
+    c->pglLinkProgram = (SH_PGLLINKPROGRAM)
+      shGetProcAddress("glLinkProgram");
+    c->pglGetProgramiv = (SH_PGLGETPROGRAMIV)
+      shGetProcAddress("glGetProgramiv");
+    c->pglDeleteProgram = (SH_PGLDELETEPROGRAM)
+      shGetProcAddress("glDeleteProgram");
+    c->pglUseProgram = (SH_PGLUSEPROGRAM)
+      shGetProcAddress("glUseProgram");
+    c->pglGetUniformLocation = (SH_PGLGETUNIFORMLOCATION)
+      shGetProcAddress("glGetUniformLocation");
+    c->pglUniform1i = (SH_PGLUNIFORM1I)
+      shGetProcAddress("glUniform1i");
+    c->pglUniform1f = (SH_PGLUNIFORM1F)
+      shGetProcAddress("glUniform1f");
+    c->pglUniform2f = (SH_PGLUNIFORM2F)
+      shGetProcAddress("glUniform2f");
+    c->pglUniform3f = (SH_PGLUNIFORM3F)
+      shGetProcAddress("glUniform3f");
+    c->pglUniform4f = (SH_PGLUNIFORM4F)
+      shGetProcAddress("glUniform4f");
+    c->pglGetAttribLocation = (SH_PGLGETATTRIBLOCATION)
+      shGetProcAddress("glGetAttribLocation");
+    c->pglVertexAttribPointer = (SH_PGLVERTEXATTRIBPOINTER)
+      shGetProcAddress("glVertexAttribPointer");
+    c->pglEnableVertexAttribArray = (SH_PGLENABLEVERTEXATTRIBARRAY)
+      shGetProcAddress("glEnableVertexAttribArray");
+    c->pglDisableVertexAttribArray = (SH_PGLDISABLEVERTEXATTRIBARRAY)
+      shGetProcAddress("glDisableVertexAttribArray");
+  }else{ /* Unavailable */
+    c->pglCreateShader = NULL;
+    c->pglShaderSource = NULL;
+    c->pglCompileShader = NULL;
+    c->pglGetShaderiv = NULL;
+    c->pglDeleteShader = NULL;
+    c->pglCreateProgram = NULL;
+    c->pglAttachShader = NULL;
+    c->pglLinkProgram = NULL;
+    c->pglGetProgramiv = NULL;
+    c->pglDeleteProgram = NULL;
+    c->pglUseProgram = NULL;
+    c->pglGetUniformLocation = NULL;
+    c->pglUniform1i = NULL;
+    c->pglUniform1f = NULL;
+    c->pglUniform2f = NULL;
+    c->pglUniform3f = NULL;
+    c->pglUniform4f = NULL;
+    c->pglGetAttribLocation = NULL;
+    c->pglVertexAttribPointer = NULL;
+    c->pglEnableVertexAttribArray = NULL;
+    c->pglDisableVertexAttribArray = NULL;
+  }
+  
+  c->isGLAvailable_Shaders =
+    (c->pglCreateShader != NULL && c->pglShaderSource != NULL &&
+     c->pglCompileShader != NULL && c->pglGetShaderiv != NULL &&
+     c->pglDeleteShader != NULL && c->pglCreateProgram != NULL &&
+     c->pglAttachShader != NULL && c->pglLinkProgram != NULL &&
+     c->pglGetProgramiv != NULL && c->pglDeleteProgram != NULL &&
+     c->pglUseProgram != NULL && c->pglGetUniformLocation != NULL &&
+     c->pglUniform1i != NULL && c->pglUniform1f != NULL &&
+     c->pglUniform2f != NULL && c->pglUniform3f != NULL &&
+     c->pglUniform4f != NULL &&
+     c->pglGetAttribLocation != NULL && c->pglVertexAttribPointer != NULL &&
+     c->pglEnableVertexAttribArray != NULL &&
+     c->pglDisableVertexAttribArray != NULL);
+  
+  
+  /* Per-instance vertex attributes and instanced draws */
+  c->pglVertexAttribDivisor = NULL;
+  c->pglDrawArraysInstanced = NULL;
+  if (c->glMajor > 3 || (c->glMajor == 3 && c->glMinor >= 3)) {
+    c->pglVertexAttribDivisor = (SH_PGLVERTEXATTRIBDIVISOR)
+      shGetProcAddress("glVertexAttribDivisor");
+    c->pglDrawArraysInstanced = (SH_PGLDRAWARRAYSINSTANCED)
+      shGetProcAddress("glDrawArraysInstanced");
+  }else if (checkExtension(ext, "GL_ARB_instanced_arrays") &&
+            checkExtension(ext, "GL_ARB_draw_instanced")) {
+    c->pglVertexAttribDivisor = (SH_PGLVERTEXATTRIBDIVISOR)
+      shGetProcAddress("glVertexAttribDivisorARB");
+    c->pglDrawArraysInstanced = (SH_PGLDRAWARRAYSINSTANCED)
+      shGetProcAddress("glDrawArraysInstancedARB");
+  }
+  
+  c->isGLAvailable_Instancing =
+    (c->isGLAvailable_Shaders && c->isGLAvailable_VertexBufferObject &&
+     c->pglVertexAttribDivisor != NULL && c->pglDrawArraysInstanced != NULL);
+  
+  
+  /* Vertex array objects, which core profiles draw from */
+  c->pglGenVertexArrays = NULL;
+  c->pglBindVertexArray = NULL;
+  c->pglDeleteVertexArrays = NULL;
+  if (c->glMajor >= 3) {
+    c->pglGenVertexArrays = (SH_PGLGENVERTEXARRAYS)
+      shGetProcAddress("glGenVertexArrays");
+    c->pglBindVertexArray = (SH_PGLBINDVERTEXARRAY)
+      shGetProcAddress("glBindVertexArray");
+    c->pglDeleteVertexArrays = (SH_PGLDELETEVERTEXARRAYS)
+      shGetProcAddress("glDeleteVertexArrays");
+  }
+  
+  c->isGLAvailable_VertexArrayObject =
+    (c->pglGenVertexArrays != NULL && c->pglBindVertexArray != NULL &&
+     c->pglDeleteVertexArrays != NULL);
+  
+  
+  /* Framebuffer objects with a packed depth and stencil
+     buffer, for drawing into images */
+  if (c->glMajor >= 3) {
+    c->pglGenFramebuffers = (SH_PGLGENFRAMEBUFFERS)
+      shGetProcAddress("glGenFramebuffers");
+    c->pglDeleteFramebuffers = (SH_PGLDELETEFRAMEBUFFERS)
+      shGetProcAddress("glDeleteFramebuffers");
+    c->pglBindFramebuffer = (SH_PGLBINDFRAMEBUFFER)
+      shGetProcAddress("glBindFramebuffer");
+    c->pglFramebufferTexture2D = (SH_PGLFRAMEBUFFERTEXTURE2D)
+      shGetProcAddress("glFramebufferTexture2D");
+    c->pglCheckFramebufferStatus = (SH_PGLCHECKFRAMEBUFFERSTATUS)
+      shGetProcAddress("glCheckFramebufferStatus");
+    c->pglGenRenderbuffers = (SH_PGLGENRENDERBUFFERS)
+      shGetProcAddress("glGenRenderbuffers");
+    c->pglDeleteRenderbuffers = (SH_PGLDELETERENDERBUFFERS)
+      shGetProcAddress("glDeleteRenderbuffers");
+    c->pglBindRenderbuffer = (SH_PGLBINDRENDERBUFFER)
+      shGetProcAddress("glBindRenderbuffer");
+    c->pglRenderbufferStorage = (SH_PGLRENDERBUFFERSTORAGE)
+      shGetProcAddress("glRenderbufferStorage");
+    c->pglFramebufferRenderbuffer = (SH_PGLFRAMEBUFFERRENDERBUFFER)
+      shGetProcAddress("glFramebufferRenderbuffer");
+  }else if (checkExtension(ext, "GL_EXT_framebuffer_object") &&
+            checkExtension(ext, "GL_EXT_packed_depth_stencil")) {
+    c->pglGenFramebuffers = (SH_PGLGENFRAMEBUFFERS)
+      shGetProcAddress("glGenFramebuffersEXT");
+    c->pglDeleteFramebuffers = (SH_PGLDELETEFRAMEBUFFERS)
+      shGetProcAddress("glDeleteFramebuffersEXT");
+    c->pglBindFramebuffer = (SH_PGLBINDFRAMEBUFFER)
+      shGetProcAddress("glBindFramebufferEXT");
+    c->pglFramebufferTexture2D = (SH_PGLFRAMEBUFFERTEXTURE2D)
+      shGetProcAddress("glFramebufferTexture2DEXT");
+    c->pglCheckFramebufferStatus = (SH_PGLCHECKFRAMEBUFFERSTATUS)
+      shGetProcAddress("glCheckFramebufferStatusEXT");
+    c->pglGenRenderbuffers = (SH_PGLGENRENDERBUFFERS)
+      shGetProcAddress("glGenRenderbuffersEXT");
+    c->pglDeleteRenderbuffers = (SH_PGLDELETERENDERBUFFERS)
+      shGetProcAddress("glDeleteRenderbuffersEXT");
+    c->pglBindRenderbuffer = (SH_PGLBINDRENDERBUFFER)
+      shGetProcAddress("glBindRenderbufferEXT");
+    c->pglRenderbufferStorage = (SH_PGLRENDERBUFFERSTORAGE)
+      shGetProcAddress("glRenderbufferStorageEXT");
+    c->pglFramebufferRenderbuffer = (SH_PGLFRAMEBUFFERRENDERBUFFER)
+      shGetProcAddress("glFramebufferRenderbufferEXT");
+  }else{ /* Unavailable */
+    c->pglGenFramebuffers = NULL;
+    c->pglDeleteFramebuffers = NULL;
+    c->pglBindFramebuffer = NULL;
+    c->pglFramebufferTexture2D = NULL;
+    c->pglCheckFramebufferStatus = NULL;
+    c->pglGenRenderbuffers = NULL;
+    c->pglDeleteRenderbuffers = NULL;
+    c->pglBindRenderbuffer = NULL;
+    c->pglRenderbufferStorage = NULL;
+    c->pglFramebufferRenderbuffer = NULL;
+  }
+  
+  /* Image textures have to be the size of the image */
+  c->isGLAvailable_FramebufferObject =
+    (c->isGLAvailable_TextureNonPowerOfTwo &&
+     c->pglGenFramebuffers != NULL && c->pglDeleteFramebuffers != NULL &&
+     c->pglBindFramebuffer != NULL && c->pglFramebufferTexture2D != NULL &&
+     c->pglCheckFramebufferStatus != NULL &&
+     c->pglGenRenderbuffers != NULL && c->pglDeleteRenderbuffers != NULL &&
+     c->pglBindRenderbuffer != NULL && c->pglRenderbufferStorage != NULL &&
+     c->pglFramebufferRenderbuffer != NULL);
 }
@@ -47,7 +47,19 @@
 #  define GL_MULTISAMPLE                   0x809D
 #  define GL_TEXTURE0                      0x84C0
 #  define GL_TEXTURE1                      0x84C1
+#  define GL_TEXTURE2                      0x84C2
+#  define GL_MAX_TEXTURE_UNITS             0x84E2
 #  define GL_CLAMP_TO_BORDER               0x812D
+#  define GL_COMBINE                       0x8570
+#  define GL_COMBINE_RGB                   0x8571
+#  define GL_COMBINE_ALPHA                 0x8572
+#  define GL_SOURCE0_RGB                   0x8580
+#  define GL_SOURCE0_ALPHA                 0x8588
+#  define GL_SOURCE1_ALPHA                 0x8589
+#  define GL_OPERAND0_RGB                  0x8590
+#  define GL_OPERAND0_ALPHA                0x8598
+#  define GL_OPERAND1_ALPHA                0x8599
+#  define GL_PREVIOUS                      0x8578
 #  define glActiveTexture                  context->pglActiveTexture
 #  define glMultiTexCoord1f                context->pglMultiTexCoord1f
 #  define glMultiTexCoord2f                context->pglMultiTexCoord2f
@@ -55,10 +67,138 @@
 
 #ifndef GL_VERSION_1_4
 #  define GL_MIRRORED_REPEAT               0x8370
+#  define GL_INCR_WRAP                     0x8507
+#  define GL_DECR_WRAP                     0x8508
+#endif
+
+#ifndef GL_VERSION_1_5
+#  include <stddef.h>
+   typedef ptrdiff_t GLintptr;
+   typedef ptrdiff_t GLsizeiptr;
+#  define GL_ARRAY_BUFFER                  0x8892
+#  define GL_STREAM_DRAW                   0x88E0
+#  define GL_STATIC_DRAW                   0x88E4
+#  define glGenBuffers                     context->pglGenBuffers
+#  define glDeleteBuffers                  context->pglDeleteBuffers
+#  define glBindBuffer                     context->pglBindBuffer
+#  define glBufferData                     context->pglBufferData
+#  define glBufferSubData                  context->pglBufferSubData
+#endif
+
+#ifndef GL_VERSION_2_0
+   typedef char GLchar;
+#  define GL_FRAGMENT_SHADER               0x8B30
+#  define GL_VERTEX_SHADER                 0x8B31
+#  define GL_COMPILE_STATUS                0x8B81
+#  define GL_LINK_STATUS                   0x8B82
+#  define glCreateShader                   context->pglCreateShader
+#  define glShaderSource                   context->pglShaderSource
+#  define glCompileShader                  context->pglCompileShader
+#  define glGetShaderiv                    context->pglGetShaderiv
+#  define glDeleteShader                   context->pglDeleteShader
+#  define glCreateProgram                  context->pglCreateProgram
+#  define glAttachShader                   context->pglAttachShader
+#  define glLinkProgram                    context->pglLinkProgram
+#  define glGetProgramiv                   context->pglGetProgramiv
+#  define glDeleteProgram                  context->pglDeleteProgram
+#  define glUseProgram                     context->pglUseProgram
+#  define glGetUniformLocation             context->pglGetUniformLocation
+#  define glUniform1i                      context->pglUniform1i
+#  define glUniform1f                      context->pglUniform1f
+#  define glUniform2f                      context->pglUniform2f
+#  define glUniform3f                      context->pglUniform3f
+#  define glUniform4f                      context->pglUniform4f
+#  define glGetAttribLocation              context->pglGetAttribLocation
+#  define glVertexAttribPointer            context->pglVertexAttribPointer
+#  define glEnableVertexAttribArray        context->pglEnableVertexAttribArray
+#  define glDisableVertexAttribArray       context->pglDisableVertexAttribArray
+#endif
+
+#ifndef GL_VERSION_3_0
+#  define GL_R8                            0x8229
+#  define glGenVertexArrays                context->pglGenVertexArrays
+#  define glBindVertexArray                context->pglBindVertexArray
+#  define glDeleteVertexArrays             context->pglDeleteVertexArrays
+#  define GL_FRAMEBUFFER                   0x8D40
+#  define GL_RENDERBUFFER                  0x8D41
+#  define GL_COLOR_ATTACHMENT0             0x8CE0
+#  define GL_DEPTH_ATTACHMENT              0x8D00
+#  define GL_STENCIL_ATTACHMENT            0x8D20
+#  define GL_FRAMEBUFFER_COMPLETE          0x8CD5
+#  define GL_DEPTH24_STENCIL8              0x88F0
+#  define glGenFramebuffers                context->pglGenFramebuffers
+#  define glDeleteFramebuffers             context->pglDeleteFramebuffers
+#  define glBindFramebuffer                context->pglBindFramebuffer
+#  define glFramebufferTexture2D           context->pglFramebufferTexture2D
+#  define glCheckFramebufferStatus         context->pglCheckFramebufferStatus
+#  define glGenRenderbuffers               context->pglGenRenderbuffers
+#  define glDeleteRenderbuffers            context->pglDeleteRenderbuffers
+#  define glBindRenderbuffer               context->pglBindRenderbuffer
+#  define glRenderbufferStorage            context->pglRenderbufferStorage
+#  define glFramebufferRenderbuffer        context->pglFramebufferRenderbuffer
+#endif
+
+#ifndef GL_VERSION_3_2
+#  define GL_CONTEXT_PROFILE_MASK          0x9126
+#  define GL_CONTEXT_CORE_PROFILE_BIT      0x00000001
+#endif
+
+#ifndef GL_VERSION_3_3
+#  define GL_TEXTURE_SWIZZLE_RGBA          0x8E46
+#endif
+
+#ifndef GL_EXT_stencil_two_side
+#  define GL_STENCIL_TEST_TWO_SIDE_EXT     0x8910
 #endif
 
 typedef void (APIENTRYP SH_PGLACTIVETEXTURE) (GLenum);
 typedef void (APIENTRYP SH_PGLMULTITEXCOORD1F) (GLenum, GLfloat);
 typedef void (APIENTRYP SH_PGLMULTITEXCOORD2F) (GLenum, GLfloat, GLfloat);
+typedef void (APIENTRYP SH_PGLSTENCILOPSEPARATE) (GLenum, GLenum, GLenum, GLenum);
+typedef void (APIENTRYP SH_PGLACTIVESTENCILFACE) (GLenum);
+typedef void (APIENTRYP SH_PGLGENBUFFERS) (GLsizei, GLuint*);
+typedef void (APIENTRYP SH_PGLDELETEBUFFERS) (GLsizei, const GLuint*);
+typedef void (APIENTRYP SH_PGLBINDBUFFER) (GLenum, GLuint);
+typedef void (APIENTRYP SH_PGLBUFFERDATA) (GLenum, GLsizeiptr, const GLvoid*, GLenum);
+typedef void (APIENTRYP SH_PGLBUFFERSUBDATA) (GLenum, GLintptr, GLsizeiptr, const GLvoid*);
+typedef GLuint (APIENTRYP SH_PGLCREATESHADER) (GLenum);
+typedef void (APIENTRYP SH_PGLSHADERSOURCE) (GLuint, GLsizei, const GLchar**, const GLint*);
+typedef void (APIENTRYP SH_PGLCOMPILESHADER) (GLuint);
+typedef void (APIENTRYP SH_PGLGETSHADERIV) (GLuint, GLenum, GLint*);
+typedef void (APIENTRYP SH_PGLDELETESHADER) (GLuint);
+typedef GLuint (APIENTRYP SH_PGLCREATEPROGRAM) (void);
+typedef void (APIENTRYP SH_PGLATTACHSHADER) (GLuint, GLuint);
+typedef void (APIENTRYP SH_PGLLINKPROGRAM) (GLuint);
+typedef void (APIENTRYP SH_PGLGETPROGRAMIV) (GLuint, GLenum, GLint*);
+typedef void (APIENTRYP SH_PGLDELETEPROGRAM) (GLuint);
+typedef void (APIENTRYP SH_PGLUSEPROGRAM) (GLuint);
+typedef GLint (APIENTRYP SH_PGLGETUNIFORMLOCATION) (GLuint, const GLchar*);
+typedef void (APIENTRYP SH_PGLUNIFORM1I) (GLint, GLint);
+typedef void (APIENTRYP SH_PGLUNIFORM1F) (GLint, GLfloat);
+typedef void (APIENTRYP SH_PGLUNIFORM2F) (GLint, GLfloat, GLfloat);
+typedef void (APIENTRYP SH_PGLUNIFORM3F) (GLint, GLfloat, GLfloat, GLfloat);
+typedef void (APIENTRYP SH_PGLUNIFORM4F) (GLint, GLfloat, GLfloat, GLfloat, GLfloat);
+typedef GLint (APIENTRYP SH_PGLGETATTRIBLOCATION) (GLuint, const GLchar*);
+typedef void (APIENTRYP SH_PGLVERTEXATTRIBPOINTER) (GLuint, GLint, GLenum, GLboolean, GLsizei, const GLvoid*);
+typedef void (APIENTRYP SH_PGLENABLEVERTEXATTRIBARRAY) (GLuint);
+typedef void (APIENTRYP SH_PGLDISABLEVERTEXATTRIBARRAY) (GLuint);
+typedef void (APIENTRYP SH_PGLVERTEXATTRIBDIVISOR) (GLuint, GLuint);
+typedef void (APIENTRYP SH_PGLDRAWARRAYSINSTANCED) (GLenum, GLint, GLsizei, GLsizei);
+typedef void (APIENTRYP SH_PGLGENVERTEXARRAYS) (GLsizei, GLuint*);
+typedef void (APIENTRYP SH_PGLBINDVERTEXARRAY) (GLuint);
+typedef void (APIENTRYP SH_PGLDELETEVERTEXARRAYS) (GLsizei, const GLuint*);
+typedef void (APIENTRYP SH_PGLGENFRAMEBUFFERS) (GLsizei, GLuint*);
+typedef void (APIENTRYP SH_PGLDELETEFRAMEBUFFERS) (GLsizei, const GLuint*);
+typedef void (APIENTRYP SH_PGLBINDFRAMEBUFFER) (GLenum, GLuint);
+typedef void (APIENTRYP SH_PGLFRAMEBUFFERTEXTURE2D) (GLenum, GLenum, GLenum,
+                                                     GLuint, GLint);
+typedef GLenum (APIENTRYP SH_PGLCHECKFRAMEBUFFERSTATUS) (GLenum);
+typedef void (APIENTRYP SH_PGLGENRENDERBUFFERS) (GLsizei, GLuint*);
+typedef void (APIENTRYP SH_PGLDELETERENDERBUFFERS) (GLsizei, const GLuint*);
+typedef void (APIENTRYP SH_PGLBINDRENDERBUFFER) (GLenum, GLuint);
+typedef void (APIENTRYP SH_PGLRENDERBUFFERSTORAGE) (GLenum, GLenum,
+                                                    GLsizei, GLsizei);
+typedef void (APIENTRYP SH_PGLFRAMEBUFFERRENDERBUFFER) (GLenum, GLenum,
+                                                        GLenum, GLuint);
 
 #endif
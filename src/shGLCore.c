@@ -0,0 +1,827 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shExtensions.h"
+#include "shContext.h"
+#include "shPath.h"
+#include "shImage.h"
+#include "shGeometry.h"
+#include "shPaint.h"
+#include "shTriangulate.h"
+#include <stdlib.h>
+
+/*------------------------------------------------------------
+ * Core-profile renderer: the stencil-and-cover pipeline of
+ * shPipeline.c for OpenGL 3.3 core profiles, which have no
+ * immediate mode, matrix stacks, texgen or texture combiners.
+ * Geometry comes from the path buffers through a single
+ * vertex array object, or from a stream buffer for quads.
+ * Every draw binds one of the programs of shShader.c, with
+ * the user-to-surface matrix in uniforms and the paint (or
+ * an image times the paint) evaluated per pixel, so paints
+ * never need a mesh. Path caches, batches, the ramp atlas,
+ * the mask and the scissor bands are shared with the legacy
+ * pipeline.
+ *------------------------------------------------------------*/
+
+/*-----------------------------------------------------------
+ * Creates the vertex array, stream buffer and the texture
+ * for pixel writes, and builds the color program to check
+ * the driver takes GLSL 3.30. Returns 0 if the renderer
+ * can't run in the current OpenGL context.
+ *-----------------------------------------------------------*/
+
+SHint shGLCoreInit(VGContext *context)
+{
+  if (context->glMajor < 3 || (context->glMajor == 3 && context->glMinor < 3))
+    return 0;
+
+  if (!context->isGLAvailable_Shaders ||
+      !context->isGLAvailable_VertexBufferObject ||
+      !context->isGLAvailable_VertexArrayObject ||
+      !context->isGLAvailable_StencilOpSeparate)
+    return 0;
+
+  glGenVertexArrays(1, &context->coreVertexArray);
+  glGenBuffers(1, &context->coreBuffer);
+  glGenTextures(1, &context->coreTexture);
+  if (!context->coreVertexArray || !context->coreBuffer ||
+      !context->coreTexture)
+    return 0;
+
+  /* Positions are the only vertex attribute */
+  glBindVertexArray(context->coreVertexArray);
+  glEnableVertexAttribArray(0);
+  context->coreVertexArrayBound = 1;
+
+  return (shLoadCoreProgram(context, SH_CORE_PAINT_COLOR) != NULL);
+}
+
+void shGLCoreRelease(VGContext *context)
+{
+  shDeleteCorePrograms(context);
+
+  if (context->coreVertexArrayBound)
+    glBindVertexArray(0);
+  if (context->coreVertexArray)
+    glDeleteVertexArrays(1, &context->coreVertexArray);
+  if (context->coreBuffer)
+    glDeleteBuffers(1, &context->coreBuffer);
+  if (context->coreTexture) {
+    shGLStateForgetTexture(&context->glState, context->coreTexture);
+    glDeleteTextures(1, &context->coreTexture);
+  }
+
+  context->coreVertexArray = 0;
+  context->coreVertexArrayBound = 0;
+  context->coreBuffer = 0;
+  context->coreTexture = 0;
+}
+
+/*-----------------------------------------------------------
+ * Binds our vertex array, once per frame since the
+ * application may bind its own between frames
+ *-----------------------------------------------------------*/
+
+static void shCoreBegin(VGContext *context)
+{
+  if (context->coreVertexArrayBound)
+    return;
+
+  glBindVertexArray(context->coreVertexArray);
+  context->coreVertexArrayBound = 1;
+}
+
+/*-----------------------------------------------------------
+ * Points the position attribute at a buffer, or uploads
+ * vertices to the stream buffer and points it there
+ *-----------------------------------------------------------*/
+
+static void shCoreVertexPointer(VGContext *context, GLuint buffer,
+                                SHint offset, SHint stride)
+{
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride,
+                        (const GLvoid*)(size_t)offset);
+}
+
+static void shCoreStreamVertices(VGContext *context, SHVector2 *v,
+                                 SHint count)
+{
+  /* Orphan the previous contents instead of
+     waiting for draws still reading them */
+  SH_TRACE_BEGIN(context, "upload");
+  glBindBuffer(GL_ARRAY_BUFFER, context->coreBuffer);
+  glBufferData(GL_ARRAY_BUFFER, count * sizeof(SHVector2), v,
+               GL_STREAM_DRAW);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)0);
+  SH_TRACE_END(context, "upload");
+}
+
+/*-----------------------------------------------------------
+ * Loads the user-to-surface matrix into the program, with
+ * the surface mapped onto the viewport
+ *-----------------------------------------------------------*/
+
+static void shCoreSetMatrix(VGContext *context, SHCoreProgram *g,
+                            SHMatrix3x3 *m, SHfloat depth)
+{
+  glUniform3f(g->userX, m->m[0][0], m->m[0][1], m->m[0][2]);
+  glUniform3f(g->userY, m->m[1][0], m->m[1][1], m->m[1][2]);
+  glUniform3f(g->userW, m->m[2][0], m->m[2][1], m->m[2][2]);
+  glUniform2f(g->viewScale, 2.0f / context->surfaceWidth,
+              2.0f / context->surfaceHeight);
+  glUniform1f(g->depth, depth);
+}
+
+/*-----------------------------------------------------------
+ * Binds the program evaluating the paint, or the image times
+ * the paint if SH_CORE_IMAGE is in flags, and sets it up for
+ * geometry in the user space of the given matrix. Paints
+ * that degenerate to a single color are drawn with it like
+ * the legacy meshes do. Returns NULL if no program builds.
+ *-----------------------------------------------------------*/
+
+static SHCoreProgram* shCoreUsePaint(VGContext *context, SHPaint *p,
+                                     VGPaintMode mode, SHint flags,
+                                     SHMatrix3x3 *user)
+{
+  SHCoreProgram *g;
+  SHMatrix3x3 *m;
+  SHMatrix3x3 mi;
+  SHColor color;
+  SHImage *img;
+  SHint kind, invertible;
+  SHfloat gx = 0.0f, gy = 0.0f, n = 1.0f;
+  SHfloat sx = 1.0f, sy = 1.0f;
+  SHfloat cx, cy, fx, fy, r;
+  SHfloat fcx, fcy;
+  SHfloat row;
+
+  if (mode == VG_FILL_PATH)
+    m = &context->fillTransform;
+  else
+    m = &context->strokeTransform;
+
+  invertible = shInvertMatrix(m, &mi);
+  kind = SH_CORE_PAINT_COLOR;
+  color = p->color;
+
+  switch (p->type) {
+  case VG_PAINT_TYPE_LINEAR_GRADIENT:
+    gx = p->linearGradient[2] - p->linearGradient[0];
+    gy = p->linearGradient[3] - p->linearGradient[1];
+    n = gx*gx + gy*gy;
+    if (invertible && n != 0.0f) kind = SH_CORE_PAINT_LINEAR;
+    else color = p->stops.items[p->stops.size-1].color;
+    break;
+
+  case VG_PAINT_TYPE_RADIAL_GRADIENT:
+    if (invertible && p->radialGradient[4] > 0.0f) kind = SH_CORE_PAINT_RADIAL;
+    else color = p->stops.items[p->stops.size-1].color;
+    break;
+
+  case VG_PAINT_TYPE_PATTERN:
+    if (p->pattern == VG_INVALID_HANDLE) break;
+    if (invertible) kind = SH_CORE_PAINT_PATTERN;
+    else color = context->tileFillColor;
+    break;
+
+  default:
+    break;
+  }
+
+  g = shLoadCoreProgram(context, kind | flags);
+  if (g == NULL)
+    return NULL;
+
+  shGLUseProgram(context, g->program);
+  shCoreSetMatrix(context, g, user, 0.0f);
+
+  if (flags & SH_CORE_MASK)
+    glUniform2f(g->maskScale, 1.0f / context->maskTexWidth,
+                1.0f / context->maskTexHeight);
+
+  if (kind == SH_CORE_PAINT_COLOR) {
+    glUniform4f(g->color, color.r, color.g, color.b, color.a);
+    return g;
+  }
+
+  /* Back to paint space, and to texture space for patterns */
+  shGLActiveTexture(context, GL_TEXTURE1);
+  if (kind == SH_CORE_PAINT_PATTERN) {
+    img = (SHImage*)p->pattern;
+    sx = 1.0f / (SHfloat)img->texwidth;
+    sy = 1.0f / (SHfloat)img->texheight;
+    shBindPatternTexture(p, context);
+  }
+
+  glUniform3f(g->paintX, sx * mi.m[0][0], sx * mi.m[0][1], sx * mi.m[0][2]);
+  glUniform3f(g->paintY, sy * mi.m[1][0], sy * mi.m[1][1], sy * mi.m[1][2]);
+
+  if (kind == SH_CORE_PAINT_LINEAR) {
+
+    row = shBindGradientRamp(p, context);
+    glUniform1f(g->rampRow, row);
+    glUniform2f(g->params[0], p->linearGradient[0], p->linearGradient[1]);
+    glUniform2f(g->params[1], gx / n, gy / n);
+
+  }else if (kind == SH_CORE_PAINT_RADIAL) {
+
+    row = shBindGradientRamp(p, context);
+    glUniform1f(g->rampRow, row);
+
+    cx = p->radialGradient[0];
+    cy = p->radialGradient[1];
+    fx = p->radialGradient[2];
+    fy = p->radialGradient[3];
+    r = p->radialGradient[4];
+
+    /* Move focus into circle if outside */
+    fcx = fx - cx;
+    fcy = fy - cy;
+    n = SH_SQRT(fcx*fcx + fcy*fcy);
+    if (n > r) {
+      fcx *= 0.995f * r / n;
+      fcy *= 0.995f * r / n;
+      fx = cx + fcx;
+      fy = cy + fcy;
+    }
+
+    glUniform2f(g->params[0], fx, fy);
+    glUniform2f(g->params[1], fcx, fcy);
+    glUniform2f(g->params[2], r*r, r*r - (fcx*fcx + fcy*fcy));
+  }
+
+  return g;
+}
+
+static SHint shIsOpaquePaint(SHPaint *p)
+{
+  return (p->type == VG_PAINT_TYPE_COLOR && p->color.a == 1.0f);
+}
+
+/*-----------------------------------------------------------
+ * The mask texture is sampled by the programs with the
+ * SH_CORE_MASK flag, which these return while it applies
+ *-----------------------------------------------------------*/
+
+static SHint shCoreBeginMasking(VGContext *context)
+{
+  if (context->masking == VG_FALSE || context->maskData == NULL ||
+      context->renderTarget != NULL)
+    return 0;
+
+  shGLActiveTexture(context, SH_MASK_TEXTURE_UNIT);
+  shGLBindTexture(context, GL_TEXTURE_2D, context->maskTexture);
+  context->maskActive = 1;
+  return SH_CORE_MASK;
+}
+
+static void shCoreEndMasking(VGContext *context)
+{
+  context->maskActive = 0;
+}
+
+/*-----------------------------------------------------------
+ * Fills the winding numbers of the contour fans, or of the
+ * batched triangles, into the stencil buffer
+ *-----------------------------------------------------------*/
+
+static void shCoreDrawFans(VGContext *context, SHPath *p)
+{
+  SHint start, size;
+
+  shCoreVertexPointer(context, p->vertexBuffer, 0, sizeof(SHVertex));
+  for (start=0; start < p->vertices.size; start += size) {
+    size = p->vertices.items[start].flags;
+    glDrawArrays(GL_TRIANGLE_FAN, start, size);
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  }
+}
+
+static void shCoreBeginNonZero(VGContext *context)
+{
+  context->pglStencilOpSeparate(GL_FRONT, GL_INCR_WRAP,
+                                GL_INCR_WRAP, GL_INCR_WRAP);
+  context->pglStencilOpSeparate(GL_BACK, GL_DECR_WRAP,
+                                GL_DECR_WRAP, GL_DECR_WRAP);
+  shGLStateInvalidateStencil(&context->glState);
+}
+
+/* The bounding box quad stored behind the geometry */
+
+static void shCoreDrawBoundBox(VGContext *context, GLuint buffer,
+                               SHint offset)
+{
+  shCoreVertexPointer(context, buffer, offset, 0);
+  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+}
+
+static void shCoreDrawPathFill(VGContext *context, SHPath *p,
+                               SHPaint *fill, SHint flags)
+{
+  SHint nonZero;
+  SHint boxOffset = p->vertices.size * sizeof(SHVertex);
+
+  if (!shCoreUsePaint(context, fill, VG_FILL_PATH, flags,
+                      &context->pathTransform))
+    return;
+
+  /* Paths with non-overlapping geometry of their own are
+     drawn with the paint in a single pass */
+  if (p->convex || context->fillTriangulation == VG_TRUE) {
+
+    SH_TRACE_BEGIN(context, "cover");
+    updateBlendingStateGL(context, shIsOpaquePaint(fill));
+
+    if (p->convex) {
+      shCoreDrawFans(context, p);
+    }else{
+      if (shIsTrianglesCacheValid( context, p ) == VG_FALSE)
+        shTriangulatePath(p, context->fillRule);
+      shUpdateTrianglesBuffer(context, p);
+      shCoreVertexPointer(context, p->trianglesBuffer, 0, 0);
+      glDrawArrays(GL_TRIANGLES, 0, p->triangles.size);
+      SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+    }
+
+    shGLDisable(context, GL_BLEND);
+    SH_TRACE_END(context, "cover");
+    return;
+  }
+
+  /* Clear the stencil below the path */
+  SH_TRACE_BEGIN(context, "stencil");
+  shGLEnable(context, GL_STENCIL_TEST);
+  shGLStencilFunc(context, GL_ALWAYS, 0, 0);
+  shGLStencilOp(context, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+  shGLColorMask(context, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  shCoreDrawBoundBox(context, p->vertexBuffer, boxOffset);
+
+  /* Tesselate into stencil; a convex contour covers every
+     pixel at most once, so parity works for either rule */
+  nonZero = (context->fillRule == VG_NON_ZERO && !p->convex);
+  if (nonZero) shCoreBeginNonZero(context);
+  else shGLStencilOp(context, GL_INVERT, GL_INVERT, GL_INVERT);
+  shCoreDrawFans(context, p);
+  SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 1);
+  SH_TRACE_END(context, "stencil");
+
+  /* Cover with the paint where stencil odd (or non-zero) */
+  SH_TRACE_BEGIN(context, "cover");
+  updateBlendingStateGL(context, shIsOpaquePaint(fill));
+  if (nonZero) shGLStencilFunc(context, GL_NOTEQUAL, 0, ~0);
+  else shGLStencilFunc(context, GL_EQUAL, 1, 1);
+  shGLStencilOp(context, GL_ZERO, GL_ZERO, GL_ZERO);
+  shGLColorMask(context, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  shCoreDrawBoundBox(context, p->vertexBuffer, boxOffset);
+
+  /* Reset state */
+  shGLDisable(context, GL_STENCIL_TEST);
+  shGLDisable(context, GL_BLEND);
+  SH_TRACE_END(context, "cover");
+}
+
+static void shCoreDrawPathStroke(VGContext *context, SHPath *p,
+                                 SHPaint *stroke, SHint flags)
+{
+  SHint boxOffset = p->stroke.size * sizeof(SHVector2);
+
+  if (!shCoreUsePaint(context, stroke, VG_STROKE_PATH, flags,
+                      &context->pathTransform))
+    return;
+
+  shUpdateStrokeBuffer(context, p);
+
+  /* Clear the stencil below the stroke */
+  SH_TRACE_BEGIN(context, "stencil");
+  shGLEnable(context, GL_STENCIL_TEST);
+  shGLStencilFunc(context, GL_ALWAYS, 0, 0);
+  shGLStencilOp(context, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+  shGLColorMask(context, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  shCoreDrawBoundBox(context, p->strokeBuffer, boxOffset);
+
+  /* Mark every pixel the stroke triangles touch once */
+  shGLStencilFunc(context, GL_NOTEQUAL, 1, 1);
+  shGLStencilOp(context, GL_KEEP, GL_INCR, GL_INCR);
+  shCoreVertexPointer(context, p->strokeBuffer, 0, 0);
+  glDrawArrays(GL_TRIANGLES, 0, p->stroke.size);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 1);
+  SH_TRACE_END(context, "stencil");
+
+  /* Cover with the paint where marked */
+  SH_TRACE_BEGIN(context, "cover");
+  updateBlendingStateGL(context, shIsOpaquePaint(stroke));
+  shGLStencilFunc(context, GL_EQUAL, 1, 1);
+  shGLStencilOp(context, GL_ZERO, GL_ZERO, GL_ZERO);
+  shGLColorMask(context, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  shCoreDrawBoundBox(context, p->strokeBuffer, boxOffset);
+
+  /* Reset state */
+  shGLDisable(context, GL_STENCIL_TEST);
+  shGLDisable(context, GL_BLEND);
+  SH_TRACE_END(context, "cover");
+}
+
+void shGLCoreDrawPath(VGContext *context, SHPath *p, VGbitfield paintModes,
+                      SHRectangle *bounds)
+{
+  SHPaint *fill, *stroke;
+  SHint flags;
+
+  /* Pick paint if available or default*/
+  fill = (context->fillPaint ? context->fillPaint : &context->defaultPaint);
+  stroke = (context->strokePaint ? context->strokePaint : &context->defaultPaint);
+
+  /* Draw pending batch first unless this path joins it */
+  if (shIsBatchable(context, fill, paintModes)) {
+    shAddToBatch(context, p, fill);
+    return;
+  }
+
+  shGLCoreFlushBatch(context);
+
+  /* Skip paths entirely outside the scissor rectangles */
+  if (!shBeginScissoring(context, bounds)) {
+    SH_COUNT(context, VG_STAT_PATHS_CULLED_SH, 1);
+    return;
+  }
+  SH_COUNT(context, VG_STAT_PATHS_DRAWN_SH, 1);
+
+  shCoreBegin(context);
+  flags = shCoreBeginMasking(context);
+
+  /* Keep the cached geometry on the GPU */
+  shUpdateVertexBuffer(context, p);
+  shGLEnable(context, GL_MULTISAMPLE);
+
+  if (paintModes & VG_FILL_PATH)
+    shCoreDrawPathFill(context, p, fill, flags);
+
+  if ((paintModes & VG_STROKE_PATH) &&
+      context->strokeLineWidth > 0.0f)
+    shCoreDrawPathStroke(context, p, stroke, flags);
+
+  shGLDisable(context, GL_MULTISAMPLE);
+  shCoreEndMasking(context);
+}
+
+/*-----------------------------------------------------------
+ * Draws the image quad with the image-user-to-surface matrix,
+ * which may be projective, multiplied by the fill paint in
+ * VG_DRAW_IMAGE_MULTIPLY mode
+ *-----------------------------------------------------------*/
+
+void shGLCoreDrawImage(VGContext *context, SHImage *i, SHRectangle *bounds)
+{
+  SHCoreProgram *g;
+  SHPaint *fill;
+  SHVector2 quad[4];
+  SHint flags;
+
+  shGLCoreFlushBatch(context);
+
+  /* Stencil mode is not supported, like in the legacy pipeline */
+  if (context->imageMode == VG_DRAW_IMAGE_STENCIL)
+    return;
+
+  if (!shBeginScissoring(context, bounds))
+    return;
+
+  shCoreBegin(context);
+  flags = shCoreBeginMasking(context) | SH_CORE_IMAGE;
+
+  /* Pick fill paint */
+  fill = (context->fillPaint ? context->fillPaint : &context->defaultPaint);
+
+  if (context->imageMode == VG_DRAW_IMAGE_MULTIPLY) {
+    g = shCoreUsePaint(context, fill, VG_FILL_PATH, flags,
+                       &context->imageTransform);
+  }else{
+    g = shLoadCoreProgram(context, SH_CORE_PAINT_COLOR | flags);
+    if (g) {
+      shGLUseProgram(context, g->program);
+      shCoreSetMatrix(context, g, &context->imageTransform, 0.0f);
+      glUniform4f(g->color, 1.0f, 1.0f, 1.0f, 1.0f);
+      if (flags & SH_CORE_MASK)
+        glUniform2f(g->maskScale, 1.0f / context->maskTexWidth,
+                    1.0f / context->maskTexHeight);
+    }
+  }
+
+  if (g == NULL) {
+    shCoreEndMasking(context);
+    return;
+  }
+
+  /* Clamp to edge for proper filtering. Adjust
+     antialiasing to settings. */
+  glUniform2f(g->imageScale, 1.0f / i->texwidth, 1.0f / i->texheight);
+  shGLActiveTexture(context, GL_TEXTURE0);
+  shGLBindTexture(context, GL_TEXTURE_2D, i->texture);
+
+  if (context->imageQuality == VG_IMAGE_QUALITY_NONANTIALIASED) {
+    shGLTexParameters(context, GL_TEXTURE_2D, i->texParams,
+                      GL_CLAMP_TO_EDGE, GL_NEAREST);
+    shGLDisable(context, GL_MULTISAMPLE);
+  }else{
+    shGLTexParameters(context, GL_TEXTURE_2D, i->texParams,
+                      GL_CLAMP_TO_EDGE, GL_LINEAR);
+    shGLEnable(context, GL_MULTISAMPLE);
+  }
+
+  updateBlendingStateGL(context, 0);
+
+  SET2(quad[0], 0, 0);
+  SET2(quad[1], (SHfloat)i->width, 0);
+  SET2(quad[2], (SHfloat)i->width, (SHfloat)i->height);
+  SET2(quad[3], 0, (SHfloat)i->height);
+  shCoreStreamVertices(context, quad, 4);
+  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+
+  shGLDisable(context, GL_BLEND);
+  shCoreEndMasking(context);
+}
+
+/*-----------------------------------------------------------
+ * Fills surface-space rectangles at the given depth (in
+ * normalized device coordinates), with blending off. Used
+ * for the scissor bands and clearing through them, with the
+ * color left alone if NULL.
+ *-----------------------------------------------------------*/
+
+void shGLCoreFillRects(VGContext *context, SHRectangle *rects, SHint count,
+                       SHfloat depth, SHColor *color)
+{
+  SHCoreProgram *g;
+  SHMatrix3x3 identity;
+  SHVector2 v[6];
+  SHRectangle *r;
+  SHint i, j;
+
+  g = shLoadCoreProgram(context, SH_CORE_PAINT_COLOR);
+  if (g == NULL)
+    return;
+
+  shCoreBegin(context);
+  shGLUseProgram(context, g->program);
+  IDMAT(identity);
+  shCoreSetMatrix(context, g, &identity, depth);
+  if (color)
+    glUniform4f(g->color, color->r, color->g, color->b, color->a);
+
+  shVector2ArrayClear(&context->coreVertices);
+  for (i=0; i<count; ++i) {
+    r = &rects[i];
+    SET2(v[0], r->x, r->y);
+    SET2(v[1], r->x + r->w, r->y);
+    SET2(v[2], r->x + r->w, r->y + r->h);
+    SET2(v[3], r->x, r->y);
+    SET2(v[4], r->x + r->w, r->y + r->h);
+    SET2(v[5], r->x, r->y + r->h);
+    for (j=0; j<6; ++j)
+      shVector2ArrayPushBackP(&context->coreVertices, &v[j]);
+  }
+
+  shGLDisable(context, GL_BLEND);
+  shCoreStreamVertices(context, context->coreVertices.items,
+                       context->coreVertices.size);
+  glDrawArrays(GL_TRIANGLES, 0, context->coreVertices.size);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+}
+
+/*-----------------------------------------------------------
+ * Pixel writes and copies go through the pixel texture,
+ * drawn unblended and unmasked within the scissor bands
+ *-----------------------------------------------------------*/
+
+static void shCoreDrawPixelTexture(VGContext *context, SHint dx, SHint dy,
+                                   SHint width, SHint height)
+{
+  SHCoreProgram *g;
+  SHMatrix3x3 m;
+  SHVector2 quad[4];
+
+  g = shLoadCoreProgram(context, SH_CORE_PAINT_COLOR | SH_CORE_IMAGE);
+  if (g == NULL)
+    return;
+
+  shGLUseProgram(context, g->program);
+  SETMAT(m, 1, 0, (SHfloat)dx, 0, 1, (SHfloat)dy, 0, 0, 1);
+  shCoreSetMatrix(context, g, &m, 0.0f);
+  glUniform4f(g->color, 1.0f, 1.0f, 1.0f, 1.0f);
+  glUniform2f(g->imageScale, 1.0f / width, 1.0f / height);
+
+  shGLTexParameters(context, GL_TEXTURE_2D, context->coreTextureParams,
+                    GL_CLAMP_TO_EDGE, GL_NEAREST);
+  shGLDisable(context, GL_BLEND);
+
+  SET2(quad[0], 0, 0);
+  SET2(quad[1], (SHfloat)width, 0);
+  SET2(quad[2], (SHfloat)width, (SHfloat)height);
+  SET2(quad[3], 0, (SHfloat)height);
+  shCoreStreamVertices(context, quad, 4);
+  glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+}
+
+void shGLCoreWritePixels(VGContext *context, const void *data,
+                         VGImageFormat format, SHint stride,
+                         SHint dataWidth, SHint dataHeight,
+                         SHint dx, SHint dy, SHint sx, SHint sy,
+                         SHint width, SHint height)
+{
+  SHuint8 *pixels;
+  SHImageFormatDesc winfd;
+  SHRectangle area;
+
+  shGLCoreFlushBatch(context);
+
+  shRectangleSet(&area, (SHfloat)dx, (SHfloat)dy,
+                 (SHfloat)width, (SHfloat)height);
+  if (!shBeginScissoring(context, &area))
+    SH_RETURN(SH_NO_RETVAL);
+
+  /* Same pixel layout as glReadPixels gets */
+  shSetupImageFormat(shRasterFormat(), &winfd);
+
+  pixels = (SHuint8*)malloc(width * height * winfd.bytes);
+  SH_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, SH_NO_RETVAL);
+
+  shCopyPixels(pixels, winfd.vgformat, -1,
+               (SHuint8*)data, format, stride,
+               width, height, dataWidth, dataHeight,
+               0, 0, sx, sy, width, height);
+
+  shCoreBegin(context);
+  shGLActiveTexture(context, GL_TEXTURE0);
+  shGLBindTexture(context, GL_TEXTURE_2D, context->coreTexture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  free(pixels);
+
+  shCoreDrawPixelTexture(context, dx, dy, width, height);
+}
+
+void shGLCoreCopyPixels(VGContext *context, SHint dx, SHint dy,
+                        SHint sx, SHint sy, SHint width, SHint height)
+{
+  SHRectangle area;
+
+  shGLCoreFlushBatch(context);
+
+  shRectangleSet(&area, (SHfloat)dx, (SHfloat)dy,
+                 (SHfloat)width, (SHfloat)height);
+  if (!shBeginScissoring(context, &area))
+    SH_RETURN(SH_NO_RETVAL);
+
+  /* Overlapping areas are fine since the source is
+     copied out of the framebuffer first */
+  shCoreBegin(context);
+  shGLActiveTexture(context, GL_TEXTURE0);
+  shGLBindTexture(context, GL_TEXTURE_2D, context->coreTexture);
+  glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, sx, sy, width, height, 0);
+
+  shCoreDrawPixelTexture(context, dx, dy, width, height);
+}
+
+/*-----------------------------------------------------------
+ * Draws the batch of plain fills collected by shAddToBatch
+ * (see shPipeline.c), its quads split into triangles
+ *-----------------------------------------------------------*/
+
+void shGLCoreFlushBatch(VGContext *context)
+{
+  SHCoreProgram *g;
+  SHMatrix3x3 identity;
+  SHVector2 *q;
+  SHint i, triangles, quads;
+
+  if (context->batchDraws == 0)
+    return;
+
+  g = shLoadCoreProgram(context, SH_CORE_PAINT_COLOR);
+
+  /* Batches are only collected with scissoring off */
+  shBeginScissoring(context, NULL);
+
+  /* Geometry is in surface space already */
+  if (g) {
+    shCoreBegin(context);
+    shGLUseProgram(context, g->program);
+    IDMAT(identity);
+    shCoreSetMatrix(context, g, &identity, 0.0f);
+    glUniform4f(g->color, context->batchColor.r, context->batchColor.g,
+                context->batchColor.b, context->batchColor.a);
+
+    shVector2ArrayClear(&context->coreVertices);
+    for (i=0; i<context->batchTriangles.size; ++i)
+      shVector2ArrayPushBackP(&context->coreVertices,
+                              &context->batchTriangles.items[i]);
+    for (i=0; i<context->batchQuads.size; i+=4) {
+      q = &context->batchQuads.items[i];
+      shVector2ArrayPushBackP(&context->coreVertices, &q[0]);
+      shVector2ArrayPushBackP(&context->coreVertices, &q[1]);
+      shVector2ArrayPushBackP(&context->coreVertices, &q[2]);
+      shVector2ArrayPushBackP(&context->coreVertices, &q[0]);
+      shVector2ArrayPushBackP(&context->coreVertices, &q[2]);
+      shVector2ArrayPushBackP(&context->coreVertices, &q[3]);
+    }
+    triangles = context->batchTriangles.size;
+    quads = context->coreVertices.size - triangles;
+    shCoreStreamVertices(context, context->coreVertices.items,
+                         context->coreVertices.size);
+    shGLEnable(context, GL_MULTISAMPLE);
+
+    /* Clear the stencil below every path */
+    SH_TRACE_BEGIN(context, "stencil");
+    shGLEnable(context, GL_STENCIL_TEST);
+    shGLStencilFunc(context, GL_ALWAYS, 0, 0);
+    shGLStencilOp(context, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+    shGLColorMask(context, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDrawArrays(GL_TRIANGLES, triangles, quads);
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+
+    /* Tesselate all paths into stencil */
+    if (context->fillRule == VG_NON_ZERO) shCoreBeginNonZero(context);
+    else shGLStencilOp(context, GL_INVERT, GL_INVERT, GL_INVERT);
+    glDrawArrays(GL_TRIANGLES, 0, triangles);
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+    SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 1);
+    SH_TRACE_END(context, "stencil");
+
+    /* Cover all paths with the shared color */
+    SH_TRACE_BEGIN(context, "cover");
+    updateBlendingStateGL(context, context->batchColor.a == 1.0f);
+    if (context->fillRule == VG_NON_ZERO) shGLStencilFunc(context, GL_NOTEQUAL, 0, ~0);
+    else shGLStencilFunc(context, GL_EQUAL, 1, 1);
+    shGLStencilOp(context, GL_ZERO, GL_ZERO, GL_ZERO);
+    shGLColorMask(context, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDrawArrays(GL_TRIANGLES, triangles, quads);
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+
+    /* Reset state */
+    shGLDisable(context, GL_STENCIL_TEST);
+    shGLDisable(context, GL_BLEND);
+    shGLDisable(context, GL_MULTISAMPLE);
+    SH_TRACE_END(context, "cover");
+    SH_COUNT(context, VG_STAT_PATHS_DRAWN_SH, context->batchDraws);
+  }
+
+  shVector2ArrayClear(&context->batchTriangles);
+  shVector2ArrayClear(&context->batchQuads);
+  context->batchDraws = 0;
+}
+
+/*-----------------------------------------------------------
+ * Ends a frame like the legacy pipeline, leaving no program
+ * or vertex array of ours bound for the application
+ *-----------------------------------------------------------*/
+
+void shGLCoreEndFrame(VGContext *context, SHint finish)
+{
+  shGLUseProgram(context, 0);
+  if (context->coreVertexArrayBound) {
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    context->coreVertexArrayBound = 0;
+  }
+
+  shGLEndFrame(context, finish);
+}
+
+/*-----------------------------------------------------------
+ * The surface is mapped onto the viewport by the programs
+ *-----------------------------------------------------------*/
+
+void shGLCoreResize(VGContext *context)
+{
+  /* depth buffer contents are undefined after a resize */
+  shEndScissoring(context);
+  glViewport(0, 0, context->surfaceWidth, context->surfaceHeight);
+}
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shExtensions.h"
+#include "shContext.h"
+#include "shGLState.h"
+
+/*------------------------------------------------------------
+ * Every pipeline state change goes through these functions,
+ * which skip it if the shadow copy says OpenGL has the same
+ * value already. The application may change OpenGL state
+ * between any two API calls, so each call marks the shadow
+ * stale and only redundant changes within a call are skipped.
+ * With VG_RETAIN_GL_STATE_SH the application promises not to
+ * touch OpenGL state before vgFlush or vgFinish, and the
+ * shadow is only forgotten there.
+ *------------------------------------------------------------*/
+
+void SHGLState_ctor(SHGLState *s)
+{
+  shGLStateInvalidate(s);
+  s->issued = 0;
+  s->skipped = 0;
+  s->frameIssued = 0;
+  s->frameSkipped = 0;
+}
+
+void SHGLState_dtor(SHGLState *s)
+{
+}
+
+void shGLStateInvalidate(SHGLState *s)
+{
+  int i, u;
+  
+  for (i=0; i<SH_GL_CAP_COUNT; ++i)
+    s->caps[i] = -1;
+  
+  for (u=0; u<SH_GL_TEXTURE_UNITS; ++u) {
+    for (i=0; i<SH_GL_UNIT_CAP_COUNT; ++i)
+      s->unitCaps[u][i] = -1;
+    s->texEnvMode[u] = -1;
+    s->texture2D[u] = -1;
+  }
+  
+  s->activeTexture = -1;
+  s->program = -1;
+  s->blendSrc = -1;
+  s->blendDst = -1;
+  s->colorMask = -1;
+  s->depthFunc = -1;
+  s->depthMask = -1;
+  s->stale = 0;
+  shGLStateInvalidateStencil(s);
+}
+
+SHGLState* shGLStateRefresh(SHGLState *s)
+{
+  shGLStateInvalidate(s);
+  return s;
+}
+
+/*------------------------------------------------------------
+ * Must be called before deleting a texture, since OpenGL
+ * unbinds it and may hand its name out again
+ *------------------------------------------------------------*/
+
+void shGLStateForgetTexture(SHGLState *s, GLuint texture)
+{
+  int u;
+  
+  for (u=0; u<SH_GL_TEXTURE_UNITS; ++u)
+    if (s->texture2D[u] == (GLint)texture)
+      s->texture2D[u] = -1;
+}
+
+void shGLStateInvalidateStencil(SHGLState *s)
+{
+  s->stencilFunc = -1;
+  s->stencilRef = -1;
+  s->stencilMask = 0;
+  s->stencilFail = -1;
+  s->stencilZFail = -1;
+  s->stencilZPass = -1;
+}
+
+/*------------------------------------------------------------
+ * Moves the call counters of the current frame to the ones
+ * reported for the last frame
+ *------------------------------------------------------------*/
+
+void shGLStateEndFrame(SHGLState *s)
+{
+  s->frameIssued = s->issued;
+  s->frameSkipped = s->skipped;
+  s->issued = 0;
+  s->skipped = 0;
+}
+
+static SHint* shGLCapState(VGContext *c, GLenum cap)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  SHint unit = 0;
+  
+  switch (cap) {
+  case GL_BLEND:                      return &s->caps[SH_GL_CAP_BLEND];
+  case GL_STENCIL_TEST:               return &s->caps[SH_GL_CAP_STENCIL_TEST];
+  case GL_DEPTH_TEST:                 return &s->caps[SH_GL_CAP_DEPTH_TEST];
+  case GL_SCISSOR_TEST:               return &s->caps[SH_GL_CAP_SCISSOR_TEST];
+  case GL_CULL_FACE:                  return &s->caps[SH_GL_CAP_CULL_FACE];
+  case GL_MULTISAMPLE:                return &s->caps[SH_GL_CAP_MULTISAMPLE];
+  case GL_LINE_SMOOTH:                return &s->caps[SH_GL_CAP_LINE_SMOOTH];
+  case GL_POLYGON_SMOOTH:             return &s->caps[SH_GL_CAP_POLYGON_SMOOTH];
+  case GL_STENCIL_TEST_TWO_SIDE_EXT:  return &s->caps[SH_GL_CAP_STENCIL_TEST_TWO_SIDE];
+  }
+  
+  /* Texturing is per texture unit. Without multitexturing
+     every unit maps to the first one. */
+  if (c->isGLAvailable_Multitexture)
+    unit = s->activeTexture - GL_TEXTURE0;
+  if (unit < 0 || unit >= SH_GL_TEXTURE_UNITS)
+    return NULL;
+  
+  switch (cap) {
+  case GL_TEXTURE_1D:     return &s->unitCaps[unit][SH_GL_UNIT_CAP_TEXTURE_1D];
+  case GL_TEXTURE_2D:     return &s->unitCaps[unit][SH_GL_UNIT_CAP_TEXTURE_2D];
+  case GL_TEXTURE_GEN_S:  return &s->unitCaps[unit][SH_GL_UNIT_CAP_TEXTURE_GEN_S];
+  case GL_TEXTURE_GEN_T:  return &s->unitCaps[unit][SH_GL_UNIT_CAP_TEXTURE_GEN_T];
+  }
+  
+  return NULL;
+}
+
+void shGLEnable(VGContext *c, GLenum cap)
+{
+  SHint *state = shGLCapState(c, cap);
+  
+  if (state && *state == 1) {
+    c->glState.skipped++;
+    return;
+  }
+  
+  glEnable(cap);
+  if (state) *state = 1;
+  c->glState.issued++;
+}
+
+void shGLDisable(VGContext *c, GLenum cap)
+{
+  SHint *state = shGLCapState(c, cap);
+  
+  if (state && *state == 0) {
+    c->glState.skipped++;
+    return;
+  }
+  
+  glDisable(cap);
+  if (state) *state = 0;
+  c->glState.issued++;
+}
+
+void shGLBlendFunc(VGContext *c, GLenum src, GLenum dst)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  
+  if (s->blendSrc == (GLint)src && s->blendDst == (GLint)dst) {
+    s->skipped++;
+    return;
+  }
+  
+  glBlendFunc(src, dst);
+  s->blendSrc = src;
+  s->blendDst = dst;
+  s->issued++;
+}
+
+void shGLStencilFunc(VGContext *c, GLenum func, GLint ref, GLuint mask)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  
+  if (s->stencilFunc == (GLint)func &&
+      s->stencilRef == ref &&
+      s->stencilMask == mask) {
+    s->skipped++;
+    return;
+  }
+  
+  glStencilFunc(func, ref, mask);
+  s->stencilFunc = func;
+  s->stencilRef = ref;
+  s->stencilMask = mask;
+  s->issued++;
+}
+
+void shGLStencilOp(VGContext *c, GLenum fail, GLenum zfail, GLenum zpass)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  
+  if (s->stencilFail == (GLint)fail &&
+      s->stencilZFail == (GLint)zfail &&
+      s->stencilZPass == (GLint)zpass) {
+    s->skipped++;
+    return;
+  }
+  
+  glStencilOp(fail, zfail, zpass);
+  s->stencilFail = fail;
+  s->stencilZFail = zfail;
+  s->stencilZPass = zpass;
+  s->issued++;
+}
+
+void shGLColorMask(VGContext *c, GLboolean r, GLboolean g,
+                   GLboolean b, GLboolean a)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  GLint mask = (r ? 1 : 0) | (g ? 2 : 0) | (b ? 4 : 0) | (a ? 8 : 0);
+  
+  if (s->colorMask == mask) {
+    s->skipped++;
+    return;
+  }
+  
+  glColorMask(r, g, b, a);
+  s->colorMask = mask;
+  s->issued++;
+}
+
+void shGLDepthFunc(VGContext *c, GLenum func)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  
+  if (s->depthFunc == (GLint)func) {
+    s->skipped++;
+    return;
+  }
+  
+  glDepthFunc(func);
+  s->depthFunc = func;
+  s->issued++;
+}
+
+void shGLDepthMask(VGContext *c, GLboolean flag)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  
+  if (s->depthMask == (flag ? 1 : 0)) {
+    s->skipped++;
+    return;
+  }
+  
+  glDepthMask(flag);
+  s->depthMask = (flag ? 1 : 0);
+  s->issued++;
+}
+
+void shGLActiveTexture(VGContext *context, GLenum unit)
+{
+  SHGLState *s = SH_GL_STATE(context);
+  
+  if (s->activeTexture == (GLint)unit) {
+    s->skipped++;
+    return;
+  }
+  
+  glActiveTexture(unit);
+  s->activeTexture = unit;
+  s->issued++;
+}
+
+void shGLUseProgram(VGContext *context, GLuint program)
+{
+  SHGLState *s = SH_GL_STATE(context);
+  
+  if (s->program == (GLint)program) {
+    s->skipped++;
+    return;
+  }
+  
+  /* Nothing to unbind without GLSL support */
+  if (!context->isGLAvailable_Shaders)
+    return;
+  
+  glUseProgram(program);
+  s->program = program;
+  s->issued++;
+}
+
+void shGLTexEnvMode(VGContext *c, GLint mode)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  SHint unit = 0;
+  
+  if (c->isGLAvailable_Multitexture)
+    unit = s->activeTexture - GL_TEXTURE0;
+  
+  if (unit >= 0 && unit < SH_GL_TEXTURE_UNITS) {
+    if (s->texEnvMode[unit] == mode) {
+      s->skipped++;
+      return;
+    }
+    s->texEnvMode[unit] = mode;
+  }
+  
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, mode);
+  s->issued++;
+}
+
+/*------------------------------------------------------------
+ * Binds a texture to the active unit. Only 2D bindings are
+ * tracked; if the active unit is unknown, the binding of
+ * every unit is forgotten.
+ *------------------------------------------------------------*/
+
+void shGLBindTexture(VGContext *c, GLenum target, GLuint texture)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  SHint unit = 0;
+  SHint u;
+  
+  if (target == GL_TEXTURE_2D) {
+    
+    if (c->isGLAvailable_Multitexture)
+      unit = s->activeTexture - GL_TEXTURE0;
+    
+    if (unit >= 0 && unit < SH_GL_TEXTURE_UNITS) {
+      if (s->texture2D[unit] == (GLint)texture) {
+        s->skipped++;
+        return;
+      }
+      s->texture2D[unit] = texture;
+    }else{
+      for (u=0; u<SH_GL_TEXTURE_UNITS; ++u)
+        s->texture2D[u] = -1;
+    }
+  }
+  
+  glBindTexture(target, texture);
+  s->issued++;
+}
+
+/*------------------------------------------------------------
+ * Sets wrapping (of both S and T for 2D textures) and both
+ * filters of the texture currently bound to the target.
+ * Texture parameters belong to the texture object, so the
+ * owner of the texture keeps their shadow copy in 'cache'
+ * (two values, initialized to -1).
+ *------------------------------------------------------------*/
+
+void shGLTexParameters(VGContext *c, GLenum target, GLint *cache,
+                       GLint wrap, GLint filter)
+{
+  SHGLState *s = SH_GL_STATE(c);
+  SHuint wrapCalls = (target == GL_TEXTURE_1D ? 1 : 2);
+  
+  if (cache[0] == wrap) {
+    s->skipped += wrapCalls;
+  }else{
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+    if (target != GL_TEXTURE_1D)
+      glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+    cache[0] = wrap;
+    s->issued += wrapCalls;
+  }
+  
+  if (cache[1] == filter) {
+    s->skipped += 2;
+  }else{
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+    cache[1] = filter;
+    s->issued += 2;
+  }
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __SHGLSTATE_H
+#define __SHGLSTATE_H
+
+#include "shDefs.h"
+
+/*------------------------------------------------------------
+ * Shadow copy of the OpenGL state touched by the pipeline.
+ * Values of -1 mean unknown so the next call always goes
+ * through to OpenGL.
+ *------------------------------------------------------------*/
+
+#define SH_GL_TEXTURE_UNITS 3
+
+typedef enum
+{
+  SH_GL_CAP_BLEND,
+  SH_GL_CAP_STENCIL_TEST,
+  SH_GL_CAP_DEPTH_TEST,
+  SH_GL_CAP_SCISSOR_TEST,
+  SH_GL_CAP_CULL_FACE,
+  SH_GL_CAP_MULTISAMPLE,
+  SH_GL_CAP_LINE_SMOOTH,
+  SH_GL_CAP_POLYGON_SMOOTH,
+  SH_GL_CAP_STENCIL_TEST_TWO_SIDE,
+  SH_GL_CAP_COUNT
+} SHGLCap;
+
+typedef enum
+{
+  SH_GL_UNIT_CAP_TEXTURE_1D,
+  SH_GL_UNIT_CAP_TEXTURE_2D,
+  SH_GL_UNIT_CAP_TEXTURE_GEN_S,
+  SH_GL_UNIT_CAP_TEXTURE_GEN_T,
+  SH_GL_UNIT_CAP_COUNT
+} SHGLUnitCap;
+
+typedef struct
+{
+  SHint caps[SH_GL_CAP_COUNT];
+  SHint unitCaps[SH_GL_TEXTURE_UNITS][SH_GL_UNIT_CAP_COUNT];
+  GLint texEnvMode[SH_GL_TEXTURE_UNITS];
+  GLint texture2D[SH_GL_TEXTURE_UNITS];
+  GLint activeTexture;
+  GLint program;
+  
+  GLint blendSrc, blendDst;
+  GLint stencilFunc, stencilRef;
+  GLint stencilFail, stencilZFail, stencilZPass;
+  GLuint stencilMask;
+  GLint colorMask;
+  GLint depthFunc;
+  GLint depthMask;
+  
+  /* Set when an API call begins without VG_RETAIN_GL_STATE_SH,
+     as the application may have changed OpenGL state since the
+     last one; the shadow is then forgotten before its next use */
+  SHint stale;
+  
+  /* Calls made during the current and the last frame */
+  SHuint issued;
+  SHuint skipped;
+  SHuint frameIssued;
+  SHuint frameSkipped;
+  
+} SHGLState;
+
+/* The shadow state of a context, forgotten first if stale */
+#define SH_GL_STATE(C) \
+  ((C)->glState.stale ? shGLStateRefresh(&(C)->glState) : &(C)->glState)
+
+void SHGLState_ctor(SHGLState *s);
+void SHGLState_dtor(SHGLState *s);
+void shGLStateInvalidate(SHGLState *s);
+SHGLState* shGLStateRefresh(SHGLState *s);
+void shGLStateInvalidateStencil(SHGLState *s);
+void shGLStateEndFrame(SHGLState *s);
+void shGLStateForgetTexture(SHGLState *s, GLuint texture);
+
+#endif /* __SHGLSTATE_H */
@@ -228,7 +228,7 @@ static void shSubdivideSegment(SHPath *p, VGPathSegment segment,
   SHint *surfaceSpace = ((SHint**)userData)[1];
   SHQuad quad; SHCubic cubic; SHArc arc;
   SHVector2 c, ux, uy;
-  VG_GETCONTEXT(VG_NO_RETVAL);
+  SH_GETCONTEXT(SH_NO_RETVAL);
   
   switch (segment)
   {
@@ -347,6 +347,7 @@ static void shSubdivideSegment(SHPath *p, VGPathSegment segment,
 
 void shFlattenPath(SHPath *p, SHint surfaceSpace)
 {
+  VGContext *context;
   SHint contourStart = -1;
   SHint surfSpace = surfaceSpace;
   SHint *userData[2];
@@ -361,6 +362,9 @@ void shFlattenPath(SHPath *p, SHint surfaceSpace)
   
   shVertexArrayClear(&p->vertices);
   shProcessPathData(p, processFlags, shSubdivideSegment, userData);
+  
+  context = shGetContext();
+  SH_COUNT(context, VG_STAT_VERTICES_FLATTENED_SH, p->vertices.size);
 }
 
 /*-------------------------------------------
@@ -796,6 +800,8 @@ void shStrokePath(VGContext* c, SHPath *p)
     dprev = d;
     tprev = t;
   }
+  
+  SH_COUNT(c, VG_STAT_STROKE_TRIANGLES_SH, p->stroke.size / 3);
 }
 
 
@@ -842,6 +848,81 @@ void shFindBoundbox(SHPath *p)
   }
 }
 
+/*--------------------------------------------------------
+ * Checks whether the tesselation is a single contour
+ * that turns the same way at every vertex and winds
+ * around only once (the x direction of its edges flips
+ * exactly twice). Such a polygon is covered exactly once
+ * by its own triangle fan, so it renders identically
+ * under both fill rules.
+ *--------------------------------------------------------*/
+
+void shFindConvexity(SHPath *p)
+{
+  SHint n = p->vertices.size;
+  SHint i, s;
+  SHint turn = 0;
+  SHint xflips = 0;
+  SHint xsign = 0, xfirst = 0;
+  SHint haveEdge = 0;
+  SHVector2 e, prev, first;
+  SHVector2 *a, *b;
+  SHfloat cross;
+  
+  p->convex = VG_FALSE;
+  if (n < 3 || p->vertices.items[0].flags != (SHuint)n)
+    return;
+  
+  SET2(prev, 0,0);
+  SET2(first, 0,0);
+  
+  /* Walk the edges (including the closing one) skipping
+     zero-length ones produced by coincident vertices */
+  for (i=0; i<=n; ++i) {
+    
+    if (i < n) {
+      a = &p->vertices.items[i].point;
+      b = &p->vertices.items[(i+1) % n].point;
+      SET2(e, b->x - a->x, b->y - a->y);
+      if (e.x == 0.0f && e.y == 0.0f) continue;
+    }else{
+      /* Wrap around to check the turn at the first vertex */
+      if (!haveEdge) return;
+      e = first;
+    }
+    
+    if (haveEdge) {
+      cross = prev.x * e.y - prev.y * e.x;
+      if (SH_ABS(cross) > 1e-5f * NORM2(prev) * NORM2(e)) {
+        s = (cross > 0.0f ? 1 : -1);
+        if (turn == 0) turn = s;
+        else if (s != turn) return;
+      }else if (DOT2(prev, e) < 0.0f) {
+        /* Contour folds back onto itself */
+        return;
+      }
+    }else{
+      first = e;
+      haveEdge = 1;
+    }
+    
+    if (i < n && e.x != 0.0f) {
+      s = (e.x > 0.0f ? 1 : -1);
+      if (xsign == 0) xfirst = s;
+      else if (s != xsign) ++xflips;
+      xsign = s;
+    }
+    
+    prev = e;
+  }
+  
+  /* Count the flip across the seam too */
+  if (xsign != xfirst) ++xflips;
+  
+  if (turn != 0 && xflips <= 2)
+    p->convex = VG_TRUE;
+}
+
 /*--------------------------------------------------------
  * Outputs a tight bounding box of a path in path's own
  * coordinate system.
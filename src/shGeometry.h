@@ -29,5 +29,6 @@ void shFlattenPath(SHPath *p, SHint surfaceSpace);
 void shStrokePath(VGContext* c, SHPath *p);
 void shTransformVertices(SHMatrix3x3 *m, SHPath *p);
 void shFindBoundbox(SHPath *p);
+void shFindConvexity(SHPath *p);
 
 #endif /* __SH_GEOMETRY_H */
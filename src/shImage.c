@@ -462,7 +462,10 @@ void SHImage_ctor(SHImage *i)
   i->data = NULL;
   i->width = 0;
   i->height = 0;
-  glGenTextures(1, &i->texture);
+  i->texture = 0;
+  i->texParams[0] = i->texParams[1] = -1;
+  i->dataStale = 0;
+  i->refCount = 1;
 }
 
 void SHImage_dtor(SHImage *i)
@@ -470,8 +473,22 @@ void SHImage_dtor(SHImage *i)
   if (i->data != NULL)
     free(i->data);
   
-  if (glIsTexture(i->texture))
+  if (i->texture != 0) {
+    SH_GETCONTEXT(SH_NO_RETVAL);
+    shForgetSharedTexture(context, i->texture);
     glDeleteTextures(1, &i->texture);
+  }
+}
+
+void shRetainImage(SHImage *i)
+{
+  if (i) i->refCount++;
+}
+
+void shReleaseImage(SHImage *i)
+{
+  if (i && --i->refCount == 0)
+    SH_DELETEOBJ(SHImage, i);
 }
 
 /*--------------------------------------------------------
@@ -511,6 +528,17 @@ void shUpdateImageTexture(SHImage *i, VGContext *c)
   SHint potwidth;
   SHint potheight;
   SHint8 *potdata;
+  GLint intformat;
+  GLenum format;
+  GLint swizzle[4];
+
+  /* Without OpenGL the image data is sampled directly */
+  if (!c->backend->gl)
+    return;
+  
+  /* Created with the first upload */
+  if (i->texture == 0)
+    glGenTextures(1, &i->texture);
 
   /* Find nearest power of two size */
 
@@ -534,14 +562,19 @@ void shUpdateImageTexture(SHImage *i, VGContext *c)
     
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glBindTexture(GL_TEXTURE_2D, i->texture);
+    shGLBindTexture(c, GL_TEXTURE_2D, i->texture);
     
     
     gluScaleImage(i->fd.glformat, i->width, i->height, i->fd.gltype, i->data,
                   potwidth, potheight, i->fd.gltype, potdata);
     
+    SH_TRACE_BEGIN(c, "upload");
     glTexImage2D(GL_TEXTURE_2D, 0, i->fd.glintformat, potwidth, potheight, 0,
                  i->fd.glformat, i->fd.gltype, potdata);
+    SH_TRACE_END(c, "upload");
+    SH_COUNT(c, VG_STAT_TEXTURE_UPLOADS_SH, 1);
+    SH_COUNT(c, VG_STAT_TEXTURE_UPLOAD_BYTES_SH,
+             potwidth * potheight * i->fd.bytes);
     
     free(potdata);
     return;
@@ -549,10 +582,35 @@ void shUpdateImageTexture(SHImage *i, VGContext *c)
   
   /* Store pixels to texture */
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glBindTexture(GL_TEXTURE_2D, i->texture);
-  glTexImage2D(GL_TEXTURE_2D, 0, i->fd.glintformat,
+  shGLBindTexture(c, GL_TEXTURE_2D, i->texture);
+  
+  /* Core profiles have no luminance or alpha textures. Single
+     channel images are stored in red and swizzled to sample
+     like those do with GL_MODULATE. */
+  intformat = i->fd.glintformat;
+  format = i->fd.glformat;
+  if (c->backend == &shGLCoreBackend &&
+      (format == GL_LUMINANCE || format == GL_ALPHA)) {
+    if (format == GL_LUMINANCE) {
+      swizzle[0] = swizzle[1] = swizzle[2] = GL_RED;
+      swizzle[3] = GL_ONE;
+    }else{
+      swizzle[0] = swizzle[1] = swizzle[2] = GL_ONE;
+      swizzle[3] = GL_RED;
+    }
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    intformat = GL_R8;
+    format = GL_RED;
+  }
+  
+  SH_TRACE_BEGIN(c, "upload");
+  glTexImage2D(GL_TEXTURE_2D, 0, intformat,
                i->texwidth, i->texheight, 0,
-               i->fd.glformat, i->fd.gltype, i->data);
+               format, i->fd.gltype, i->data);
+  SH_TRACE_END(c, "upload");
+  SH_COUNT(c, VG_STAT_TEXTURE_UPLOADS_SH, 1);
+  SH_COUNT(c, VG_STAT_TEXTURE_UPLOAD_BYTES_SH,
+           i->texwidth * i->texheight * i->fd.bytes);
 }
 
 /*----------------------------------------------------------
@@ -614,7 +672,7 @@ VG_API_CALL VGImage vgCreateImage(VGImageFormat format,
   shUpdateImageTexture(i, context);
   
   /* Add to resource list */
-  shImageArrayPushBack(&context->images, i);
+  shImageArrayPushBack(&context->share->images, i);
   
   VG_RETURN((VGImage)i);
 }
@@ -625,12 +683,21 @@ VG_API_CALL void vgDestroyImage(VGImage image)
   VG_GETCONTEXT(VG_NO_RETVAL);
   
   /* Check if valid resource */
-  index = shImageArrayFind(&context->images, (SHImage*)image);
+  index = shImageArrayFind(&context->share->images, (SHImage*)image);
   VG_RETURN_ERR_IF(index == -1, VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
   
-  /* Delete object and remove resource */
-  SH_DELETEOBJ(SHImage, (SHImage*)image);
-  shImageArrayRemoveAt(&context->images, index);
+  /* Binned software draws of the group may still read it */
+  shFlushShareGroup(context);
+  
+  /* Drawing goes back to the window */
+  if ((SHImage*)image == context->renderTarget)
+    shReleaseRenderTarget(context);
+  
+  /* Remove resource, paints using it as pattern and other
+     contexts drawing into it keep it */
+  shImageArrayRemoveAt(&context->share->images, index);
+  shReleaseImage((SHImage*)image);
+  context->share->objectGeneration++;
   
   VG_RETURN(VG_NO_RETVAL);
 }
@@ -652,12 +719,17 @@ VG_API_CALL void vgClearImage(VGImage image,
   VG_RETURN_ERR_IF(!shIsValidImage(context, image),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
-  /* TODO: check if image current render target */
-  
   i = (SHImage*)image;
+  VG_RETURN_ERR_IF(i == context->renderTarget,
+                   VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
+  
   VG_RETURN_ERR_IF(width <= 0 || height <= 0,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
   
+  /* Binned software draws of the group may still read it */
+  shFlushShareGroup(context);
+  shSyncImageData(context, i);
+  
   /* Nothing to do if target rectangle out of bounds */
   if (x >= i->width || y >= i->height)
     VG_RETURN(VG_NO_RETVAL);
@@ -708,6 +780,9 @@ void shCopyPixels(SHuint8 *dst, VGImageFormat dstFormat, SHint dstStride,
 
   SHImageFormatDesc dfd;
   SHImageFormatDesc sfd;
+  VGContext *context = shGetContext();
+  
+  SH_COUNT(context, VG_STAT_IMAGE_CONVERSIONS_SH, 1);
 
   /* Setup image format descriptors */
   SH_ASSERT(shIsSupportedImageFormat(dstFormat));
@@ -813,8 +888,9 @@ VG_API_CALL void vgImageSubData(VGImage image,
   VG_RETURN_ERR_IF(!shIsValidImage(context, image),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
-  /* TODO: check if image current render target */
   i = (SHImage*)image;
+  VG_RETURN_ERR_IF(i == context->renderTarget,
+                   VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
   
   /* Reject invalid formats */
   VG_RETURN_ERR_IF(!shIsValidImageFormat(dataFormat),
@@ -829,6 +905,12 @@ VG_API_CALL void vgImageSubData(VGImage image,
   VG_RETURN_ERR_IF(width <= 0 || height <= 0 || !data,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
   
+  SH_TRACE_BEGIN(context, "vgImageSubData");
+  
+  /* Binned software draws of the group may still read it */
+  shFlushShareGroup(context);
+  shSyncImageData(context, i);
+  
   /* TODO: check data array alignment */
   
   shCopyPixels(i->data, i->fd.vgformat, i->texwidth * i->fd.bytes,
@@ -837,6 +919,8 @@ VG_API_CALL void vgImageSubData(VGImage image,
                x, y, 0, 0, width, height);
   
   shUpdateImageTexture(i, context);
+  
+  SH_TRACE_END(context, "vgImageSubData");
   VG_RETURN(VG_NO_RETVAL);
 }
 
@@ -858,8 +942,9 @@ VG_API_CALL void vgGetImageSubData(VGImage image,
   VG_RETURN_ERR_IF(!shIsValidImage(context, image),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
-  /* TODO: check if image current render target */
   i = (SHImage*)image;
+  VG_RETURN_ERR_IF(i == context->renderTarget,
+                   VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
   
   /* Reject invalid formats */
   VG_RETURN_ERR_IF(!shIsValidImageFormat(dataFormat),
@@ -874,6 +959,8 @@ VG_API_CALL void vgGetImageSubData(VGImage image,
   VG_RETURN_ERR_IF(width <= 0 || height <= 0 || !data,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
   
+  shSyncImageData(context, i);
+  
   /* TODO: check data array alignment */
   
   shCopyPixels(data, dataFormat, dataStride,
@@ -904,12 +991,19 @@ VG_API_CALL void vgCopyImage(VGImage dst, VGint dx, VGint dy,
                    !shIsValidImage(context, dst),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
 
-  /* TODO: check if images current render target */
-
   s = (SHImage*)src; d = (SHImage*)dst;
+  VG_RETURN_ERR_IF(s == context->renderTarget ||
+                   d == context->renderTarget,
+                   VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
+  
   VG_RETURN_ERR_IF(width <= 0 || height <= 0,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
 
+  /* Binned software draws of the group may still read it */
+  shFlushShareGroup(context);
+  shSyncImageData(context, s);
+  shSyncImageData(context, d);
+
   /* In order to perform copying in a cosistent fashion
      we first copy to a temporary buffer and only then to
      destination image */
@@ -919,7 +1013,7 @@ VG_API_CALL void vgCopyImage(VGImage dst, VGint dx, VGint dy,
      we can copy directly */
 
   pixels = (SHuint8*)malloc(width * height * s->fd.bytes);
-  SH_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, SH_NO_RETVAL);
+  VG_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, VG_NO_RETVAL);
 
   shCopyPixels(pixels, s->fd.vgformat, s->texwidth * s->fd.bytes,
                s->data, s->fd.vgformat, s->texwidth * s->fd.bytes,
@@ -948,43 +1042,33 @@ VG_API_CALL void vgSetPixels(VGint dx, VGint dy,
                              VGint width, VGint height)
 {
   SHImage *i;
-  SHuint8 *pixels;
-  SHImageFormatDesc winfd;
+  SHRectangle area;
 
   VG_GETCONTEXT(VG_NO_RETVAL);
+  shFlushBatch(context);
   
   VG_RETURN_ERR_IF(!shIsValidImage(context, src),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
-  /* TODO: check if image current render target (requires EGL) */
-
   i = (SHImage*)src;
+  VG_RETURN_ERR_IF(i == context->renderTarget,
+                   VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
+  
   VG_RETURN_ERR_IF(width <= 0 || height <= 0,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
 
-  /* Setup window image format descriptor */
-  /* TODO: this actually depends on the target framebuffer type
-     if we really want the copy to be optimized */
-  shSetupImageFormat(VG_sRGBA_8888, &winfd);
-
-  /* OpenGL doesn't allow us to use random stride. We have to
-     manually copy the image data and write from a copy with
-     normal row length (without power-of-two roundup pixels) */
-
-  pixels = (SHuint8*)malloc(width * height * winfd.bytes);
-  SH_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, SH_NO_RETVAL);
-
-  shCopyPixels(pixels, winfd.vgformat, -1,
-               i->data, i->fd.vgformat, i->texwidth * i->fd.bytes,
-               width, height, i->width, i->height,
-               0,0,sx,sy, width, height);
+  /* Nothing to do outside the scissor rectangles
+     or the redraw region */
+  shRectangleSet(&area, (SHfloat)dx, (SHfloat)dy,
+                 (SHfloat)width, (SHfloat)height);
+  if (!shRecordDraw(context, &area))
+    VG_RETURN(VG_NO_RETVAL);
 
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glRasterPos2i(dx, dy);
-  glDrawPixels(width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-  glRasterPos2i(0,0);
-  
-  free(pixels);
+  shSyncImageData(context, i);
+  context->backend->writePixels(context, i->data, i->fd.vgformat,
+                                i->texwidth * i->fd.bytes,
+                                i->width, i->height,
+                                dx, dy, sx, sy, width, height);
 
   VG_RETURN(VG_NO_RETVAL);
 }
@@ -1000,10 +1084,10 @@ VG_API_CALL void vgWritePixels(const void * data, VGint dataStride,
                                VGint dx, VGint dy,
                                VGint width, VGint height)
 {
-  SHuint8 *pixels;
-  SHImageFormatDesc winfd;
+  SHRectangle area;
 
   VG_GETCONTEXT(VG_NO_RETVAL);
+  shFlushBatch(context);
 
   /* Reject invalid formats */
   VG_RETURN_ERR_IF(!shIsValidImageFormat(dataFormat),
@@ -1020,29 +1104,16 @@ VG_API_CALL void vgWritePixels(const void * data, VGint dataStride,
   VG_RETURN_ERR_IF(width <= 0 || height <= 0 || !data,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
 
-  /* Setup window image format descriptor */
-  /* TODO: this actually depends on the target framebuffer type
-     if we really want the copy to be optimized */
-  shSetupImageFormat(VG_sRGBA_8888, &winfd);
-
-  /* OpenGL doesn't allow us to use random stride. We have to
-     manually copy the image data and write from a copy with
-     normal row length */
+  /* Nothing to do outside the scissor rectangles
+     or the redraw region */
+  shRectangleSet(&area, (SHfloat)dx, (SHfloat)dy,
+                 (SHfloat)width, (SHfloat)height);
+  if (!shRecordDraw(context, &area))
+    VG_RETURN(VG_NO_RETVAL);
 
-  pixels = (SHuint8*)malloc(width * height * winfd.bytes);
-  SH_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, SH_NO_RETVAL);
-  
-  shCopyPixels(pixels, winfd.vgformat, -1,
-               (SHuint8*)data, dataFormat, dataStride,
-               width, height, width, height,
-               0,0,0,0, width, height);
-  
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glRasterPos2i(dx, dy);
-  glDrawPixels(width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-  glRasterPos2i(0,0);
-  
-  free(pixels);
+  context->backend->writePixels(context, data, dataFormat, dataStride,
+                                width, height, dx, dy, 0, 0,
+                                width, height);
 
   VG_RETURN(VG_NO_RETVAL); 
 }
@@ -1058,40 +1129,24 @@ VG_API_CALL void vgGetPixels(VGImage dst, VGint dx, VGint dy,
                              VGint width, VGint height)
 {
   SHImage *i;
-  SHuint8 *pixels;
-  SHImageFormatDesc winfd;
   VG_GETCONTEXT(VG_NO_RETVAL);
+  shFlushBatch(context);
   
   VG_RETURN_ERR_IF(!shIsValidImage(context, dst),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
-   /* TODO: check if image current render target */
-
   i = (SHImage*)dst;
+  VG_RETURN_ERR_IF(i == context->renderTarget,
+                   VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
+  
   VG_RETURN_ERR_IF(width <= 0 || height <= 0,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
 
-  /* Setup window image format descriptor */
-  /* TODO: this actually depends on the target framebuffer type
-     if we really want the copy to be optimized */
-  shSetupImageFormat(VG_sRGBA_8888, &winfd);
-  
-  /* OpenGL doesn't allow us to read to random destination
-     coordinates nor using random stride. We have to
-     read first and then manually copy to the image data */
-
-  pixels = (SHuint8*)malloc(width * height * winfd.bytes);
-  SH_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, SH_NO_RETVAL);
-
-  glPixelStorei(GL_PACK_ALIGNMENT, 1);
-  glReadPixels(sx, sy, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-  
-  shCopyPixels(i->data, i->fd.vgformat, i->texwidth * i->fd.bytes,
-               pixels, winfd.vgformat, -1,
-               i->width, i->height, width, height,
-               dx, dy, 0, 0, width, height);
-
-  free(pixels);
+  shSyncImageData(context, i);
+  context->backend->readPixels(context, i->data, i->fd.vgformat,
+                               i->texwidth * i->fd.bytes,
+                               i->width, i->height,
+                               dx, dy, sx, sy, width, height);
   
   shUpdateImageTexture(i, context);
   VG_RETURN(VG_NO_RETVAL);
@@ -1108,9 +1163,8 @@ VG_API_CALL void vgReadPixels(void * data, VGint dataStride,
                               VGint sx, VGint sy,
                               VGint width, VGint height)
 {
-  SHuint8 *pixels;
-  SHImageFormatDesc winfd;
   VG_GETCONTEXT(VG_NO_RETVAL);
+  shFlushBatch(context);
 
   /* Reject invalid formats */
   VG_RETURN_ERR_IF(!shIsValidImageFormat(dataFormat),
@@ -1127,26 +1181,9 @@ VG_API_CALL void vgReadPixels(void * data, VGint dataStride,
   VG_RETURN_ERR_IF(width <= 0 || height <= 0 || !data,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
 
-  /* Setup window image format descriptor */
-  /* TODO: this actually depends on the target framebuffer type
-     if we really want the copy to be optimized */
-  shSetupImageFormat(VG_sRGBA_8888, &winfd);
-
-  /* OpenGL doesn't allow random data stride. We have to
-     read first and then manually copy to the output buffer */
-
-  pixels = (SHuint8*)malloc(width * height * winfd.bytes);
-  SH_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, SH_NO_RETVAL);
-
-  glPixelStorei(GL_PACK_ALIGNMENT, 1);
-  glReadPixels(sx, sy, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-  
-  shCopyPixels(data, dataFormat, dataStride,
-               pixels, winfd.vgformat, -1,
-               width, height, width, height,
-               0, 0, 0, 0, width, height);
-
-  free(pixels);
+  context->backend->readPixels(context, data, dataFormat, dataStride,
+                               width, height, 0, 0, sx, sy,
+                               width, height);
   
   VG_RETURN(VG_NO_RETVAL);
 }
@@ -1161,16 +1198,240 @@ VG_API_CALL void vgCopyPixels(VGint dx, VGint dy,
                               VGint sx, VGint sy,
                               VGint width, VGint height)
 {
+  SHRectangle area;
+
   VG_GETCONTEXT(VG_NO_RETVAL);
+  shFlushBatch(context);
   
   VG_RETURN_ERR_IF(width <= 0 || height <= 0,
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+
+  /* Nothing to do outside the scissor rectangles
+     or the redraw region */
+  shRectangleSet(&area, (SHfloat)dx, (SHfloat)dy,
+                 (SHfloat)width, (SHfloat)height);
+  if (!shRecordDraw(context, &area))
+    VG_RETURN(VG_NO_RETVAL);
+  
+  context->backend->copyPixels(context, dx, dy, sx, sy, width, height);
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
+
+/*----------------------------------------------------------
+ * Surface pixel access of the OpenGL backend. OpenGL
+ * doesn't allow random strides nor destination offsets,
+ * so the pixels go through a buffer of normal row length
+ * (without power-of-two roundup pixels).
+ *---------------------------------------------------------*/
+
+void shGLReadPixels(VGContext *context, void *data,
+                    VGImageFormat format, SHint stride,
+                    SHint dataWidth, SHint dataHeight,
+                    SHint dx, SHint dy, SHint sx, SHint sy,
+                    SHint width, SHint height)
+{
+  SHuint8 *pixels;
+  SHImageFormatDesc winfd;
+  
+  /* Setup window image format descriptor: R,G,B,A bytes
+     as GL_RGBA / GL_UNSIGNED_BYTE lays them out */
+  /* TODO: this actually depends on the target framebuffer type
+     if we really want the copy to be optimized */
+  shSetupImageFormat(shRasterFormat(), &winfd);
+
+  pixels = (SHuint8*)malloc(width * height * winfd.bytes);
+  SH_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, SH_NO_RETVAL);
+
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(sx, sy, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  
+  shCopyPixels(data, format, stride,
+               pixels, winfd.vgformat, -1,
+               dataWidth, dataHeight, width, height,
+               dx, dy, 0, 0, width, height);
+
+  free(pixels);
+}
+
+void shGLWritePixels(VGContext *context, const void *data,
+                     VGImageFormat format, SHint stride,
+                     SHint dataWidth, SHint dataHeight,
+                     SHint dx, SHint dy, SHint sx, SHint sy,
+                     SHint width, SHint height)
+{
+  SHuint8 *pixels;
+  SHImageFormatDesc winfd;
+  SHRectangle area;
+  
+  shRectangleSet(&area, (SHfloat)dx, (SHfloat)dy,
+                 (SHfloat)width, (SHfloat)height);
+  if (!shBeginScissoring(context, &area))
+    SH_RETURN(SH_NO_RETVAL);
+
+  /* Setup window image format descriptor: R,G,B,A bytes
+     as GL_RGBA / GL_UNSIGNED_BYTE lays them out */
+  /* TODO: this actually depends on the target framebuffer type
+     if we really want the copy to be optimized */
+  shSetupImageFormat(shRasterFormat(), &winfd);
+
+  pixels = (SHuint8*)malloc(width * height * winfd.bytes);
+  SH_RETURN_ERR_IF(!pixels, VG_OUT_OF_MEMORY_ERROR, SH_NO_RETVAL);
+  
+  shCopyPixels(pixels, winfd.vgformat, -1,
+               (SHuint8*)data, format, stride,
+               width, height, dataWidth, dataHeight,
+               0, 0, sx, sy, width, height);
+  
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glRasterPos2i(dx, dy);
+  glDrawPixels(width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  glRasterPos2i(0,0);
+  
+  free(pixels);
+}
+
+void shGLCopyPixels(VGContext *context, SHint dx, SHint dy,
+                    SHint sx, SHint sy, SHint width, SHint height)
+{
+  SHRectangle area;
+  
+  shRectangleSet(&area, (SHfloat)dx, (SHfloat)dy,
+                 (SHfloat)width, (SHfloat)height);
+  if (!shBeginScissoring(context, &area))
+    SH_RETURN(SH_NO_RETVAL);
   
   glPixelStorei(GL_PACK_ALIGNMENT, 1);
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   glRasterPos2i(dx, dy);
   glCopyPixels(sx, sy, width, height, GL_COLOR);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
   glRasterPos2i(0, 0);
+}
+
+/*-----------------------------------------------------------
+ * Render targets. vgRenderToImageSH makes an image the
+ * surface drawn into, through a framebuffer object with the
+ * image texture for color and a depth and stencil buffer
+ * shared by all images, so the pixels stay on the GPU. The
+ * image data is read back from the texture only once the
+ * CPU needs it.
+ *-----------------------------------------------------------*/
+
+void shSyncImageData(VGContext *context, SHImage *i)
+{
+  if (!i->dataStale)
+    return;
+  
+  shGLBindTexture(context, GL_TEXTURE_2D, i->texture);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D, 0, i->fd.glformat, i->fd.gltype, i->data);
+  i->dataStale = 0;
+}
+
+static SHint shAttachRenderTarget(VGContext *context, SHImage *i)
+{
+  if (context->targetFramebuffer == 0)
+    glGenFramebuffers(1, &context->targetFramebuffer);
+  if (context->targetDepthStencil == 0)
+    glGenRenderbuffers(1, &context->targetDepthStencil);
+  
+  glBindFramebuffer(GL_FRAMEBUFFER, context->targetFramebuffer);
+  
+  /* Depth for the scissor bands and stencil for the
+     paths, reallocated when the image size differs */
+  if (context->targetWidth != i->width ||
+      context->targetHeight != i->height) {
+    glBindRenderbuffer(GL_RENDERBUFFER, context->targetDepthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8,
+                          i->width, i->height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    context->targetWidth = i->width;
+    context->targetHeight = i->height;
+  }
+  
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, context->targetDepthStencil);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, context->targetDepthStencil);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                         GL_TEXTURE_2D, i->texture, 0);
+  
+  return (glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+          GL_FRAMEBUFFER_COMPLETE);
+}
+
+static void shDetachRenderTarget(VGContext *context)
+{
+  SHImage *target = context->renderTarget;
+  
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                         GL_TEXTURE_2D, 0, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  
+  context->renderTarget = NULL;
+  context->surfaceWidth = context->windowWidth;
+  context->surfaceHeight = context->windowHeight;
+  context->backend->resize(context);
+  shReleaseImage(target);
+}
+
+/* Goes back to drawing into the window */
+
+void shReleaseRenderTarget(VGContext *context)
+{
+  if (context->renderTarget == NULL)
+    return;
+  
+  /* Pending draws belong to the image */
+  shFlushBatch(context);
+  shDetachRenderTarget(context);
+}
+
+VG_API_CALL void vgRenderToImageSH(VGImage image)
+{
+  SHImage *i;
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  if (image == VG_INVALID_HANDLE) {
+    shReleaseRenderTarget(context);
+    VG_RETURN(VG_NO_RETVAL);
+  }
+  
+  VG_RETURN_ERR_IF(!shIsValidImage(context, image),
+                   VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+  
+  /* Needs framebuffer objects */
+  VG_RETURN_ERR_IF(!context->backend->gl ||
+                   !context->isGLAvailable_FramebufferObject,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  /* Luminance and alpha textures can't be drawn into */
+  i = (SHImage*)image;
+  VG_RETURN_ERR_IF(i->fd.glintformat != GL_RGBA &&
+                   i->fd.glintformat != GL_RGB,
+                   VG_UNSUPPORTED_IMAGE_FORMAT_ERROR, VG_NO_RETVAL);
+  
+  if (i == context->renderTarget)
+    VG_RETURN(VG_NO_RETVAL);
+  
+  /* Pending draws go to the previous surface, and a
+     previous target image is released */
+  shFlushBatch(context);
+  shReleaseRenderTarget(context);
+  
+  if (!shAttachRenderTarget(context, i)) {
+    shDetachRenderTarget(context);
+    VG_RETURN_ERR(VG_UNSUPPORTED_IMAGE_FORMAT_ERROR, VG_NO_RETVAL);
+  }
+  
+  shRetainImage(i);
+  context->renderTarget = i;
+  context->surfaceWidth = i->width;
+  context->surfaceHeight = i->height;
+  context->backend->resize(context);
+  i->dataStale = 1;
   
   VG_RETURN(VG_NO_RETVAL);
 }
@@ -82,11 +82,22 @@ typedef struct
   SHfloat texwidthK;
   SHfloat texheightK;
   GLuint texture;
+  GLint texParams[2];
+  
+  /* Drawn into as a render target since data was
+     last read back from the texture */
+  SHint dataStale;
+  
+  /* References held by the handle, the paints using the
+     image as pattern and the contexts drawing into it */
+  SHint refCount;
   
 } SHImage;
 
 void SHImage_ctor(SHImage *i);
 void SHImage_dtor(SHImage *i);
+void shRetainImage(SHImage *i);
+void shReleaseImage(SHImage *i);
 
 #define _ITEM_T SHImage*
 #define _ARRAY_T SHImageArray
@@ -121,10 +132,10 @@ void SHImage_dtor(SHImage *i);
  *-------------------------------------------------------*/
 
 #define CSTORE_RGBA1D_8(c, rgba, x)  { \
-  rgba[x*4+0] = (SHuint8)SH_FLOOR(c.r * 255); \
-  rgba[x*4+1] = (SHuint8)SH_FLOOR(c.g * 255); \
-  rgba[x*4+2] = (SHuint8)SH_FLOOR(c.b * 255); \
-  rgba[x*4+3] = (SHuint8)SH_FLOOR(c.a * 255); }
+  rgba[x*4+0] = (SHuint8)SH_FLOOR(c.r * 255 + 0.5f); \
+  rgba[x*4+1] = (SHuint8)SH_FLOOR(c.g * 255 + 0.5f); \
+  rgba[x*4+2] = (SHuint8)SH_FLOOR(c.b * 255 + 0.5f); \
+  rgba[x*4+3] = (SHuint8)SH_FLOOR(c.a * 255 + 0.5f); }
 
 #define CSTORE_RGBA1D_F(c, rgba, x)  { \
   rgba[x*4+0] = c.r; \
@@ -133,10 +144,10 @@ void SHImage_dtor(SHImage *i);
   rgba[x*4+3] = c.a; }
 
 #define CSTORE_RGBA2D_8(c, rgba, x, y, width) { \
-  rgba[y*width*4+x*4+0] = (SHuint8)SH_FLOOR(c.r * 255); \
-  rgba[y*width*4+x*4+1] = (SHuint8)SH_FLOOR(c.g * 255); \
-  rgba[y*width*4+x*4+2] = (SHuint8)SH_FLOOR(c.b * 255); \
-  rgba[y*width*4+x*4+3] = (SHuint8)SH_FLOOR(c.a * 255); }
+  rgba[y*width*4+x*4+0] = (SHuint8)SH_FLOOR(c.r * 255 + 0.5f); \
+  rgba[y*width*4+x*4+1] = (SHuint8)SH_FLOOR(c.g * 255 + 0.5f); \
+  rgba[y*width*4+x*4+2] = (SHuint8)SH_FLOOR(c.b * 255 + 0.5f); \
+  rgba[y*width*4+x*4+3] = (SHuint8)SH_FLOOR(c.a * 255 + 0.5f); }
 
 #define CSTORE_RGBA2D_F(c, rgba, x, y, width) { \
   rgba[y*width*4+x*4+0] = c.r; \
@@ -149,6 +160,12 @@ void SHImage_dtor(SHImage *i);
 
 void shStoreColor(SHColor *c, void *data, SHImageFormatDesc *f);
 void shLoadColor(SHColor *c, const void *data, SHImageFormatDesc *f);
+void shSetupImageFormat(VGImageFormat vg, SHImageFormatDesc *f);
+void shCopyPixels(SHuint8 *dst, VGImageFormat dstFormat, SHint dstStride,
+                  const SHuint8 *src, VGImageFormat srcFormat, SHint srcStride,
+                  SHint dwidth, SHint dheight, SHint swidth, SHint sheight,
+                  SHint dx, SHint dy, SHint sx, SHint sy,
+                  SHint width, SHint height);
 
 
 #endif /* __SHIMAGE_H */
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shExtensions.h"
+#include "shContext.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*------------------------------------------------------------
+ * The alpha mask covers the drawing surface with one byte
+ * per pixel. vgMask combines it with image alpha in memory
+ * and uploads the changed area into an alpha texture that
+ * the pipeline samples in window space. Until the first
+ * vgMask call the mask is implicitly all ones, and drawing
+ * does not look at it.
+ *------------------------------------------------------------*/
+
+static SHint shNextPowerOfTwo(SHint x)
+{
+  SHint p = 1;
+  while (p < x) p *= 2;
+  return p;
+}
+
+/* Core profiles keep the mask in red, see shGLCore.c */
+
+static GLenum shMaskFormat(VGContext *c)
+{
+  return (c->backend == &shGLCoreBackend ? GL_RED : GL_ALPHA);
+}
+
+static void shUploadMask(VGContext *c, SHint x, SHint y, SHint w, SHint h)
+{
+  shGLActiveTexture(c, SH_MASK_TEXTURE_UNIT);
+  shGLBindTexture(c, GL_TEXTURE_2D, c->maskTexture);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, c->maskWidth);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, y);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h,
+                  shMaskFormat(c), GL_UNSIGNED_BYTE, c->maskData);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+  glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+}
+
+/*------------------------------------------------------------
+ * (Re)allocates the mask at the window surface size. The
+ * overlapping area of the previous mask is kept and the
+ * rest filled with ones.
+ *------------------------------------------------------------*/
+
+static int shAllocMask(VGContext *c)
+{
+  SHuint8 *data;
+  SHint w = c->windowWidth;
+  SHint h = c->windowHeight;
+  SHint y, keepw, keeph;
+
+  if (w <= 0 || h <= 0)
+    return 0;
+
+  data = (SHuint8*)malloc(w * h);
+  if (!data) return 0;
+  memset(data, 255, w * h);
+
+  if (c->maskData) {
+    keepw = SH_MIN(w, c->maskWidth);
+    keeph = SH_MIN(h, c->maskHeight);
+    for (y=0; y<keeph; ++y)
+      memcpy(data + y*w, c->maskData + y*c->maskWidth, keepw);
+    free(c->maskData);
+  }
+
+  c->maskData = data;
+  c->maskWidth = w;
+  c->maskHeight = h;
+
+  /* Without OpenGL the data is read directly */
+  if (!c->backend->gl)
+    return 1;
+
+  if (c->isGLAvailable_TextureNonPowerOfTwo) {
+    c->maskTexWidth = w;
+    c->maskTexHeight = h;
+  }else{
+    c->maskTexWidth = shNextPowerOfTwo(w);
+    c->maskTexHeight = shNextPowerOfTwo(h);
+  }
+
+  if (c->maskTexture == 0) {
+    glGenTextures(1, &c->maskTexture);
+    c->maskTexParams[0] = -1;
+    c->maskTexParams[1] = -1;
+  }
+
+  /* Texture size changes the texgen planes */
+  SH_GL_STATE(c)->texEnvMode[SH_MASK_TEXTURE_UNIT - GL_TEXTURE0] = -1;
+  
+  /* Every pixel is sampled at its center */
+  shGLActiveTexture(c, SH_MASK_TEXTURE_UNIT);
+  shGLBindTexture(c, GL_TEXTURE_2D, c->maskTexture);
+  shGLTexParameters(c, GL_TEXTURE_2D, c->maskTexParams,
+                    GL_CLAMP_TO_EDGE, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, shMaskFormat(c) == GL_RED ?
+               GL_R8 : GL_ALPHA8, c->maskTexWidth, c->maskTexHeight, 0,
+               shMaskFormat(c), GL_UNSIGNED_BYTE, NULL);
+  shUploadMask(c, 0, 0, w, h);
+
+  return 1;
+}
+
+void shResizeMask(VGContext *c)
+{
+  if (c->maskData == NULL)
+    return;
+
+  if (c->maskWidth != c->windowWidth ||
+      c->maskHeight != c->windowHeight)
+    shAllocMask(c);
+}
+
+void shDeleteMask(VGContext *c)
+{
+  if (c->maskTexture) {
+    shGLStateForgetTexture(&c->glState, c->maskTexture);
+    glDeleteTextures(1, &c->maskTexture);
+  }
+
+  if (c->maskData)
+    free(c->maskData);
+
+  c->maskData = NULL;
+  c->maskTexture = 0;
+}
+
+/*------------------------------------------------------------
+ * Makes the next draws multiply their alpha by the mask.
+ * The texture unit reserved for the mask scales only the
+ * alpha coming from the units before it, with its texture
+ * coordinates generated from eye space, which is surface
+ * space under the identity modelview that the pipeline
+ * leaves loaded. Gradient programs sample the same unit
+ * by fragment position instead.
+ *------------------------------------------------------------*/
+
+void shBeginMasking(VGContext *c)
+{
+  GLfloat planeS[4] = {0,0,0,0};
+  GLfloat planeT[4] = {0,0,0,0};
+
+  /* The mask belongs to the window surface */
+  if (c->masking == VG_FALSE || c->maskData == NULL ||
+      c->renderTarget != NULL ||
+      c->maxTextureUnits <= SH_MASK_TEXTURE_UNIT - GL_TEXTURE0)
+    return;
+
+  shGLActiveTexture(c, SH_MASK_TEXTURE_UNIT);
+  shGLBindTexture(c, GL_TEXTURE_2D, c->maskTexture);
+  shGLEnable(c, GL_TEXTURE_2D);
+
+  /* The combiner and the planes stay with the unit, which
+     nothing else uses. They are set up again only when the
+     state tracker has lost the unit or the mask was resized. */
+  if (SH_GL_STATE(c)->texEnvMode[SH_MASK_TEXTURE_UNIT - GL_TEXTURE0]
+      != GL_COMBINE) {
+    shGLTexEnvMode(c, GL_COMBINE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_RGB, GL_REPLACE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_RGB, GL_PREVIOUS);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_RGB, GL_SRC_COLOR);
+    glTexEnvi(GL_TEXTURE_ENV, GL_COMBINE_ALPHA, GL_MODULATE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE0_ALPHA, GL_PREVIOUS);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND0_ALPHA, GL_SRC_ALPHA);
+    glTexEnvi(GL_TEXTURE_ENV, GL_SOURCE1_ALPHA, GL_TEXTURE);
+    glTexEnvi(GL_TEXTURE_ENV, GL_OPERAND1_ALPHA, GL_SRC_ALPHA);
+
+    planeS[0] = 1.0f / c->maskTexWidth;
+    planeT[1] = 1.0f / c->maskTexHeight;
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+    glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
+    glTexGenfv(GL_S, GL_EYE_PLANE, planeS);
+    glTexGenfv(GL_T, GL_EYE_PLANE, planeT);
+    glPopMatrix();
+  }
+  shGLEnable(c, GL_TEXTURE_GEN_S);
+  shGLEnable(c, GL_TEXTURE_GEN_T);
+
+  shGLActiveTexture(c, GL_TEXTURE0);
+  c->maskActive = 1;
+}
+
+void shEndMasking(VGContext *c)
+{
+  if (!c->maskActive)
+    return;
+
+  shGLActiveTexture(c, SH_MASK_TEXTURE_UNIT);
+  shGLDisable(c, GL_TEXTURE_2D);
+  shGLDisable(c, GL_TEXTURE_GEN_S);
+  shGLDisable(c, GL_TEXTURE_GEN_T);
+  shGLActiveTexture(c, GL_TEXTURE0);
+  c->maskActive = 0;
+}
+
+/*------------------------------------------------------------
+ * Modifies the alpha mask in the given surface area. The
+ * operations using an image take the mask values from its
+ * alpha channel, or its luminance if it has no alpha.
+ *------------------------------------------------------------*/
+
+VG_API_CALL void vgMask(VGImage mask, VGMaskOperation operation,
+                        VGint x, VGint y, VGint width, VGint height)
+{
+  SHImage *i = NULL;
+  SHColor color;
+  SHuint8 *row, *src;
+  SHint x0, y0, x1, y1, px, py;
+  SHfloat m, s;
+
+  VG_GETCONTEXT(VG_NO_RETVAL);
+
+  VG_RETURN_ERR_IF(operation < VG_CLEAR_MASK ||
+                   operation > VG_SUBTRACT_MASK,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+
+  VG_RETURN_ERR_IF(width <= 0 || height <= 0,
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+
+  if (operation != VG_CLEAR_MASK && operation != VG_FILL_MASK) {
+    VG_RETURN_ERR_IF(!shIsValidImage(context, mask),
+                     VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+    i = (SHImage*)mask;
+    VG_RETURN_ERR_IF(i == context->renderTarget,
+                     VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
+    width = SH_MIN(width, i->width);
+    height = SH_MIN(height, i->height);
+  }
+
+  /* Filling a mask that is all ones already */
+  if (context->maskData == NULL && (operation == VG_FILL_MASK ||
+                                    operation == VG_UNION_MASK))
+    VG_RETURN(VG_NO_RETVAL);
+
+  /* Clip to surface */
+  x0 = SH_MAX(x, 0);
+  y0 = SH_MAX(y, 0);
+  x1 = SH_MIN(x + width, context->windowWidth);
+  y1 = SH_MIN(y + height, context->windowHeight);
+  if (x0 >= x1 || y0 >= y1)
+    VG_RETURN(VG_NO_RETVAL);
+
+  /* Pending draws still see the old mask */
+  shFlushBatch(context);
+
+  if (context->maskData == NULL) {
+    VG_RETURN_ERR_IF(!shAllocMask(context),
+                     VG_OUT_OF_MEMORY_ERROR, VG_NO_RETVAL);
+  }
+  
+  if (i != NULL)
+    shSyncImageData(context, i);
+
+  for (py=y0; py<y1; ++py) {
+
+    row = context->maskData + py * context->maskWidth;
+
+    if (operation == VG_CLEAR_MASK || operation == VG_FILL_MASK) {
+      memset(row + x0, operation == VG_FILL_MASK ? 255 : 0, x1 - x0);
+      continue;
+    }
+
+    src = i->data + (py - y) * i->texwidth * i->fd.bytes;
+    for (px=x0; px<x1; ++px) {
+
+      shLoadColor(&color, src + (px - x) * i->fd.bytes, &i->fd);
+      s = (i->fd.amask ? color.a : color.r);
+      m = (SHfloat)row[px] / 255.0f;
+
+      switch (operation) {
+      case VG_SET_MASK:       m = s; break;
+      case VG_UNION_MASK:     m = 1.0f - (1.0f - m) * (1.0f - s); break;
+      case VG_INTERSECT_MASK: m = m * s; break;
+      case VG_SUBTRACT_MASK:  m = m * (1.0f - s); break;
+      default: break;
+      }
+
+      row[px] = (SHuint8)SH_FLOOR(m * 255.0f + 0.5f);
+    }
+  }
+
+  if (context->backend->gl) {
+    shUploadMask(context, x0, y0, x1 - x0, y1 - y0);
+    shGLActiveTexture(context, GL_TEXTURE0);
+  }
+
+  VG_RETURN(VG_NO_RETVAL);
+}
@@ -23,6 +23,7 @@
 #include "shContext.h"
 #include "shPaint.h"
 #include <stdio.h>
+#include <string.h>
 
 #define _ITEM_T SHStop
 #define _ARRAY_T SHStopArray
@@ -31,6 +32,12 @@
 #define _ARRAY_DEFINE
 #include "shArrayBase.h"
 
+#define _ITEM_T SHColorRamp*
+#define _ARRAY_T SHColorRampArray
+#define _FUNC_T shColorRampArray
+#define _ARRAY_DEFINE
+#include "shArrayBase.h"
+
 #define _ITEM_T SHPaint*
 #define _ARRAY_T SHPaintArray
 #define _FUNC_T shPaintArray
@@ -52,11 +59,8 @@ void SHPaint_ctor(SHPaint *p)
   for (i=0; i<4; ++i) p->linearGradient[i] = 0.0f;
   for (i=0; i<5; ++i) p->radialGradient[i] = 0.0f;
   p->pattern = VG_INVALID_HANDLE;
-  
-  glGenTextures(1, &p->texture);
-  glBindTexture(GL_TEXTURE_1D, p->texture);
-  glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA, SH_GRADIENT_TEX_SIZE, 0,
-               GL_RGBA, GL_FLOAT, NULL);
+  p->ramp = NULL;
+  p->refCount = 1;
 }
 
 void SHPaint_dtor(SHPaint *p)
@@ -64,8 +68,42 @@ void SHPaint_dtor(SHPaint *p)
   SH_DEINITOBJ(SHStopArray, p->instops);
   SH_DEINITOBJ(SHStopArray, p->stops);
   
-  if (glIsTexture(p->texture))
-    glDeleteTextures(1, &p->texture);
+  if (p->pattern != VG_INVALID_HANDLE)
+    shReleaseImage((SHImage*)p->pattern);
+  
+  if (p->ramp) {
+    SH_GETCONTEXT(SH_NO_RETVAL);
+    shReleaseColorRamp(context, p->ramp);
+  }
+}
+
+/*--------------------------------------------------------
+ * A paint stays alive while it is set on any context of
+ * the share group, after its handle is destroyed
+ *--------------------------------------------------------*/
+
+void shRetainPaint(SHPaint *p)
+{
+  if (p) p->refCount++;
+}
+
+void shReleasePaint(SHPaint *p)
+{
+  if (p && --p->refCount == 0)
+    SH_DELETEOBJ(SHPaint, p);
+}
+
+void SHColorRamp_ctor(SHColorRamp *r)
+{
+  r->hash = 0;
+  SH_INITOBJ(SHStopArray, r->stops);
+  r->row = -1;
+  r->refCount = 0;
+}
+
+void SHColorRamp_dtor(SHColorRamp *r)
+{
+  SH_DEINITOBJ(SHStopArray, r->stops);
 }
 
 VG_API_CALL VGPaint vgCreatePaint(void)
@@ -79,7 +117,7 @@ VG_API_CALL VGPaint vgCreatePaint(void)
                    VG_INVALID_HANDLE);
   
   /* Add to resource list */
-  shPaintArrayPushBack(&context->paints, p);
+  shPaintArrayPushBack(&context->share->paints, p);
   
   VG_RETURN((VGPaint)p);
 }
@@ -90,12 +128,13 @@ VG_API_CALL void vgDestroyPaint(VGPaint paint)
   VG_GETCONTEXT(VG_NO_RETVAL);
   
   /* Check if handle valid */
-  index = shPaintArrayFind(&context->paints, (SHPaint*)paint);
+  index = shPaintArrayFind(&context->share->paints, (SHPaint*)paint);
   VG_RETURN_ERR_IF(index == -1, VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
-  /* Delete object and remove resource */
-  SH_DELETEOBJ(SHPaint, (SHPaint*)paint);
-  shPaintArrayRemoveAt(&context->paints, index);
+  /* Remove resource, contexts drawing with it keep it */
+  shPaintArrayRemoveAt(&context->share->paints, index);
+  shReleasePaint((SHPaint*)paint);
+  context->share->objectGeneration++;
   
   VG_RETURN(VG_NO_RETVAL);
 }
@@ -114,10 +153,16 @@ VG_API_CALL void vgSetPaint(VGPaint paint, VGbitfield paintModes)
                    VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
   
   /* Set stroke / fill */
-  if (paintModes & VG_STROKE_PATH)
+  if (paintModes & VG_STROKE_PATH) {
+    shRetainPaint((SHPaint*)paint);
+    shReleasePaint(context->strokePaint);
     context->strokePaint = (SHPaint*)paint;
-  if (paintModes & VG_FILL_PATH)
+  }
+  if (paintModes & VG_FILL_PATH) {
+    shRetainPaint((SHPaint*)paint);
+    shReleasePaint(context->fillPaint);
     context->fillPaint = (SHPaint*)paint;
+  }
   
   VG_RETURN(VG_NO_RETVAL);
 }
@@ -134,32 +179,37 @@ VG_API_CALL void vgPaintPattern(VGPaint paint, VGImage pattern)
   VG_RETURN_ERR_IF(!shIsValidImage(context, pattern),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
-  /* TODO: Check if pattern image is current rendering target */
+  /* Can't sample the image being drawn into */
+  VG_RETURN_ERR_IF((SHImage*)pattern == context->renderTarget,
+                   VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
   
-  /* Set pattern image */
+  /* Set pattern image, which the paint keeps alive */
+  shRetainImage((SHImage*)pattern);
+  if (((SHPaint*)paint)->pattern != VG_INVALID_HANDLE)
+    shReleaseImage((SHImage*)((SHPaint*)paint)->pattern);
   ((SHPaint*)paint)->pattern = pattern;
   
   VG_RETURN(VG_NO_RETVAL);
 }
 
-void shUpdateColorRampTexture(SHPaint *p)
+static void shUpdateColorRampTexture(VGContext *context, SHColorRamp *r)
 {
   SHint s=0;
   SHStop *stop1, *stop2;
-  SHfloat rgba[SH_GRADIENT_TEX_COORDSIZE];
+  SHuint8 rgba[SH_GRADIENT_TEX_COORDSIZE];
   SHint x1=0, x2=0, dx, x;
   SHColor dc, c;
   SHfloat k;
   
   /* Write first pixel color */
-  stop1 = &p->stops.items[0];
-  CSTORE_RGBA1D_F(stop1->color, rgba, x1);
+  stop1 = &r->stops.items[0];
+  CSTORE_RGBA1D_8(stop1->color, rgba, x1);
   
   /* Walk stops */
-  for (s=1; s<p->stops.size; ++s, x1=x2, stop1=stop2) {
+  for (s=1; s<r->stops.size; ++s, x1=x2, stop1=stop2) {
     
     /* Pick next stop */
-    stop2 = &p->stops.items[s];
+    stop2 = &r->stops.items[s];
     x2 = (SHint)(stop2->offset * (SH_GRADIENT_TEX_SIZE-1));
     
     SH_ASSERT(x1 >= 0 && x1 < SH_GRADIENT_TEX_SIZE &&
@@ -175,23 +225,178 @@ void shUpdateColorRampTexture(SHPaint *p)
       k = (SHfloat)(x-x1)/dx;
       CSETC(c, stop1->color);
       CADDCK(c, dc, k);
-      CSTORE_RGBA1D_F(c, rgba, x);
+      CSTORE_RGBA1D_8(c, rgba, x);
     }
   }
   
-  /* Update texture image */
-  glBindTexture(GL_TEXTURE_1D, p->texture);
+  /* Upload into the ramp's atlas row */
+  shGLBindTexture(context, GL_TEXTURE_2D, context->share->rampAtlas);
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glTexSubImage1D(GL_TEXTURE_1D, 0, 0, SH_GRADIENT_TEX_SIZE,
-                  GL_RGBA, GL_FLOAT, rgba);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, r->row, SH_GRADIENT_TEX_SIZE, 1,
+                  GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+}
+
+/*--------------------------------------------------------
+ * All the color ramps of a context are rows of a single
+ * 2D texture, so switching between gradient paints needs
+ * no texture rebind. The atlas doubles its height when it
+ * runs out of rows, re-uploading the ramps it holds.
+ *--------------------------------------------------------*/
+
+static SHint shResizeRampAtlas(VGContext *c, SHint rows)
+{
+  SHShareGroup *g = c->share;
+  GLint maxSize = 0;
+  SHint i;
+  
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+  if (rows > maxSize)
+    return 0;
+  
+  if (!shUint8ArrayReserveAndCopy(&g->rampAtlasRows, rows))
+    return 0;
+  
+  if (g->rampAtlas == 0) {
+    glGenTextures(1, &g->rampAtlas);
+    g->rampAtlasParams[0] = g->rampAtlasParams[1] = -1;
+  }
+  
+  shGLBindTexture(c, GL_TEXTURE_2D, g->rampAtlas);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SH_GRADIENT_TEX_SIZE, rows, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  
+  while (g->rampAtlasRows.size < rows)
+    shUint8ArrayPushBack(&g->rampAtlasRows, 0);
+  
+  for (i=0; i<g->ramps.size; ++i)
+    shUpdateColorRampTexture(c, g->ramps.items[i]);
+  
+  return 1;
+}
+
+static SHint shAllocRampRow(VGContext *c)
+{
+  SHUint8Array *rows = &c->share->rampAtlasRows;
+  SHint row;
+  
+  for (row=0; row<rows->size; ++row)
+    if (rows->items[row] == 0) break;
+  
+  if (row == rows->size) {
+    if (!shResizeRampAtlas(c, SH_MAX(2 * row, SH_RAMP_ATLAS_MIN_ROWS)))
+      return -1;
+  }
+  
+  rows->items[row] = 1;
+  return row;
+}
+
+void shDeleteRampAtlas(VGContext *c)
+{
+  SHShareGroup *g = c->share;
+  
+  if (g->rampAtlas == 0)
+    return;
+  
+  shForgetSharedTexture(c, g->rampAtlas);
+  glDeleteTextures(1, &g->rampAtlas);
+  g->rampAtlas = 0;
+  shUint8ArrayClear(&g->rampAtlasRows);
+}
+
+/*--------------------------------------------------------
+ * Color ramps are cached in the context by their stops,
+ * so paints defining the same gradient colors share one
+ * atlas row, interpolated and uploaded only once.
+ *--------------------------------------------------------*/
+
+static SHuint shHashStops(SHStopArray *stops)
+{
+  const SHuint8 *b = (const SHuint8*)stops->items;
+  SHint size = stops->size * sizeof(SHStop);
+  SHuint hash = 2166136261u;
+  SHint i;
+  
+  /* FNV-1a */
+  for (i=0; i<size; ++i) {
+    hash ^= b[i];
+    hash *= 16777619u;
+  }
+  
+  return hash;
+}
+
+static SHColorRamp* shAcquireColorRamp(VGContext *c, SHStopArray *stops)
+{
+  SHColorRampArray *ramps = &c->share->ramps;
+  SHColorRamp *r;
+  SHuint hash;
+  SHint i;
+  
+  hash = shHashStops(stops);
+  
+  for (i=0; i<ramps->size; ++i) {
+    r = ramps->items[i];
+    if (r->hash == hash && r->stops.size == stops->size &&
+        memcmp(r->stops.items, stops->items,
+               stops->size * sizeof(SHStop)) == 0) {
+      r->refCount++;
+      return r;
+    }
+  }
+  
+  /* Create new ramp */
+  SH_NEWOBJ(SHColorRamp, r);
+  if (!r) return NULL;
+  
+  if (!shStopArrayReserve(&r->stops, stops->size) ||
+      !shColorRampArrayReserveAndCopy(ramps, ramps->size + 1)) {
+    SH_DELETEOBJ(SHColorRamp, r);
+    return NULL;
+  }
+  
+  for (i=0; i<stops->size; ++i)
+    shStopArrayPushBackP(&r->stops, &stops->items[i]);
+  
+  /* Growing the atlas re-uploads the cached ramps,
+     so the new one is added to the cache after it */
+  r->row = shAllocRampRow(c);
+  if (r->row == -1) {
+    SH_DELETEOBJ(SHColorRamp, r);
+    return NULL;
+  }
+  
+  shColorRampArrayPushBack(ramps, r);
+  r->hash = hash;
+  r->refCount = 1;
+  shUpdateColorRampTexture(c, r);
+  return r;
+}
+
+void shReleaseColorRamp(VGContext *c, SHColorRamp *r)
+{
+  SHint index;
+  
+  if (--r->refCount > 0)
+    return;
+  
+  index = shColorRampArrayFind(&c->share->ramps, r);
+  if (index != -1)
+    shColorRampArrayRemoveAt(&c->share->ramps, index);
+  
+  c->share->rampAtlasRows.items[r->row] = 0;
+  SH_DELETEOBJ(SHColorRamp, r);
 }
 
 void shValidateInputStops(SHPaint *p)
 {
   SHStop *instop, stop;
   SHfloat lastOffset=0.0f;
+  SHColorRamp *old;
   int i;
   
+  SH_GETCONTEXT(SH_NO_RETVAL);
+  
   shStopArrayClear(&p->stops);
   shStopArrayReserve(&p->stops, p->instops.size);
   
@@ -241,8 +446,15 @@ void shValidateInputStops(SHPaint *p)
     shStopArrayPushBackP(&p->stops, &stop);
   }
   
-  /* Update texture */
-  shUpdateColorRampTexture(p);
+  /* Without OpenGL the ramps are built per draw */
+  if (!context->backend->gl)
+    return;
+  
+  /* Switch to the ramp texture of the new stops,
+     acquired first in case it is the same one */
+  old = p->ramp;
+  p->ramp = shAcquireColorRamp(context, &p->stops);
+  if (old) shReleaseColorRamp(context, old);
 }
 
 void shGenerateStops(SHPaint *p, SHfloat minOffset, SHfloat maxOffset,
@@ -343,53 +555,80 @@ void shGenerateStops(SHPaint *p, SHfloat minOffset, SHfloat maxOffset,
   }
 }
 
-void shSetGradientTexGLState(SHPaint *p)
+/*--------------------------------------------------------
+ * Binds the ramp atlas with the wrap mode of the spread
+ * mode and returns the texture coordinate addressing the
+ * center of the paint's ramp row
+ *--------------------------------------------------------*/
+
+SHfloat shBindGradientRamp(SHPaint *p, VGContext *c)
 {
-  glBindTexture(GL_TEXTURE_1D, p->texture);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  GLint wrap = GL_CLAMP_TO_EDGE;
   
   switch (p->spreadMode) {
   case VG_COLOR_RAMP_SPREAD_PAD:
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); break;
+    wrap = GL_CLAMP_TO_EDGE; break;
   case VG_COLOR_RAMP_SPREAD_REPEAT:
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_REPEAT); break;
+    wrap = GL_REPEAT; break;
   case VG_COLOR_RAMP_SPREAD_REFLECT:
-    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT); break;
+    wrap = GL_MIRRORED_REPEAT; break;
   }
   
-  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-  glColor4f(1,1,1,1);
+  if (p->ramp == NULL) {
+    /* Out of memory, no texture to apply */
+    shGLBindTexture(c, GL_TEXTURE_2D, 0);
+    return 0.0f;
+  }
+  
+  shGLBindTexture(c, GL_TEXTURE_2D, c->share->rampAtlas);
+  shGLTexParameters(c, GL_TEXTURE_2D, c->share->rampAtlasParams,
+                    wrap, GL_LINEAR);
+  return ((SHfloat)p->ramp->row + 0.5f) /
+    (SHfloat)c->share->rampAtlasRows.size;
 }
 
-void shSetPatternTexGLState(SHPaint *p, VGContext *c)
+/*--------------------------------------------------------
+ * Binds the pattern image with the wrap mode of the
+ * tiling mode
+ *--------------------------------------------------------*/
+
+void shBindPatternTexture(SHPaint *p, VGContext *c)
 {
-  glBindTexture(GL_TEXTURE_2D, ((SHImage*)p->pattern)->texture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  SHImage *i = (SHImage*)p->pattern;
+  GLint wrap = GL_CLAMP_TO_EDGE;
   
   switch(p->tilingMode) {
   case VG_TILE_FILL:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR,
-                     (GLfloat*)&c->tileFillColor);
-    break;
+    wrap = GL_CLAMP_TO_BORDER; break;
   case VG_TILE_PAD:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    break;
+    wrap = GL_CLAMP_TO_EDGE; break;
   case VG_TILE_REPEAT:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    break;
+    wrap = GL_REPEAT; break;
   case VG_TILE_REFLECT:
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
-    break;
+    wrap = GL_MIRRORED_REPEAT; break;
   }
   
-  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  shGLBindTexture(c, GL_TEXTURE_2D, i->texture);
+  shGLTexParameters(c, GL_TEXTURE_2D, i->texParams, wrap, GL_LINEAR);
+  
+  if (p->tilingMode == VG_TILE_FILL)
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR,
+                     (GLfloat*)&c->tileFillColor);
+}
+
+/* Same, with fixed-function texturing set to modulate */
+
+SHfloat shSetGradientTexGLState(SHPaint *p, VGContext *c)
+{
+  shGLTexEnvMode(c, GL_MODULATE);
+  glColor4f(1,1,1,1);
+  return shBindGradientRamp(p, c);
+}
+
+void shSetPatternTexGLState(SHPaint *p, VGContext *c)
+{
+  shBindPatternTexture(p, c);
+  shGLTexEnvMode(c, GL_MODULATE);
   glColor4f(1,1,1,1);
 }
 
@@ -415,6 +654,7 @@ int shDrawLinearGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
   SHfloat left = 0.0f;
   SHfloat right = 0.0f;
   SHVector2 l1,r1,l2,r2;
+  SHfloat row;
 
   /* Pick paint transform matrix */
   SH_GETCONTEXT(0);
@@ -454,6 +694,7 @@ int shDrawLinearGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
     glColor4fv((GLfloat*)c); glBegin(GL_QUADS);
     for (i=0; i<4; ++i) glVertex2fv((GLfloat*)&corners[i]);
     glEnd();
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
     return 1;
   }
   
@@ -484,22 +725,23 @@ int shDrawLinearGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
   OFFSET2V(r2, uuy, right); OFFSET2V(r2, uux, maxOffset * n);
   
   /* Draw quad using color-ramp texture */
-  glActiveTexture(texUnit);
-  shSetGradientTexGLState(p);
+  shGLActiveTexture(context, texUnit);
+  row = shSetGradientTexGLState(p, context);
   
-  glEnable(GL_TEXTURE_1D);
+  shGLEnable(context, GL_TEXTURE_2D);
   glBegin(GL_QUAD_STRIP);
   
-  glMultiTexCoord1f(texUnit, minOffset);
+  glMultiTexCoord2f(texUnit, minOffset, row);
   glVertex2fv((GLfloat*)&r1);
   glVertex2fv((GLfloat*)&l1);
   
-  glMultiTexCoord1f(texUnit, maxOffset);
+  glMultiTexCoord2f(texUnit, maxOffset, row);
   glVertex2fv((GLfloat*)&r2);
   glVertex2fv((GLfloat*)&l2);
   
   glEnd();
-  glDisable(GL_TEXTURE_1D);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  shGLDisable(context, GL_TEXTURE_2D);
 
   return 1;
 }
@@ -538,6 +780,7 @@ int shDrawRadialGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
   float step = 2*PI/numsteps;
   SHVector2 tmin, tmax;
   SHVector2 min1, max1, min2, max2;
+  SHfloat row;
   
   /* Pick paint transform matrix */
   SH_GETCONTEXT(0);
@@ -591,6 +834,7 @@ int shDrawRadialGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
     glColor4fv((GLfloat*)c); glBegin(GL_QUADS);
     for (i=0; i<4; ++i) glVertex2fv((GLfloat*)&corners[i]);
     glEnd();
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
     return 1;
   }
   
@@ -667,10 +911,10 @@ int shDrawRadialGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
   step = PI/50;
   numsteps = (SHint)SH_CEIL(maxA / step) + 1;
   
-  glActiveTexture(texUnit);
-  shSetGradientTexGLState(p);
+  shGLActiveTexture(context, texUnit);
+  row = shSetGradientTexGLState(p, context);
   
-  glEnable(GL_TEXTURE_1D);
+  shGLEnable(context, GL_TEXTURE_2D);
   glBegin(GL_QUADS);
   
   /* Walk the steps and draw gradient mesh */
@@ -701,10 +945,10 @@ int shDrawRadialGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
     
     /* Draw quad */
     if (i!=0) {
-      glMultiTexCoord1f(texUnit, minOffset);
+      glMultiTexCoord2f(texUnit, minOffset, row);
       glVertex2fv((GLfloat*)&min1);
       glVertex2fv((GLfloat*)&min2);
-      glMultiTexCoord1f(texUnit, maxOffset);
+      glMultiTexCoord2f(texUnit, maxOffset, row);
       glVertex2fv((GLfloat*)&max2);
       glVertex2fv((GLfloat*)&max1);
     }
@@ -715,7 +959,8 @@ int shDrawRadialGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
   }
   
   glEnd();
-  glDisable(GL_TEXTURE_1D);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  shGLDisable(context, GL_TEXTURE_2D);
 
   return 1;
 }
@@ -754,6 +999,7 @@ int shDrawPatternMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
     glColor4fv((GLfloat*)c); glBegin(GL_QUADS);
     for (i=0; i<4; ++i) glVertex2fv((GLfloat*)&corners[i]);
     glEnd();
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
     return 1;
   }
   
@@ -763,7 +1009,7 @@ int shDrawPatternMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
   sx = 1.0f/(VGfloat)img->texwidth;
   sy = 1.0f/(VGfloat)img->texheight;
   
-  glActiveTexture(texUnit);
+  shGLActiveTexture(context, texUnit);
   shMatrixToGL(&mi, migl);
   glMatrixMode(GL_TEXTURE);
   glPushMatrix();
@@ -774,7 +1020,7 @@ int shDrawPatternMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
   /* Draw boundbox with same texture coordinates
      that will get transformed back to paint space */
   shSetPatternTexGLState(p, context);
-  glEnable(GL_TEXTURE_2D);
+  shGLEnable(context, GL_TEXTURE_2D);
   glBegin(GL_QUADS);
   
   for (i=0; i<4; ++i) {
@@ -783,8 +1029,233 @@ int shDrawPatternMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
   }
   
   glEnd();
-  glDisable(GL_TEXTURE_2D);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  shGLDisable(context, GL_TEXTURE_2D);
   glPopMatrix();
   glMatrixMode(GL_MODELVIEW);
   return 1;
 }
+
+/*--------------------------------------------------------------
+ * Binds the GLSL program of a gradient paint with uniforms
+ * set up for the current paint transformation, so that the
+ * geometry drawn next (in user space) gets the gradient
+ * evaluated per pixel. Returns 0 and leaves the state alone
+ * when shaders are off or unavailable or the gradient is
+ * degenerate; the meshes above are used in that case.
+ *--------------------------------------------------------------*/
+
+int shSetGradientShaderState(SHPaint *p, VGPaintMode mode, GLenum texUnit)
+{
+  SHMatrix3x3 *m;
+  SHMatrix3x3 mi;
+  SHGradientProgram *g;
+  SHfloat gx = 0.0f, gy = 0.0f, n = 1.0f;
+  SHfloat cx, cy, fx, fy, r;
+  SHfloat fcx, fcy;
+  SHfloat row;
+  
+  SH_GETCONTEXT(0);
+  if (context->gradientShaders != VG_TRUE)
+    return 0;
+  
+  if (mode == VG_FILL_PATH)
+    m = &context->fillTransform;
+  else
+    m = &context->strokeTransform;
+  
+  if (!shInvertMatrix(m, &mi))
+    return 0;
+  
+  switch (p->type) {
+  case VG_PAINT_TYPE_LINEAR_GRADIENT:
+    gx = p->linearGradient[2] - p->linearGradient[0];
+    gy = p->linearGradient[3] - p->linearGradient[1];
+    n = gx*gx + gy*gy;
+    if (n == 0.0f) return 0;
+    g = (context->maskActive ? &context->linearMaskProgram
+         : &context->linearProgram);
+    break;
+    
+  case VG_PAINT_TYPE_RADIAL_GRADIENT:
+    if (p->radialGradient[4] <= 0.0f) return 0;
+    g = (context->maskActive ? &context->radialMaskProgram
+         : &context->radialProgram);
+    break;
+    
+  default:
+    return 0;
+  }
+  
+  if (!shLoadGradientPrograms(context))
+    return 0;
+  
+  shGLActiveTexture(context, texUnit);
+  row = shSetGradientTexGLState(p, context);
+  shGLUseProgram(context, g->program);
+  
+  glUniform3f(g->paintX, mi.m[0][0], mi.m[0][1], mi.m[0][2]);
+  glUniform3f(g->paintY, mi.m[1][0], mi.m[1][1], mi.m[1][2]);
+  glUniform1i(g->ramp, texUnit - GL_TEXTURE0);
+  glUniform1f(g->rampRow, row);
+  
+  if (context->maskActive) {
+    glUniform1i(g->mask, SH_MASK_TEXTURE_UNIT - GL_TEXTURE0);
+    glUniform2f(g->maskScale, 1.0f / context->maskTexWidth,
+                1.0f / context->maskTexHeight);
+  }
+  
+  if (p->type == VG_PAINT_TYPE_LINEAR_GRADIENT) {
+    
+    glUniform2f(g->params[0], p->linearGradient[0], p->linearGradient[1]);
+    glUniform2f(g->params[1], gx / n, gy / n);
+    
+  }else{
+    
+    cx = p->radialGradient[0];
+    cy = p->radialGradient[1];
+    fx = p->radialGradient[2];
+    fy = p->radialGradient[3];
+    r = p->radialGradient[4];
+    
+    /* Move focus into circle if outside */
+    fcx = fx - cx;
+    fcy = fy - cy;
+    n = SH_SQRT(fcx*fcx + fcy*fcy);
+    if (n > r) {
+      fcx *= 0.995f * r / n;
+      fcy *= 0.995f * r / n;
+      fx = cx + fcx;
+      fy = cy + fcy;
+    }
+    
+    glUniform2f(g->params[0], fx, fy);
+    glUniform2f(g->params[1], fcx, fcy);
+    glUniform2f(g->params[2], r*r, r*r - (fcx*fcx + fcy*fcy));
+  }
+  
+  return 1;
+}
+
+/*--------------------------------------------------------------
+ * Sets up OpenGL state so that the paint is applied directly
+ * to the path geometry drawn next (in user space), with the
+ * texture coordinates generated from vertex positions or the
+ * gradient evaluated by a shader. Returns 0 if the paint cannot
+ * be expressed this way (radial gradient offsets are not linear
+ * in the position) and leaves the state untouched in that case.
+ *--------------------------------------------------------------*/
+
+int shSetPaintTexGenGLState(SHPaint *p, VGPaintMode mode, GLenum texUnit)
+{
+  SHMatrix3x3 *m;
+  SHMatrix3x3 mi;
+  SHfloat planeS[4] = {0,0,0,0};
+  SHfloat planeT[4] = {0,0,0,0};
+  SHfloat gx, gy, n;
+  SHfloat sx, sy;
+  SHImage *img;
+  
+  SH_GETCONTEXT(0);
+  if (mode == VG_FILL_PATH)
+    m = &context->fillTransform;
+  else
+    m = &context->strokeTransform;
+  
+  if (shSetGradientShaderState(p, mode, texUnit))
+    return 1;
+  
+  switch (p->type) {
+  case VG_PAINT_TYPE_RADIAL_GRADIENT:
+    return 0;
+    
+  case VG_PAINT_TYPE_LINEAR_GRADIENT:
+    
+    gx = p->linearGradient[2] - p->linearGradient[0];
+    gy = p->linearGradient[3] - p->linearGradient[1];
+    n = gx*gx + gy*gy;
+    
+    if (!shInvertMatrix(m, &mi) || n == 0.0f) {
+      /* Fill with color at offset 1 */
+      glColor4fv((GLfloat*)&p->stops.items[p->stops.size-1].color);
+      return 1;
+    }
+    
+    /* Offset is the projection of the paint-space
+       position onto the gradient vector */
+    gx /= n; gy /= n;
+    planeS[0] = gx * mi.m[0][0] + gy * mi.m[1][0];
+    planeS[1] = gx * mi.m[0][1] + gy * mi.m[1][1];
+    planeS[3] = gx * (mi.m[0][2] - p->linearGradient[0])
+              + gy * (mi.m[1][2] - p->linearGradient[1]);
+    
+    shGLActiveTexture(context, texUnit);
+    planeT[3] = shSetGradientTexGLState(p, context);
+    glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+    glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+    glTexGenfv(GL_S, GL_OBJECT_PLANE, planeS);
+    glTexGenfv(GL_T, GL_OBJECT_PLANE, planeT);
+    shGLEnable(context, GL_TEXTURE_GEN_S);
+    shGLEnable(context, GL_TEXTURE_GEN_T);
+    shGLEnable(context, GL_TEXTURE_2D);
+    return 1;
+    
+  case VG_PAINT_TYPE_PATTERN:
+    if (p->pattern != VG_INVALID_HANDLE) {
+      
+      if (!shInvertMatrix(m, &mi)) {
+        /* Fill with tile fill color */
+        glColor4fv((GLfloat*)&context->tileFillColor);
+        return 1;
+      }
+      
+      /* Back to paint space, then to texture space */
+      img = (SHImage*)p->pattern;
+      sx = 1.0f/(VGfloat)img->texwidth;
+      sy = 1.0f/(VGfloat)img->texheight;
+      planeS[0] = sx * mi.m[0][0];
+      planeS[1] = sx * mi.m[0][1];
+      planeS[3] = sx * mi.m[0][2];
+      planeT[0] = sy * mi.m[1][0];
+      planeT[1] = sy * mi.m[1][1];
+      planeT[3] = sy * mi.m[1][2];
+      
+      shGLActiveTexture(context, texUnit);
+      shSetPatternTexGLState(p, context);
+      glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+      glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
+      glTexGenfv(GL_S, GL_OBJECT_PLANE, planeS);
+      glTexGenfv(GL_T, GL_OBJECT_PLANE, planeT);
+      shGLEnable(context, GL_TEXTURE_GEN_S);
+      shGLEnable(context, GL_TEXTURE_GEN_T);
+      shGLEnable(context, GL_TEXTURE_2D);
+      return 1;
+    }/* else behave as a color paint */
+    
+  case VG_PAINT_TYPE_COLOR:
+    glColor4fv((GLfloat*)&p->color);
+    return 1;
+  }
+  
+  return 0;
+}
+
+/*--------------------------------------------------------------
+ * Disables whatever shSetPaintTexGenGLState turned on
+ *--------------------------------------------------------------*/
+
+void shResetPaintTexGenGLState(SHPaint *p, GLenum texUnit)
+{
+  SH_GETCONTEXT(SH_NO_RETVAL);
+  
+  if (p->type == VG_PAINT_TYPE_COLOR ||
+      (p->type == VG_PAINT_TYPE_PATTERN &&
+       p->pattern == VG_INVALID_HANDLE))
+    return;
+  
+  shGLUseProgram(context, 0);
+  shGLActiveTexture(context, texUnit);
+  shGLDisable(context, GL_TEXTURE_GEN_S);
+  shGLDisable(context, GL_TEXTURE_GEN_T);
+  shGLDisable(context, GL_TEXTURE_2D);
+}
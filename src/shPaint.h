@@ -38,6 +38,27 @@ typedef struct
 #define _ARRAY_DECLARE
 #include "shArrayBase.h"
 
+/* Color ramp shared by all the paints with the same
+   validated stops, stored in a row of the context's
+   ramp atlas texture */
+typedef struct
+{
+  SHuint hash;
+  SHStopArray stops;
+  SHint row;
+  SHint refCount;
+  
+} SHColorRamp;
+
+void SHColorRamp_ctor(SHColorRamp *r);
+void SHColorRamp_dtor(SHColorRamp *r);
+
+#define _ITEM_T SHColorRamp*
+#define _ARRAY_T SHColorRampArray
+#define _FUNC_T shColorRampArray
+#define _ARRAY_DECLARE
+#include "shArrayBase.h"
+
 typedef struct
 {
   VGPaintType type;
@@ -50,12 +71,17 @@ typedef struct
   VGTilingMode tilingMode;
   SHfloat linearGradient[4];
   SHfloat radialGradient[5];
-  GLuint texture;
+  SHColorRamp *ramp;
   VGImage pattern;
   
+  /* References held by the handle and the contexts
+     drawing with the paint */
+  SHint refCount;
+  
 } SHPaint;
 
 #define SH_GRADIENT_TEX_SIZE 1024
+#define SH_RAMP_ATLAS_MIN_ROWS 16
 
 void SHPaint_ctor(SHPaint *p);
 void SHPaint_dtor(SHPaint *p);
@@ -66,8 +92,16 @@ void SHPaint_dtor(SHPaint *p);
 #define _ARRAY_DECLARE
 #include "shArrayBase.h"
 
+struct VGContext;
+
 void shValidateInputStops(SHPaint *p);
-void shSetGradientTexGLState(SHPaint *p);
+void shRetainPaint(SHPaint *p);
+void shReleasePaint(SHPaint *p);
+void shReleaseColorRamp(struct VGContext *c, SHColorRamp *r);
+void shDeleteRampAtlas(struct VGContext *c);
+SHfloat shBindGradientRamp(SHPaint *p, struct VGContext *c);
+void shBindPatternTexture(SHPaint *p, struct VGContext *c);
+SHfloat shSetGradientTexGLState(SHPaint *p, struct VGContext *c);
 
 int shDrawLinearGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
                              VGPaintMode mode, GLenum texUnit);
@@ -77,6 +111,10 @@ int shDrawRadialGradientMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
 
 int shDrawPatternMesh(SHPaint *p, SHVector2 *min, SHVector2 *max,
                       VGPaintMode mode, GLenum texUnit);
+
+int shSetGradientShaderState(SHPaint *p, VGPaintMode mode, GLenum texUnit);
+int shSetPaintTexGenGLState(SHPaint *p, VGPaintMode mode, GLenum texUnit);
+void shResetPaintTexGenGLState(SHPaint *p, GLenum texUnit);
   
 
 #endif /* __SHPAINT_H */
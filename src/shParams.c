@@ -33,6 +33,9 @@ int shIsParamVector(SHint type)
 {
   return
     (type == VG_SCISSOR_RECTS ||
+     type == VG_DAMAGE_RECTS_SH ||
+     type == VG_REDRAW_RECTS_SH ||
+     type == VG_FRAME_STATISTICS_SH ||
      type == VG_STROKE_DASH_PATTERN ||
      type == VG_TILE_FILL_COLOR ||
      type == VG_CLEAR_COLOR ||
@@ -106,6 +109,12 @@ int shIsEnumValid(SHint type, VGint val)
   case VG_STROKE_DASH_PHASE_RESET:
   case VG_SCISSORING:
   case VG_MASKING:
+  case VG_FILL_TRIANGULATION_SH:
+  case VG_DRAW_BATCHING_SH:
+  case VG_RETAIN_GL_STATE_SH:
+  case VG_GRADIENT_SHADERS_SH:
+  case VG_DAMAGE_TRACKING_SH:
+  case VG_REDRAW_CULLING_SH:
     return (val == VG_TRUE ||
             val == VG_FALSE);
     
@@ -267,6 +276,8 @@ static void shSet(VGContext *context, VGParamType type, SHint count,
   case VG_FILL_RULE:
     SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
     SH_RETURN_ERR_IF(!shIsEnumValid(type,ivalue), VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    if (context->fillRule != (VGFillRule)ivalue)
+      shFlushBatch(context);
     context->fillRule = (VGFillRule)ivalue;
     break;
     
@@ -285,6 +296,8 @@ static void shSet(VGContext *context, VGParamType type, SHint count,
   case VG_BLEND_MODE:
     SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
     SH_RETURN_ERR_IF(!shIsEnumValid(type,ivalue), VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    if (context->blendMode != (VGBlendMode)ivalue)
+      shFlushBatch(context);
     context->blendMode = (VGBlendMode)ivalue;
     break;
     
@@ -339,11 +352,46 @@ static void shSet(VGContext *context, VGParamType type, SHint count,
     
   case VG_SCISSORING:
     SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shFlushBatch(context);
     context->scissoring = bvalue;
-    if (bvalue)
-      shEnableScissoring(context);
-    else
-      shDisableScissoring(context);
+    break;
+    
+  case VG_FILL_TRIANGULATION_SH:
+    SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    context->fillTriangulation = bvalue;
+    break;
+    
+  case VG_DRAW_BATCHING_SH:
+    SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    if (bvalue == VG_FALSE) shFlushBatch(context);
+    context->drawBatching = bvalue;
+    break;
+    
+  case VG_RETAIN_GL_STATE_SH:
+    SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    context->retainGLState = bvalue;
+    break;
+    
+  case VG_GRADIENT_SHADERS_SH:
+    SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    context->gradientShaders = bvalue;
+    break;
+    
+  case VG_DAMAGE_TRACKING_SH:
+    SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    context->damageTracking = bvalue;
+    break;
+    
+  case VG_REDRAW_CULLING_SH:
+    SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    context->redrawCulling = bvalue;
+    break;
+    
+  case VG_SOFTWARE_THREADS_SH:
+    SH_RETURN_ERR_IF(count!=1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    SH_RETURN_ERR_IF(ivalue < 1 || ivalue > SH_RASTER_MAX_THREADS,
+                     VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shRasterSetThreads(context, ivalue);
     break;
     
   case VG_STROKE_LINE_WIDTH:
@@ -392,9 +440,17 @@ static void shSet(VGContext *context, VGParamType type, SHint count,
   case VG_SCISSOR_RECTS:
     
     SH_RETURN_ERR_IF(count % 4, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shFlushBatch(context);
     shBuildScissorContext(context, count, values, floats);
     
     break;
+  case VG_REDRAW_RECTS_SH:
+    
+    SH_RETURN_ERR_IF(count % 4, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shRectsFromParams(&context->redrawRects, SH_MAX_REDRAW_RECTS,
+                      count, values, floats);
+    
+    break;
     
   case VG_MAX_SCISSOR_RECTS:
   case VG_MAX_DASH_COUNT:
@@ -407,6 +463,10 @@ static void shSet(VGContext *context, VGParamType type, SHint count,
   case VG_MAX_IMAGE_BYTES:
   case VG_MAX_FLOAT:
   case VG_MAX_GAUSSIAN_STD_DEVIATION:
+  case VG_GL_CALLS_ISSUED_SH:
+  case VG_GL_CALLS_SKIPPED_SH:
+  case VG_DAMAGE_RECTS_SH:
+  case VG_FRAME_STATISTICS_SH:
     /* Read-only */ break;
     
   default:
@@ -574,6 +634,41 @@ static void shGet(VGContext *context, VGParamType type, SHint count, void *value
     shIntToParam((SHint)context->scissoring, count, values, floats, 0);
     break;
     
+  case VG_FILL_TRIANGULATION_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam((SHint)context->fillTriangulation, count, values, floats, 0);
+    break;
+    
+  case VG_DRAW_BATCHING_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam((SHint)context->drawBatching, count, values, floats, 0);
+    break;
+    
+  case VG_RETAIN_GL_STATE_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam((SHint)context->retainGLState, count, values, floats, 0);
+    break;
+    
+  case VG_GRADIENT_SHADERS_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam((SHint)context->gradientShaders, count, values, floats, 0);
+    break;
+    
+  case VG_DAMAGE_TRACKING_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam((SHint)context->damageTracking, count, values, floats, 0);
+    break;
+    
+  case VG_REDRAW_CULLING_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam((SHint)context->redrawCulling, count, values, floats, 0);
+    break;
+    
+  case VG_SOFTWARE_THREADS_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam(context->raster.threads, count, values, floats, 0);
+    break;
+    
   case VG_STROKE_LINE_WIDTH:
     SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
     shFloatToParam(context->strokeLineWidth, count, values, floats, 0);
@@ -622,6 +717,26 @@ static void shGet(VGContext *context, VGParamType type, SHint count, void *value
                      VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
     break;
     
+  case VG_DAMAGE_RECTS_SH:
+    SH_RETURN_ERR_IF(shRectsToParams(&context->lastDamage, count, values, floats),
+                     VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    break;
+    
+  case VG_REDRAW_RECTS_SH:
+    SH_RETURN_ERR_IF(shRectsToParams(&context->redrawRects, count, values, floats),
+                     VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    break;
+    
+  case VG_FRAME_STATISTICS_SH:
+    
+    SH_RETURN_ERR_IF(count > VG_STAT_COUNT_SH,
+                     VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    
+    for (i=0; i<count; ++i)
+      shIntToParam(context->frameStats[i], count, values, floats, i);
+    
+    break;
+    
   case VG_MAX_SCISSOR_RECTS:
     SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
     shIntToParam(SH_MAX_SCISSOR_RECTS, count, values, floats, 0);
@@ -677,6 +792,16 @@ static void shGet(VGContext *context, VGParamType type, SHint count, void *value
     shFloatToParam(0.0f, count, values, floats, 0);
     break;
     
+  case VG_GL_CALLS_ISSUED_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam((SHint)context->glState.frameIssued, count, values, floats, 0);
+    break;
+    
+  case VG_GL_CALLS_SKIPPED_SH:
+    SH_RETURN_ERR_IF(count != 1, VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
+    shIntToParam((SHint)context->glState.frameSkipped, count, values, floats, 0);
+    break;
+    
   default:
     /* Invalid VGParamType */
     SH_RETURN_ERR(VG_ILLEGAL_ARGUMENT_ERROR, SH_NO_RETVAL);
@@ -780,6 +905,13 @@ VG_API_CALL VGint vgGetVectorSize(VGParamType type)
   case VG_STROKE_DASH_PHASE_RESET:
   case VG_MASKING:
   case VG_SCISSORING:
+  case VG_FILL_TRIANGULATION_SH:
+  case VG_DRAW_BATCHING_SH:
+  case VG_RETAIN_GL_STATE_SH:
+  case VG_GRADIENT_SHADERS_SH:
+  case VG_DAMAGE_TRACKING_SH:
+  case VG_REDRAW_CULLING_SH:
+  case VG_SOFTWARE_THREADS_SH:
   case VG_STROKE_LINE_WIDTH:
   case VG_STROKE_MITER_LIMIT:
   case VG_STROKE_DASH_PHASE:
@@ -794,6 +926,8 @@ VG_API_CALL VGint vgGetVectorSize(VGParamType type)
   case VG_MAX_IMAGE_BYTES:
   case VG_MAX_FLOAT:
   case VG_MAX_GAUSSIAN_STD_DEVIATION:
+  case VG_GL_CALLS_ISSUED_SH:
+  case VG_GL_CALLS_SKIPPED_SH:
     retval = 1;
     break;
     
@@ -810,6 +944,18 @@ VG_API_CALL VGint vgGetVectorSize(VGParamType type)
     retval = context->scissor.size * 4;
     break;
     
+  case VG_DAMAGE_RECTS_SH:
+    retval = context->lastDamage.size * 4;
+    break;
+    
+  case VG_REDRAW_RECTS_SH:
+    retval = context->redrawRects.size * 4;
+    break;
+    
+  case VG_FRAME_STATISTICS_SH:
+    retval = VG_STAT_COUNT_SH;
+    break;
+    
   default:
     /* Invalid VGParamType */
     VG_RETURN_ERR(VG_ILLEGAL_ARGUMENT_ERROR, retval);
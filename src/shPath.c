@@ -87,6 +87,15 @@ void SHPath_ctor(SHPath *p)
   
   SH_INITOBJ(SHVertexArray, p->vertices);
   SH_INITOBJ(SHVector2Array, p->stroke);
+  SH_INITOBJ(SHVector2Array, p->triangles);
+  p->convex = VG_FALSE;
+  
+  p->vertexBuffer = 0;
+  p->strokeBuffer = 0;
+  p->trianglesBuffer = 0;
+  p->cacheVertexBufferValid = VG_FALSE;
+  p->cacheStrokeBufferValid = VG_FALSE;
+  p->cacheTrianglesBufferValid = VG_FALSE;
 }
 
 /*-----------------------------------------------------
@@ -100,6 +109,14 @@ void SHPath_dtor(SHPath *p)
   
   SH_DEINITOBJ(SHVertexArray, p->vertices);
   SH_DEINITOBJ(SHVector2Array, p->stroke);
+  SH_DEINITOBJ(SHVector2Array, p->triangles);
+  
+  if (p->vertexBuffer || p->strokeBuffer || p->trianglesBuffer) {
+    SH_GETCONTEXT(SH_NO_RETVAL);
+    if (p->vertexBuffer) glDeleteBuffers(1, &p->vertexBuffer);
+    if (p->strokeBuffer) glDeleteBuffers(1, &p->strokeBuffer);
+    if (p->trianglesBuffer) glDeleteBuffers(1, &p->trianglesBuffer);
+  }
 }
 
 /*-----------------------------------------------------
@@ -153,7 +170,7 @@ VG_API_CALL VGPath vgCreatePath(VGint pathFormat,
   /* Allocate new resource */
   SH_NEWOBJ(SHPath, p);
   VG_RETURN_ERR_IF(!p, VG_OUT_OF_MEMORY_ERROR, VG_INVALID_HANDLE);
-  shPathArrayPushBack(&context->paths, p);
+  shPathArrayPushBack(&context->share->paths, p);
   
   /* Set parameters */
   p->format = pathFormat;
@@ -168,6 +185,7 @@ VG_API_CALL VGPath vgCreatePath(VGint pathFormat,
   p->cacheDataValid = VG_TRUE;
   p->cacheTransformInit = VG_FALSE;
   p->cacheStrokeInit = VG_FALSE;
+  p->cacheTrianglesValid = VG_FALSE;
   
   VG_RETURN((VGPath)p);
 }
@@ -185,6 +203,8 @@ VG_API_CALL void vgClearPath(VGPath path, VGbitfield capabilities)
   VG_RETURN_ERR_IF(!shIsValidPath(context, path),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
+  SH_TRACE_BEGIN(context, "vgClearPath");
+  
   /* Clear raw data */
   p = (SHPath*)path;
   free(p->segs);
@@ -204,6 +224,7 @@ VG_API_CALL void vgClearPath(VGPath path, VGbitfield capabilities)
   /* Re-set capabilities */
   p->caps = capabilities & VG_PATH_CAPABILITY_ALL;
   
+  SH_TRACE_END(context, "vgClearPath");
   VG_RETURN(VG_NO_RETVAL);
 }
 
@@ -217,12 +238,13 @@ VG_API_CALL void vgDestroyPath(VGPath path)
   VG_GETCONTEXT(VG_NO_RETVAL);
   
   /* Check if handle valid */
-  index = shPathArrayFind(&context->paths, (SHPath*)path);
+  index = shPathArrayFind(&context->share->paths, (SHPath*)path);
   VG_RETURN_ERR_IF(index == -1, VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
   
   /* Delete object and remove resource */
   SH_DELETEOBJ(SHPath, (SHPath*)path);
-  shPathArrayRemoveAt(&context->paths, index);
+  shPathArrayRemoveAt(&context->share->paths, index);
+  context->share->objectGeneration++;
   
   VG_RETURN_ERR(VG_NO_ERROR, VG_NO_RETVAL);
 }
@@ -379,6 +401,8 @@ VG_API_CALL void vgAppendPath(VGPath dstPath, VGPath srcPath)
   shResizePathData(dst, src->segCount, src->dataCount, &newSegs, &newData);
   VG_RETURN_ERR_IF(!newData, VG_OUT_OF_MEMORY_ERROR, VG_NO_RETVAL);
   
+  SH_TRACE_BEGIN(context, "vgAppendPath");
+  
   /* Copy new segments */
   memcpy(newSegs+dst->segCount, src->segs, src->segCount);
   
@@ -405,6 +429,7 @@ VG_API_CALL void vgAppendPath(VGPath dstPath, VGPath srcPath)
   /* Mark change */
   dst->cacheDataValid = VG_FALSE;
   
+  SH_TRACE_END(context, "vgAppendPath");
   VG_RETURN(VG_NO_RETVAL);
 }
 
@@ -448,6 +473,8 @@ VG_API_CALL void vgAppendPathData(VGPath dstPath, VGint newSegCount,
   shResizePathData(dst, newSegCount, newDataCount, &newSegs, &newData);
   VG_RETURN_ERR_IF(!newData, VG_OUT_OF_MEMORY_ERROR, VG_NO_RETVAL);
   
+  SH_TRACE_BEGIN(context, "vgAppendPathData");
+  
   /* Copy new segments */
   memcpy(newSegs+dst->segCount, segs, newSegCount);
   
@@ -473,6 +500,7 @@ VG_API_CALL void vgAppendPathData(VGPath dstPath, VGint newSegCount,
   /* Mark change */
   dst->cacheDataValid = VG_FALSE;
   
+  SH_TRACE_END(context, "vgAppendPathData");
   VG_RETURN(VG_NO_RETVAL);
 }
 
@@ -504,6 +532,8 @@ VG_API_CALL void vgModifyPathCoords(VGPath dstPath, VGint startIndex,
   
   /* TODO: check data array alignment */
   
+  SH_TRACE_BEGIN(context, "vgModifyPathCoords");
+  
   /* Find start of the coordinates to be changed */
   dataStartCount = shCoordCountForData(startIndex, p->segs);
   dataStartSize = dataStartCount * shBytesPerDatatype[p->datatype];
@@ -524,6 +554,7 @@ VG_API_CALL void vgModifyPathCoords(VGPath dstPath, VGint startIndex,
   /* Mark change */
   p->cacheDataValid = VG_FALSE;
   
+  SH_TRACE_END(context, "vgModifyPathCoords");
   VG_RETURN(VG_NO_RETVAL);
 }
 
@@ -978,7 +1009,7 @@ static void shTransformSegment(SHPath *p, VGPathSegment segment,
   SHMatrix3x3 *ctm;
   
   /* Get current transform matrix */
-  VG_GETCONTEXT(VG_NO_RETVAL);
+  SH_GETCONTEXT(SH_NO_RETVAL);
   ctm = &context->pathTransform;
   
   switch (segment) {
@@ -1143,6 +1174,8 @@ VG_API_CALL void vgTransformPath(VGPath dstPath, VGPath srcPath)
   shResizePathData(dst, newSegCount, newDataCount, &newSegs, &newData);
   VG_RETURN_ERR_IF(!newData, VG_OUT_OF_MEMORY_ERROR, VG_NO_RETVAL);
   
+  SH_TRACE_BEGIN(context, "vgTransformPath");
+  
   /* Transform src path into new data */
   segCount = dst->segCount;
   dataCount = dst->dataCount;
@@ -1164,6 +1197,7 @@ VG_API_CALL void vgTransformPath(VGPath dstPath, VGPath srcPath)
   /* Mark change */
   dst->cacheDataValid = VG_FALSE;
   
+  SH_TRACE_END(context, "vgTransformPath");
   VG_RETURN_ERR(VG_NO_ERROR, VG_NO_RETVAL);
 }
 
@@ -1219,6 +1253,8 @@ VG_API_CALL VGboolean vgInterpolatePath(VGPath dstPath, VGPath startPath,
   VG_RETURN_ERR_IF(start->segCount != end->segCount,
                    VG_NO_ERROR, VG_FALSE);
   
+  SH_TRACE_BEGIN(context, "vgInterpolatePath");
+  
   /* Allocate storage for processed path data */
   shProcessedDataCount(start, processFlags, &procSegCount1, &procDataCount1);
   shProcessedDataCount(end, processFlags, &procSegCount2, &procDataCount2);
@@ -1228,6 +1264,7 @@ VG_API_CALL VGboolean vgInterpolatePath(VGPath dstPath, VGPath startPath,
   procData2 = (SHfloat*)malloc(procDataCount2 * sizeof(SHfloat));
   if (!procSegs1 || !procSegs2 || !procData1 || !procData2) {
     free(procSegs1); free(procSegs2); free(procData1); free(procData2);
+    SH_TRACE_END(context, "vgInterpolatePath");
     VG_RETURN_ERR(VG_OUT_OF_MEMORY_ERROR, VG_FALSE);
   }
   
@@ -1250,6 +1287,7 @@ VG_API_CALL VGboolean vgInterpolatePath(VGPath dstPath, VGPath startPath,
   if (!newData) {
     free(procSegs1); free(procData1);
     free(procSegs2); free(procData2);
+    SH_TRACE_END(context, "vgInterpolatePath");
     VG_RETURN_ERR(VG_OUT_OF_MEMORY_ERROR, VG_FALSE);
   }
   
@@ -1274,6 +1312,7 @@ VG_API_CALL VGboolean vgInterpolatePath(VGPath dstPath, VGPath startPath,
       free(procSegs1); free(procData1);
       free(procSegs2); free(procData2);
       free(newSegs); free(newData);
+      SH_TRACE_END(context, "vgInterpolatePath");
       VG_RETURN_ERR(VG_NO_ERROR, VG_FALSE);
     }
     
@@ -1301,5 +1340,6 @@ VG_API_CALL VGboolean vgInterpolatePath(VGPath dstPath, VGPath startPath,
   /* Mark change */
   dst->cacheDataValid = VG_FALSE;
   
+  SH_TRACE_END(context, "vgInterpolatePath");
   VG_RETURN_ERR(VG_NO_ERROR, VG_TRUE);
 }
@@ -89,19 +89,35 @@ typedef struct SHPath
   /* Subdivision */
   SHVertexArray vertices;
   SHVector2 min, max;
+  VGboolean convex;
   
   /* Additional stroke geometry (dash vertices if
      path dashed or triangle vertices if width > 1 */
   SHVector2Array stroke;
+  
+  /* Non-overlapping fill triangles (see shTriangulate.c) */
+  SHVector2Array triangles;
+  
+  /* GL buffer objects holding the geometry above with
+     the bounding box quad appended (0 if not created) */
+  GLuint vertexBuffer;
+  GLuint strokeBuffer;
+  GLuint trianglesBuffer;
 
   /* Cache */
   VGboolean      cacheDataValid;
+  VGboolean      cacheVertexBufferValid;
+
+  VGboolean      cacheTrianglesValid;
+  VGFillRule     cacheTrianglesFillRule;
+  VGboolean      cacheTrianglesBufferValid;
 
   VGboolean      cacheTransformInit;
   SHMatrix3x3    cacheTransform;
 
   VGboolean      cacheStrokeInit;
   VGboolean      cacheStrokeTessValid;
+  VGboolean      cacheStrokeBufferValid;
   SHfloat        cacheStrokeLineWidth;
   VGCapStyle     cacheStrokeCapStyle;
   VGJoinStyle    cacheStrokeJoinStyle;
@@ -27,11 +27,14 @@
 #include "shImage.h"
 #include "shGeometry.h"
 #include "shPaint.h"
+#include "shTriangulate.h"
 
 void shPremultiplyFramebuffer()
 {
+  SH_GETCONTEXT(SH_NO_RETVAL);
+  
   /* Multiply target color with its own alpha */
-  glBlendFunc(GL_ZERO, GL_DST_ALPHA);
+  shGLBlendFunc(context, GL_ZERO, GL_DST_ALPHA);
 }
 
 void shUnpremultiplyFramebuffer()
@@ -45,57 +48,206 @@ void updateBlendingStateGL(VGContext *c, int alphaIsOne)
      as well as SRC is optimized by turning OpenGL
      blending off. In other cases its turned on. */
   
+  /* The mask scales the source alpha, so masked pixels
+     need blending like translucent ones. SRC is blended
+     like SRC_OVER, which is exact for opaque paints. */
+  if (c->maskActive) {
+    alphaIsOne = 0;
+    if (c->blendMode == VG_BLEND_SRC) {
+      shGLBlendFunc(c, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      shGLEnable(c, GL_BLEND);
+      return;
+    }
+  }
+  
   switch (c->blendMode)
   {
   case VG_BLEND_SRC:
-    glBlendFunc(GL_ONE, GL_ZERO);
-    glDisable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_ONE, GL_ZERO);
+    shGLDisable(c, GL_BLEND); break;
 
   case VG_BLEND_SRC_IN:
-    glBlendFunc(GL_DST_ALPHA, GL_ZERO);
-    glEnable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_DST_ALPHA, GL_ZERO);
+    shGLEnable(c, GL_BLEND); break;
 
   case VG_BLEND_DST_IN:
-    glBlendFunc(GL_ZERO, GL_SRC_ALPHA);
-    glEnable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_ZERO, GL_SRC_ALPHA);
+    shGLEnable(c, GL_BLEND); break;
     
   case VG_BLEND_SRC_OUT_SH:
-    glBlendFunc(GL_ONE_MINUS_DST_ALPHA, GL_ZERO);
-    glEnable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_ONE_MINUS_DST_ALPHA, GL_ZERO);
+    shGLEnable(c, GL_BLEND); break;
 
   case VG_BLEND_DST_OUT_SH:
-    glBlendFunc(GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    shGLEnable(c, GL_BLEND); break;
 
   case VG_BLEND_SRC_ATOP_SH:
-    glBlendFunc(GL_DST_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_DST_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    shGLEnable(c, GL_BLEND); break;
 
   case VG_BLEND_DST_ATOP_SH:
-    glBlendFunc(GL_ONE_MINUS_DST_ALPHA, GL_SRC_ALPHA);
-    glEnable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_ONE_MINUS_DST_ALPHA, GL_SRC_ALPHA);
+    shGLEnable(c, GL_BLEND); break;
 
   case VG_BLEND_DST_OVER:
-    glBlendFunc(GL_ONE_MINUS_DST_ALPHA, GL_DST_ALPHA);
-    glEnable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_ONE_MINUS_DST_ALPHA, GL_DST_ALPHA);
+    shGLEnable(c, GL_BLEND); break;
 
   case VG_BLEND_SRC_OVER: default:
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    if (alphaIsOne) glDisable(GL_BLEND);
-    else glEnable(GL_BLEND); break;
+    shGLBlendFunc(c, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (alphaIsOne) shGLDisable(c, GL_BLEND);
+    else shGLEnable(c, GL_BLEND); break;
   };
 }
 
+/*-----------------------------------------------------------
+ * Computes the corners of a quad that covers the bounding
+ * box of a path, enlarged to fit the stroke if needed
+ *-----------------------------------------------------------*/
+
+static void shFindBoundBoxQuad(VGContext *c, SHPath *p, VGPaintMode mode,
+                               SHVector2 *quad)
+{
+  SHfloat K = 1.0f;
+  if (mode == VG_STROKE_PATH)
+    K = SH_CEIL(c->strokeMiterLimit * c->strokeLineWidth) + 1.0f;
+  
+  /* We want to be sure to cover every pixel of this path so better
+     take a pixel more than leave some out (multisampling is tricky). */
+  SET2(quad[0], p->min.x-K, p->min.y-K);
+  SET2(quad[1], p->max.x+K, p->min.y-K);
+  SET2(quad[2], p->max.x+K, p->max.y+K);
+  SET2(quad[3], p->min.x-K, p->max.y+K);
+}
+
+/*-----------------------------------------------------------
+ * Uploads an array of vertices followed by the bounding box
+ * quad into the given GL buffer object, creating it first
+ * if it doesn't exist yet.
+ *-----------------------------------------------------------*/
+
+static void shUploadBuffer(VGContext *context, GLuint *buffer,
+                           const void *items, SHint size, SHint stride,
+                           SHVector2 *quad, GLenum usage)
+{
+  SH_TRACE_BEGIN(context, "upload");
+  
+  if (*buffer == 0)
+    glGenBuffers(1, buffer);
+  
+  glBindBuffer(GL_ARRAY_BUFFER, *buffer);
+  glBufferData(GL_ARRAY_BUFFER, size * stride + 4 * sizeof(SHVector2),
+               NULL, usage);
+  
+  if (size > 0)
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size * stride, items);
+  
+  glBufferSubData(GL_ARRAY_BUFFER, size * stride,
+                  4 * sizeof(SHVector2), quad);
+  
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  
+  SH_TRACE_END(context, "upload");
+}
+
+void shUpdateVertexBuffer(VGContext *c, SHPath *p)
+{
+  SHVector2 quad[4];
+  
+  if (!c->isGLAvailable_VertexBufferObject ||
+      p->cacheVertexBufferValid == VG_TRUE)
+    return;
+  
+  shFindBoundBoxQuad(c, p, VG_FILL_PATH, quad);
+  shUploadBuffer(c, &p->vertexBuffer, p->vertices.items, p->vertices.size,
+                 sizeof(SHVertex), quad, GL_STATIC_DRAW);
+  p->cacheVertexBufferValid = VG_TRUE;
+}
+
+void shUpdateStrokeBuffer(VGContext *c, SHPath *p)
+{
+  SHVector2 quad[4];
+  
+  if (!c->isGLAvailable_VertexBufferObject ||
+      p->cacheStrokeBufferValid == VG_TRUE)
+    return;
+  
+  /* Dashed strokes get regenerated on every draw */
+  shFindBoundBoxQuad(c, p, VG_STROKE_PATH, quad);
+  shUploadBuffer(c, &p->strokeBuffer, p->stroke.items, p->stroke.size,
+                 sizeof(SHVector2), quad, c->strokeDashPattern.size > 0 ?
+                 GL_STREAM_DRAW : GL_STATIC_DRAW);
+  p->cacheStrokeBufferValid = VG_TRUE;
+}
+
+void shUpdateTrianglesBuffer(VGContext *c, SHPath *p)
+{
+  SHVector2 quad[4];
+  
+  if (!c->isGLAvailable_VertexBufferObject ||
+      p->cacheTrianglesBufferValid == VG_TRUE)
+    return;
+  
+  shFindBoundBoxQuad(c, p, VG_FILL_PATH, quad);
+  shUploadBuffer(c, &p->trianglesBuffer, p->triangles.items,
+                 p->triangles.size, sizeof(SHVector2), quad, GL_STATIC_DRAW);
+  p->cacheTrianglesBufferValid = VG_TRUE;
+}
+
+/*-----------------------------------------------------------
+ * Sets the vertex pointer to either the given GL buffer
+ * object at the given offset or the client-side array.
+ *-----------------------------------------------------------*/
+
+static void shBindVertexPointer(VGContext *context, GLuint buffer,
+                                const void *items, SHint offset,
+                                SHint stride)
+{
+  glEnableClientState(GL_VERTEX_ARRAY);
+  
+  if (context->isGLAvailable_VertexBufferObject) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glVertexPointer(2, GL_FLOAT, stride, (const GLvoid*)(size_t)offset);
+  }else{
+    glVertexPointer(2, GL_FLOAT, stride, items);
+  }
+}
+
+static void shUnbindVertexPointer(VGContext *context)
+{
+  if (context->isGLAvailable_VertexBufferObject)
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  
+  glDisableClientState(GL_VERTEX_ARRAY);
+}
+
 /*-----------------------------------------------------------
  * Draws the triangles representing the stroke of a path.
  *-----------------------------------------------------------*/
 
 static void shDrawStroke(SHPath *p)
 {
-  glEnableClientState(GL_VERTEX_ARRAY);
-  glVertexPointer(2, GL_FLOAT, 0, p->stroke.items);
+  SH_GETCONTEXT(SH_NO_RETVAL);
+  
+  shBindVertexPointer(context, p->strokeBuffer, p->stroke.items, 0, 0);
   glDrawArrays(GL_TRIANGLES, 0, p->stroke.size);
-  glDisableClientState(GL_VERTEX_ARRAY);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  shUnbindVertexPointer(context);
+}
+
+/*-----------------------------------------------------------
+ * Draws the triangulation of a filled path.
+ *-----------------------------------------------------------*/
+
+static void shDrawTriangles(SHPath *p)
+{
+  SH_GETCONTEXT(SH_NO_RETVAL);
+  
+  shBindVertexPointer(context, p->trianglesBuffer, p->triangles.items, 0, 0);
+  glDrawArrays(GL_TRIANGLES, 0, p->triangles.size);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  shUnbindVertexPointer(context);
 }
 
 /*-----------------------------------------------------------
@@ -107,19 +259,98 @@ static void shDrawVertices(SHPath *p, GLenum mode)
 {
   int start = 0;
   int size = 0;
+  SH_GETCONTEXT(SH_NO_RETVAL);
   
   /* We separate vertex arrays by contours to properly
      handle the fill modes */
-  glEnableClientState(GL_VERTEX_ARRAY);
-  glVertexPointer(2, GL_FLOAT, sizeof(SHVertex), p->vertices.items);
+  shBindVertexPointer(context, p->vertexBuffer, p->vertices.items,
+                      0, sizeof(SHVertex));
   
   while (start < p->vertices.size) {
     size = p->vertices.items[start].flags;
     glDrawArrays(mode, start, size);
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
     start += size;
   }
   
-  glDisableClientState(GL_VERTEX_ARRAY);
+  shUnbindVertexPointer(context);
+}
+
+/*-----------------------------------------------------------
+ * Counts the winding number of the geometry drawn by the
+ * given function into the stencil buffer. Front-facing
+ * triangles increment and back-facing ones decrement the
+ * value, so it ends up different from the value returned by
+ * shNonZeroBase wherever the path is filled.
+ *-----------------------------------------------------------*/
+
+typedef void (*SHDrawFunc) (void *userData);
+
+/* Stencil value the count starts from. Without wrapping
+   operations the passes saturate, so the count starts in the
+   middle of the 8-bit range where negative winding numbers
+   don't clamp at zero. */
+
+static GLint shNonZeroBase(VGContext *c)
+{
+  if (c->isGLAvailable_StencilWrap &&
+      (c->isGLAvailable_StencilOpSeparate ||
+       c->isGLAvailable_StencilTwoSide))
+    return 0;
+  
+  return 128;
+}
+
+static void shDrawNonZero(SHDrawFunc draw, void *userData)
+{
+  SH_GETCONTEXT(SH_NO_RETVAL);
+  
+  if (context->isGLAvailable_StencilWrap &&
+      context->isGLAvailable_StencilOpSeparate) {
+    
+    /* Both faces in a single pass */
+    context->pglStencilOpSeparate(GL_FRONT, GL_INCR_WRAP,
+                                  GL_INCR_WRAP, GL_INCR_WRAP);
+    context->pglStencilOpSeparate(GL_BACK, GL_DECR_WRAP,
+                                  GL_DECR_WRAP, GL_DECR_WRAP);
+    shGLStateInvalidateStencil(&context->glState);
+    draw(userData);
+    SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 1);
+    
+  }else if (context->isGLAvailable_StencilWrap &&
+             context->isGLAvailable_StencilTwoSide) {
+    
+    /* Both faces in a single pass (EXT_stencil_two_side) */
+    shGLEnable(context, GL_STENCIL_TEST_TWO_SIDE_EXT);
+    context->pglActiveStencilFace(GL_BACK);
+    glStencilFunc(GL_ALWAYS, 0, 0);
+    glStencilOp(GL_DECR_WRAP, GL_DECR_WRAP, GL_DECR_WRAP);
+    context->pglActiveStencilFace(GL_FRONT);
+    shGLStencilOp(context, GL_INCR_WRAP, GL_INCR_WRAP, GL_INCR_WRAP);
+    draw(userData);
+    SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 1);
+    shGLDisable(context, GL_STENCIL_TEST_TWO_SIDE_EXT);
+    
+  }else{
+    
+    /* Fall back to a pass per face with saturating operations,
+       counting from the base value (see shNonZeroBase) */
+    shGLEnable(context, GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    shGLStencilOp(context, GL_INCR, GL_INCR, GL_INCR);
+    draw(userData);
+    glCullFace(GL_FRONT);
+    shGLStencilOp(context, GL_DECR, GL_DECR, GL_DECR);
+    draw(userData);
+    SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 2);
+    glCullFace(GL_BACK);
+    shGLDisable(context, GL_CULL_FACE);
+  }
+}
+
+static void shDrawVerticesFan(void *userData)
+{
+  shDrawVertices((SHPath*)userData, GL_TRIANGLE_FAN);
 }
 
 /*-------------------------------------------------------------
@@ -128,54 +359,83 @@ static void shDrawVertices(SHPath *p, GLenum mode)
 
 static void shDrawBoundBox(VGContext *c, SHPath *p, VGPaintMode mode)
 {
-  SHfloat K = 1.0f;
-  if (mode == VG_STROKE_PATH)
-    K = SH_CEIL(c->strokeMiterLimit * c->strokeLineWidth) + 1.0f;
+  SHVector2 quad[4];
+  
+  if (c->isGLAvailable_VertexBufferObject) {
+    
+    /* The quad is stored behind the geometry */
+    if (mode == VG_STROKE_PATH)
+      shBindVertexPointer(c, p->strokeBuffer, NULL,
+                          p->stroke.size * sizeof(SHVector2), 0);
+    else
+      shBindVertexPointer(c, p->vertexBuffer, NULL,
+                          p->vertices.size * sizeof(SHVertex), 0);
+    
+    glDrawArrays(GL_QUADS, 0, 4);
+    SH_COUNT(c, VG_STAT_DRAW_CALLS_SH, 1);
+    shUnbindVertexPointer(c);
+    
+  }else{
+    
+    shFindBoundBoxQuad(c, p, mode, quad);
+    glBegin(GL_QUADS);
+    glVertex2fv((GLfloat*)&quad[0]);
+    glVertex2fv((GLfloat*)&quad[1]);
+    glVertex2fv((GLfloat*)&quad[2]);
+    glVertex2fv((GLfloat*)&quad[3]);
+    glEnd();
+    SH_COUNT(c, VG_STAT_DRAW_CALLS_SH, 1);
+  }
+}
+
+/*--------------------------------------------------------------
+ * Covers the bounding box with a gradient evaluated per pixel
+ * by a shader. Returns 0 if the mesh has to be built instead.
+ *--------------------------------------------------------------*/
+
+static int shDrawGradientCover(VGContext *c, SHPath *path, SHPaint *p,
+                               VGPaintMode mode, GLenum texUnit)
+{
+  if (!shSetGradientShaderState(p, mode, texUnit))
+    return 0;
   
-  glBegin(GL_QUADS);
-  glVertex2f(p->min.x-K, p->min.y-K);
-  glVertex2f(p->max.x+K, p->min.y-K);
-  glVertex2f(p->max.x+K, p->max.y+K);
-  glVertex2f(p->min.x-K, p->max.y+K);
-  glEnd();
+  shDrawBoundBox(c, path, mode);
+  shGLUseProgram(c, 0);
+  return 1;
 }
 
 /*--------------------------------------------------------------
  * Constructs & draws colored OpenGL primitives that cover the
- * given bounding box to represent the currently selected
- * stroke or fill paint
+ * bounding box of the given path to represent the currently
+ * selected stroke or fill paint
  *--------------------------------------------------------------*/
 
-static void shDrawPaintMesh(VGContext *c, SHVector2 *min, SHVector2 *max,
+static void shDrawPaintMesh(VGContext *c, SHPath *path,
                             VGPaintMode mode, GLenum texUnit)
 {
   SHPaint *p;
-  SHVector2 pmin, pmax;
-  SHfloat K = 1.0f;
+  SHVector2 *min = &path->min;
+  SHVector2 *max = &path->max;
   
   /* Pick the right paint */
   if (mode == VG_FILL_PATH) {
     p = (c->fillPaint ? c->fillPaint : &c->defaultPaint);
-  }else if (mode == VG_STROKE_PATH) {
+  }else{
     p = (c->strokePaint ? c->strokePaint : &c->defaultPaint);
-    K = SH_CEIL(c->strokeMiterLimit * c->strokeLineWidth) + 1.0f;
   }
-  
-  /* We want to be sure to cover every pixel of this path so better
-     take a pixel more than leave some out (multisampling is tricky). */
-  SET2V(pmin, (*min)); SUB2(pmin, K,K);
-  SET2V(pmax, (*max)); ADD2(pmax, K,K);
 
   /* Construct appropriate OpenGL primitives so as
      to fill the stencil mask with select paint */
 
   switch (p->type) {
   case VG_PAINT_TYPE_LINEAR_GRADIENT:
-    shDrawLinearGradientMesh(p, min, max, mode, texUnit);
+    if (!shDrawGradientCover(c, path, p, mode, texUnit))
+      shDrawLinearGradientMesh(p, min, max, mode, texUnit);
     break;
 
   case VG_PAINT_TYPE_RADIAL_GRADIENT:
-    shDrawRadialGradientMesh(p, min, max, mode, texUnit);
+    if (!shDrawGradientCover(c, path, p, mode, texUnit))
+      shDrawRadialGradientMesh(p, min, max, mode, texUnit);
     break;
     
   case VG_PAINT_TYPE_PATTERN:
@@ -186,12 +446,7 @@ static void shDrawPaintMesh(VGContext *c, SHVector2 *min, SHVector2 *max,
   
   case VG_PAINT_TYPE_COLOR:
     glColor4fv((GLfloat*)&p->color);
-    glBegin(GL_QUADS);
-    glVertex2f(pmin.x, pmin.y);
-    glVertex2f(pmax.x, pmin.y);
-    glVertex2f(pmax.x, pmax.y);
-    glVertex2f(pmin.x, pmax.y);
-    glEnd();
+    shDrawBoundBox(c, path, mode);
     break;
   }
 }
@@ -231,6 +486,30 @@ VGboolean shIsTessCacheValid (VGContext *c, SHPath *p)
     p->cacheTransformInit = VG_TRUE;
     p->cacheTransform = c->pathTransform;
     p->cacheStrokeTessValid = VG_FALSE;
+    p->cacheTrianglesValid = VG_FALSE;
+    p->cacheVertexBufferValid = VG_FALSE;
+  }
+  
+  return valid;
+}
+
+VGboolean shIsTrianglesCacheValid (VGContext *c, SHPath *p)
+{
+  VGboolean valid = VG_TRUE;
+  
+  if (p->cacheTrianglesValid == VG_FALSE) {
+    valid = VG_FALSE;
+  }
+  else if (p->cacheTrianglesFillRule != c->fillRule) {
+    valid = VG_FALSE;
+  }
+  
+  if (valid == VG_FALSE)
+  {
+    /* Update cache */
+    p->cacheTrianglesValid = VG_TRUE;
+    p->cacheTrianglesFillRule = c->fillRule;
+    p->cacheTrianglesBufferValid = VG_FALSE;
   }
   
   return valid;
@@ -265,227 +544,867 @@ VGboolean shIsStrokeCacheValid (VGContext *c, SHPath *p)
     p->cacheStrokeCapStyle   = c->strokeCapStyle;
     p->cacheStrokeJoinStyle  = c->strokeJoinStyle;
     p->cacheStrokeMiterLimit = c->strokeMiterLimit;
+    p->cacheStrokeBufferValid = VG_FALSE;
   }
 
   return valid;
 }
 
 /*-----------------------------------------------------------
- * Tessellates / strokes the path and draws it according to
- * VGContext state.
+ * Draw batching: consecutive fills of non-overlapping paths
+ * with the same solid color are collected in surface space
+ * and share a single stencil clear, fill and cover pass.
+ * Blend mode, fill rule and scissoring changes flush the
+ * batch before they take effect.
  *-----------------------------------------------------------*/
 
-VG_API_CALL void vgDrawPath(VGPath path, VGbitfield paintModes)
+#define SH_BATCH_MAX_DRAWS 256
+
+static void shDrawBatchTriangles(void *userData)
 {
-  SHPath *p;
-  SHMatrix3x3 mi;
-  SHfloat mgl[16];
-  SHPaint *fill, *stroke;
-  SHRectangle *rect;
+  VGContext *c = (VGContext*)userData;
+  glDrawArrays(GL_TRIANGLES, 0, c->batchTriangles.size);
+  SH_COUNT(c, VG_STAT_DRAW_CALLS_SH, 1);
+}
+
+void shGLFlushBatch(VGContext *context)
+{
+  SHint offset;
+  SHint bytes;
+  GLint base;
   
-  VG_GETCONTEXT(VG_NO_RETVAL);
+  if (context->batchDraws == 0)
+    return;
   
-  VG_RETURN_ERR_IF(!shIsValidPath(context, path),
-                   VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+  offset = context->batchTriangles.size * sizeof(SHVector2);
+  bytes = offset + context->batchQuads.size * sizeof(SHVector2);
   
-  VG_RETURN_ERR_IF(paintModes & (~(VG_STROKE_PATH | VG_FILL_PATH)),
-                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  /* Batches are only collected with scissoring off */
+  shBeginScissoring(context, NULL);
+  
+  /* Geometry is in surface space already */
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+  shGLEnable(context, GL_MULTISAMPLE);
+  
+  if (context->isGLAvailable_VertexBufferObject) {
+    SH_TRACE_BEGIN(context, "upload");
+    if (context->batchBuffer == 0)
+      glGenBuffers(1, &context->batchBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, context->batchBuffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, offset,
+                    context->batchTriangles.items);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, bytes - offset,
+                    context->batchQuads.items);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    SH_TRACE_END(context, "upload");
+  }
+  
+  /* Clear the stencil below every path */
+  SH_TRACE_BEGIN(context, "stencil");
+  base = (context->fillRule == VG_NON_ZERO ? shNonZeroBase(context) : 0);
+  shGLEnable(context, GL_STENCIL_TEST);
+  shGLStencilFunc(context, GL_ALWAYS, base, 0);
+  shGLStencilOp(context, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+  shGLColorMask(context, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  shBindVertexPointer(context, context->batchBuffer,
+                      context->batchQuads.items, offset, 0);
+  glDrawArrays(GL_QUADS, 0, context->batchQuads.size);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  
+  /* Tesselate all paths into stencil */
+  shBindVertexPointer(context, context->batchBuffer,
+                      context->batchTriangles.items, 0, 0);
+  if (context->fillRule == VG_NON_ZERO) {
+    shDrawNonZero(shDrawBatchTriangles, context);
+  }else{
+    shGLStencilOp(context, GL_INVERT, GL_INVERT, GL_INVERT);
+    shDrawBatchTriangles(context);
+    SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 1);
+  }
+  SH_TRACE_END(context, "stencil");
+  
+  /* Cover all paths with the shared color */
+  SH_TRACE_BEGIN(context, "cover");
+  updateBlendingStateGL(context, context->batchColor.a == 1.0f);
+  if (context->fillRule == VG_NON_ZERO) shGLStencilFunc(context, GL_NOTEQUAL, base, ~0);
+  else shGLStencilFunc(context, GL_EQUAL, 1, 1);
+  shGLStencilOp(context, GL_ZERO, GL_ZERO, GL_ZERO);
+  shGLColorMask(context, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glColor4fv((GLfloat*)&context->batchColor);
+  shBindVertexPointer(context, context->batchBuffer,
+                      context->batchQuads.items, offset, 0);
+  glDrawArrays(GL_QUADS, 0, context->batchQuads.size);
+  SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  shUnbindVertexPointer(context);
+  SH_TRACE_END(context, "cover");
+  
+  /* Reset state */
+  shGLDisable(context, GL_STENCIL_TEST);
+  shGLDisable(context, GL_BLEND);
+  shGLDisable(context, GL_MULTISAMPLE);
+  glPopMatrix();
+  
+  SH_COUNT(context, VG_STAT_PATHS_DRAWN_SH, context->batchDraws);
+  shVector2ArrayClear(&context->batchTriangles);
+  shVector2ArrayClear(&context->batchQuads);
+  context->batchDraws = 0;
+}
 
-  /* Check whether scissoring is enabled and scissor
-     rectangle is valid */
-  if (context->scissoring == VG_TRUE) {
-    rect = &context->scissor.items[0];
-    if (context->scissor.size == 0) VG_RETURN( VG_NO_RETVAL );
-    if (rect->w <= 0.0f || rect->h <= 0.0f) VG_RETURN( VG_NO_RETVAL );
-    glScissor( (GLint)rect->x, (GLint)rect->y, (GLint)rect->w, (GLint)rect->h );
-    glEnable( GL_SCISSOR_TEST );
+int shIsBatchable(VGContext *c, SHPaint *fill, VGbitfield paintModes)
+{
+  return (c->drawBatching == VG_TRUE &&
+          paintModes == VG_FILL_PATH &&
+          c->scissoring == VG_FALSE &&
+          (c->masking == VG_FALSE || c->maskData == NULL) &&
+          c->fillTriangulation == VG_FALSE &&
+          (fill->type == VG_PAINT_TYPE_COLOR ||
+           (fill->type == VG_PAINT_TYPE_PATTERN &&
+            fill->pattern == VG_INVALID_HANDLE)));
+}
+
+void shAddToBatch(VGContext *c, SHPath *p, SHPaint *fill)
+{
+  SHVector2 corners[4];
+  SHVector2 min, max, v0, v;
+  SHint i, j, start, size;
+  SHVector2 *q;
+  
+  /* Find path bounds in surface space */
+  SET2(corners[0], p->min.x, p->min.y);
+  SET2(corners[1], p->max.x, p->min.y);
+  SET2(corners[2], p->max.x, p->max.y);
+  SET2(corners[3], p->min.x, p->max.y);
+  for (i=0; i<4; ++i)
+    TRANSFORM2(corners[i], c->pathTransform);
+  
+  min = max = corners[0];
+  for (i=1; i<4; ++i) {
+    min.x = SH_MIN(min.x, corners[i].x);
+    min.y = SH_MIN(min.y, corners[i].y);
+    max.x = SH_MAX(max.x, corners[i].x);
+    max.y = SH_MAX(max.y, corners[i].y);
   }
   
-  p = (SHPath*)path;
+  /* Paths sharing a stencil pass must not overlap and
+     must be covered with the same color */
+  if (c->batchDraws > 0) {
+    
+    if (c->batchDraws >= SH_BATCH_MAX_DRAWS ||
+        c->batchColor.r != fill->color.r ||
+        c->batchColor.g != fill->color.g ||
+        c->batchColor.b != fill->color.b ||
+        c->batchColor.a != fill->color.a) {
+      shFlushBatch(c);
+      
+    }else{
+      
+      /* Stored quads are one pixel larger than the path */
+      for (i=0; i<c->batchQuads.size; i+=4) {
+        q = &c->batchQuads.items[i];
+        if (min.x < q[2].x - 1.0f && max.x > q[0].x + 1.0f &&
+            min.y < q[2].y - 1.0f && max.y > q[0].y + 1.0f) {
+          shFlushBatch(c);
+          break;
+        }
+      }
+    }
+  }
+  
+  if (c->batchDraws == 0)
+    c->batchColor = fill->color;
+  
+  /* Split contour fans into separate triangles */
+  for (start=0; start < p->vertices.size; start += size) {
+    size = p->vertices.items[start].flags;
+    TRANSFORM2TO(p->vertices.items[start].point, c->pathTransform, v0);
+    
+    for (j=start+1; j+1 < start+size; ++j) {
+      shVector2ArrayPushBackP(&c->batchTriangles, &v0);
+      TRANSFORM2TO(p->vertices.items[j].point, c->pathTransform, v);
+      shVector2ArrayPushBackP(&c->batchTriangles, &v);
+      TRANSFORM2TO(p->vertices.items[j+1].point, c->pathTransform, v);
+      shVector2ArrayPushBackP(&c->batchTriangles, &v);
+    }
+  }
+  
+  /* Cover quad takes a pixel more like shDrawBoundBox */
+  SET2(v, min.x - 1.0f, min.y - 1.0f);
+  shVector2ArrayPushBackP(&c->batchQuads, &v);
+  SET2(v, max.x + 1.0f, min.y - 1.0f);
+  shVector2ArrayPushBackP(&c->batchQuads, &v);
+  SET2(v, max.x + 1.0f, max.y + 1.0f);
+  shVector2ArrayPushBackP(&c->batchQuads, &v);
+  SET2(v, min.x - 1.0f, max.y + 1.0f);
+  shVector2ArrayPushBackP(&c->batchQuads, &v);
+  
+  c->batchDraws++;
+}
+
+/*-----------------------------------------------------------
+ * Tessellates the path for the current path-user-to-surface
+ * matrix unless its cached vertices are still good for it.
+ *-----------------------------------------------------------*/
+
+static void shUpdatePathCache(VGContext *context, SHPath *p)
+{
+  SHMatrix3x3 mi;
   
   /* If user-to-surface matrix invertible tessellate in
      surface space for better path resolution */
   if (shIsTessCacheValid( context, p ) == VG_FALSE)
   {
+    SH_COUNT(context, VG_STAT_TESS_CACHE_MISSES_SH, 1);
     if (shInvertMatrix(&context->pathTransform, &mi)) {
+      SH_TRACE_BEGIN(context, "flatten");
       shFlattenPath(p, 1);
+      SH_TRACE_END(context, "flatten");
+      SH_TRACE_BEGIN(context, "transform");
       shTransformVertices(&mi, p);
-    }else shFlattenPath(p, 0);
+      SH_TRACE_END(context, "transform");
+    }else{
+      SH_TRACE_BEGIN(context, "flatten");
+      shFlattenPath(p, 0);
+      SH_TRACE_END(context, "flatten");
+    }
+    SH_TRACE_BEGIN(context, "bounds");
     shFindBoundbox(p);
+    shFindConvexity(p);
+    SH_TRACE_END(context, "bounds");
+  }else{
+    SH_COUNT(context, VG_STAT_TESS_CACHE_HITS_SH, 1);
   }
+}
+
+/*-----------------------------------------------------------
+ * Fill and stroke the cached geometry of a path with the
+ * given paint, in the user space set up by the caller.
+ *-----------------------------------------------------------*/
+
+static void shDrawPathFill(VGContext *context, SHPath *p, SHPaint *fill)
+{
+  SHint nonZero;
+  GLint base;
+  SHint direct;
   
-  /* TODO: Turn antialiasing on/off */
-  glDisable(GL_LINE_SMOOTH);
-  glDisable(GL_POLYGON_SMOOTH);
-  glEnable(GL_MULTISAMPLE);
+  /* Paths that have non-overlapping geometry of their
+     own can be drawn with the paint in a single pass */
+  direct = 0;
+  if (p->convex || context->fillTriangulation == VG_TRUE)
+    direct = shSetPaintTexGenGLState(fill, VG_FILL_PATH, GL_TEXTURE0);
+  
+  if (direct) {
+    
+    SH_TRACE_BEGIN(context, "cover");
+    updateBlendingStateGL(context,
+                          fill->type == VG_PAINT_TYPE_COLOR &&
+                          fill->color.a == 1.0f);
+    
+    if (p->convex) {
+      /* A single convex contour is covered exactly
+         once by its own triangle fan */
+      shDrawVertices(p, GL_TRIANGLE_FAN);
+    }else{
+      if (shIsTrianglesCacheValid( context, p ) == VG_FALSE)
+        shTriangulatePath(p, context->fillRule);
+      shUpdateTrianglesBuffer(context, p);
+      shDrawTriangles(p);
+    }
+    
+    /* Reset state */
+    shResetPaintTexGenGLState(fill, GL_TEXTURE0);
+    shGLDisable(context, GL_BLEND);
+    SH_TRACE_END(context, "cover");
+    
+  }else{
+  
+    /* A single convex contour covers every pixel at most once,
+       so even-odd parity works for it under either fill rule */
+    nonZero = (context->fillRule == VG_NON_ZERO && !p->convex);
+    base = (nonZero ? shNonZeroBase(context) : 0);
+    
+    /* Tesselate into stencil */
+    SH_TRACE_BEGIN(context, "stencil");
+    shGLEnable(context, GL_STENCIL_TEST);
+    /* Clear the stencil buffer first */
+    shGLStencilFunc(context, GL_ALWAYS, base, 0);
+    shGLStencilOp(context, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+    shGLColorMask(context, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    shDrawBoundBox(context, p, VG_FILL_PATH);
+  
+    shGLStencilFunc(context, GL_ALWAYS, 0, 0);
+    shGLColorMask(context, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    if (nonZero) {
+      shDrawNonZero(shDrawVerticesFan, p);
+    }else{
+      shGLStencilOp(context, GL_INVERT, GL_INVERT, GL_INVERT);
+      shDrawVertices(p, GL_TRIANGLE_FAN);
+      SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 1);
+    }
+    SH_TRACE_END(context, "stencil");
+  
+    /* Setup blending */
+    SH_TRACE_BEGIN(context, "cover");
+    updateBlendingStateGL(context,
+                          fill->type == VG_PAINT_TYPE_COLOR &&
+                          fill->color.a == 1.0f);
+  
+    /* Draw paint where stencil odd (or non-zero) */
+    if (nonZero) shGLStencilFunc(context, GL_NOTEQUAL, base, ~0);
+    else shGLStencilFunc(context, GL_EQUAL, 1, 1);
+    shGLStencilOp(context, GL_ZERO, GL_ZERO, GL_ZERO);
+    shGLColorMask(context, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    shDrawPaintMesh(context, p, VG_FILL_PATH, GL_TEXTURE0);
+
+    /* Reset state */
+    shGLColorMask(context, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    shGLDisable(context, GL_STENCIL_TEST);
+    shGLDisable(context, GL_BLEND);
+    SH_TRACE_END(context, "cover");
+  }
+}
+
+static void shUpdateStrokeCache(VGContext *context, SHPath *p)
+{
+  if (shIsStrokeCacheValid( context, p ) == VG_FALSE)
+  {
+    /* Generate stroke triangles in user space */
+    SH_COUNT(context, VG_STAT_STROKE_CACHE_MISSES_SH, 1);
+    SH_TRACE_BEGIN(context, "stroke");
+    shVector2ArrayClear(&p->stroke);
+    shStrokePath(context, p);
+    SH_TRACE_END(context, "stroke");
+  }else{
+    SH_COUNT(context, VG_STAT_STROKE_CACHE_HITS_SH, 1);
+  }
+}
+
+static void shDrawPathStroke(VGContext *context, SHPath *p, SHPaint *stroke)
+{
+  if (1) {/*context->strokeLineWidth > 1.0f) {*/
+
+    shUpdateStrokeBuffer(context, p);
+
+    /* Stroke into stencil */
+    SH_TRACE_BEGIN(context, "stencil");
+    shGLEnable(context, GL_STENCIL_TEST);
+    /* Clear the stencil buffer first */
+    shGLStencilFunc(context, GL_ALWAYS, 0, 0);
+    shGLStencilOp(context, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+    shGLColorMask(context, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    shDrawBoundBox(context, p, VG_STROKE_PATH);
+
+    shGLStencilFunc(context, GL_NOTEQUAL, 1, 1);
+    shGLStencilOp(context, GL_KEEP, GL_INCR, GL_INCR);
+    shGLColorMask(context, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    shDrawStroke(p);
+    SH_COUNT(context, VG_STAT_STENCIL_PASSES_SH, 1);
+    SH_TRACE_END(context, "stencil");
+
+    /* Setup blending */
+    SH_TRACE_BEGIN(context, "cover");
+    updateBlendingStateGL(context,
+                          stroke->type == VG_PAINT_TYPE_COLOR &&
+                          stroke->color.a == 1.0f);
+
+    /* Draw paint where stencil odd */
+    shGLStencilFunc(context, GL_EQUAL, 1, 1);
+    shGLStencilOp(context, GL_ZERO, GL_ZERO, GL_ZERO);
+    shGLColorMask(context, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    shDrawPaintMesh(context, p, VG_STROKE_PATH, GL_TEXTURE0);
+    
+    /* Reset state */
+    shGLColorMask(context, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    shGLDisable(context, GL_STENCIL_TEST);
+    shGLDisable(context, GL_BLEND);
+    SH_TRACE_END(context, "cover");
+    
+  }else{
+    
+    /* Simulate thin stroke by alpha */
+    SHColor c = stroke->color;
+    if (context->strokeLineWidth < 1.0f)
+      c.a *= context->strokeLineWidth;
+    
+    /* Draw contour as a line */
+    shGLDisable(context, GL_MULTISAMPLE);
+    shGLEnable(context, GL_BLEND);
+    shGLEnable(context, GL_LINE_SMOOTH);
+    shGLBlendFunc(context, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4fv((GLfloat*)&c);
+    shDrawVertices(p, GL_LINE_STRIP);
+    
+    shGLDisable(context, GL_BLEND);
+    shGLDisable(context, GL_LINE_SMOOTH);
+  }
+}
+
+/*-----------------------------------------------------------
+ * Draws the cached geometry of a path with OpenGL, joining
+ * the current batch if the fill is a plain one
+ *-----------------------------------------------------------*/
+
+void shGLDrawPath(VGContext *context, SHPath *p, VGbitfield paintModes,
+                  SHRectangle *bounds)
+{
+  SHfloat mgl[16];
+  SHPaint *fill, *stroke;
   
   /* Pick paint if available or default*/
   fill = (context->fillPaint ? context->fillPaint : &context->defaultPaint);
   stroke = (context->strokePaint ? context->strokePaint : &context->defaultPaint);
   
+  /* Draw pending batch first unless this path joins it */
+  if (shIsBatchable(context, fill, paintModes)) {
+    shAddToBatch(context, p, fill);
+    return;
+  }
+  
+  shGLFlushBatch(context);
+  
+  /* Skip paths entirely outside the scissor rectangles */
+  if (!shBeginScissoring(context, bounds)) {
+    SH_COUNT(context, VG_STAT_PATHS_CULLED_SH, 1);
+    return;
+  }
+  
+  SH_COUNT(context, VG_STAT_PATHS_DRAWN_SH, 1);
+  shBeginMasking(context);
+  
+  /* Keep the cached geometry on the GPU */
+  shUpdateVertexBuffer(context, p);
+  
+  /* TODO: Turn antialiasing on/off */
+  shGLDisable(context, GL_LINE_SMOOTH);
+  shGLDisable(context, GL_POLYGON_SMOOTH);
+  shGLEnable(context, GL_MULTISAMPLE);
+  
   /* Apply transformation */
   shMatrixToGL(&context->pathTransform, mgl);
   glMatrixMode(GL_MODELVIEW);
   glPushMatrix();
   glMultMatrixf(mgl);
   
-  if (paintModes & VG_FILL_PATH) {
-    
-    /* Tesselate into stencil */
-    glEnable(GL_STENCIL_TEST);
-    /* Clear the stencil buffer first */
-    glStencilFunc(GL_ALWAYS, 0, 0);
-    glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
-    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-    shDrawBoundBox(context, p, VG_FILL_PATH);
+  if (paintModes & VG_FILL_PATH)
+    shDrawPathFill(context, p, fill);
+  
+  /* TODO: Turn antialiasing on/off */
+  shGLDisable(context, GL_LINE_SMOOTH);
+  shGLDisable(context, GL_POLYGON_SMOOTH);
+  shGLEnable(context, GL_MULTISAMPLE);
+  
+  if ((paintModes & VG_STROKE_PATH) &&
+      context->strokeLineWidth > 0.0f)
+    shDrawPathStroke(context, p, stroke);
+  
+  shGLDisable(context, GL_MULTISAMPLE);
+  shEndMasking(context);
+  glPopMatrix();
+}
 
-    glStencilFunc(GL_ALWAYS, 0, 0);
-    glStencilOp(GL_INVERT, GL_INVERT, GL_INVERT);
-    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-    shDrawVertices(p, GL_TRIANGLE_FAN);
+/*-----------------------------------------------------------
+ * Tessellates / strokes the path and has the backend draw
+ * it according to VGContext state. The arguments have been
+ * checked by vgDrawPath or when the call was recorded into
+ * a command list.
+ *-----------------------------------------------------------*/
+
+void shDrawPath(VGContext *context, SHPath *p, VGbitfield paintModes)
+{
+  SHRectangle bounds, *drawBounds;
+  SHfloat pad;
+  
+  shUpdatePathCache(context, p);
+  
+  /* Surface-space bounds for culling and damage tracking */
+  drawBounds = NULL;
+  if (context->scissoring == VG_TRUE ||
+      context->damageTracking == VG_TRUE ||
+      context->redrawCulling == VG_TRUE) {
+    pad = 0.0f;
+    if ((paintModes & VG_STROKE_PATH) && context->strokeLineWidth > 0.0f)
+      pad = context->strokeLineWidth * 0.5f *
+        SH_MAX(context->strokeMiterLimit, 1.5f);
+    shTransformBounds(&context->pathTransform, &p->min, &p->max, pad, &bounds);
+    if (!shRecordDraw(context, &bounds)) {
+      SH_COUNT(context, VG_STAT_PATHS_CULLED_SH, 1);
+      SH_RETURN(SH_NO_RETVAL);
+    }
+    drawBounds = &bounds;
+  }
+  
+  if ((paintModes & VG_STROKE_PATH) &&
+      context->strokeLineWidth > 0.0f)
+    shUpdateStrokeCache(context, p);
+  
+  /* Backends count it as drawn once submitted, or
+     culled if the scissor rectangles leave nothing */
+  SH_TRACE_BEGIN(context, "submit");
+  context->backend->drawPath(context, p, paintModes, drawBounds);
+  SH_TRACE_END(context, "submit");
+  
+  SH_RETURN(SH_NO_RETVAL);
+}
+
+/*-----------------------------------------------------------
+ * Submits draws held back by the backend, e.g. the current
+ * batch of plain fills
+ *-----------------------------------------------------------*/
+
+void shFlushBatch(VGContext *context)
+{
+  SH_TRACE_BEGIN(context, "submit");
+  context->backend->flush(context);
+  SH_TRACE_END(context, "submit");
+}
+
+VG_API_CALL void vgDrawPath(VGPath path, VGbitfield paintModes)
+{
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(!shIsValidPath(context, path),
+                   VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(paintModes & (~(VG_STROKE_PATH | VG_FILL_PATH)),
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  if (context->recordList)
+    shRecordPathCommand(context, (SHPath*)path, paintModes);
+  
+  SH_TRACE_BEGIN(context, "vgDrawPath");
+  shDrawPath(context, (SHPath*)path, paintModes);
+  SH_TRACE_END(context, "vgDrawPath");
+  
+  VG_RETURN(VG_NO_RETVAL);
+}
+
+/*-----------------------------------------------------------
+ * Instanced drawing: the path is tessellated once, at the
+ * resolution needed by the instance drawn largest, and each
+ * instance matrix is applied on top of the path-user-to-
+ * surface matrix. Fills with a solid color, or with a color
+ * per instance, are drawn by a single instanced call taking
+ * the matrices and colors from vertex attributes. Other
+ * paints, strokes and OpenGL without instanced arrays draw
+ * the cached geometry once per instance.
+ *-----------------------------------------------------------*/
+
+/* Two matrix rows and a color */
+#define SH_INSTANCE_FLOATS 10
+
+static void shInstanceMatrix(SHMatrix3x3 *view, const VGfloat *mm,
+                             SHMatrix3x3 *out)
+{
+  SHMatrix3x3 m;
+  
+  SETMAT(m,
+         mm[0], mm[3], mm[6],
+         mm[1], mm[4], mm[7],
+         0.0f,  0.0f,  1.0f);
+  
+  MULMATMAT((*view), m, (*out));
+}
+
+static SHfloat shMatrixScale(SHMatrix3x3 *m)
+{
+  SHVector2 X, Y;
+  SET2(X, m->m[0][0], m->m[1][0]);
+  SET2(Y, m->m[0][1], m->m[1][1]);
+  return SH_MAX(NORM2(X), NORM2(Y));
+}
+
+static void shPushInstance(VGContext *c, SHMatrix3x3 *m, SHColor *color)
+{
+  shFloatArrayPushBack(&c->instanceData, m->m[0][0]);
+  shFloatArrayPushBack(&c->instanceData, m->m[0][1]);
+  shFloatArrayPushBack(&c->instanceData, m->m[0][2]);
+  shFloatArrayPushBack(&c->instanceData, m->m[1][0]);
+  shFloatArrayPushBack(&c->instanceData, m->m[1][1]);
+  shFloatArrayPushBack(&c->instanceData, m->m[1][2]);
+  shFloatArrayPushBack(&c->instanceData, color->r);
+  shFloatArrayPushBack(&c->instanceData, color->g);
+  shFloatArrayPushBack(&c->instanceData, color->b);
+  shFloatArrayPushBack(&c->instanceData, color->a);
+}
+
+static void shBindInstanceAttrib(VGContext *context, GLint attrib,
+                                 SHint size, SHint offset)
+{
+  glVertexAttribPointer(attrib, size, GL_FLOAT, GL_FALSE,
+                        SH_INSTANCE_FLOATS * sizeof(SHfloat),
+                        (const GLvoid*)(size_t)(offset * sizeof(SHfloat)));
+  glEnableVertexAttribArray(attrib);
+  context->pglVertexAttribDivisor(attrib, 1);
+}
+
+static void shUnbindInstanceAttrib(VGContext *context, GLint attrib)
+{
+  context->pglVertexAttribDivisor(attrib, 0);
+  glDisableVertexAttribArray(attrib);
+}
+
+static void shDrawInstances(VGContext *context, SHPath *p, SHint alphaIsOne)
+{
+  SHInstanceProgram *g;
+  SHint count = context->instanceData.size / SH_INSTANCE_FLOATS;
+  
+  g = (context->maskActive ? &context->instanceMaskProgram
+       : &context->instanceProgram);
+  
+  if (context->instanceBuffer == 0)
+    glGenBuffers(1, &context->instanceBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, context->instanceBuffer);
+  glBufferData(GL_ARRAY_BUFFER, context->instanceData.size * sizeof(SHfloat),
+               context->instanceData.items, GL_STREAM_DRAW);
+  shBindInstanceAttrib(context, g->instanceX, 3, 0);
+  shBindInstanceAttrib(context, g->instanceY, 3, 3);
+  shBindInstanceAttrib(context, g->instanceColor, 4, 6);
+  
+  shGLUseProgram(context, g->program);
+  if (context->maskActive) {
+    glUniform1i(g->mask, SH_MASK_TEXTURE_UNIT - GL_TEXTURE0);
+    glUniform2f(g->maskScale, 1.0f / context->maskTexWidth,
+                1.0f / context->maskTexHeight);
+  }
+  updateBlendingStateGL(context, alphaIsOne);
+  
+  /* The matrices map to surface space already */
+  glMatrixMode(GL_MODELVIEW);
+  glPushMatrix();
+  glLoadIdentity();
+  
+  if (p->convex) {
+    shBindVertexPointer(context, p->vertexBuffer, p->vertices.items,
+                        0, sizeof(SHVertex));
+    context->pglDrawArraysInstanced(GL_TRIANGLE_FAN, 0,
+                                    p->vertices.size, count);
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  }else{
+    shUpdateTrianglesBuffer(context, p);
+    shBindVertexPointer(context, p->trianglesBuffer, p->triangles.items,
+                        0, 0);
+    context->pglDrawArraysInstanced(GL_TRIANGLES, 0,
+                                    p->triangles.size, count);
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
+  }
+  
+  shUnbindVertexPointer(context);
+  shUnbindInstanceAttrib(context, g->instanceX);
+  shUnbindInstanceAttrib(context, g->instanceY);
+  shUnbindInstanceAttrib(context, g->instanceColor);
+  shGLUseProgram(context, 0);
+  shGLDisable(context, GL_BLEND);
+  glPopMatrix();
+}
+
+VG_API_CALL void vgDrawPathInstancedSH(VGPath path, VGbitfield paintModes,
+                                       VGint count, const VGfloat *matrices,
+                                       const VGfloat *colors)
+{
+  SHPath *p;
+  SHPaint *fill, *stroke, *oldFill;
+  SHMatrix3x3 view, m;
+  SHRectangle bounds;
+  SHColor color;
+  SHfloat mgl[16];
+  SHfloat scale, maxScale, pad;
+  SHint i, largest, cull, instanced, alphaIsOne;
+  
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(!shIsValidPath(context, path),
+                   VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(paintModes & (~(VG_STROKE_PATH | VG_FILL_PATH)),
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(count < 0 || (count > 0 && matrices == NULL),
+                   VG_ILLEGAL_ARGUMENT_ERROR, VG_NO_RETVAL);
+  
+  if (count == 0 || paintModes == 0)
+    VG_RETURN(VG_NO_RETVAL);
+  
+  p = (SHPath*)path;
+  fill = (context->fillPaint ? context->fillPaint : &context->defaultPaint);
+  stroke = (context->strokePaint ? context->strokePaint : &context->defaultPaint);
+  
+  view = context->pathTransform;
+  
+  /* Without the legacy OpenGL pipeline the instances
+     are drawn one by one */
+  if (context->backend != &shGLBackend) {
     
-    /* Setup blending */
-    updateBlendingStateGL(context,
-                          fill->type == VG_PAINT_TYPE_COLOR &&
-                          fill->color.a == 1.0f);
+    oldFill = context->fillPaint;
+    if (colors) {
+      context->instancePaint.type = VG_PAINT_TYPE_COLOR;
+      context->fillPaint = &context->instancePaint;
+    }
     
-    /* Draw paint where stencil odd */
-    glStencilFunc(GL_EQUAL, 1, 1);
-    glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    shDrawPaintMesh(context, &p->min, &p->max, VG_FILL_PATH, GL_TEXTURE0);
-
-    /* Reset state */
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_BLEND);
+    for (i=0; i<count; ++i) {
+      if (colors) CSET(context->instancePaint.color, colors[4*i+0],
+                       colors[4*i+1], colors[4*i+2], colors[4*i+3]);
+      shInstanceMatrix(&view, matrices + 9*i, &context->pathTransform);
+      shDrawPath(context, p, paintModes);
+    }
+    
+    context->pathTransform = view;
+    context->fillPaint = oldFill;
+    VG_RETURN(VG_NO_RETVAL);
   }
   
+  shFlushBatch(context);
+  
+  /* Tessellate for the instance drawn at the largest scale */
+  largest = 0; maxScale = 0.0f;
+  for (i=0; i<count; ++i) {
+    shInstanceMatrix(&view, matrices + 9*i, &m);
+    scale = shMatrixScale(&m);
+    if (scale > maxScale) { maxScale = scale; largest = i; }
+  }
+  
+  shInstanceMatrix(&view, matrices + 9*largest, &context->pathTransform);
+  shUpdatePathCache(context, p);
+  context->pathTransform = view;
+  
+  if ((paintModes & VG_STROKE_PATH) && context->strokeLineWidth > 0.0f)
+    shUpdateStrokeCache(context, p);
+  
+  /* Instances are culled and recorded one by one */
+  cull = (context->damageTracking == VG_TRUE ||
+          context->redrawCulling == VG_TRUE);
+  pad = 0.0f;
+  if ((paintModes & VG_STROKE_PATH) && context->strokeLineWidth > 0.0f)
+    pad = context->strokeLineWidth * 0.5f *
+      SH_MAX(context->strokeMiterLimit, 1.5f);
+  
+  if (!shBeginScissoring(context, NULL))
+    VG_RETURN(VG_NO_RETVAL);
+  
+  shBeginMasking(context);
+  shUpdateVertexBuffer(context, p);
+  
   /* TODO: Turn antialiasing on/off */
-  glDisable(GL_LINE_SMOOTH);
-  glDisable(GL_POLYGON_SMOOTH);
-  glEnable(GL_MULTISAMPLE);
+  shGLDisable(context, GL_LINE_SMOOTH);
+  shGLDisable(context, GL_POLYGON_SMOOTH);
+  shGLEnable(context, GL_MULTISAMPLE);
   
-  if ((paintModes & VG_STROKE_PATH) &&
-      context->strokeLineWidth > 0.0f) {
+  /* Only plain colors can be passed per instance */
+  instanced = (paintModes == VG_FILL_PATH &&
+               (colors != NULL || fill->type == VG_PAINT_TYPE_COLOR) &&
+               shLoadInstancePrograms(context));
+  
+  if (instanced) {
     
-    if (1) {/*context->strokeLineWidth > 1.0f) {*/
-
-      if (shIsStrokeCacheValid( context, p ) == VG_FALSE)
-      {
-        /* Generate stroke triangles in user space */
-        shVector2ArrayClear(&p->stroke);
-        shStrokePath(context, p);
+    if (!p->convex && shIsTrianglesCacheValid( context, p ) == VG_FALSE)
+      shTriangulatePath(p, context->fillRule);
+    
+    shFloatArrayClear(&context->instanceData);
+    alphaIsOne = 1;
+    
+    for (i=0; i<count; ++i) {
+      
+      shInstanceMatrix(&view, matrices + 9*i, &m);
+      if (cull) {
+        shTransformBounds(&m, &p->min, &p->max, 0.0f, &bounds);
+        if (!shRecordDraw(context, &bounds)) continue;
       }
-
-      /* Stroke into stencil */
-      glEnable(GL_STENCIL_TEST);
-      /* Clear the stencil buffer first */
-      glStencilFunc(GL_ALWAYS, 0, 0);
-      glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
-      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-      shDrawBoundBox(context, p, VG_STROKE_PATH);
-
-      glStencilFunc(GL_NOTEQUAL, 1, 1);
-      glStencilOp(GL_KEEP, GL_INCR, GL_INCR);
-      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-      shDrawStroke(p);
-
-      /* Setup blending */
-      updateBlendingStateGL(context,
-                            stroke->type == VG_PAINT_TYPE_COLOR &&
-                            stroke->color.a == 1.0f);
-
-      /* Draw paint where stencil odd */
-      glStencilFunc(GL_EQUAL, 1, 1);
-      glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
-      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-      shDrawPaintMesh(context, &p->min, &p->max, VG_STROKE_PATH, GL_TEXTURE0);
       
-      /* Reset state */
-      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-      glDisable(GL_STENCIL_TEST);
-      glDisable(GL_BLEND);
+      if (colors) CSET(color, colors[4*i+0], colors[4*i+1],
+                       colors[4*i+2], colors[4*i+3])
+      else color = fill->color;
+      if (color.a != 1.0f) alphaIsOne = 0;
       
-    }else{
+      shPushInstance(context, &m, &color);
+    }
+    
+    if (context->instanceData.size > 0)
+      shDrawInstances(context, p, alphaIsOne);
+    
+  }else{
+    
+    oldFill = context->fillPaint;
+    if (colors) {
+      context->instancePaint.type = VG_PAINT_TYPE_COLOR;
+      context->fillPaint = &context->instancePaint;
+      fill = &context->instancePaint;
+    }
+    
+    glMatrixMode(GL_MODELVIEW);
+    for (i=0; i<count; ++i) {
+      
+      shInstanceMatrix(&view, matrices + 9*i, &m);
+      if (cull) {
+        shTransformBounds(&m, &p->min, &p->max, pad, &bounds);
+        if (!shRecordDraw(context, &bounds)) continue;
+      }
+      
+      if (colors) CSET(context->instancePaint.color, colors[4*i+0],
+                       colors[4*i+1], colors[4*i+2], colors[4*i+3]);
       
-      /* Simulate thin stroke by alpha */
-      SHColor c = stroke->color;
-      if (context->strokeLineWidth < 1.0f)
-        c.a *= context->strokeLineWidth;
+      shMatrixToGL(&m, mgl);
+      glPushMatrix();
+      glMultMatrixf(mgl);
       
-      /* Draw contour as a line */
-      glDisable(GL_MULTISAMPLE);
-      glEnable(GL_BLEND);
-      glEnable(GL_LINE_SMOOTH);
-      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-      glColor4fv((GLfloat*)&c);
-      shDrawVertices(p, GL_LINE_STRIP);
+      if (paintModes & VG_FILL_PATH)
+        shDrawPathFill(context, p, fill);
       
-      glDisable(GL_BLEND);
-      glDisable(GL_LINE_SMOOTH);
+      if ((paintModes & VG_STROKE_PATH) &&
+          context->strokeLineWidth > 0.0f) {
+        shGLDisable(context, GL_LINE_SMOOTH);
+        shGLDisable(context, GL_POLYGON_SMOOTH);
+        shGLEnable(context, GL_MULTISAMPLE);
+        shDrawPathStroke(context, p, stroke);
+      }
+      
+      glPopMatrix();
     }
+    
+    context->fillPaint = oldFill;
   }
   
-  glDisable(GL_MULTISAMPLE);
-  glPopMatrix();
+  shGLDisable(context, GL_MULTISAMPLE);
+  shEndMasking(context);
   
-  if (context->scissoring == VG_TRUE)
-    glDisable( GL_SCISSOR_TEST );
-
   VG_RETURN(VG_NO_RETVAL);
 }
 
-VG_API_CALL void vgDrawImage(VGImage image)
+void shGLDrawImage(VGContext *context, SHImage *i, SHRectangle *bounds)
 {
-  SHImage *i;
   SHfloat mgl[16];
   SHfloat texGenS[4] = {0,0,0,0};
   SHfloat texGenT[4] = {0,0,0,0};
   SHPaint *fill;
   SHVector2 min, max;
-  SHRectangle *rect;
   
-  VG_GETCONTEXT(VG_NO_RETVAL);
+  shGLFlushBatch(context);
   
-  VG_RETURN_ERR_IF(!shIsValidImage(context, image),
-                   VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
-
-  /* TODO: check if image is current render target */
+  if (!shBeginScissoring(context, bounds))
+    SH_RETURN(SH_NO_RETVAL);
   
-  /* Check whether scissoring is enabled and scissor
-     rectangle is valid */
-  if (context->scissoring == VG_TRUE) {
-    rect = &context->scissor.items[0];
-    if (context->scissor.size == 0) VG_RETURN( VG_NO_RETVAL );
-    if (rect->w <= 0.0f || rect->h <= 0.0f) VG_RETURN( VG_NO_RETVAL );
-    glScissor( (GLint)rect->x, (GLint)rect->y, (GLint)rect->w, (GLint)rect->h );
-    glEnable( GL_SCISSOR_TEST );
-  }
+  shBeginMasking(context);
   
   /* Apply image-user-to-surface transformation */
-  i = (SHImage*)image;
   shMatrixToGL(&context->imageTransform, mgl);
   glMatrixMode(GL_MODELVIEW);
   glPushMatrix();
   glMultMatrixf(mgl);
   
-  /* Clamp to edge for proper filtering, modulate for multiply mode */
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, i->texture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  /* Clamp to edge for proper filtering, modulate for multiply mode.
+     Adjust antialiasing to settings. */
+  shGLActiveTexture(context, GL_TEXTURE0);
+  shGLBindTexture(context, GL_TEXTURE_2D, i->texture);
+  shGLTexEnvMode(context, GL_MODULATE);
   
-  /* Adjust antialiasing to settings */
   if (context->imageQuality == VG_IMAGE_QUALITY_NONANTIALIASED) {
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glDisable(GL_MULTISAMPLE);
+    shGLTexParameters(context, GL_TEXTURE_2D, i->texParams,
+                      GL_CLAMP_TO_EDGE, GL_NEAREST);
+    shGLDisable(context, GL_MULTISAMPLE);
   }else{
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glEnable(GL_MULTISAMPLE);
+    shGLTexParameters(context, GL_TEXTURE_2D, i->texParams,
+                      GL_CLAMP_TO_EDGE, GL_LINEAR);
+    shGLEnable(context, GL_MULTISAMPLE);
   }
   
   /* Generate image texture coords automatically */
@@ -495,8 +1414,8 @@ VG_API_CALL void vgDrawImage(VGImage image)
   glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_OBJECT_LINEAR);
   glTexGenfv(GL_S, GL_OBJECT_PLANE, texGenS);
   glTexGenfv(GL_T, GL_OBJECT_PLANE, texGenT);
-  glEnable(GL_TEXTURE_GEN_S);
-  glEnable(GL_TEXTURE_GEN_T);
+  shGLEnable(context, GL_TEXTURE_GEN_S);
+  shGLEnable(context, GL_TEXTURE_GEN_T);
   
   /* Pick fill paint */
   fill = (context->fillPaint ? context->fillPaint : &context->defaultPaint);
@@ -513,12 +1432,12 @@ VG_API_CALL void vgDrawImage(VGImage image)
       fill->type != VG_PAINT_TYPE_COLOR) {
     
     /* Draw image quad into stencil */
-    glDisable(GL_BLEND);
-    glDisable(GL_TEXTURE_2D);
-    glEnable(GL_STENCIL_TEST);
-    glStencilFunc(GL_ALWAYS, 1, 1);
-    glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
-    glColorMask(GL_FALSE,GL_FALSE,GL_FALSE,GL_FALSE);
+    shGLDisable(context, GL_BLEND);
+    shGLDisable(context, GL_TEXTURE_2D);
+    shGLEnable(context, GL_STENCIL_TEST);
+    shGLStencilFunc(context, GL_ALWAYS, 1, 1);
+    shGLStencilOp(context, GL_REPLACE, GL_REPLACE, GL_REPLACE);
+    shGLColorMask(context, GL_FALSE,GL_FALSE,GL_FALSE,GL_FALSE);
     
     glBegin(GL_QUADS);
     glVertex2i(0, 0);
@@ -526,15 +1445,16 @@ VG_API_CALL void vgDrawImage(VGImage image)
     glVertex2i(i->width, i->height);
     glVertex2i(0, i->height);
     glEnd();
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
 
     /* Setup blending */
     updateBlendingStateGL(context, 0);
     
     /* Draw gradient mesh where stencil 1*/
-    glEnable(GL_TEXTURE_2D);
-    glStencilFunc(GL_EQUAL, 1, 1);
-    glStencilOp(GL_ZERO,GL_ZERO,GL_ZERO);
-    glColorMask(GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
+    shGLEnable(context, GL_TEXTURE_2D);
+    shGLStencilFunc(context, GL_EQUAL, 1, 1);
+    shGLStencilOp(context, GL_ZERO,GL_ZERO,GL_ZERO);
+    shGLColorMask(context, GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
     
     SET2(min,0,0);
     SET2(max, (SHfloat)i->width, (SHfloat)i->height);
@@ -545,9 +1465,9 @@ VG_API_CALL void vgDrawImage(VGImage image)
     }else if (fill->type == VG_PAINT_TYPE_PATTERN) {
       shDrawPatternMesh(fill, &min, &max, VG_FILL_PATH, GL_TEXTURE1); }
     
-    glActiveTexture(GL_TEXTURE0);
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_STENCIL_TEST);
+    shGLActiveTexture(context, GL_TEXTURE0);
+    shGLDisable(context, GL_TEXTURE_2D);
+    shGLDisable(context, GL_STENCIL_TEST);
     
   }else if (context->imageMode == VG_DRAW_IMAGE_STENCIL) {
     
@@ -558,7 +1478,7 @@ VG_API_CALL void vgDrawImage(VGImage image)
     updateBlendingStateGL(context, 0);
 
     /* Draw textured quad */
-    glEnable(GL_TEXTURE_2D);
+    shGLEnable(context, GL_TEXTURE_2D);
     
     glBegin(GL_QUADS);
     glVertex2i(0, 0);
@@ -566,17 +1486,61 @@ VG_API_CALL void vgDrawImage(VGImage image)
     glVertex2i(i->width, i->height);
     glVertex2i(0, i->height);
     glEnd();
+    SH_COUNT(context, VG_STAT_DRAW_CALLS_SH, 1);
     
-    glDisable(GL_TEXTURE_2D);
+    shGLDisable(context, GL_TEXTURE_2D);
   }
   
   
-  glDisable(GL_TEXTURE_GEN_S);
-  glDisable(GL_TEXTURE_GEN_T);
+  shGLDisable(context, GL_TEXTURE_GEN_S);
+  shGLDisable(context, GL_TEXTURE_GEN_T);
+  shEndMasking(context);
   glPopMatrix();
+  
+  SH_RETURN(SH_NO_RETVAL);
+}
 
-  if (context->scissoring == VG_TRUE)
-    glDisable( GL_SCISSOR_TEST );
+void shDrawImage(VGContext *context, SHImage *i)
+{
+  SHVector2 min, max;
+  SHRectangle bounds;
+  
+  /* Replayed command lists may hold the render target,
+     which can't be sampled while being drawn into */
+  if (i == context->renderTarget)
+    SH_RETURN(SH_NO_RETVAL);
+  
+  /* Skip images entirely outside the scissor rectangles
+     or the redraw region */
+  SET2(min,0,0);
+  SET2(max, (SHfloat)i->width, (SHfloat)i->height);
+  shTransformBounds(&context->imageTransform, &min, &max, 0.0f, &bounds);
+  if (!shRecordDraw(context, &bounds))
+    SH_RETURN(SH_NO_RETVAL);
+  
+  SH_TRACE_BEGIN(context, "submit");
+  context->backend->drawImage(context, i, &bounds);
+  SH_TRACE_END(context, "submit");
+  
+  SH_RETURN(SH_NO_RETVAL);
+}
+
+VG_API_CALL void vgDrawImage(VGImage image)
+{
+  VG_GETCONTEXT(VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF(!shIsValidImage(context, image),
+                   VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
+  
+  VG_RETURN_ERR_IF((SHImage*)image == context->renderTarget,
+                   VG_IMAGE_IN_USE_ERROR, VG_NO_RETVAL);
+  
+  if (context->recordList)
+    shRecordImageCommand(context, (SHImage*)image);
+  
+  SH_TRACE_BEGIN(context, "vgDrawImage");
+  shDrawImage(context, (SHImage*)image);
+  SH_TRACE_END(context, "vgDrawImage");
   
   VG_RETURN(VG_NO_RETVAL);
 }
@@ -0,0 +1,1544 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shContext.h"
+#include <string.h>
+#include <stdlib.h>
+
+#if defined(SH_RASTER_THREADS)
+#  include <pthread.h>
+#endif
+
+/*------------------------------------------------------------
+ * Software rendering for contexts without OpenGL. The paths
+ * are flattened and stroked by the same code as for OpenGL,
+ * then every edge adds the exact area it covers in each pixel
+ * cell of the draw's box to an accumulation buffer. Sweeping
+ * a row sums the cells into the signed winding, and the fill
+ * rule applied to it gives the pixel coverage. A stroke is
+ * the union of its triangles, all turned to the same side
+ * and filled non-zero. Paints are evaluated per pixel with
+ * the formulas of the gradient programs, and blended with
+ * the same factors as the OpenGL pipeline uses.
+ *
+ * Every draw is first recorded with its edges and the state
+ * it depends on. With a single thread it is rasterized right
+ * away. With more, its edges are binned into the surface
+ * bands they cross, and vgFlush (or anything else that needs
+ * the pixels) has the threads rasterize whole bands, each
+ * running the draws of its band in order. The coverage of a
+ * row only depends on the edges crossing it, added in the
+ * same order and with the same arithmetic either way, so
+ * the result is the same to the bit.
+ *------------------------------------------------------------*/
+
+/* Coverage below which a pixel is left alone */
+#define SH_RASTER_MIN_COVERAGE (1.0f / 1024.0f)
+
+#define _ITEM_T SHRasterDraw
+#define _ARRAY_T SHRasterDrawArray
+#define _FUNC_T shRasterDrawArray
+#define _ARRAY_DEFINE
+#define _COMPARE_T(d1,d2) 0
+#include "shArrayBase.h"
+
+void SHRasterDraw_ctor(SHRasterDraw *d) {
+}
+
+void SHRasterDraw_dtor(SHRasterDraw *d) {
+}
+
+void SHRasterCells_ctor(SHRasterCells *rc)
+{
+  rc->x = rc->y = 0;
+  rc->width = rc->height = 0;
+  rc->row0 = rc->rows = 0;
+  SH_INITOBJ(SHFloatArray, rc->cells);
+  SH_INITOBJ(SHIntArray, rc->rowSpans);
+  SH_INITOBJ(SHFloatArray, rc->coverage);
+  SH_INITOBJ(SHColorArray, rc->colors);
+}
+
+void SHRasterCells_dtor(SHRasterCells *rc)
+{
+  SH_DEINITOBJ(SHFloatArray, rc->cells);
+  SH_DEINITOBJ(SHIntArray, rc->rowSpans);
+  SH_DEINITOBJ(SHFloatArray, rc->coverage);
+  SH_DEINITOBJ(SHColorArray, rc->colors);
+}
+
+static void shRasterDeletePool(SHRaster *r);
+
+void SHRaster_ctor(SHRaster *r)
+{
+  r->pixels = NULL;
+  r->stride = 0;
+  SH_INITOBJ(SHRasterCells, r->cells);
+  r->threads = 1;
+  SH_INITOBJ(SHRasterDrawArray, r->draws);
+  SH_INITOBJ(SHFloatArray, r->edges);
+  SH_INITOBJ(SHColorArray, r->ramps);
+  r->bins = NULL;
+  SH_INITOBJ(SHIntArray, r->binHeads);
+  r->binCount = 0;
+  r->pool = NULL;
+  SH_INITOBJ(SHVector2Array, r->points);
+}
+
+void SHRaster_dtor(SHRaster *r)
+{
+  SHint i;
+
+  shRasterDeletePool(r);
+  for (i=0; i<r->binCount; ++i)
+    SH_DEINITOBJ(SHIntArray, r->bins[i]);
+  if (r->bins) free(r->bins);
+
+  SH_DEINITOBJ(SHRasterCells, r->cells);
+  SH_DEINITOBJ(SHRasterDrawArray, r->draws);
+  SH_DEINITOBJ(SHFloatArray, r->edges);
+  SH_DEINITOBJ(SHColorArray, r->ramps);
+  SH_DEINITOBJ(SHIntArray, r->binHeads);
+  SH_DEINITOBJ(SHVector2Array, r->points);
+}
+
+/*------------------------------------------------------------
+ * Byte order of the surface pixels as an image format, for
+ * the conversions of vgReadPixels and friends
+ *------------------------------------------------------------*/
+
+VGImageFormat shRasterFormat(void)
+{
+  SHuint32 one = 1;
+
+  /* R,G,B,A in memory is ABGR in a little-endian word */
+  if (*(SHuint8*)&one == 1)
+    return VG_sABGR_8888;
+  else return VG_sRGBA_8888;
+}
+
+/*------------------------------------------------------------
+ * Prepares the cells for the rows [y0,y1) of the surface
+ * within the box of a draw
+ *------------------------------------------------------------*/
+
+static int shRasterBegin(SHRasterCells *rc, SHRasterDraw *d,
+                         SHint y0, SHint y1)
+{
+  SHint cells, i;
+
+  rc->x = d->x;
+  rc->y = d->y;
+  rc->width = d->width;
+  rc->height = d->height;
+  rc->row0 = y0 - d->y;
+  rc->rows = y1 - y0;
+
+  /* Only a new buffer needs clearing */
+  cells = (rc->width + 2) * rc->rows;
+  if (rc->cells.capacity < cells) {
+    if (!shFloatArrayReserve(&rc->cells, cells)) return 0;
+    memset(rc->cells.items, 0, rc->cells.capacity * sizeof(SHfloat));
+  }
+
+  if (!shIntArrayReserve(&rc->rowSpans, 2 * rc->rows) ||
+      !shFloatArrayReserve(&rc->coverage, rc->width) ||
+      !shColorArrayReserve(&rc->colors, rc->width))
+    return 0;
+
+  for (i=0; i<rc->rows; ++i) {
+    rc->rowSpans.items[2*i+0] = rc->width + 2;
+    rc->rowSpans.items[2*i+1] = -1;
+  }
+
+  return 1;
+}
+
+/*------------------------------------------------------------
+ * Adds the signed area a line covers in the cells it crosses,
+ * and the rest of the row's coverage to the cell after them.
+ * The coordinates are relative to the box and x is within
+ * it. The crossings of each row are computed from the end
+ * points alone, so that they are the same whichever rows
+ * the cells hold.
+ *------------------------------------------------------------*/
+
+static void shRasterLine(SHRasterCells *rc, SHfloat x0, SHfloat y0,
+                         SHfloat x1, SHfloat y1)
+{
+  SHfloat dir, dxdy, x, xnext, dy, d, t;
+  SHfloat xa, xb, xafloor, xbceil, s, xaf, xbf, a0, a1, a2, am;
+  SHint y, yend, xai, xbi, xi;
+  SHfloat w = (SHfloat)rc->width;
+  SHfloat *row;
+  SHint *span;
+
+  if (y0 == y1)
+    return;
+
+  dir = 1.0f;
+  if (y0 > y1) {
+    dir = -1.0f;
+    t = x0; x0 = x1; x1 = t;
+    t = y0; y0 = y1; y1 = t;
+  }
+
+  y = SH_MAX((SHint)SH_FLOOR(y0), rc->row0);
+  yend = SH_MIN((SHint)SH_CEIL(y1), rc->row0 + rc->rows);
+  if (y >= yend)
+    return;
+
+  dxdy = (x1 - x0) / (y1 - y0);
+
+  for (; y < yend; ++y) {
+
+    row = rc->cells.items + (y - rc->row0) * (rc->width + 2);
+    span = rc->rowSpans.items + 2 * (y - rc->row0);
+
+    /* Where the line enters and leaves the row,
+       rounding may step just outside the box */
+    if (y0 >= (SHfloat)y) x = x0;
+    else x = x0 + dxdy * ((SHfloat)y - y0);
+    if (y1 <= (SHfloat)(y + 1)) xnext = x1;
+    else xnext = x0 + dxdy * ((SHfloat)(y + 1) - y0);
+    SH_CLAMP(x, 0.0f, w);
+    SH_CLAMP(xnext, 0.0f, w);
+
+    dy = SH_MIN((SHfloat)(y + 1), y1) - SH_MAX((SHfloat)y, y0);
+    d = dy * dir;
+
+    if (x < xnext) { xa = x; xb = xnext; }
+    else { xa = xnext; xb = x; }
+
+    xafloor = SH_FLOOR(xa);
+    xai = (SHint)xafloor;
+    xbceil = SH_CEIL(xb);
+    xbi = (SHint)xbceil;
+
+    if (xbi <= xai + 1) {
+
+      /* Within a single cell */
+      xaf = 0.5f * (x + xnext) - xafloor;
+      row[xai] += d - d * xaf;
+      row[xai + 1] += d * xaf;
+      xbi = xai + 1;
+
+    }else{
+
+      /* Trapezoids in the first and last cell
+         and equal parts in the ones between */
+      s = 1.0f / (xb - xa);
+      xaf = xa - xafloor;
+      a0 = 0.5f * s * (1.0f - xaf) * (1.0f - xaf);
+      xbf = xb - xbceil + 1.0f;
+      am = 0.5f * s * xbf * xbf;
+
+      row[xai] += d * a0;
+      if (xbi == xai + 2) {
+        row[xai + 1] += d * (1.0f - a0 - am);
+      }else{
+        a1 = s * (1.5f - xaf);
+        row[xai + 1] += d * (a1 - a0);
+        for (xi = xai + 2; xi < xbi - 1; ++xi)
+          row[xi] += d * s;
+        a2 = a1 + (SHfloat)(xbi - xai - 3) * s;
+        row[xbi - 1] += d * (1.0f - a2 - am);
+      }
+      row[xbi] += d * am;
+    }
+
+    if (xai < span[0]) span[0] = xai;
+    if (xbi > span[1]) span[1] = xbi;
+  }
+}
+
+/*------------------------------------------------------------
+ * Adds an edge relative to the box. The parts left of it
+ * count as if they ran along its left side, and the ones
+ * right of it end up in the guard cells.
+ *------------------------------------------------------------*/
+
+static void shRasterClipLine(SHRasterCells *rc, SHfloat x0, SHfloat y0,
+                             SHfloat x1, SHfloat y1)
+{
+  SHfloat w = (SHfloat)rc->width;
+  SHfloat ym;
+
+  /* Split where the edge crosses either side */
+  if ((x0 < 0.0f && x1 > 0.0f) || (x0 > 0.0f && x1 < 0.0f)) {
+    ym = y0 + (y1 - y0) * (0.0f - x0) / (x1 - x0);
+    shRasterClipLine(rc, x0, y0, 0.0f, ym);
+    shRasterClipLine(rc, 0.0f, ym, x1, y1);
+    return;
+  }
+
+  if ((x0 < w && x1 > w) || (x0 > w && x1 < w)) {
+    ym = y0 + (y1 - y0) * (w - x0) / (x1 - x0);
+    shRasterClipLine(rc, x0, y0, w, ym);
+    shRasterClipLine(rc, w, ym, x1, y1);
+    return;
+  }
+
+  SH_CLAMP(x0, 0.0f, w);
+  SH_CLAMP(x1, 0.0f, w);
+  shRasterLine(rc, x0, y0, x1, y1);
+}
+
+static void shRasterEdge(SHRasterCells *rc, const SHfloat *e)
+{
+  shRasterClipLine(rc,
+                   e[0] - (SHfloat)rc->x, e[1] - (SHfloat)rc->y,
+                   e[2] - (SHfloat)rc->x, e[3] - (SHfloat)rc->y);
+}
+
+/*------------------------------------------------------------
+ * Paint evaluation. The matrices map surface space to the
+ * space of the paint and of the image drawn, and pixels are
+ * sampled at their centers.
+ *------------------------------------------------------------*/
+
+static void shRasterTexel(SHImage *i, SHint x, SHint y,
+                          VGTilingMode tiling, const SHColor *fill,
+                          SHColor *out)
+{
+  switch (tiling) {
+  case VG_TILE_FILL:
+    if (x < 0 || y < 0 || x >= i->width || y >= i->height) {
+      *out = *fill;
+      return;
+    }
+    break;
+
+  case VG_TILE_REPEAT:
+    x %= i->width;  if (x < 0) x += i->width;
+    y %= i->height; if (y < 0) y += i->height;
+    break;
+
+  case VG_TILE_REFLECT:
+    x %= 2 * i->width;  if (x < 0) x += 2 * i->width;
+    y %= 2 * i->height; if (y < 0) y += 2 * i->height;
+    if (x >= i->width) x = 2 * i->width - 1 - x;
+    if (y >= i->height) y = 2 * i->height - 1 - y;
+    break;
+
+  case VG_TILE_PAD: default:
+    if (x < 0) x = 0; else if (x >= i->width) x = i->width - 1;
+    if (y < 0) y = 0; else if (y >= i->height) y = i->height - 1;
+    break;
+  }
+
+  shLoadColor(out, i->data + (y * i->texwidth + x) * i->fd.bytes, &i->fd);
+}
+
+static void shRasterSample(const SHRasterDraw *d, SHImage *i,
+                           SHfloat u, SHfloat v,
+                           VGTilingMode tiling, SHColor *out)
+{
+  SHColor t[4];
+  SHfloat fx, fy;
+  SHint x, y;
+
+  if (d->imageQuality == VG_IMAGE_QUALITY_NONANTIALIASED) {
+    shRasterTexel(i, (SHint)SH_FLOOR(u), (SHint)SH_FLOOR(v),
+                  tiling, &d->tileFillColor, out);
+    return;
+  }
+
+  /* Bilinear between the four nearest texel centers */
+  u -= 0.5f; v -= 0.5f;
+  x = (SHint)SH_FLOOR(u);
+  y = (SHint)SH_FLOOR(v);
+  fx = u - (SHfloat)x;
+  fy = v - (SHfloat)y;
+
+  shRasterTexel(i, x,   y,   tiling, &d->tileFillColor, &t[0]);
+  shRasterTexel(i, x+1, y,   tiling, &d->tileFillColor, &t[1]);
+  shRasterTexel(i, x,   y+1, tiling, &d->tileFillColor, &t[2]);
+  shRasterTexel(i, x+1, y+1, tiling, &d->tileFillColor, &t[3]);
+
+  out->r = (t[0].r + (t[1].r - t[0].r) * fx) * (1.0f - fy) +
+           (t[2].r + (t[3].r - t[2].r) * fx) * fy;
+  out->g = (t[0].g + (t[1].g - t[0].g) * fx) * (1.0f - fy) +
+           (t[2].g + (t[3].g - t[2].g) * fx) * fy;
+  out->b = (t[0].b + (t[1].b - t[0].b) * fx) * (1.0f - fy) +
+           (t[2].b + (t[3].b - t[2].b) * fx) * fy;
+  out->a = (t[0].a + (t[1].a - t[0].a) * fx) * (1.0f - fy) +
+           (t[2].a + (t[3].a - t[2].a) * fx) * fy;
+}
+
+static void shRasterPaintColor(const SHRasterDraw *d, const SHColor *ramp,
+                               SHfloat u, SHfloat v, SHColor *out)
+{
+  const SHfloat *g = d->params;
+  SHfloat t, dx, dy, c, q;
+  SHint i;
+
+  switch (d->paintType) {
+  case VG_PAINT_TYPE_LINEAR_GRADIENT:
+    t = (u - g[0]) * g[2] + (v - g[1]) * g[3] + g[4];
+    break;
+
+  case VG_PAINT_TYPE_RADIAL_GRADIENT:
+    dx = u - g[0];
+    dy = v - g[1];
+    c = dx * g[3] - dy * g[2];
+    q = g[4] * (dx*dx + dy*dy) - c*c;
+    t = (dx * g[2] + dy * g[3] + (q > 0.0f ? SH_SQRT(q) : 0.0f)) / g[5];
+    break;
+
+  case VG_PAINT_TYPE_PATTERN:
+    shRasterSample(d, d->pattern, u, v, d->tilingMode, out);
+    return;
+
+  default:
+    *out = d->color;
+    return;
+  }
+
+  /* Spread the offset into the ramp */
+  switch (d->spreadMode) {
+  case VG_COLOR_RAMP_SPREAD_REPEAT:
+    t -= SH_FLOOR(t);
+    break;
+  case VG_COLOR_RAMP_SPREAD_REFLECT:
+    t = SH_ABS(t);
+    t -= 2.0f * SH_FLOOR(t * 0.5f);
+    if (t > 1.0f) t = 2.0f - t;
+    break;
+  case VG_COLOR_RAMP_SPREAD_PAD: default:
+    SH_CLAMP(t, 0.0f, 1.0f);
+    break;
+  }
+
+  i = (SHint)(t * (SH_GRADIENT_TEX_SIZE-1) + 0.5f);
+  *out = ramp[i];
+}
+
+static void shRasterPaintSpan(VGContext *c, const SHRasterDraw *d,
+                              SHint y, SHint x, SHint count, SHColor *out)
+{
+  const SHMatrix3x3 *m = &d->toPaint;
+  const SHMatrix3x3 *mi = &d->toImage;
+  const SHColor *ramp = NULL;
+  SHfloat px = (SHfloat)x + 0.5f;
+  SHfloat py = (SHfloat)y + 0.5f;
+  SHfloat u, v, iu, iv;
+  SHColor p;
+  SHint i;
+
+  if (d->rampStart >= 0)
+    ramp = c->raster.ramps.items + d->rampStart;
+
+  u = m->m[0][0] * px + m->m[0][1] * py + m->m[0][2];
+  v = m->m[1][0] * px + m->m[1][1] * py + m->m[1][2];
+  iu = mi->m[0][0] * px + mi->m[0][1] * py + mi->m[0][2];
+  iv = mi->m[1][0] * px + mi->m[1][1] * py + mi->m[1][2];
+
+  for (i=0; i<count; ++i) {
+
+    if (d->image) {
+      shRasterSample(d, d->image, iu, iv, VG_TILE_PAD, &out[i]);
+      if (d->multiply) {
+        shRasterPaintColor(d, ramp, u, v, &p);
+        out[i].r *= p.r; out[i].g *= p.g;
+        out[i].b *= p.b; out[i].a *= p.a;
+      }
+      iu += mi->m[0][0];
+      iv += mi->m[1][0];
+    }else shRasterPaintColor(d, ramp, u, v, &out[i]);
+
+    u += m->m[0][0];
+    v += m->m[1][0];
+  }
+}
+
+/*------------------------------------------------------------
+ * Blends a straight color into a pixel with the factors
+ * updateBlendingStateGL sets for the blend mode, weighted
+ * by the coverage like a multisample resolve would do.
+ *------------------------------------------------------------*/
+
+static void shRasterBlend(VGBlendMode mode, SHuint8 *dst,
+                          const SHColor *s, SHfloat k)
+{
+  SHfloat d[4], fs, fd, a, b, o;
+  SHint i;
+
+  d[0] = dst[0] * (1.0f / 255.0f);
+  d[1] = dst[1] * (1.0f / 255.0f);
+  d[2] = dst[2] * (1.0f / 255.0f);
+  d[3] = dst[3] * (1.0f / 255.0f);
+
+  switch (mode) {
+  case VG_BLEND_SRC:         fs = 1.0f;        fd = 0.0f; break;
+  case VG_BLEND_SRC_IN:      fs = d[3];        fd = 0.0f; break;
+  case VG_BLEND_DST_IN:      fs = 0.0f;        fd = s->a; break;
+  case VG_BLEND_SRC_OUT_SH:  fs = 1.0f - d[3]; fd = 0.0f; break;
+  case VG_BLEND_DST_OUT_SH:  fs = 0.0f;        fd = 1.0f - s->a; break;
+  case VG_BLEND_SRC_ATOP_SH: fs = d[3];        fd = 1.0f - s->a; break;
+  case VG_BLEND_DST_ATOP_SH: fs = 1.0f - d[3]; fd = s->a; break;
+  case VG_BLEND_DST_OVER:    fs = 1.0f - d[3]; fd = d[3]; break;
+  case VG_BLEND_SRC_OVER: default:
+    fs = s->a; fd = 1.0f - s->a; break;
+  }
+
+  /* d + (s*fs + d*fd - d) * k */
+  a = fs * k;
+  b = 1.0f + (fd - 1.0f) * k;
+
+  for (i=0; i<4; ++i) {
+    o = (&s->r)[i] * a + d[i] * b;
+    SH_CLAMP(o, 0.0f, 1.0f);
+    dst[i] = (SHuint8)(o * 255.0f + 0.5f);
+  }
+}
+
+static void shRasterFillSpan(VGContext *c, SHRasterCells *rc,
+                             const SHRasterDraw *d, SHint y,
+                             SHint x0, SHint x1, SHfloat *coverage)
+{
+  SHuint8 *p = c->raster.pixels + y * c->raster.stride + x0 * 4;
+  const SHColor *s = &d->color;
+  SHint count = x1 - x0 + 1;
+  SHint step = 0, i;
+
+  if (d->paintType != VG_PAINT_TYPE_COLOR || d->image) {
+    shRasterPaintSpan(c, d, y, x0, count, rc->colors.items);
+    s = rc->colors.items;
+    step = 1;
+  }
+
+  for (i=0; i<count; ++i, p+=4, s+=step)
+    if (coverage[i] >= SH_RASTER_MIN_COVERAGE)
+      shRasterBlend(d->blendMode, p, s, coverage[i]);
+}
+
+/*------------------------------------------------------------
+ * Applies the alpha mask and the scissor rectangles to the
+ * coverage of a row span and fills the parts that are left
+ *------------------------------------------------------------*/
+
+static void shRasterComposite(VGContext *c, SHRasterCells *rc,
+                              const SHRasterDraw *d, SHint y,
+                              SHint x0, SHint x1, SHfloat *coverage)
+{
+  SHRectangle *b;
+  SHuint8 *mask;
+  SHfloat yc = (SHfloat)y + 0.5f;
+  SHint i, sx0, sx1;
+
+  if (d->masking && c->maskData != NULL && y < c->maskHeight) {
+    mask = c->maskData + y * c->maskWidth;
+    for (i=x0; i<=x1 && i<c->maskWidth; ++i)
+      coverage[i - x0] *= (SHfloat)mask[i] * (1.0f / 255.0f);
+  }
+
+  if (c->scissoring == VG_FALSE) {
+    shRasterFillSpan(c, rc, d, y, x0, x1, coverage);
+    return;
+  }
+
+  /* The bands don't overlap, pixels belong
+     to the ones holding their centers */
+  for (i=0; i<c->scissorBands.size; ++i) {
+    b = &c->scissorBands.items[i];
+    if (yc < b->y || yc >= b->y + b->h) continue;
+    sx0 = (SHint)SH_CEIL(b->x - 0.5f);
+    sx1 = (SHint)SH_CEIL(b->x + b->w - 0.5f) - 1;
+    if (sx0 < x0) sx0 = x0;
+    if (sx1 > x1) sx1 = x1;
+    if (sx0 <= sx1)
+      shRasterFillSpan(c, rc, d, y, sx0, sx1, coverage + (sx0 - x0));
+  }
+}
+
+/*------------------------------------------------------------
+ * Turns the accumulated cells into coverage row by row,
+ * clearing them on the way, and composites the result
+ *------------------------------------------------------------*/
+
+static void shRasterSweep(VGContext *c, SHRasterCells *rc,
+                          const SHRasterDraw *d)
+{
+  SHfloat *row, *coverage = rc->coverage.items;
+  SHfloat acc, a;
+  SHint y, x, x0, x1;
+
+  for (y=0; y<rc->rows; ++y) {
+
+    x0 = rc->rowSpans.items[2*y+0];
+    x1 = rc->rowSpans.items[2*y+1];
+    if (x1 < x0) continue;
+
+    row = rc->cells.items + y * (rc->width + 2);
+    acc = 0.0f;
+
+    for (x=x0; x<=x1; ++x) {
+      acc += row[x];
+      row[x] = 0.0f;
+      if (x >= rc->width) continue;
+
+      a = SH_ABS(acc);
+      if (d->fillRule == VG_EVEN_ODD) {
+        a -= 2.0f * SH_FLOOR(a * 0.5f);
+        if (a > 1.0f) a = 2.0f - a;
+      }else if (a > 1.0f) a = 1.0f;
+
+      if (d->aliased) a = (a >= 0.5f ? 1.0f : 0.0f);
+      coverage[x] = a;
+    }
+
+    if (x0 < rc->width)
+      shRasterComposite(c, rc, d, rc->y + rc->row0 + y, rc->x + x0,
+                        rc->x + SH_MIN(x1, rc->width - 1), coverage + x0);
+  }
+}
+
+/*------------------------------------------------------------
+ * Sets the pixels of the cleared box that are within the
+ * scissor rectangles to the clear color
+ *------------------------------------------------------------*/
+
+static void shRasterClearRows(VGContext *c, const SHRasterDraw *d,
+                              SHint y0, SHint y1)
+{
+  SHRectangle *b;
+  SHuint8 color[4], *p;
+  SHint x0, x1, px, py, i;
+  SHfloat yc;
+
+  color[0] = (SHuint8)(d->color.r * 255.0f + 0.5f);
+  color[1] = (SHuint8)(d->color.g * 255.0f + 0.5f);
+  color[2] = (SHuint8)(d->color.b * 255.0f + 0.5f);
+  color[3] = (SHuint8)(d->color.a * 255.0f + 0.5f);
+
+  x0 = d->x;
+  x1 = d->x + d->width;
+
+  for (py=y0; py<y1; ++py) {
+
+    if (c->scissoring == VG_FALSE) {
+      p = c->raster.pixels + py * c->raster.stride + x0 * 4;
+      for (px=x0; px<x1; ++px, p+=4)
+        memcpy(p, color, 4);
+      continue;
+    }
+
+    yc = (SHfloat)py + 0.5f;
+    for (i=0; i<c->scissorBands.size; ++i) {
+      b = &c->scissorBands.items[i];
+      if (yc < b->y || yc >= b->y + b->h) continue;
+      px = SH_MAX((SHint)SH_CEIL(b->x - 0.5f), x0);
+      p = c->raster.pixels + py * c->raster.stride + px * 4;
+      for (; px < x1 && (SHfloat)px + 0.5f < b->x + b->w; ++px, p+=4)
+        memcpy(p, color, 4);
+    }
+  }
+}
+
+/*------------------------------------------------------------
+ * Rasterizes the surface rows [y0,y1) of a recorded draw,
+ * from all of its edges or the given ones only
+ *------------------------------------------------------------*/
+
+static void shRasterRun(VGContext *c, SHRasterCells *rc, SHRasterDraw *d,
+                        SHint y0, SHint y1, const SHint *edges, SHint count)
+{
+  const SHfloat *e = c->raster.edges.items;
+  SHint i;
+
+  y0 = SH_MAX(y0, d->y);
+  y1 = SH_MIN(y1, d->y + d->height);
+  if (y0 >= y1)
+    return;
+
+  if (d->type == SH_RASTER_CLEAR) {
+    shRasterClearRows(c, d, y0, y1);
+    return;
+  }
+
+  if (!shRasterBegin(rc, d, y0, y1))
+    return;
+
+  if (edges) {
+    for (i=0; i<count; ++i)
+      shRasterEdge(rc, e + 4 * edges[i]);
+  }else{
+    for (i=d->edgeStart; i<d->edgeStart + d->edgeCount; ++i)
+      shRasterEdge(rc, e + 4 * i);
+  }
+
+  shRasterSweep(c, rc, d);
+}
+
+static void shRasterRunBin(VGContext *c, SHRasterCells *rc, SHint bin)
+{
+  SHIntArray *b = &c->raster.bins[bin];
+  SHint y0 = bin * SH_RASTER_TILE_ROWS;
+  SHint y1 = SH_MIN(y0 + SH_RASTER_TILE_ROWS, c->surfaceHeight);
+  SHint i, count;
+
+  /* Draw index, edge count and edge indices per draw */
+  for (i=0; i<b->size; i+=2+count) {
+    count = b->items[i+1];
+    shRasterRun(c, rc, &c->raster.draws.items[b->items[i]],
+                y0, y1, b->items + i + 2, count);
+  }
+}
+
+/*------------------------------------------------------------
+ * Worker threads. Every thread starts with a contiguous
+ * range of bands, and one that runs out takes the upper
+ * half of the largest range left to another thread.
+ *------------------------------------------------------------*/
+
+#if defined(SH_RASTER_THREADS)
+
+typedef struct
+{
+  struct SHRasterPool *pool;
+  SHint index;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  SHint next, end;
+  SHRasterCells cells;
+
+} SHRasterWorker;
+
+struct SHRasterPool
+{
+  VGContext *context;
+  SHint count;
+  SHRasterWorker *workers;
+  pthread_mutex_t lock;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  SHint generation;
+  SHint busy;
+  SHint quit;
+};
+
+static SHint shRasterTakeBin(struct SHRasterPool *pool, SHRasterWorker *w)
+{
+  SHRasterWorker *v;
+  SHint i, best, left, mid, end;
+
+  pthread_mutex_lock(&w->lock);
+  if (w->next < w->end) {
+    i = w->next++;
+    pthread_mutex_unlock(&w->lock);
+    return i;
+  }
+  pthread_mutex_unlock(&w->lock);
+
+  for (;;) {
+
+    /* Find the most work left */
+    best = -1; left = 0;
+    for (i=0; i<pool->count; ++i) {
+      v = &pool->workers[i];
+      if (v == w) continue;
+      pthread_mutex_lock(&v->lock);
+      if (v->end - v->next > left) {
+        left = v->end - v->next;
+        best = i;
+      }
+      pthread_mutex_unlock(&v->lock);
+    }
+
+    if (best < 0)
+      return -1;
+
+    /* Steal its upper half, if still there */
+    v = &pool->workers[best];
+    pthread_mutex_lock(&v->lock);
+    left = v->end - v->next;
+    if (left <= 0) {
+      pthread_mutex_unlock(&v->lock);
+      continue;
+    }
+    mid = v->next + left / 2;
+    end = v->end;
+    v->end = mid;
+    pthread_mutex_unlock(&v->lock);
+
+    pthread_mutex_lock(&w->lock);
+    w->next = mid + 1;
+    w->end = end;
+    pthread_mutex_unlock(&w->lock);
+    return mid;
+  }
+}
+
+static void shRasterWork(struct SHRasterPool *pool, SHRasterWorker *w)
+{
+  SHint bin;
+
+  while ((bin = shRasterTakeBin(pool, w)) >= 0)
+    shRasterRunBin(pool->context, &w->cells, bin);
+}
+
+static void* shRasterThread(void *arg)
+{
+  SHRasterWorker *w = (SHRasterWorker*)arg;
+  struct SHRasterPool *pool = w->pool;
+  SHint generation = 0;
+
+  for (;;) {
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->generation == generation && !pool->quit)
+      pthread_cond_wait(&pool->start, &pool->lock);
+    if (pool->quit) {
+      pthread_mutex_unlock(&pool->lock);
+      return NULL;
+    }
+    generation = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    shRasterWork(pool, w);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busy == 0)
+      pthread_cond_signal(&pool->done);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+static struct SHRasterPool* shRasterCreatePool(VGContext *c, SHint count)
+{
+  struct SHRasterPool *pool;
+  SHint i;
+
+  pool = (struct SHRasterPool*)malloc(sizeof(struct SHRasterPool));
+  if (!pool) return NULL;
+
+  pool->workers = (SHRasterWorker*)malloc(count * sizeof(SHRasterWorker));
+  if (!pool->workers) {
+    free(pool);
+    return NULL;
+  }
+
+  pool->context = c;
+  pool->count = count;
+  pool->generation = 0;
+  pool->busy = 0;
+  pool->quit = 0;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->start, NULL);
+  pthread_cond_init(&pool->done, NULL);
+
+  for (i=0; i<count; ++i) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i;
+    pool->workers[i].next = pool->workers[i].end = 0;
+    pthread_mutex_init(&pool->workers[i].lock, NULL);
+    SH_INITOBJ(SHRasterCells, pool->workers[i].cells);
+  }
+
+  /* The calling thread is the first worker */
+  for (i=1; i<count; ++i) {
+    if (pthread_create(&pool->workers[i].thread, NULL,
+                       shRasterThread, &pool->workers[i]) != 0)
+      break;
+  }
+
+  pool->count = i;
+  return pool;
+}
+
+static void shRasterDeletePool(SHRaster *r)
+{
+  struct SHRasterPool *pool = r->pool;
+  SHint i;
+
+  if (!pool)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->quit = 1;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (i=1; i<pool->count; ++i)
+    pthread_join(pool->workers[i].thread, NULL);
+
+  for (i=0; i<pool->count; ++i) {
+    pthread_mutex_destroy(&pool->workers[i].lock);
+    SH_DEINITOBJ(SHRasterCells, pool->workers[i].cells);
+  }
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->start);
+  pthread_cond_destroy(&pool->done);
+  free(pool->workers);
+  free(pool);
+  r->pool = NULL;
+}
+
+static void shRasterRunBins(VGContext *c)
+{
+  SHRaster *r = &c->raster;
+  struct SHRasterPool *pool;
+  SHint i;
+
+  if (r->pool && r->pool->count != r->threads)
+    shRasterDeletePool(r);
+  if (!r->pool)
+    r->pool = shRasterCreatePool(c, r->threads);
+
+  pool = r->pool;
+  if (!pool) {
+    for (i=0; i<r->binCount; ++i)
+      shRasterRunBin(c, &r->cells, i);
+    return;
+  }
+
+  for (i=0; i<pool->count; ++i) {
+    pool->workers[i].next = r->binCount * i / pool->count;
+    pool->workers[i].end = r->binCount * (i+1) / pool->count;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->busy = pool->count - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start);
+  pthread_mutex_unlock(&pool->lock);
+
+  shRasterWork(pool, &pool->workers[0]);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy > 0)
+    pthread_cond_wait(&pool->done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+#else
+
+static void shRasterDeletePool(SHRaster *r) {
+}
+
+static void shRasterRunBins(VGContext *c)
+{
+  SHint i;
+  for (i=0; i<c->raster.binCount; ++i)
+    shRasterRunBin(c, &c->raster.cells, i);
+}
+
+#endif /* SH_RASTER_THREADS */
+
+/*------------------------------------------------------------
+ * Number of threads rasterizing the binned draws, 1 to draw
+ * right away on the calling thread
+ *------------------------------------------------------------*/
+
+SHint shRasterMaxThreads(void)
+{
+#if defined(SH_RASTER_THREADS)
+  return SH_RASTER_MAX_THREADS;
+#else
+  return 1;
+#endif
+}
+
+void shRasterSetThreads(VGContext *c, SHint threads)
+{
+  shRasterFlush(c);
+  c->raster.threads = SH_MIN(threads, shRasterMaxThreads());
+}
+
+/*------------------------------------------------------------
+ * Rasterizes the binned draws and empties the bins
+ *------------------------------------------------------------*/
+
+void shRasterFlush(VGContext *c)
+{
+  SHRaster *r = &c->raster;
+  SHint i;
+
+  if (r->draws.size == 0)
+    return;
+
+  shRasterRunBins(c);
+
+  for (i=0; i<r->binCount; ++i)
+    shIntArrayClear(&r->bins[i]);
+  shRasterDrawArrayClear(&r->draws);
+  shFloatArrayClear(&r->edges);
+  shColorArrayClear(&r->ramps);
+}
+
+/*------------------------------------------------------------
+ * Adds the edges of the last recorded draw to the bins of
+ * the surface bands they cross
+ *------------------------------------------------------------*/
+
+static int shRasterBinDraw(VGContext *c)
+{
+  SHRaster *r = &c->raster;
+  SHint index = r->draws.size - 1;
+  SHRasterDraw *d = &r->draws.items[index];
+  SHfloat *e;
+  SHint bins, i, b, b0, b1, y0, y1, *head;
+  SHIntArray *bin;
+
+  /* One bin per band of the surface */
+  bins = (c->surfaceHeight + SH_RASTER_TILE_ROWS - 1) / SH_RASTER_TILE_ROWS;
+  if (bins > r->binCount) {
+    bin = (SHIntArray*)realloc(r->bins, bins * sizeof(SHIntArray));
+    if (!bin) return 0;
+    r->bins = bin;
+    for (i=r->binCount; i<bins; ++i)
+      SH_INITOBJ(SHIntArray, r->bins[i]);
+    r->binCount = bins;
+  }
+
+  if (!shIntArrayReserveAndCopy(&r->binHeads, r->binCount))
+    return 0;
+  r->binHeads.size = r->binCount;
+
+  b0 = d->y / SH_RASTER_TILE_ROWS;
+  b1 = (d->y + d->height - 1) / SH_RASTER_TILE_ROWS;
+  for (b=b0; b<=b1; ++b) {
+    shIntArrayPushBack(&r->bins[b], index);
+    shIntArrayPushBack(&r->bins[b], 0);
+    r->binHeads.items[b] = r->bins[b].size - 1;
+  }
+
+  /* Cleared bands don't need edges */
+  if (d->type == SH_RASTER_CLEAR)
+    return 1;
+
+  for (i=d->edgeStart; i<d->edgeStart + d->edgeCount; ++i) {
+
+    /* A row more on each side, in case the edge ends up
+       in it after splitting at the sides of the box */
+    e = r->edges.items + 4 * i;
+    y0 = SH_MAX((SHint)SH_FLOOR(SH_MIN(e[1], e[3])) - 1, d->y);
+    y1 = SH_MIN((SHint)SH_CEIL(SH_MAX(e[1], e[3])) + 1, d->y + d->height);
+    if (y0 >= y1) continue;
+
+    for (b=y0 / SH_RASTER_TILE_ROWS; b<=(y1-1) / SH_RASTER_TILE_ROWS; ++b) {
+      shIntArrayPushBack(&r->bins[b], i);
+      head = &r->bins[b].items[r->binHeads.items[b]];
+      (*head)++;
+    }
+  }
+
+  return 1;
+}
+
+/*------------------------------------------------------------
+ * Completes the last recorded draw: rasterizes it right away
+ * with a single thread or bins it for the threads
+ *------------------------------------------------------------*/
+
+static void shRasterSubmit(VGContext *c)
+{
+  SHRaster *r = &c->raster;
+  SHRasterDraw *d = &r->draws.items[r->draws.size - 1];
+
+  if (r->threads > 1 && shRasterBinDraw(c)) {
+    /* Keep memory in check on huge frames */
+    if (r->edges.size > (1 << 24))
+      shRasterFlush(c);
+    return;
+  }
+
+  /* Nothing else binned with a single thread */
+  shRasterRun(c, &r->cells, d, d->y, d->y + d->height, NULL, 0);
+  shRasterDrawArrayClear(&r->draws);
+  shFloatArrayClear(&r->edges);
+  shColorArrayClear(&r->ramps);
+}
+
+/*------------------------------------------------------------
+ * Records a new draw covering the given bounds, clamped to
+ * the surface and the scissor rectangles. Returns NULL if
+ * nothing is left of it.
+ *------------------------------------------------------------*/
+
+static SHRasterDraw* shRasterNewDraw(VGContext *c, SHRectangle *bounds)
+{
+  SHRaster *r = &c->raster;
+  SHRasterDraw d;
+  SHfloat bx0, by0, bx1, by1;
+  SHint x0, y0, x1, y1;
+
+  bx0 = bounds->x;
+  by0 = bounds->y;
+  bx1 = bounds->x + bounds->w;
+  by1 = bounds->y + bounds->h;
+
+  if (c->scissoring == VG_TRUE) {
+    if (c->scissorBands.size == 0) return NULL;
+    bx0 = SH_MAX(bx0, c->scissorBounds.x);
+    by0 = SH_MAX(by0, c->scissorBounds.y);
+    bx1 = SH_MIN(bx1, c->scissorBounds.x + c->scissorBounds.w);
+    by1 = SH_MIN(by1, c->scissorBounds.y + c->scissorBounds.h);
+  }
+
+  x0 = SH_MAX((SHint)SH_FLOOR(bx0), 0);
+  y0 = SH_MAX((SHint)SH_FLOOR(by0), 0);
+  x1 = SH_MIN((SHint)SH_CEIL(bx1), c->surfaceWidth);
+  y1 = SH_MIN((SHint)SH_CEIL(by1), c->surfaceHeight);
+  if (x0 >= x1 || y0 >= y1)
+    return NULL;
+
+  d.type = SH_RASTER_FILL;
+  d.x = x0;
+  d.y = y0;
+  d.width = x1 - x0;
+  d.height = y1 - y0;
+  d.edgeStart = r->edges.size / 4;
+  d.edgeCount = 0;
+  d.fillRule = c->fillRule;
+  d.blendMode = c->blendMode;
+  d.aliased = (c->renderingQuality == VG_RENDERING_QUALITY_NONANTIALIASED);
+  d.masking = (c->masking == VG_TRUE);
+  d.imageQuality = c->imageQuality;
+  d.tileFillColor = c->tileFillColor;
+  d.paintType = VG_PAINT_TYPE_COLOR;
+  CSET(d.color, 0,0,0,1);
+  IDMAT(d.toPaint);
+  d.rampStart = -1;
+  d.spreadMode = VG_COLOR_RAMP_SPREAD_PAD;
+  d.tilingMode = VG_TILE_FILL;
+  d.pattern = NULL;
+  d.image = NULL;
+  IDMAT(d.toImage);
+  d.multiply = 0;
+
+  if (!shRasterDrawArrayPushBackP(&r->draws, &d))
+    return NULL;
+  return &r->draws.items[r->draws.size - 1];
+}
+
+static void shRasterAddEdge(VGContext *c, SHRasterDraw *d,
+                            SHVector2 *a, SHVector2 *b)
+{
+  SHFloatArray *e = &c->raster.edges;
+
+  /* Horizontal edges cover nothing */
+  if (a->y == b->y)
+    return;
+
+  shFloatArrayPushBack(e, a->x);
+  shFloatArrayPushBack(e, a->y);
+  shFloatArrayPushBack(e, b->x);
+  shFloatArrayPushBack(e, b->y);
+  d->edgeCount++;
+}
+
+/*------------------------------------------------------------
+ * Sets up the paint of a draw, with its ramp interpolated
+ * like the ramp textures are
+ *------------------------------------------------------------*/
+
+static void shRasterBuildRamp(VGContext *c, SHRasterDraw *d, SHPaint *p)
+{
+  SHColorArray *ramps = &c->raster.ramps;
+  SHStop defaults[2], *stops, *s1, *s2;
+  SHColor *ramp;
+  SHint count, needed, s, x, x1, x2;
+  SHfloat k;
+
+  stops = p->stops.items;
+  count = p->stops.size;
+
+  /* Black to white like a paint without valid stops */
+  if (count == 0) {
+    defaults[0].offset = 0.0f;
+    CSET(defaults[0].color, 0,0,0,1);
+    defaults[1].offset = 1.0f;
+    CSET(defaults[1].color, 1,1,1,1);
+    stops = defaults;
+    count = 2;
+  }
+
+  needed = ramps->size + SH_GRADIENT_TEX_SIZE;
+  if (needed > ramps->capacity)
+    needed = SH_MAX(needed, 2 * ramps->capacity);
+  if (!shColorArrayReserveAndCopy(ramps, needed)) {
+    d->paintType = VG_PAINT_TYPE_COLOR;
+    d->color = stops[count-1].color;
+    return;
+  }
+
+  d->rampStart = ramps->size;
+  ramps->size += SH_GRADIENT_TEX_SIZE;
+  ramp = ramps->items + d->rampStart;
+
+  ramp[0] = stops[0].color;
+  for (s=1, x1=0; s<count; ++s, x1=x2) {
+    s1 = &stops[s-1];
+    s2 = &stops[s];
+    x2 = (SHint)(s2->offset * (SH_GRADIENT_TEX_SIZE-1));
+    for (x=x1+1; x<=x2; ++x) {
+      k = (SHfloat)(x-x1) / (x2-x1);
+      ramp[x].r = s1->color.r + (s2->color.r - s1->color.r) * k;
+      ramp[x].g = s1->color.g + (s2->color.g - s1->color.g) * k;
+      ramp[x].b = s1->color.b + (s2->color.b - s1->color.b) * k;
+      ramp[x].a = s1->color.a + (s2->color.a - s1->color.a) * k;
+    }
+  }
+}
+
+static void shRasterSetupPaint(VGContext *c, SHRasterDraw *d, SHPaint *p,
+                               SHMatrix3x3 *userToSurface,
+                               SHMatrix3x3 *paintToUser)
+{
+  SHMatrix3x3 m;
+  SHfloat gx, gy, n, cx, cy, fx, fy, fcx, fcy, r;
+
+  d->paintType = p->type;
+  d->color = p->color;
+  d->spreadMode = p->spreadMode;
+  d->tilingMode = p->tilingMode;
+
+  if (p->type == VG_PAINT_TYPE_COLOR)
+    return;
+
+  if (p->type == VG_PAINT_TYPE_PATTERN) {
+    if (p->pattern == VG_INVALID_HANDLE ||
+        !shIsValidImage(c, p->pattern)) {
+      d->paintType = VG_PAINT_TYPE_COLOR;
+      return;
+    }
+    d->pattern = (SHImage*)p->pattern;
+  }
+
+  MULMATMAT((*userToSurface), (*paintToUser), m);
+  if (!shInvertMatrix(&m, &d->toPaint)) {
+    /* Nothing maps back to the paint */
+    d->paintType = VG_PAINT_TYPE_COLOR;
+    if (p->type == VG_PAINT_TYPE_PATTERN)
+      d->color = c->tileFillColor;
+    else if (p->stops.size > 0)
+      d->color = p->stops.items[p->stops.size-1].color;
+    return;
+  }
+
+  switch (p->type) {
+  case VG_PAINT_TYPE_LINEAR_GRADIENT:
+
+    /* Start and direction over its squared length,
+       or the last color if the points coincide */
+    gx = p->linearGradient[2] - p->linearGradient[0];
+    gy = p->linearGradient[3] - p->linearGradient[1];
+    n = gx*gx + gy*gy;
+    d->params[0] = p->linearGradient[0];
+    d->params[1] = p->linearGradient[1];
+    d->params[2] = (n > 0.0f ? gx / n : 0.0f);
+    d->params[3] = (n > 0.0f ? gy / n : 0.0f);
+    d->params[4] = (n > 0.0f ? 0.0f : 1.0f);
+    shRasterBuildRamp(c, d, p);
+    break;
+
+  case VG_PAINT_TYPE_RADIAL_GRADIENT:
+
+    cx = p->radialGradient[0];
+    cy = p->radialGradient[1];
+    fx = p->radialGradient[2];
+    fy = p->radialGradient[3];
+    r = p->radialGradient[4];
+
+    if (r <= 0.0f) {
+      /* Degenerate circle, last color everywhere */
+      d->paintType = VG_PAINT_TYPE_LINEAR_GRADIENT;
+      d->params[0] = d->params[1] = 0.0f;
+      d->params[2] = d->params[3] = 0.0f;
+      d->params[4] = 1.0f;
+      shRasterBuildRamp(c, d, p);
+      break;
+    }
+
+    /* Move focus into circle if outside */
+    fcx = fx - cx;
+    fcy = fy - cy;
+    n = SH_SQRT(fcx*fcx + fcy*fcy);
+    if (n > r) {
+      fcx *= 0.995f * r / n;
+      fcy *= 0.995f * r / n;
+      fx = cx + fcx;
+      fy = cy + fcy;
+    }
+
+    d->params[0] = fx;
+    d->params[1] = fy;
+    d->params[2] = fcx;
+    d->params[3] = fcy;
+    d->params[4] = r*r;
+    d->params[5] = r*r - (fcx*fcx + fcy*fcy);
+    shRasterBuildRamp(c, d, p);
+    break;
+
+  default:
+    break;
+  }
+}
+
+/*------------------------------------------------------------
+ * Transforms the points into the scratch array of the
+ * rasterizer and returns their surface-space bounds
+ *------------------------------------------------------------*/
+
+static int shRasterTransform(VGContext *c, SHMatrix3x3 *m,
+                             SHVector2 *points, SHint stride,
+                             SHint count, SHRectangle *bounds)
+{
+  SHVector2Array *out = &c->raster.points;
+  SHVector2 *p, min, max;
+  SHint i;
+
+  if (count == 0 || !shVector2ArrayReserve(out, count))
+    return 0;
+
+  for (i=0; i<count; ++i) {
+    p = &out->items[i];
+    TRANSFORM2TO((*(SHVector2*)((SHuint8*)points + i * stride)), (*m), (*p));
+  }
+
+  min = max = out->items[0];
+  for (i=1; i<count; ++i) {
+    p = &out->items[i];
+    if (p->x < min.x) min.x = p->x;
+    if (p->y < min.y) min.y = p->y;
+    if (p->x > max.x) max.x = p->x;
+    if (p->y > max.y) max.y = p->y;
+  }
+
+  out->size = count;
+  shRectangleSet(bounds, min.x, min.y, max.x - min.x, max.y - min.y);
+  return 1;
+}
+
+/*------------------------------------------------------------
+ * Path draws, returning 1 if anything was left to submit
+ *------------------------------------------------------------*/
+
+SHint shRasterFillPath(VGContext *c, SHPath *p, SHPaint *paint)
+{
+  SHRasterDraw *d;
+  SHRectangle bounds;
+  SHVector2 *v;
+  SHint start, size, i;
+
+  if (!shRasterTransform(c, &c->pathTransform, &p->vertices.items[0].point,
+                         sizeof(SHVertex), p->vertices.size, &bounds) ||
+      !(d = shRasterNewDraw(c, &bounds)))
+    return 0;
+
+  /* Each contour closed by an edge back to its start */
+  v = c->raster.points.items;
+  for (start=0; start < p->vertices.size; start += size) {
+    size = p->vertices.items[start].flags;
+    for (i=start; i<start+size-1; ++i)
+      shRasterAddEdge(c, d, &v[i], &v[i+1]);
+    shRasterAddEdge(c, d, &v[i], &v[start]);
+  }
+
+  shRasterSetupPaint(c, d, paint, &c->pathTransform, &c->fillTransform);
+  shRasterSubmit(c);
+  return 1;
+}
+
+SHint shRasterStrokePath(VGContext *c, SHPath *p, SHPaint *paint)
+{
+  SHRasterDraw *d;
+  SHRectangle bounds;
+  SHVector2 *v;
+  SHint i;
+
+  if (!shRasterTransform(c, &c->pathTransform, p->stroke.items,
+                         sizeof(SHVector2), p->stroke.size, &bounds) ||
+      !(d = shRasterNewDraw(c, &bounds)))
+    return 0;
+
+  /* Counter-clockwise triangles only, so that
+     overlapping ones never cancel each other */
+  v = c->raster.points.items;
+  for (i=0; i+2<c->raster.points.size; i+=3) {
+    if ((v[i+1].x - v[i].x) * (v[i+2].y - v[i].y) -
+        (v[i+2].x - v[i].x) * (v[i+1].y - v[i].y) >= 0.0f) {
+      shRasterAddEdge(c, d, &v[i], &v[i+1]);
+      shRasterAddEdge(c, d, &v[i+1], &v[i+2]);
+      shRasterAddEdge(c, d, &v[i+2], &v[i]);
+    }else{
+      shRasterAddEdge(c, d, &v[i], &v[i+2]);
+      shRasterAddEdge(c, d, &v[i+2], &v[i+1]);
+      shRasterAddEdge(c, d, &v[i+1], &v[i]);
+    }
+  }
+
+  d->fillRule = VG_NON_ZERO;
+  shRasterSetupPaint(c, d, paint, &c->pathTransform, &c->strokeTransform);
+  shRasterSubmit(c);
+  return 1;
+}
+
+void shRasterDrawImage(VGContext *c, SHImage *i, SHRectangle *bounds)
+{
+  SHRasterDraw *d;
+  SHRectangle box;
+  SHVector2 corners[4], *v;
+  SHPaint *fill;
+  SHMatrix3x3 toImage;
+  SHint k;
+
+  /* Stencil mode is not supported by the OpenGL pipeline either */
+  if (c->imageMode == VG_DRAW_IMAGE_STENCIL)
+    return;
+
+  if (!shInvertMatrix(&c->imageTransform, &toImage))
+    return;
+
+  SET2(corners[0], 0, 0);
+  SET2(corners[1], (SHfloat)i->width, 0);
+  SET2(corners[2], (SHfloat)i->width, (SHfloat)i->height);
+  SET2(corners[3], 0, (SHfloat)i->height);
+
+  if (!shRasterTransform(c, &c->imageTransform, corners,
+                         sizeof(SHVector2), 4, &box) ||
+      !(d = shRasterNewDraw(c, &box)))
+    return;
+
+  v = c->raster.points.items;
+  for (k=0; k<4; ++k)
+    shRasterAddEdge(c, d, &v[k], &v[(k+1)%4]);
+
+  d->fillRule = VG_NON_ZERO;
+  fill = (c->fillPaint ? c->fillPaint : &c->defaultPaint);
+  shRasterSetupPaint(c, d, fill, &c->imageTransform, &c->fillTransform);
+  d->image = i;
+  d->toImage = toImage;
+  d->multiply = (c->imageMode == VG_DRAW_IMAGE_MULTIPLY);
+
+  shRasterSubmit(c);
+}
+
+void shRasterClear(VGContext *c, SHint x, SHint y, SHint width, SHint height)
+{
+  SHRasterDraw *d;
+  SHRectangle bounds;
+
+  shRectangleSet(&bounds, (SHfloat)x, (SHfloat)y,
+                 (SHfloat)width, (SHfloat)height);
+  if (!(d = shRasterNewDraw(c, &bounds)))
+    return;
+
+  /* The scissor bounds only narrow the box, the
+     pixels are still tested against the bands */
+  d->type = SH_RASTER_CLEAR;
+  d->color = c->clearColor;
+  shRasterSubmit(c);
+}
+
+/*------------------------------------------------------------
+ * Backend entry points. The caller has flushed the binned
+ * draws before any of the pixel copies.
+ *------------------------------------------------------------*/
+
+void shRasterDrawPath(VGContext *c, SHPath *p, VGbitfield paintModes,
+                      SHRectangle *bounds)
+{
+  SHPaint *fill, *stroke;
+  SHint drawn = 0;
+
+  fill = (c->fillPaint ? c->fillPaint : &c->defaultPaint);
+  stroke = (c->strokePaint ? c->strokePaint : &c->defaultPaint);
+
+  if (paintModes & VG_FILL_PATH)
+    drawn |= shRasterFillPath(c, p, fill);
+
+  if ((paintModes & VG_STROKE_PATH) && c->strokeLineWidth > 0.0f)
+    drawn |= shRasterStrokePath(c, p, stroke);
+
+  /* Culled if the scissor rectangles left nothing */
+  if (drawn) {
+    SH_COUNT(c, VG_STAT_PATHS_DRAWN_SH, 1);
+  }else if (c->scissoring == VG_TRUE) {
+    SH_COUNT(c, VG_STAT_PATHS_CULLED_SH, 1);
+  }
+}
+
+void shRasterReadPixels(VGContext *c, void *data,
+                        VGImageFormat format, SHint stride,
+                        SHint dataWidth, SHint dataHeight,
+                        SHint dx, SHint dy, SHint sx, SHint sy,
+                        SHint width, SHint height)
+{
+  shCopyPixels((SHuint8*)data, format, stride,
+               c->raster.pixels, shRasterFormat(), c->raster.stride,
+               dataWidth, dataHeight, c->surfaceWidth, c->surfaceHeight,
+               dx, dy, sx, sy, width, height);
+}
+
+void shRasterWritePixels(VGContext *c, const void *data,
+                         VGImageFormat format, SHint stride,
+                         SHint dataWidth, SHint dataHeight,
+                         SHint dx, SHint dy, SHint sx, SHint sy,
+                         SHint width, SHint height)
+{
+  shCopyPixels(c->raster.pixels, shRasterFormat(), c->raster.stride,
+               (const SHuint8*)data, format, stride,
+               c->surfaceWidth, c->surfaceHeight, dataWidth, dataHeight,
+               dx, dy, sx, sy, width, height);
+}
+
+void shRasterCopyPixels(VGContext *c, SHint dx, SHint dy,
+                        SHint sx, SHint sy, SHint width, SHint height)
+{
+  VGImageFormat format = shRasterFormat();
+  SHuint8 *pixels;
+
+  /* Only copy what is inside the surface */
+  if (sx < 0) { dx -= sx; width += sx; sx = 0; }
+  if (sy < 0) { dy -= sy; height += sy; sy = 0; }
+  width = SH_MIN(width, c->surfaceWidth - sx);
+  height = SH_MIN(height, c->surfaceHeight - sy);
+  if (width <= 0 || height <= 0)
+    return;
+
+  /* The areas may overlap, copy through a buffer */
+  pixels = (SHuint8*)malloc(width * height * 4);
+  if (!pixels) {
+    shSetError(c, VG_OUT_OF_MEMORY_ERROR);
+    return;
+  }
+
+  shCopyPixels(pixels, format, -1,
+               c->raster.pixels, format, c->raster.stride,
+               width, height, c->surfaceWidth, c->surfaceHeight,
+               0, 0, sx, sy, width, height);
+  shCopyPixels(c->raster.pixels, format, c->raster.stride,
+               pixels, format, -1,
+               c->surfaceWidth, c->surfaceHeight, width, height,
+               dx, dy, 0, 0, width, height);
+
+  free(pixels);
+}
+
+void shRasterEndFrame(VGContext *c, SHint finish)
+{
+}
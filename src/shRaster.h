@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __SHRASTER_H
+#define __SHRASTER_H
+
+#include "shDefs.h"
+#include "shArrays.h"
+#include "shPath.h"
+#include "shVectors.h"
+#include "shImage.h"
+
+/* Worker threads need POSIX threads */
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_LIBPTHREAD)
+#  define SH_RASTER_THREADS
+#endif
+
+#define SH_RASTER_MAX_THREADS 64
+
+/* Height of the surface bands draws are binned into */
+#define SH_RASTER_TILE_ROWS 16
+
+/*------------------------------------------------------------
+ * Cell accumulation buffer of a thread, holding a cell per
+ * pixel and two guard cells for the rows [row0, row0+rows)
+ * of the box being rasterized. The cells are kept zero
+ * between draws and cleared by the sweep that reads them.
+ *------------------------------------------------------------*/
+
+typedef struct
+{
+  SHint x, y, width, height;
+  SHint row0, rows;
+  SHFloatArray cells;
+  SHIntArray rowSpans;
+
+  /* Coverage and colors of the span being composited */
+  SHFloatArray coverage;
+  SHColorArray colors;
+
+} SHRasterCells;
+
+void SHRasterCells_ctor(SHRasterCells *rc);
+void SHRasterCells_dtor(SHRasterCells *rc);
+
+/*------------------------------------------------------------
+ * A recorded draw with the state it depends on. Its edges
+ * (x0,y0,x1,y1 in surface space) and gradient ramp are kept
+ * in the arrays of the rasterizer.
+ *------------------------------------------------------------*/
+
+#define SH_RASTER_FILL  0
+#define SH_RASTER_CLEAR 1
+
+typedef struct
+{
+  SHint type;
+  SHint x, y, width, height;
+  SHint edgeStart, edgeCount;
+  VGFillRule fillRule;
+  VGBlendMode blendMode;
+  SHint aliased;
+  SHint masking;
+  VGImageQuality imageQuality;
+  SHColor tileFillColor;
+
+  /* Paint, or the clear color */
+  VGPaintType paintType;
+  SHColor color;
+  SHMatrix3x3 toPaint;
+  SHfloat params[6];
+  SHint rampStart;
+  VGColorRampSpreadMode spreadMode;
+  VGTilingMode tilingMode;
+  SHImage *pattern;
+
+  /* Image drawn by vgDrawImage, if any, and
+     whether it is multiplied by the paint */
+  SHImage *image;
+  SHMatrix3x3 toImage;
+  SHint multiply;
+
+} SHRasterDraw;
+
+void SHRasterDraw_ctor(SHRasterDraw *d);
+void SHRasterDraw_dtor(SHRasterDraw *d);
+
+#define _ITEM_T SHRasterDraw
+#define _ARRAY_T SHRasterDrawArray
+#define _FUNC_T shRasterDrawArray
+#define _ARRAY_DECLARE
+#include "shArrayBase.h"
+
+struct SHRasterPool;
+
+/*------------------------------------------------------------
+ * Software rendering target of a context created with
+ * vgCreateSoftwareContextSH (see shRaster.c)
+ *------------------------------------------------------------*/
+
+typedef struct
+{
+  /* Caller's buffer, 4 bytes per pixel in R,G,B,A order,
+     row y starting at pixels + y * stride */
+  SHuint8 *pixels;
+  SHint stride;
+
+  /* Cells of draws rasterized on the calling thread */
+  SHRasterCells cells;
+
+  /* Draws waiting to be rasterized by the threads, with
+     a list of draws and their edges per surface band */
+  SHint threads;
+  SHRasterDrawArray draws;
+  SHFloatArray edges;
+  SHColorArray ramps;
+  SHIntArray *bins;
+  SHIntArray binHeads;
+  SHint binCount;
+  struct SHRasterPool *pool;
+
+  /* Surface-space points of the draw */
+  SHVector2Array points;
+
+} SHRaster;
+
+void SHRaster_ctor(SHRaster *r);
+void SHRaster_dtor(SHRaster *r);
+
+#endif /* __SHRASTER_H */
@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shExtensions.h"
+#include "shContext.h"
+#include "shShader.h"
+#include <string.h>
+
+/*------------------------------------------------------------
+ * Gradient paints are normally drawn as a mesh built on the
+ * CPU with the offsets at its vertices. With OpenGL 2.0 the
+ * offset is computed per pixel instead, so a gradient costs
+ * a single cover quad like a color paint. Spread modes are
+ * left to the wrap mode of the color ramp atlas. Each program
+ * has a variant compiled with SH_MASK defined, which scales
+ * the alpha by the mask texture at the fragment position.
+ *------------------------------------------------------------*/
+
+static const char *shGradientHeader = "#version 110\n";
+static const char *shGradientMaskHeader = "#version 110\n#define SH_MASK\n";
+
+static const char *shGradientVertexSource =
+  "uniform vec3 paintX;\n"
+  "uniform vec3 paintY;\n"
+  "varying vec2 paintCoord;\n"
+  "void main()\n"
+  "{\n"
+  "  vec3 p = vec3(gl_Vertex.xy, 1.0);\n"
+  "  paintCoord = vec2(dot(paintX, p), dot(paintY, p));\n"
+  "  gl_Position = ftransform();\n"
+  "}\n";
+
+#define SH_MASK_DECLARATIONS \
+  "#ifdef SH_MASK\n" \
+  "uniform sampler2D mask;\n" \
+  "uniform vec2 maskScale;\n" \
+  "#endif\n"
+
+#define SH_MASK_STATEMENTS \
+  "#ifdef SH_MASK\n" \
+  "  gl_FragColor.a *= texture2D(mask, gl_FragCoord.xy * maskScale).a;\n" \
+  "#endif\n"
+
+/* Projection onto the gradient vector; 'dir' is
+   divided by its squared length on the CPU */
+static const char *shLinearGradientSource =
+  "uniform sampler2D ramp;\n"
+  "uniform float rampRow;\n"
+  "uniform vec2 start;\n"
+  "uniform vec2 dir;\n"
+  "varying vec2 paintCoord;\n"
+  SH_MASK_DECLARATIONS
+  "void main()\n"
+  "{\n"
+  "  float t = dot(paintCoord - start, dir);\n"
+  "  gl_FragColor = texture2D(ramp, vec2(t, rampRow));\n"
+  SH_MASK_STATEMENTS
+  "}\n";
+
+/* Offset formula from the OpenVG specification with the
+   focus relative to the center in 'fc' and the squared
+   radius and the denominator packed into 'radius' */
+static const char *shRadialGradientSource =
+  "uniform sampler2D ramp;\n"
+  "uniform float rampRow;\n"
+  "uniform vec2 focus;\n"
+  "uniform vec2 fc;\n"
+  "uniform vec2 radius;\n"
+  "varying vec2 paintCoord;\n"
+  SH_MASK_DECLARATIONS
+  "void main()\n"
+  "{\n"
+  "  vec2 d = paintCoord - focus;\n"
+  "  float c = d.x * fc.y - d.y * fc.x;\n"
+  "  float g = dot(d, fc) + sqrt(radius.x * dot(d, d) - c * c);\n"
+  "  gl_FragColor = texture2D(ramp, vec2(g / radius.y, rampRow));\n"
+  SH_MASK_STATEMENTS
+  "}\n";
+
+static const char *shInstanceVertexSource =
+  "attribute vec3 instanceX;\n"
+  "attribute vec3 instanceY;\n"
+  "attribute vec4 instanceColor;\n"
+  "void main()\n"
+  "{\n"
+  "  vec3 p = vec3(gl_Vertex.xy, 1.0);\n"
+  "  gl_Position = gl_ModelViewProjectionMatrix *\n"
+  "    vec4(dot(instanceX, p), dot(instanceY, p), 0.0, 1.0);\n"
+  "  gl_FrontColor = instanceColor;\n"
+  "}\n";
+
+static const char *shInstanceFragmentSource =
+  SH_MASK_DECLARATIONS
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = gl_Color;\n"
+  SH_MASK_STATEMENTS
+  "}\n";
+
+/* Programs of the core-profile renderer (see shGLCore.c).
+   The paint is evaluated the same way as above; images
+   sample unit 0, paints unit 1 and the mask its own unit,
+   with single-channel textures read from red. */
+static const char *shCoreVertexSource =
+  "layout(location = 0) in vec2 position;\n"
+  "uniform vec3 userX;\n"
+  "uniform vec3 userY;\n"
+  "uniform vec3 userW;\n"
+  "uniform vec2 viewScale;\n"
+  "uniform float depth;\n"
+  "uniform vec3 paintX;\n"
+  "uniform vec3 paintY;\n"
+  "out vec2 paintCoord;\n"
+  "#ifdef SH_IMAGE\n"
+  "uniform vec2 imageScale;\n"
+  "out vec2 imageCoord;\n"
+  "#endif\n";
+
+static const char *shCoreVertexMain =
+  "void main()\n"
+  "{\n"
+  "  vec3 p = vec3(position, 1.0);\n"
+  "  vec3 s = vec3(dot(userX, p), dot(userY, p), dot(userW, p));\n"
+  "  paintCoord = vec2(dot(paintX, p), dot(paintY, p));\n"
+  "#ifdef SH_IMAGE\n"
+  "  imageCoord = position * imageScale;\n"
+  "#endif\n"
+  "  gl_Position = vec4(s.xy * viewScale - s.z, depth * s.z, s.z);\n"
+  "}\n";
+
+static const char *shCoreFragmentSource =
+  "in vec2 paintCoord;\n"
+  "out vec4 fragColor;\n"
+  "uniform vec4 color;\n"
+  "#if defined(SH_LINEAR) || defined(SH_RADIAL)\n"
+  "uniform sampler2D ramp;\n"
+  "uniform float rampRow;\n"
+  "#endif\n"
+  "#ifdef SH_LINEAR\n"
+  "uniform vec2 start;\n"
+  "uniform vec2 dir;\n"
+  "#endif\n"
+  "#ifdef SH_RADIAL\n"
+  "uniform vec2 focus;\n"
+  "uniform vec2 fc;\n"
+  "uniform vec2 radius;\n"
+  "#endif\n"
+  "#ifdef SH_PATTERN\n"
+  "uniform sampler2D pattern;\n"
+  "#endif\n"
+  "#ifdef SH_IMAGE\n"
+  "uniform sampler2D image;\n"
+  "in vec2 imageCoord;\n"
+  "#endif\n"
+  "#ifdef SH_MASK\n"
+  "uniform sampler2D mask;\n"
+  "uniform vec2 maskScale;\n"
+  "#endif\n";
+
+static const char *shCoreFragmentMain =
+  "void main()\n"
+  "{\n"
+  "#if defined(SH_LINEAR)\n"
+  "  float t = dot(paintCoord - start, dir);\n"
+  "  fragColor = texture(ramp, vec2(t, rampRow));\n"
+  "#elif defined(SH_RADIAL)\n"
+  "  vec2 d = paintCoord - focus;\n"
+  "  float c = d.x * fc.y - d.y * fc.x;\n"
+  "  float g = dot(d, fc) + sqrt(radius.x * dot(d, d) - c * c);\n"
+  "  fragColor = texture(ramp, vec2(g / radius.y, rampRow));\n"
+  "#elif defined(SH_PATTERN)\n"
+  "  fragColor = texture(pattern, paintCoord);\n"
+  "#else\n"
+  "  fragColor = color;\n"
+  "#endif\n";
+
+static const char *shCoreFragmentEnd =
+  "#ifdef SH_IMAGE\n"
+  "  fragColor *= texture(image, imageCoord);\n"
+  "#endif\n"
+  "#ifdef SH_MASK\n"
+  "  fragColor.a *= texture(mask, gl_FragCoord.xy * maskScale).r;\n"
+  "#endif\n"
+  "}\n";
+
+static const char *shLinearGradientParams[SH_GRADIENT_PARAMS] =
+  { "start", "dir", NULL };
+
+static const char *shRadialGradientParams[SH_GRADIENT_PARAMS] =
+  { "focus", "fc", "radius" };
+
+void SHGradientProgram_ctor(SHGradientProgram *g)
+{
+  int i;
+  
+  g->program = 0;
+  g->paintX = -1;
+  g->paintY = -1;
+  g->ramp = -1;
+  g->rampRow = -1;
+  g->mask = -1;
+  g->maskScale = -1;
+  for (i=0; i<SH_GRADIENT_PARAMS; ++i)
+    g->params[i] = -1;
+}
+
+void SHGradientProgram_dtor(SHGradientProgram *g)
+{
+}
+
+void SHInstanceProgram_ctor(SHInstanceProgram *g)
+{
+  g->program = 0;
+  g->instanceX = -1;
+  g->instanceY = -1;
+  g->instanceColor = -1;
+  g->mask = -1;
+  g->maskScale = -1;
+}
+
+void SHInstanceProgram_dtor(SHInstanceProgram *g)
+{
+}
+
+void SHCoreProgram_ctor(SHCoreProgram *g)
+{
+  int i;
+  
+  g->state = 0;
+  g->program = 0;
+  g->userX = -1;
+  g->userY = -1;
+  g->userW = -1;
+  g->viewScale = -1;
+  g->depth = -1;
+  g->paintX = -1;
+  g->paintY = -1;
+  g->color = -1;
+  g->rampRow = -1;
+  g->imageScale = -1;
+  g->maskScale = -1;
+  for (i=0; i<SH_GRADIENT_PARAMS; ++i)
+    g->params[i] = -1;
+}
+
+void SHCoreProgram_dtor(SHCoreProgram *g)
+{
+}
+
+static GLuint shCompileShaderStrings(VGContext *context, GLenum type,
+                                     const char **strings, GLsizei count)
+{
+  GLuint shader;
+  GLint status = GL_FALSE;
+  
+  shader = glCreateShader(type);
+  if (shader == 0) return 0;
+  
+  glShaderSource(shader, count, (const GLchar**)strings, NULL);
+  glCompileShader(shader);
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  
+  if (status != GL_TRUE) {
+    glDeleteShader(shader);
+    return 0;
+  }
+  
+  return shader;
+}
+
+static GLuint shCompileShader(VGContext *context, GLenum type,
+                              const char *header, const char *source)
+{
+  const char *strings[2];
+  
+  strings[0] = header;
+  strings[1] = source;
+  return shCompileShaderStrings(context, type, strings, 2);
+}
+
+static int shLinkGradientProgram(VGContext *context, SHGradientProgram *g,
+                                 GLuint vertex, const char *header,
+                                 const char *source, const char **params)
+{
+  GLuint fragment;
+  GLint status = GL_FALSE;
+  int i;
+  
+  fragment = shCompileShader(context, GL_FRAGMENT_SHADER, header, source);
+  if (fragment == 0) return 0;
+  
+  g->program = glCreateProgram();
+  if (g->program == 0) {
+    glDeleteShader(fragment);
+    return 0;
+  }
+  
+  /* Shaders are flagged for deletion and go
+     away together with the program */
+  glAttachShader(g->program, vertex);
+  glAttachShader(g->program, fragment);
+  glLinkProgram(g->program);
+  glDeleteShader(fragment);
+  
+  glGetProgramiv(g->program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) return 0;
+  
+  g->paintX = glGetUniformLocation(g->program, "paintX");
+  g->paintY = glGetUniformLocation(g->program, "paintY");
+  g->ramp = glGetUniformLocation(g->program, "ramp");
+  g->rampRow = glGetUniformLocation(g->program, "rampRow");
+  g->mask = glGetUniformLocation(g->program, "mask");
+  g->maskScale = glGetUniformLocation(g->program, "maskScale");
+  for (i=0; i<SH_GRADIENT_PARAMS; ++i)
+    if (params[i] != NULL)
+      g->params[i] = glGetUniformLocation(g->program, params[i]);
+  
+  return 1;
+}
+
+/*------------------------------------------------------------
+ * Builds the gradient programs on first use and returns
+ * whether they can be used in this context. A failure is
+ * remembered so the fixed-function meshes are used from
+ * then on without retrying.
+ *------------------------------------------------------------*/
+
+SHint shLoadGradientPrograms(VGContext *context)
+{
+  GLuint vertex;
+  int ok;
+  
+  if (context->gradientProgramsState != 0)
+    return (context->gradientProgramsState > 0);
+  
+  context->gradientProgramsState = -1;
+  if (!context->isGLAvailable_Shaders)
+    return 0;
+  
+  vertex = shCompileShader(context, GL_VERTEX_SHADER, shGradientHeader,
+                           shGradientVertexSource);
+  if (vertex == 0) return 0;
+  
+  ok = shLinkGradientProgram(context, &context->linearProgram, vertex,
+                             shGradientHeader, shLinearGradientSource,
+                             shLinearGradientParams);
+  if (ok)
+    ok = shLinkGradientProgram(context, &context->radialProgram, vertex,
+                               shGradientHeader, shRadialGradientSource,
+                               shRadialGradientParams);
+  if (ok)
+    ok = shLinkGradientProgram(context, &context->linearMaskProgram, vertex,
+                               shGradientMaskHeader, shLinearGradientSource,
+                               shLinearGradientParams);
+  if (ok)
+    ok = shLinkGradientProgram(context, &context->radialMaskProgram, vertex,
+                               shGradientMaskHeader, shRadialGradientSource,
+                               shRadialGradientParams);
+  glDeleteShader(vertex);
+  
+  if (!ok) {
+    shDeleteGradientPrograms(context);
+    context->gradientProgramsState = -1;
+    return 0;
+  }
+  
+  context->gradientProgramsState = 1;
+  return 1;
+}
+
+void shDeleteGradientPrograms(VGContext *context)
+{
+  if (context->linearProgram.program)
+    glDeleteProgram(context->linearProgram.program);
+  if (context->radialProgram.program)
+    glDeleteProgram(context->radialProgram.program);
+  if (context->linearMaskProgram.program)
+    glDeleteProgram(context->linearMaskProgram.program);
+  if (context->radialMaskProgram.program)
+    glDeleteProgram(context->radialMaskProgram.program);
+  
+  SHGradientProgram_ctor(&context->linearProgram);
+  SHGradientProgram_ctor(&context->radialProgram);
+  SHGradientProgram_ctor(&context->linearMaskProgram);
+  SHGradientProgram_ctor(&context->radialMaskProgram);
+  context->gradientProgramsState = 0;
+}
+
+static int shLinkInstanceProgram(VGContext *context, SHInstanceProgram *g,
+                                 const char *header)
+{
+  GLuint vertex, fragment;
+  GLint status = GL_FALSE;
+  
+  vertex = shCompileShader(context, GL_VERTEX_SHADER, header,
+                           shInstanceVertexSource);
+  fragment = shCompileShader(context, GL_FRAGMENT_SHADER, header,
+                             shInstanceFragmentSource);
+  
+  if (vertex != 0 && fragment != 0)
+    g->program = glCreateProgram();
+  
+  if (g->program != 0) {
+    glAttachShader(g->program, vertex);
+    glAttachShader(g->program, fragment);
+    glLinkProgram(g->program);
+    glGetProgramiv(g->program, GL_LINK_STATUS, &status);
+  }
+  
+  if (vertex) glDeleteShader(vertex);
+  if (fragment) glDeleteShader(fragment);
+  if (status != GL_TRUE) return 0;
+  
+  g->instanceX = glGetAttribLocation(g->program, "instanceX");
+  g->instanceY = glGetAttribLocation(g->program, "instanceY");
+  g->instanceColor = glGetAttribLocation(g->program, "instanceColor");
+  g->mask = glGetUniformLocation(g->program, "mask");
+  g->maskScale = glGetUniformLocation(g->program, "maskScale");
+  
+  return (g->instanceX >= 0 && g->instanceY >= 0 &&
+          g->instanceColor >= 0);
+}
+
+/*------------------------------------------------------------
+ * Builds the instancing programs on first use, the same way
+ * as the gradient programs
+ *------------------------------------------------------------*/
+
+SHint shLoadInstancePrograms(VGContext *context)
+{
+  int ok;
+  
+  if (context->instanceProgramsState != 0)
+    return (context->instanceProgramsState > 0);
+  
+  context->instanceProgramsState = -1;
+  if (!context->isGLAvailable_Instancing)
+    return 0;
+  
+  ok = shLinkInstanceProgram(context, &context->instanceProgram,
+                             shGradientHeader);
+  if (ok)
+    ok = shLinkInstanceProgram(context, &context->instanceMaskProgram,
+                               shGradientMaskHeader);
+  
+  if (!ok) {
+    shDeleteInstancePrograms(context);
+    context->instanceProgramsState = -1;
+    return 0;
+  }
+  
+  context->instanceProgramsState = 1;
+  return 1;
+}
+
+void shDeleteInstancePrograms(VGContext *context)
+{
+  if (context->instanceProgram.program)
+    glDeleteProgram(context->instanceProgram.program);
+  if (context->instanceMaskProgram.program)
+    glDeleteProgram(context->instanceMaskProgram.program);
+  
+  SHInstanceProgram_ctor(&context->instanceProgram);
+  SHInstanceProgram_ctor(&context->instanceMaskProgram);
+  context->instanceProgramsState = 0;
+}
+
+/*------------------------------------------------------------
+ * Builds a variant of the core-profile program on first use
+ * and returns it, or NULL if it failed to build, which is
+ * remembered like for the programs above.
+ *------------------------------------------------------------*/
+
+SHCoreProgram* shLoadCoreProgram(VGContext *context, SHint variant)
+{
+  SHCoreProgram *g = &context->corePrograms[variant];
+  const char **params = shLinearGradientParams;
+  const char *strings[4];
+  char header[128];
+  GLuint vertex, fragment;
+  GLint status = GL_FALSE;
+  int i;
+  
+  if (g->state != 0)
+    return (g->state > 0 ? g : NULL);
+  
+  g->state = -1;
+  
+  strcpy(header, "#version 330 core\n");
+  switch (variant & 3) {
+  case SH_CORE_PAINT_LINEAR:
+    strcat(header, "#define SH_LINEAR\n"); break;
+  case SH_CORE_PAINT_RADIAL:
+    strcat(header, "#define SH_RADIAL\n");
+    params = shRadialGradientParams; break;
+  case SH_CORE_PAINT_PATTERN:
+    strcat(header, "#define SH_PATTERN\n"); break;
+  }
+  if (variant & SH_CORE_IMAGE)
+    strcat(header, "#define SH_IMAGE\n");
+  if (variant & SH_CORE_MASK)
+    strcat(header, "#define SH_MASK\n");
+  
+  strings[0] = header;
+  strings[1] = shCoreVertexSource;
+  strings[2] = shCoreVertexMain;
+  vertex = shCompileShaderStrings(context, GL_VERTEX_SHADER, strings, 3);
+  strings[1] = shCoreFragmentSource;
+  strings[2] = shCoreFragmentMain;
+  strings[3] = shCoreFragmentEnd;
+  fragment = shCompileShaderStrings(context, GL_FRAGMENT_SHADER, strings, 4);
+  
+  if (vertex != 0 && fragment != 0)
+    g->program = glCreateProgram();
+  
+  if (g->program != 0) {
+    glAttachShader(g->program, vertex);
+    glAttachShader(g->program, fragment);
+    glLinkProgram(g->program);
+    glGetProgramiv(g->program, GL_LINK_STATUS, &status);
+  }
+  
+  if (vertex) glDeleteShader(vertex);
+  if (fragment) glDeleteShader(fragment);
+  
+  if (status != GL_TRUE) {
+    if (g->program) glDeleteProgram(g->program);
+    SHCoreProgram_ctor(g);
+    g->state = -1;
+    return NULL;
+  }
+  
+  g->userX = glGetUniformLocation(g->program, "userX");
+  g->userY = glGetUniformLocation(g->program, "userY");
+  g->userW = glGetUniformLocation(g->program, "userW");
+  g->viewScale = glGetUniformLocation(g->program, "viewScale");
+  g->depth = glGetUniformLocation(g->program, "depth");
+  g->paintX = glGetUniformLocation(g->program, "paintX");
+  g->paintY = glGetUniformLocation(g->program, "paintY");
+  g->color = glGetUniformLocation(g->program, "color");
+  g->rampRow = glGetUniformLocation(g->program, "rampRow");
+  g->imageScale = glGetUniformLocation(g->program, "imageScale");
+  g->maskScale = glGetUniformLocation(g->program, "maskScale");
+  for (i=0; i<SH_GRADIENT_PARAMS; ++i)
+    if (params[i] != NULL)
+      g->params[i] = glGetUniformLocation(g->program, params[i]);
+  
+  /* Samplers stay on their units for good */
+  shGLUseProgram(context, g->program);
+  glUniform1i(glGetUniformLocation(g->program, "image"), 0);
+  glUniform1i(glGetUniformLocation(g->program, "ramp"), 1);
+  glUniform1i(glGetUniformLocation(g->program, "pattern"), 1);
+  glUniform1i(glGetUniformLocation(g->program, "mask"),
+              SH_MASK_TEXTURE_UNIT - GL_TEXTURE0);
+  
+  g->state = 1;
+  return g;
+}
+
+void shDeleteCorePrograms(VGContext *context)
+{
+  int i;
+  
+  for (i=0; i<SH_CORE_PROGRAMS; ++i) {
+    if (context->corePrograms[i].program)
+      glDeleteProgram(context->corePrograms[i].program);
+    SHCoreProgram_ctor(&context->corePrograms[i]);
+  }
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+#ifndef __SHSHADER_H
+#define __SHSHADER_H
+
+#include "shDefs.h"
+
+/*------------------------------------------------------------
+ * GLSL program evaluating a gradient paint per pixel. The
+ * vertex stage maps user space to paint space through the
+ * two rows of the inverse paint matrix, the fragment stage
+ * turns the paint-space position into a color ramp offset.
+ *------------------------------------------------------------*/
+
+#define SH_GRADIENT_PARAMS 3
+
+typedef struct
+{
+  GLuint program;
+  GLint paintX;
+  GLint paintY;
+  GLint ramp;
+  GLint rampRow;
+  GLint mask;
+  GLint maskScale;
+  GLint params[SH_GRADIENT_PARAMS];
+  
+} SHGradientProgram;
+
+void SHGradientProgram_ctor(SHGradientProgram *g);
+void SHGradientProgram_dtor(SHGradientProgram *g);
+
+/*------------------------------------------------------------
+ * GLSL program drawing all the instances of an instanced
+ * fill at once. The rows of the user-to-surface matrix and
+ * the color of each instance come in vertex attributes that
+ * advance once per instance.
+ *------------------------------------------------------------*/
+
+typedef struct
+{
+  GLuint program;
+  GLint instanceX;
+  GLint instanceY;
+  GLint instanceColor;
+  GLint mask;
+  GLint maskScale;
+  
+} SHInstanceProgram;
+
+void SHInstanceProgram_ctor(SHInstanceProgram *g);
+void SHInstanceProgram_dtor(SHInstanceProgram *g);
+
+/*------------------------------------------------------------
+ * GLSL 3.30 program of the core-profile renderer. Every
+ * variant maps user space to the surface through the rows of
+ * the user-to-surface matrix and to paint space through the
+ * rows of the inverse paint matrix; the variant index is the
+ * paint kind plus the SH_CORE_IMAGE and SH_CORE_MASK flags.
+ *------------------------------------------------------------*/
+
+#define SH_CORE_PAINT_COLOR   0
+#define SH_CORE_PAINT_LINEAR  1
+#define SH_CORE_PAINT_RADIAL  2
+#define SH_CORE_PAINT_PATTERN 3
+#define SH_CORE_IMAGE         4
+#define SH_CORE_MASK          8
+#define SH_CORE_PROGRAMS      16
+
+typedef struct
+{
+  SHint state;
+  GLuint program;
+  GLint userX;
+  GLint userY;
+  GLint userW;
+  GLint viewScale;
+  GLint depth;
+  GLint paintX;
+  GLint paintY;
+  GLint color;
+  GLint rampRow;
+  GLint imageScale;
+  GLint maskScale;
+  GLint params[SH_GRADIENT_PARAMS];
+  
+} SHCoreProgram;
+
+void SHCoreProgram_ctor(SHCoreProgram *g);
+void SHCoreProgram_dtor(SHCoreProgram *g);
+
+#endif /* __SHSHADER_H */
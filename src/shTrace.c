@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shContext.h"
+#include <stdio.h>
+
+#if !defined(WIN32)
+#  include <sys/time.h>
+#endif
+
+/*------------------------------------------------------------
+ * Trace events: the pipeline opens and closes named scopes
+ * around its stages (SH_TRACE_BEGIN / SH_TRACE_END), which
+ * are handed with a timestamp in microseconds to the sink set
+ * by vgTraceCallbackSH. vgTraceFileSH installs a sink writing
+ * them to a file in the Chrome trace-event JSON format, which
+ * chrome://tracing and Perfetto load directly.
+ *------------------------------------------------------------*/
+
+static double shTraceTime(void)
+{
+#if defined(WIN32)
+  LARGE_INTEGER count, frequency;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return (double)count.QuadPart * 1000000.0 / (double)frequency.QuadPart;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec * 1000000.0 + (double)tv.tv_usec;
+#endif
+}
+
+void shTraceEvent(VGContext *c, const char *name, VGboolean begin)
+{
+  c->traceCallback(c->traceUserData, name, begin, shTraceTime());
+}
+
+/*------------------------------------------------------------
+ * Built-in sink writing a JSON array of duration events,
+ * timed from the moment the file was opened
+ *------------------------------------------------------------*/
+
+typedef struct
+{
+  FILE *file;
+  double start;
+  SHint events;
+
+} SHTraceFile;
+
+static void shWriteTraceEvent(void *userData, const char *name,
+                              VGboolean begin, double microseconds)
+{
+  SHTraceFile *t = (SHTraceFile*)userData;
+
+  fprintf(t->file, "%s\n{\"name\":\"%s\",\"cat\":\"OpenVG\",\"ph\":\"%c\","
+          "\"ts\":%.3f,\"pid\":1,\"tid\":1}", t->events > 0 ? "," : "",
+          name, begin ? 'B' : 'E', microseconds - t->start);
+
+  t->events++;
+}
+
+/*------------------------------------------------------------
+ * Closes the array and the file of the built-in sink if it
+ * is installed, and removes the current sink
+ *------------------------------------------------------------*/
+
+void shCloseTrace(VGContext *c)
+{
+  SHTraceFile *t;
+
+  if (c->traceCallback == shWriteTraceEvent) {
+    t = (SHTraceFile*)c->traceUserData;
+    fprintf(t->file, "\n]\n");
+    fclose(t->file);
+    free(t);
+  }
+
+  c->traceCallback = NULL;
+  c->traceUserData = NULL;
+}
+
+VG_API_CALL void vgTraceCallbackSH(VGTraceCallbackSH callback, void *userData)
+{
+  VG_GETCONTEXT(VG_NO_RETVAL);
+
+  shCloseTrace(context);
+  context->traceCallback = callback;
+  context->traceUserData = (callback ? userData : NULL);
+
+  VG_RETURN(VG_NO_RETVAL);
+}
+
+/*------------------------------------------------------------
+ * Starts writing the trace events to the given file, or stops
+ * and completes the file being written when NULL is passed.
+ * Returns VG_FALSE if the file can't be opened or the library
+ * was built without tracing.
+ *------------------------------------------------------------*/
+
+VG_API_CALL VGboolean vgTraceFileSH(const char *filename)
+{
+#if !defined(SH_DISABLE_TRACING)
+  SHTraceFile *t;
+#endif
+  VG_GETCONTEXT(VG_FALSE);
+
+  shCloseTrace(context);
+  if (!filename)
+    VG_RETURN(VG_TRUE);
+
+#if defined(SH_DISABLE_TRACING)
+  VG_RETURN(VG_FALSE);
+#else
+  t = (SHTraceFile*)malloc(sizeof(SHTraceFile));
+  VG_RETURN_ERR_IF(!t, VG_OUT_OF_MEMORY_ERROR, VG_FALSE);
+
+  t->file = fopen(filename, "w");
+  if (!t->file) {
+    free(t);
+    VG_RETURN(VG_FALSE);
+  }
+
+  fprintf(t->file, "[");
+  t->start = shTraceTime();
+  t->events = 0;
+
+  context->traceCallback = shWriteTraceEvent;
+  context->traceUserData = t;
+
+  VG_RETURN(VG_TRUE);
+#endif
+}
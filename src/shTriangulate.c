@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2007 Ivan Leben
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file COPYING;
+ * if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#define VG_API_EXPORT
+#include "openvg.h"
+#include "shDefs.h"
+#include "shPath.h"
+#include "shTriangulate.h"
+
+/*-----------------------------------------------------------
+ * Triangulation of the path tessellation into a mesh of
+ * non-overlapping triangles under a given fill rule.
+ *
+ * The plane is cut into horizontal slabs at every vertex y.
+ * Inside a slab no vertex is met, so the edges crossing it
+ * can be ordered by x and the filled spans between them
+ * found by accumulating the winding number. Where two edges
+ * intersect inside a slab the slab is cut again at the
+ * intersection. Spans bounded by the same pair of edges in
+ * consecutive slabs are merged into a single trapezoid,
+ * which is finally output as two triangles.
+ *-----------------------------------------------------------*/
+
+/* Relative slab height below which an intersection
+   of two edges is considered to lie on the slab bottom */
+#define SH_TRIANGULATE_EPSILON 1e-5f
+
+typedef struct
+{
+  SHfloat x0, y0;  /* lower end */
+  SHfloat x1, y1;  /* upper end */
+  SHfloat dxdy;
+  SHint winding;
+  
+} SHEdge;
+
+typedef struct
+{
+  SHint edge;
+  SHfloat xa, xb;  /* x at the bottom and top of the slab */
+  
+} SHActiveEdge;
+
+typedef struct
+{
+  SHint left, right;
+  SHfloat y;
+  SHfloat xl, xr;
+  
+} SHTrapezoid;
+
+/* Edges and trapezoids arrays */
+#define _ITEM_T SHEdge
+#define _ARRAY_T SHEdgeArray
+#define _FUNC_T shEdgeArray
+#define _COMPARE_T(a,b) 0
+#define _ARRAY_DECLARE
+#define _ARRAY_DEFINE
+#include "shArrayBase.h"
+
+#define _ITEM_T SHTrapezoid
+#define _ARRAY_T SHTrapezoidArray
+#define _FUNC_T shTrapezoidArray
+#define _COMPARE_T(a,b) 0
+#define _ARRAY_DECLARE
+#define _ARRAY_DEFINE
+#include "shArrayBase.h"
+
+static SHfloat shEdgeX(SHEdge *e, SHfloat y)
+{
+  if (y <= e->y0) return e->x0;
+  if (y >= e->y1) return e->x1;
+  return e->x0 + (y - e->y0) * e->dxdy;
+}
+
+static int shCompareFloats(const void *a, const void *b)
+{
+  SHfloat fa = *(const SHfloat*)a;
+  SHfloat fb = *(const SHfloat*)b;
+  return (fa < fb ? -1 : (fa > fb ? 1 : 0));
+}
+
+static int shCompareEdgesByY(const void *a, const void *b)
+{
+  SHfloat ya = ((const SHEdge*)a)->y0;
+  SHfloat yb = ((const SHEdge*)b)->y0;
+  return (ya < yb ? -1 : (ya > yb ? 1 : 0));
+}
+
+static int shCompareActiveByX(const void *a, const void *b)
+{
+  const SHActiveEdge *ea = (const SHActiveEdge*)a;
+  const SHActiveEdge *eb = (const SHActiveEdge*)b;
+  
+  /* Edges meeting at the slab bottom are
+     ordered by where they leave the slab */
+  if (ea->xa != eb->xa) return (ea->xa < eb->xa ? -1 : 1);
+  if (ea->xb != eb->xb) return (ea->xb < eb->xb ? -1 : 1);
+  return 0;
+}
+
+/*-----------------------------------------------------------
+ * Outputs a trapezoid from its bottom at y0 up to y1
+ *-----------------------------------------------------------*/
+
+static void shEmitTrapezoid(SHPath *p, SHEdge *edges,
+                            SHTrapezoid *t, SHfloat y1)
+{
+  SHVector2 v[4];
+  SHfloat xl1, xr1;
+  
+  if (y1 <= t->y) return;
+  
+  xl1 = shEdgeX(&edges[t->left], y1);
+  xr1 = shEdgeX(&edges[t->right], y1);
+  SET2(v[0], t->xl, t->y);
+  SET2(v[1], t->xr, t->y);
+  SET2(v[2], xr1, y1);
+  SET2(v[3], xl1, y1);
+  
+  if (t->xr > t->xl) {
+    shVector2ArrayPushBackP(&p->triangles, &v[0]);
+    shVector2ArrayPushBackP(&p->triangles, &v[1]);
+    shVector2ArrayPushBackP(&p->triangles, &v[2]);
+  }
+  
+  if (xr1 > xl1) {
+    shVector2ArrayPushBackP(&p->triangles, &v[0]);
+    shVector2ArrayPushBackP(&p->triangles, &v[2]);
+    shVector2ArrayPushBackP(&p->triangles, &v[3]);
+  }
+}
+
+/*-----------------------------------------------------------
+ * Finds the filled spans between active edges inside the
+ * slab from y0 to y1 (in which the edges are known not to
+ * cross) and continues or opens trapezoids for them.
+ *-----------------------------------------------------------*/
+
+static void shFillSlab(SHPath *p, SHEdge *edges,
+                       SHActiveEdge *active, SHint activeCount,
+                       SHfloat y0, SHfloat y1, VGFillRule rule,
+                       SHTrapezoidArray *open, SHTrapezoidArray *next)
+{
+  SHint i, j, w = 0, left = -1;
+  SHint inside, wasInside = 0;
+  SHTrapezoid t;
+  
+  shTrapezoidArrayClear(next);
+  
+  for (i=0; i<activeCount; ++i) {
+    
+    w += edges[active[i].edge].winding;
+    inside = (rule == VG_EVEN_ODD ? (w & 1) : (w != 0));
+    
+    if (inside && !wasInside) {
+      left = i;
+      
+    }else if (!inside && wasInside) {
+      
+      /* Continue an open trapezoid bounded by same edges */
+      for (j=0; j<open->size; ++j)
+        if (open->items[j].left == active[left].edge &&
+            open->items[j].right == active[i].edge) break;
+      
+      if (j < open->size) {
+        t = open->items[j];
+        open->items[j].left = -1;
+      }else{
+        t.left = active[left].edge;
+        t.right = active[i].edge;
+        t.y = y0;
+        t.xl = active[left].xa;
+        t.xr = active[i].xa;
+      }
+      
+      shTrapezoidArrayPushBackP(next, &t);
+    }
+    
+    wasInside = inside;
+  }
+  
+  /* Close trapezoids that did not continue */
+  for (j=0; j<open->size; ++j)
+    if (open->items[j].left != -1)
+      shEmitTrapezoid(p, edges, &open->items[j], y0);
+}
+
+/*-----------------------------------------------------------
+ * Sweeps the slabs between the sorted vertex y coordinates
+ *-----------------------------------------------------------*/
+
+static void shSweepSlabs(SHPath *p, SHEdgeArray *edges, SHFloatArray *ys,
+                         SHActiveEdge *active, VGFillRule rule)
+{
+  SHTrapezoidArray open, next, tmp;
+  SHActiveEdge swap;
+  SHint activeCount = 0;
+  SHint i, j, k, e, swapped;
+  SHfloat y0, y1, ya, yc, yx, d0, d1;
+  
+  SH_INITOBJ(SHTrapezoidArray, open);
+  SH_INITOBJ(SHTrapezoidArray, next);
+  
+  for (k=0, e=0; k+1<ys->size; ++k) {
+    
+    y0 = ys->items[k];
+    y1 = ys->items[k+1];
+    
+    /* Update active edge list */
+    for (i=0, j=0; i<activeCount; ++i)
+      if (edges->items[active[i].edge].y1 > y0) active[j++] = active[i];
+    activeCount = j;
+    
+    while (e < edges->size && edges->items[e].y0 <= y0) {
+      if (edges->items[e].y1 > y0) active[activeCount++].edge = e;
+      ++e;
+    }
+    
+    /* Walk the slab, cutting it where edges intersect */
+    ya = y0;
+    while (ya < y1) {
+      
+      for (i=0; i<activeCount; ++i) {
+        active[i].xa = shEdgeX(&edges->items[active[i].edge], ya);
+        active[i].xb = shEdgeX(&edges->items[active[i].edge], y1);
+      }
+      
+      qsort(active, activeCount, sizeof(SHActiveEdge), shCompareActiveByX);
+      
+      /* Neighbours that cross right at the bottom (within
+         rounding error) are swapped into their upper order */
+      do {
+        swapped = 0;
+        for (i=0; i+1<activeCount; ++i) {
+          d1 = active[i+1].xb - active[i].xb;
+          if (d1 >= 0.0f) continue;
+          d0 = active[i+1].xa - active[i].xa;
+          yx = ya + (y1 - ya) * (d0 / (d0 - d1));
+          if (d0 <= (d0 - d1) * SH_TRIANGULATE_EPSILON || yx <= ya) {
+            swap = active[i]; active[i] = active[i+1]; active[i+1] = swap;
+            swapped = 1;
+          }
+        }
+      } while (swapped);
+      
+      /* Lowest crossing of neighbouring edges */
+      yc = y1;
+      for (i=0; i+1<activeCount; ++i) {
+        d1 = active[i+1].xb - active[i].xb;
+        if (d1 >= 0.0f) continue;
+        d0 = active[i+1].xa - active[i].xa;
+        yx = ya + (y1 - ya) * (d0 / (d0 - d1));
+        if (yx < yc) yc = yx;
+      }
+      
+      shFillSlab(p, edges->items, active, activeCount,
+                 ya, yc, rule, &open, &next);
+      
+      tmp = open; open = next; next = tmp;
+      ya = yc;
+    }
+  }
+  
+  /* Close what is left open at the top */
+  for (j=0; j<open.size; ++j)
+    shEmitTrapezoid(p, edges->items, &open.items[j], ys->items[ys->size-1]);
+  
+  SH_DEINITOBJ(SHTrapezoidArray, open);
+  SH_DEINITOBJ(SHTrapezoidArray, next);
+}
+
+/*-----------------------------------------------------------
+ * Builds p->triangles from p->vertices
+ *-----------------------------------------------------------*/
+
+void shTriangulatePath(SHPath *p, VGFillRule rule)
+{
+  SHEdgeArray edges;
+  SHFloatArray ys;
+  SHActiveEdge *active = NULL;
+  SHint start, size, i, j;
+  SHVector2 *a, *b;
+  SHEdge edge;
+  
+  shVector2ArrayClear(&p->triangles);
+  if (p->vertices.size < 3) return;
+  
+  SH_INITOBJ(SHEdgeArray, edges);
+  SH_INITOBJ(SHFloatArray, ys);
+  
+  /* Collect non-horizontal edges of all the
+     (implicitly closed) contours */
+  for (start=0; start<p->vertices.size; start+=size) {
+    size = p->vertices.items[start].flags;
+    for (i=0; i<size; ++i) {
+      
+      a = &p->vertices.items[start + i].point;
+      b = &p->vertices.items[start + (i+1) % size].point;
+      shFloatArrayPushBack(&ys, a->y);
+      if (a->y == b->y) continue;
+      
+      if (a->y < b->y) {
+        edge.x0 = a->x; edge.y0 = a->y;
+        edge.x1 = b->x; edge.y1 = b->y;
+        edge.winding = 1;
+      }else{
+        edge.x0 = b->x; edge.y0 = b->y;
+        edge.x1 = a->x; edge.y1 = a->y;
+        edge.winding = -1;
+      }
+      
+      edge.dxdy = (edge.x1 - edge.x0) / (edge.y1 - edge.y0);
+      shEdgeArrayPushBackP(&edges, &edge);
+    }
+  }
+  
+  if (edges.size >= 2 && !edges.outofmemory && !ys.outofmemory)
+    active = (SHActiveEdge*)malloc(edges.size * sizeof(SHActiveEdge));
+  
+  if (active) {
+    
+    /* Sort slab boundaries (removing duplicates)
+       and edges by their lower end */
+    qsort(ys.items, ys.size, sizeof(SHfloat), shCompareFloats);
+    for (i=1, j=0; i<ys.size; ++i)
+      if (ys.items[i] != ys.items[j]) ys.items[++j] = ys.items[i];
+    ys.size = j+1;
+    
+    qsort(edges.items, edges.size, sizeof(SHEdge), shCompareEdgesByY);
+    shSweepSlabs(p, &edges, &ys, active, rule);
+    free(active);
+  }
+  
+  SH_DEINITOBJ(SHEdgeArray, edges);
+  SH_DEINITOBJ(SHFloatArray, ys);
+}